@@ -0,0 +1,390 @@
+#pragma once
+#if !defined(__cpp_impl_coroutine) || !__has_include(<coroutine>)
+#error "AsyncAcquisition.h requires C++20 coroutines"
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "SampleBlock.h"
+#include "SensorEMG.h"
+
+// ==== Асинхронное чтение датчиков на корутинах (C++20) ====
+//
+// Вместо потока с опросом и sleep на каждого потребителя (как emg_thread) — корутины на общем
+// исполнителе:
+//
+//     EmgExecutor executor(2);
+//     SensorStream stream(sensor, executor);
+//     executor.spawn([](BlockSubscription sub) -> EmgTask {
+//         while (SampleBlockRef block = co_await sub.nextBlock()) { ... }
+//     }(stream.subscribe()));
+//     stream.start();
+//
+// Поток чтения датчика (SensorStream, один на датчик) ждёт данные в read() транспорта — без sleep —
+// и публикует порции в BlockStream. Корутина, дошедшая до последней порции, приостанавливается и
+// ставится в очередь исполнителя только публикацией следующей; сотни потребителей обходятся
+// несколькими потоками исполнителя. Каждый подписчик читает все порции по своему курсору; отставший
+// больше чем на history порций пропускает старые (BlockSubscription::getMissed()).
+//
+// Ядро собирается как C++17; этот заголовок — только для целей с C++20 (CMake: EMG_COROUTINES).
+
+class EmgExecutor;
+
+/**
+ * @brief Корутина без результата, запускаемая EmgExecutor::spawn().
+ *        Исключение из неё сохраняется в исполнителе и выбрасывается из waitIdle().
+ */
+class EmgTask {
+public:
+    struct promise_type {
+        EmgExecutor* executor = nullptr;
+        std::exception_ptr exception;
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<promise_type> h) noexcept;
+            void await_resume() noexcept {}
+        };
+
+        EmgTask get_return_object() { return EmgTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+    EmgTask(EmgTask&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    EmgTask& operator=(EmgTask&& other) noexcept {
+        std::swap(handle, other.handle);
+        return *this;
+    }
+    ~EmgTask() {
+        if (handle) handle.destroy();    // Не запущена
+    }
+
+private:
+    friend class EmgExecutor;
+    std::coroutine_handle<promise_type> handle;
+
+    explicit EmgTask(std::coroutine_handle<promise_type> h) : handle(h) {}
+    static void finished(EmgExecutor* executor, std::exception_ptr exception);
+};
+
+struct ExecutorStats {
+    uint64_t spawned = 0;
+    uint64_t finished = 0;
+    uint64_t resumes = 0;               // Возобновлений корутин потоками исполнителя
+};
+
+/**
+ * @brief Пул потоков, возобновляющих готовые корутины. Задачи должны завершиться до разрушения
+ *        исполнителя (закрыть потоки порций, затем waitIdle()).
+ */
+class EmgExecutor {
+private:
+    friend class EmgTask;
+
+    std::mutex mutex;
+    std::condition_variable readyCv;
+    std::condition_variable idleCv;
+    std::deque<std::coroutine_handle<>> ready;
+    std::vector<std::thread> threads;
+    uint64_t liveTasks;
+    bool stopping;
+    std::exception_ptr error;           // Первое исключение задачи
+    ExecutorStats stats;
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            readyCv.wait(lock, [this] { return stopping || !ready.empty(); });
+            if (stopping) return;
+            std::coroutine_handle<> h = ready.front();
+            ready.pop_front();
+            stats.resumes++;
+            lock.unlock();
+            h.resume();
+            lock.lock();
+        }
+    }
+
+    void taskFinished(std::exception_ptr e) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (e && !error) error = e;
+        stats.finished++;
+        if (--liveTasks == 0) idleCv.notify_all();
+    }
+
+public:
+    explicit EmgExecutor(unsigned threadCount = 1) : liveTasks(0), stopping(false) {
+        if (threadCount == 0) threadCount = 1;
+        for (unsigned i = 0; i < threadCount; ++i) threads.emplace_back(&EmgExecutor::workerLoop, this);
+    }
+
+    ~EmgExecutor() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        readyCv.notify_all();
+        for (std::thread& t : threads) t.join();
+    }
+
+    EmgExecutor(const EmgExecutor&) = delete;
+    EmgExecutor& operator=(const EmgExecutor&) = delete;
+
+    /**
+     * @brief Ставит задачу в очередь; она выполняется в потоках исполнителя до первого co_await
+     */
+    void spawn(EmgTask task) {
+        std::coroutine_handle<EmgTask::promise_type> h = std::exchange(task.handle, nullptr);
+        h.promise().executor = this;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            liveTasks++;
+            stats.spawned++;
+            ready.push_back(h);
+        }
+        readyCv.notify_one();
+    }
+
+    void post(std::coroutine_handle<> h) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.push_back(h);
+        }
+        readyCv.notify_one();
+    }
+
+    // Несколько корутин одной блокировкой (пробуждение подписчиков порции)
+    void post(const std::vector<std::coroutine_handle<>>& handles) {
+        if (handles.empty()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.insert(ready.end(), handles.begin(), handles.end());
+        }
+        if (handles.size() == 1) readyCv.notify_one();
+        else readyCv.notify_all();
+    }
+
+    /**
+     * @brief co_await executor.schedule() — продолжить в потоке исполнителя
+     */
+    auto schedule() {
+        struct ScheduleAwaiter {
+            EmgExecutor* executor;
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { executor->post(h); }
+            void await_resume() noexcept {}
+        };
+        return ScheduleAwaiter{this};
+    }
+
+    /**
+     * @brief Ждёт завершения всех задач; исключение задачи выбрасывается здесь
+     */
+    void waitIdle() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idleCv.wait(lock, [this] { return liveTasks == 0; });
+        if (error) std::rethrow_exception(std::exchange(error, nullptr));
+    }
+
+    size_t getThreadCount() const { return threads.size(); }
+
+    ExecutorStats getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+};
+
+inline void EmgTask::promise_type::FinalAwaiter::await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+    EmgExecutor* executor = h.promise().executor;
+    std::exception_ptr exception = std::move(h.promise().exception);
+    h.destroy();
+    EmgTask::finished(executor, std::move(exception));
+}
+
+inline void EmgTask::finished(EmgExecutor* executor, std::exception_ptr exception) {
+    executor->taskFinished(std::move(exception));
+}
+
+class BlockSubscription;
+
+/**
+ * @brief Поток порций с одним издателем и любым числом подписчиков-корутин.
+ *        publish() и close() — из одного потока.
+ */
+class BlockStream {
+private:
+    friend class BlockSubscription;
+
+    EmgExecutor& executor;
+    std::mutex mutex;
+    std::vector<SampleBlockRef> ring;   // Последние порции: порция n — ring[n % size]
+    uint64_t published;
+    bool closed;
+    std::vector<std::coroutine_handle<>> waiters;    // Ждут порцию с номером published
+
+public:
+    /**
+     * @param history Порций, которые отставший подписчик ещё может прочитать
+     */
+    explicit BlockStream(EmgExecutor& executor_, size_t history = 32)
+        : executor(executor_), ring(history ? history : 1), published(0), closed(false) {}
+
+    BlockStream(const BlockStream&) = delete;
+    BlockStream& operator=(const BlockStream&) = delete;
+
+    void publish(SampleBlockRef block) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ring[published % ring.size()] = std::move(block);
+        published++;
+        executor.post(waiters);    // Порядок блокировок: поток порций -> исполнитель
+        waiters.clear();
+    }
+
+    /**
+     * @brief Конец потока: подписчики дочитывают оставшееся и получают пустую порцию
+     */
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        executor.post(waiters);
+        waiters.clear();
+    }
+
+    /**
+     * @brief Подписчик, получающий порции, опубликованные после подписки
+     */
+    BlockSubscription subscribe();
+
+    uint64_t getPublished() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return published;
+    }
+};
+
+/**
+ * @brief Курсор подписчика: while (SampleBlockRef b = co_await sub.nextBlock()) { ... }
+ */
+class BlockSubscription {
+private:
+    BlockStream* stream;
+    uint64_t cursor;                    // Номер следующей порции
+    uint64_t missed;
+
+    // Вызывается под stream->mutex
+    bool available() const { return cursor < stream->published || stream->closed; }
+
+public:
+    BlockSubscription(BlockStream& stream_, uint64_t cursor_) : stream(&stream_), cursor(cursor_), missed(0) {}
+
+    struct NextAwaiter {
+        BlockSubscription* sub;
+
+        bool await_ready() {
+            std::lock_guard<std::mutex> lock(sub->stream->mutex);
+            return sub->available();
+        }
+        bool await_suspend(std::coroutine_handle<> h) {
+            std::lock_guard<std::mutex> lock(sub->stream->mutex);
+            if (sub->available()) return false;    // Порция пришла между await_ready() и сюда
+            sub->stream->waiters.push_back(h);
+            return true;
+        }
+        SampleBlockRef await_resume() {
+            BlockStream& s = *sub->stream;
+            std::lock_guard<std::mutex> lock(s.mutex);
+            if (sub->cursor == s.published) return SampleBlockRef();    // Поток закрыт
+            if (s.published - sub->cursor > s.ring.size()) {
+                sub->missed += s.published - sub->cursor - s.ring.size();
+                sub->cursor = s.published - s.ring.size();
+            }
+            return s.ring[sub->cursor++ % s.ring.size()];
+        }
+    };
+
+    /**
+     * @brief Следующая порция; пустая ссылка — поток закрыт и прочитан до конца
+     */
+    NextAwaiter nextBlock() { return NextAwaiter{this}; }
+
+    // Порций, пропущенных из-за отставания больше чем на history
+    uint64_t getMissed() const { return missed; }
+};
+
+inline BlockSubscription BlockStream::subscribe() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return BlockSubscription(*this, published);
+}
+
+/**
+ * @brief Поток чтения датчика: pollBlock() в цикле (ожидание — в read() транспорта),
+ *        порции — в BlockStream. Поток порций закрывается при конце воспроизведения и при ошибке
+ *        порта: Transport::read() бросает исключение (SerialTransport — при отключении адаптера),
+ *        оно сохраняется для getError(), а подписчики получают пустую порцию.
+ */
+class SensorStream {
+private:
+    SensorEMG& sensor;
+    BlockStream stream;
+    std::atomic<bool> stopping;
+    std::exception_ptr error;
+    std::thread reader;
+
+    void readerLoop() {
+        try {
+            while (!stopping.load(std::memory_order_relaxed) && !sensor.isFinished()) {
+                SampleBlockRef block = sensor.pollBlock();
+                if (block) stream.publish(std::move(block));
+            }
+        } catch (...) {
+            error = std::current_exception();    // Ошибка порта: read() транспорта бросает
+        }
+        stream.close();    // После error: подписчик, увидевший закрытие, видит и ошибку
+    }
+
+public:
+    /**
+     * @param sensor Подключённый датчик (connect(), sendSTART()); после start() читается только этим потоком
+     */
+    SensorStream(SensorEMG& sensor_, EmgExecutor& executor, size_t history = 32)
+        : sensor(sensor_), stream(executor, history), stopping(false) {}
+
+    /**
+     * @brief Запускает поток чтения; подписчики, созданные до start(), получают все порции
+     */
+    void start() {
+        if (!reader.joinable()) reader = std::thread(&SensorStream::readerLoop, this);
+    }
+
+    ~SensorStream() { stop(); }
+
+    SensorStream(const SensorStream&) = delete;
+    SensorStream& operator=(const SensorStream&) = delete;
+
+    /**
+     * @brief Останавливает чтение (не позже таймаута read() транспорта) и закрывает поток порций
+     */
+    void stop() {
+        stopping = true;
+        if (reader.joinable()) reader.join();
+        else stream.close();    // Не запускался
+    }
+
+    BlockSubscription subscribe() { return stream.subscribe(); }
+    BlockStream& getStream() { return stream; }
+
+    // Исключение потока чтения (отключение или ошибка порта); читать после закрытия потока порций
+    std::exception_ptr getError() const { return error; }
+};
@@ -0,0 +1,369 @@
+#include "AsyncFileWriter.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "HostClock.h"
+#include "Metrics.h"
+#include "Trace.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+const size_t DIRECT_IO_ALIGNMENT = 4096;    // Выравнивание адреса и размера для O_DIRECT
+
+static uint8_t* allocAligned(size_t bytes) {
+#ifdef _WIN32
+    void* p = _aligned_malloc(bytes, DIRECT_IO_ALIGNMENT);
+#else
+    void* p = nullptr;
+    if (posix_memalign(&p, DIRECT_IO_ALIGNMENT, bytes) != 0) p = nullptr;
+#endif
+    if (!p) throw std::bad_alloc();
+    return static_cast<uint8_t*>(p);
+}
+
+static void freeAligned(uint8_t* p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+static void atomicMax(std::atomic<int64_t>& target, int64_t value) {
+    int64_t prev = target.load(std::memory_order_relaxed);
+    while (value > prev && !target.compare_exchange_weak(prev, value, std::memory_order_relaxed)) {}
+}
+
+AsyncFileWriter::AsyncFileWriter()
+    : current(nullptr),
+      freeCount(0),
+      stopping(false),
+#ifdef _WIN32
+      hFile(INVALID_HANDLE_VALUE),
+#else
+      fd(-1),
+#endif
+      logicalSize(0),
+      bytesSubmitted(0), bytesWritten(0), buffersWritten(0),
+      droppedWrites(0), droppedBytes(0), fsyncCount(0), writeErrors(0),
+      maxLagNs(0), maxWriteNs(0) {}
+
+AsyncFileWriter::~AsyncFileWriter() {
+    close();
+}
+
+void AsyncFileWriter::open(const std::string& path, const AsyncWriterOptions& opts) {
+    close();
+    options = opts;
+    options.bufferCount = std::max<size_t>(options.bufferCount, 2);
+    options.bufferBytes = std::max<size_t>(options.bufferBytes, DIRECT_IO_ALIGNMENT);
+    options.bufferBytes = (options.bufferBytes + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+
+    openFile(path);
+
+    // Вся память выделяется один раз здесь; в процессе записи аллокаций нет
+    buffers.resize(options.bufferCount);
+    freeList.clear();
+    for (Buffer& b : buffers) {
+        b.data = allocAligned(options.bufferBytes);
+        b.used = 0;
+        b.firstWriteNs = 0;
+        freeList.push_back(&b);
+    }
+    fullQueue.clear();
+    freeCount = freeList.size();
+    current = nullptr;
+    stopping = false;
+    logicalSize = 0;
+
+    bytesSubmitted = bytesWritten = buffersWritten = 0;
+    droppedWrites = droppedBytes = fsyncCount = writeErrors = 0;
+    maxLagNs = maxWriteNs = 0;
+
+    writerThread = std::thread(&AsyncFileWriter::writerLoop, this);
+}
+
+void AsyncFileWriter::openFile(const std::string& path) {
+#ifdef _WIN32
+    DWORD flags = FILE_ATTRIBUTE_NORMAL;
+    if (options.directIO) flags |= FILE_FLAG_NO_BUFFERING;
+    hFile = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, flags, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Cannot create file " + path);
+#else
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+    if (options.directIO) flags |= O_DIRECT;
+#endif
+    fd = ::open(path.c_str(), flags, 0644);
+    if (fd < 0 && options.directIO && errno == EINVAL) {
+        // tmpfs и некоторые ФС не поддерживают O_DIRECT
+        std::cerr << "O_DIRECT is not supported for " << path << ", using buffered I/O" << std::endl;
+        options.directIO = false;
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    if (fd < 0)
+        throw std::runtime_error("Cannot create file " + path);
+#endif
+}
+
+void AsyncFileWriter::closeFile() {
+#ifdef _WIN32
+    if (hFile == INVALID_HANDLE_VALUE) return;
+    if (options.directIO) {
+        // Отрезаем нули, которыми был выровнен последний буфер
+        LARGE_INTEGER pos;
+        pos.QuadPart = (LONGLONG)logicalSize;
+        SetFilePointerEx(hFile, pos, nullptr, FILE_BEGIN);
+        SetEndOfFile(hFile);
+    }
+    CloseHandle(hFile);
+    hFile = INVALID_HANDLE_VALUE;
+#else
+    if (fd < 0) return;
+    if (options.directIO && ftruncate(fd, (off_t)logicalSize) != 0) writeErrors++;
+    ::close(fd);
+    fd = -1;
+#endif
+}
+
+bool AsyncFileWriter::takeFreeBuffer(bool wait) {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    if (wait) freeCv.wait(lock, [this] { return !freeList.empty(); });
+    if (freeList.empty()) return false;
+    current = freeList.back();
+    freeList.pop_back();
+    freeCount.fetch_sub(1, std::memory_order_relaxed);
+    current->used = 0;
+    return true;
+}
+
+void AsyncFileWriter::submitCurrent() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        fullQueue.push_back(current);
+        current = nullptr;
+    }
+    queueCv.notify_one();
+}
+
+bool AsyncFileWriter::write(const void* data, size_t bytes) {
+    if (!writerThread.joinable() || bytes == 0) return bytes == 0;
+
+    // Проверка места до копирования: буферы освобождает только писатель,
+    // поэтому свободных может стать больше, но не меньше
+    size_t space = current ? options.bufferBytes - current->used : 0;
+    if (bytes > space + freeCount.load(std::memory_order_acquire) * options.bufferBytes) {
+        droppedWrites.fetch_add(1, std::memory_order_relaxed);
+        droppedBytes.fetch_add(bytes, std::memory_order_relaxed);
+        return false;
+    }
+
+    const uint8_t* src = static_cast<const uint8_t*>(data);
+    size_t left = bytes;
+    int64_t now = hostNowNs();
+    while (left > 0) {
+        if (!current) takeFreeBuffer(false);
+        if (current->used == 0) current->firstWriteNs = now;
+        size_t take = std::min(left, options.bufferBytes - current->used);
+        std::memcpy(current->data + current->used, src, take);
+        current->used += take;
+        src += take;
+        left -= take;
+        if (current->used == options.bufferBytes) submitCurrent();
+    }
+    bytesSubmitted.fetch_add(bytes, std::memory_order_relaxed);
+
+    // Политика сброса: неполный буфер не должен висеть в памяти дольше flushIntervalMs
+    if (current && options.flushIntervalMs > 0 &&
+        now - current->firstWriteNs > options.flushIntervalMs * 1000000) flush();
+    return true;
+}
+
+void AsyncFileWriter::writeBlocking(const void* data, size_t bytes) {
+    if (!writerThread.joinable()) return;
+    const uint8_t* src = static_cast<const uint8_t*>(data);
+    while (bytes > 0) {
+        if (!current) takeFreeBuffer(true);
+        if (current->used == 0) current->firstWriteNs = hostNowNs();
+        size_t take = std::min(bytes, options.bufferBytes - current->used);
+        std::memcpy(current->data + current->used, src, take);
+        current->used += take;
+        src += take;
+        bytes -= take;
+        bytesSubmitted.fetch_add(take, std::memory_order_relaxed);
+        if (current->used == options.bufferBytes) submitCurrent();
+    }
+}
+
+void AsyncFileWriter::flush() {
+    // С O_DIRECT на диск уходят только целые выровненные буферы; хвост — при close()
+    if (options.directIO || !current || current->used == 0) return;
+    if (freeCount.load(std::memory_order_acquire) == 0) return;    // Некуда переключиться — подождём заполнения
+    submitCurrent();
+}
+
+void AsyncFileWriter::close() {
+    if (!writerThread.joinable()) return;
+    if (current && current->used > 0) submitCurrent();
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCv.notify_one();
+    writerThread.join();
+    closeFile();
+
+    for (Buffer& b : buffers) freeAligned(b.data);
+    buffers.clear();
+    freeList.clear();
+    fullQueue.clear();
+    current = nullptr;
+    freeCount = 0;
+}
+
+void AsyncFileWriter::writeToDisk(const uint8_t* data, size_t bytes) {
+    EMG_TRACE_SCOPE("disk write");
+    int64_t t0 = hostNowNs();
+#ifdef _WIN32
+    while (bytes > 0) {
+        DWORD written = 0;
+        DWORD chunk = (DWORD)std::min<size_t>(bytes, 1u << 30);
+        if (!WriteFile((HANDLE)hFile, data, chunk, &written, nullptr) || written == 0) {
+            writeErrors.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        data += written;
+        bytes -= written;
+    }
+#else
+    while (bytes > 0) {
+        ssize_t written = ::write(fd, data, bytes);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) {
+            writeErrors.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        data += written;
+        bytes -= (size_t)written;
+    }
+#endif
+    atomicMax(maxWriteNs, hostNowNs() - t0);
+}
+
+void AsyncFileWriter::syncToDisk() {
+    EMG_TRACE_SCOPE("fsync");
+#ifdef _WIN32
+    FlushFileBuffers((HANDLE)hFile);
+#elif defined(__linux__)
+    fdatasync(fd);
+#else
+    fsync(fd);
+#endif
+    fsyncCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AsyncFileWriter::writerLoop() {
+    traceSetThreadName("writer");
+    int64_t lastSyncNs = hostNowNs();
+    for (;;) {
+        Buffer* b;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCv.wait(lock, [this] { return stopping || !fullQueue.empty(); });
+            if (fullQueue.empty()) break;    // stopping и очередь пуста
+            b = fullQueue.front();           // Остаётся в очереди до конца записи — для расчёта отставания
+        }
+
+        size_t bytes = b->used;
+        if (options.directIO && bytes % DIRECT_IO_ALIGNMENT != 0) {
+            // Последний неполный буфер: дополняем нулями, лишнее отрежет closeFile()
+            size_t aligned = (bytes + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+            std::memset(b->data + bytes, 0, aligned - bytes);
+            bytes = aligned;
+        }
+        writeToDisk(b->data, bytes);
+        logicalSize += b->used;
+        bytesWritten.fetch_add(b->used, std::memory_order_relaxed);
+        buffersWritten.fetch_add(1, std::memory_order_relaxed);
+
+        int64_t now = hostNowNs();
+        atomicMax(maxLagNs, now - b->firstWriteNs);
+        if (options.fsyncPolicy == FsyncPolicy::EveryBuffer ||
+            (options.fsyncPolicy == FsyncPolicy::Interval &&
+             now - lastSyncNs >= options.fsyncIntervalMs * 1000000)) {
+            syncToDisk();
+            lastSyncNs = hostNowNs();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            fullQueue.pop_front();
+            b->used = 0;
+            freeList.push_back(b);
+            freeCount.fetch_add(1, std::memory_order_release);
+        }
+        freeCv.notify_one();
+    }
+    if (options.fsyncPolicy != FsyncPolicy::Never) syncToDisk();
+}
+
+bool syncFileToDisk(const std::string& path) {
+#ifdef _WIN32
+    HANDLE h = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    const bool ok = FlushFileBuffers(h) != 0;
+    CloseHandle(h);
+    return ok;
+#else
+    int fd = ::open(path.c_str(), O_WRONLY);
+    if (fd < 0) return false;
+#if defined(__linux__)
+    const bool ok = fdatasync(fd) == 0;
+#else
+    const bool ok = fsync(fd) == 0;
+#endif
+    ::close(fd);
+    return ok;
+#endif
+}
+
+AsyncWriterStats AsyncFileWriter::getStats() {
+    AsyncWriterStats s;
+    s.bytesSubmitted = bytesSubmitted.load(std::memory_order_relaxed);
+    s.bytesWritten   = bytesWritten.load(std::memory_order_relaxed);
+    s.buffersWritten = buffersWritten.load(std::memory_order_relaxed);
+    s.droppedWrites  = droppedWrites.load(std::memory_order_relaxed);
+    s.droppedBytes   = droppedBytes.load(std::memory_order_relaxed);
+    s.fsyncCount     = fsyncCount.load(std::memory_order_relaxed);
+    s.writeErrors    = writeErrors.load(std::memory_order_relaxed);
+    s.maxLagNs       = maxLagNs.load(std::memory_order_relaxed);
+    s.maxWriteNs     = maxWriteNs.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(queueMutex);
+    s.queuedBuffers = fullQueue.size();
+    s.lagNs = fullQueue.empty() ? 0 : hostNowNs() - fullQueue.front()->firstWriteNs;
+    return s;
+}
+
+void publishWriterMetrics(MetricsRegistry& registry, const std::string& sink, const AsyncWriterStats& stats) {
+    const std::string l = "{" + metricLabel("sink", sink) + "}";
+    registry.counter("emg_writer_bytes_total" + l, "Bytes written to disk").store(stats.bytesWritten);
+    registry.counter("emg_writer_dropped_writes_total" + l, "Writes dropped because all buffers were queued").store(stats.droppedWrites);
+    registry.counter("emg_writer_errors_total" + l, "Failed write/fsync system calls").store(stats.writeErrors);
+    registry.gauge("emg_writer_queued_buffers" + l, "Buffers waiting for the writer thread").set((int64_t)stats.queuedBuffers);
+    registry.gauge("emg_writer_lag_ns" + l, "Age of the oldest unwritten buffer, ns").set(stats.lagNs);
+    registry.gauge("emg_writer_max_write_ns" + l, "Longest write system call, ns").set(stats.maxWriteNs);
+}
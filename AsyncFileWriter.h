@@ -0,0 +1,136 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Политика fsync потока записи
+enum class FsyncPolicy {
+    Never,          // Только ОС решает, когда сбрасывать кэш
+    EveryBuffer,    // После каждого записанного буфера
+    Interval,       // Не чаще, чем раз в fsyncIntervalMs
+};
+
+struct AsyncWriterOptions {
+    size_t bufferBytes = 1 << 20;       // Размер одного буфера (кратен 4096 при directIO)
+    size_t bufferCount = 3;             // 2 — двойная, 3 — тройная буферизация
+    int64_t flushIntervalMs = 500;      // Неполный буфер уходит на диск не позже, чем через N мс (0 — только полные)
+    FsyncPolicy fsyncPolicy = FsyncPolicy::Never;
+    int64_t fsyncIntervalMs = 5000;
+    bool directIO = false;              // O_DIRECT / FILE_FLAG_NO_BUFFERING, пишутся только выровненные буферы
+};
+
+struct AsyncWriterStats {
+    uint64_t bytesSubmitted = 0;        // Принято от производителя
+    uint64_t bytesWritten = 0;          // Записано на диск
+    uint64_t buffersWritten = 0;
+    uint64_t droppedWrites = 0;         // Вызовы write(), отброшенные из-за нехватки свободных буферов
+    uint64_t droppedBytes = 0;
+    uint64_t fsyncCount = 0;
+    uint64_t writeErrors = 0;
+    size_t   queuedBuffers = 0;         // Буферов в очереди на запись
+    int64_t  lagNs = 0;                 // Возраст самого старого незаписанного буфера
+    int64_t  maxLagNs = 0;
+    int64_t  maxWriteNs = 0;            // Самый долгий системный вызов записи
+};
+
+/**
+ * @brief Запись файла в отдельном потоке через заранее выделенные буферы.
+ *
+ * Поток чтения только копирует байты в текущий буфер и никогда не ждёт диск:
+ * если свободных буферов нет, данные вызова write() отбрасываются целиком
+ * и учитываются в droppedWrites. Рассчитан на одного производителя.
+ */
+class AsyncFileWriter {
+private:
+    struct Buffer {
+        uint8_t* data;
+        size_t used;
+        int64_t firstWriteNs;           // Когда в буфер попал первый байт
+    };
+
+    AsyncWriterOptions options;
+    std::vector<Buffer> buffers;
+    Buffer* current;
+
+    std::mutex queueMutex;
+    std::condition_variable queueCv;    // Писатель ждёт полные буферы
+    std::condition_variable freeCv;     // writeBlocking() ждёт свободные
+    std::deque<Buffer*> fullQueue;
+    std::vector<Buffer*> freeList;
+    std::atomic<size_t> freeCount;
+    bool stopping;
+    std::thread writerThread;
+
+#ifdef _WIN32
+    void* hFile;
+#else
+    int fd;
+#endif
+    uint64_t logicalSize;               // Размер файла без выравнивающего хвоста
+
+    // Статистика: производитель пишет свои поля, писатель — свои
+    std::atomic<uint64_t> bytesSubmitted, bytesWritten, buffersWritten;
+    std::atomic<uint64_t> droppedWrites, droppedBytes, fsyncCount, writeErrors;
+    std::atomic<int64_t> maxLagNs, maxWriteNs;
+
+    void writerLoop();
+    void writeToDisk(const uint8_t* data, size_t bytes);
+    void syncToDisk();
+    void submitCurrent();
+    bool takeFreeBuffer(bool wait);
+    void openFile(const std::string& path);
+    void closeFile();
+
+public:
+    AsyncFileWriter();
+    ~AsyncFileWriter();
+
+    AsyncFileWriter(const AsyncFileWriter&) = delete;
+    AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+    void open(const std::string& path, const AsyncWriterOptions& opts = AsyncWriterOptions());
+
+    /**
+     * @brief Копирует данные в буфер. Не блокируется на диске.
+     * @return false, если данные отброшены (писатель не успевает)
+     */
+    bool write(const void* data, size_t bytes);
+
+    /**
+     * @brief Как write(), но при нехватке буферов ждёт писателя (для заголовков и индекса)
+     */
+    void writeBlocking(const void* data, size_t bytes);
+
+    /**
+     * @brief Отдаёт текущий неполный буфер писателю (без ожидания записи)
+     */
+    void flush();
+
+    /**
+     * @brief Дописывает всё, ждёт поток записи и закрывает файл
+     */
+    void close();
+
+    bool isOpen() const { return writerThread.joinable(); }
+    AsyncWriterStats getStats();
+};
+
+/**
+ * @brief Доводит файл до диска (fdatasync / FlushFileBuffers), включая то, что дописано в обход
+ *        писателя (правка заголовка после close())
+ * @return false, если файл не открылся или сброс не удался
+ */
+bool syncFileToDisk(const std::string& path);
+
+class MetricsRegistry;
+
+/**
+ * @brief Копирует статистику писателя в метрики реестра с меткой sink="..." (очередь, задержка, потери)
+ */
+void publishWriterMetrics(MetricsRegistry& registry, const std::string& sink, const AsyncWriterStats& stats);
@@ -0,0 +1,97 @@
+#include "ClockSync.h"
+
+#include <algorithm>
+#include <cmath>
+
+const double MIN_FIT_SPAN_SECONDS = 1.0;    // Короче — наклон по шуму не оценить, берётся номинальный
+
+ClockSync::ClockSync(double nominalRate_, int64_t windowNs_, size_t refitEvery_)
+    : nominalRate(nominalRate_),
+      windowNs(windowNs_),
+      refitEvery(std::max<size_t>(1, refitEvery_)) {
+    reset();
+}
+
+void ClockSync::reset() {
+    points.clear();
+    sinceFit = 0;
+    originSample = 0;
+    originNs = 0.0;
+    slopeNs = 1e9 / nominalRate;
+    lastStampNs = INT64_MIN;
+    stats = ClockSyncStats();
+    stats.rateHz = nominalRate;
+}
+
+void ClockSync::observe(uint64_t lastSample, int64_t hostNs) {
+    if (!points.empty() && lastSample <= points.back().deviceSample) return;    // Новых сэмплов нет
+    points.push_back({lastSample, hostNs});
+    while (points.size() > 2 && hostNs - points.front().hostNs > windowNs) points.pop_front();
+
+    // Пока наблюдений мало, модель обновляется на каждом, дальше — раз в refitEvery
+    if (++sinceFit >= refitEvery || points.size() <= refitEvery) refit();
+}
+
+void ClockSync::refit() {
+    sinceFit = 0;
+    const size_t n = points.size();
+    const Point& first = points.front();
+
+    // Координаты относительно первой точки окна — без потери точности double на больших значениях
+    double meanX = 0.0, meanY = 0.0;
+    for (const Point& p : points) {
+        meanX += (double)(p.deviceSample - first.deviceSample);
+        meanY += (double)(p.hostNs - first.hostNs);
+    }
+    meanX /= (double)n;
+    meanY /= (double)n;
+
+    double slope = 1e9 / nominalRate;
+    double spanSeconds = (double)(points.back().hostNs - first.hostNs) * 1e-9;
+    if (n >= 3 && spanSeconds >= MIN_FIT_SPAN_SECONDS) {
+        double sxx = 0.0, sxy = 0.0;
+        for (const Point& p : points) {
+            double dx = (double)(p.deviceSample - first.deviceSample) - meanX;
+            double dy = (double)(p.hostNs - first.hostNs) - meanY;
+            sxx += dx * dx;
+            sxy += dx * dy;
+        }
+        if (sxx > 0.0) slope = sxy / sxx;
+    }
+
+    // Сдвиг по нижней огибающей остатков; разброс остатков — дрожание прихода
+    double minR = INFINITY, maxR = -INFINITY, sumR = 0.0, sumR2 = 0.0;
+    for (const Point& p : points) {
+        double r = (double)(p.hostNs - first.hostNs) - slope * (double)(p.deviceSample - first.deviceSample);
+        minR = std::min(minR, r);
+        maxR = std::max(maxR, r);
+        sumR += r;
+        sumR2 += r * r;
+    }
+    double meanR = sumR / (double)n;
+
+    slopeNs = slope;
+    originSample = first.deviceSample;
+    originNs = (double)first.hostNs + minR;
+
+    stats.rateHz = 1e9 / slope;
+    stats.driftPpm = (stats.rateHz / nominalRate - 1.0) * 1e6;
+    stats.jitterRmsNs = std::sqrt(std::max(0.0, sumR2 / (double)n - meanR * meanR));
+    stats.latencySpreadNs = maxR - minR;
+    stats.points = n;
+}
+
+int64_t ClockSync::hostTimeOf(uint64_t deviceSample) const {
+    double dx = deviceSample >= originSample ? (double)(deviceSample - originSample)
+                                             : -(double)(originSample - deviceSample);
+    return (int64_t)std::llround(originNs + slopeNs * dx);
+}
+
+void ClockSync::stamp(uint64_t firstSample, size_t count, int64_t* out) {
+    for (size_t i = 0; i < count; ++i) {
+        // Модель уточняется на ходу: новое время не должно уйти назад относительно выданного
+        int64_t t = std::max(hostTimeOf(firstSample + i), lastStampNs == INT64_MIN ? INT64_MIN : lastStampNs + 1);
+        out[i] = t;
+        lastStampNs = t;
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+// ==== Синхронизация часов датчика и хоста ====
+//
+// Наблюдение — пара (индекс последнего пришедшего сэмпла, время прихода байт на хосте).
+// Время прихода = время сэмпла + задержка (буфер датчика, USB, период опроса), задержка
+// только положительная, поэтому модель строится так:
+//   наклон (нс хоста на сэмпл) — МНК по окну наблюдений;
+//   сдвиг — по нижней огибающей (минимальный остаток), а не по среднему.
+// Так оценка не смещается на среднюю задержку пакетирования; постоянная часть задержки
+// (минимальная по окну) по времени прихода неотличима от сдвига часов и остаётся в оценке.
+
+struct ClockSyncStats {
+    double driftPpm = 0.0;         // Уход часов датчика относительно хоста (+ — датчик спешит)
+    double rateHz = 0.0;           // Фактическая частота в шкале хоста
+    double jitterRmsNs = 0.0;      // СКО времени прихода вокруг модели
+    double latencySpreadNs = 0.0;  // Размах задержки прихода над огибающей
+    size_t points = 0;             // Наблюдений в окне
+};
+
+class ClockSync {
+private:
+    struct Point {
+        uint64_t deviceSample;
+        int64_t hostNs;
+    };
+
+    double nominalRate;
+    int64_t windowNs;
+    size_t refitEvery;             // Пересчёт модели раз в столько наблюдений
+    std::deque<Point> points;
+    size_t sinceFit;
+
+    // host(sample) = originNs + slopeNs * (sample - originSample)
+    uint64_t originSample;
+    double originNs;
+    double slopeNs;
+    int64_t lastStampNs;           // Для монотонности stamp()
+    ClockSyncStats stats;
+
+    void refit();
+
+public:
+    /**
+     * @param nominalRate Номинальная частота датчика, используется до первой оценки
+     * @param windowNs Окно наблюдений (по часам хоста)
+     */
+    explicit ClockSync(double nominalRate = 500.0, int64_t windowNs = 60000000000LL, size_t refitEvery = 16);
+
+    void reset();
+
+    /**
+     * @param lastSample Индекс последнего сэмпла, пришедшего в этом чтении (в шкале устройства)
+     * @param hostNs Время прихода байт (hostNowNs())
+     */
+    void observe(uint64_t lastSample, int64_t hostNs);
+
+    bool isValid() const { return !points.empty(); }
+
+    // Время сэмпла в шкале hostNowNs()
+    int64_t hostTimeOf(uint64_t deviceSample) const;
+
+    // Текущий период сэмпла в нс хоста
+    double samplePeriodNs() const { return slopeNs; }
+
+    /**
+     * @brief Времена count сэмплов подряд начиная с firstSample; между вызовами не убывают
+     */
+    void stamp(uint64_t firstSample, size_t count, int64_t* out);
+
+    const ClockSyncStats& getStats() const { return stats; }
+};
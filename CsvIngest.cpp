@@ -0,0 +1,290 @@
+#include "CsvIngest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <stdexcept>
+#include <thread>
+
+#include "HostClock.h"
+#include "MappedFile.h"
+#include "RecordingFormat.h"
+
+namespace fs = std::filesystem;
+
+// ==== Признаки ====
+
+EmgFeatures computeEmgFeatures(const float* samples, size_t count, float threshold) {
+    EmgFeatures f;
+    f.count = count;
+    if (count == 0) return f;
+
+    double sum = 0.0, sumSquares = 0.0, sumAbs = 0.0, length = 0.0;
+    float lo = samples[0], hi = samples[0];
+    for (size_t i = 0; i < count; ++i) {
+        const double x = samples[i];
+        sum += x;
+        sumSquares += x * x;
+        sumAbs += std::fabs(x);
+        lo = std::min(lo, samples[i]);
+        hi = std::max(hi, samples[i]);
+        if (i > 0) length += std::fabs(x - samples[i - 1]);
+    }
+    f.mean = sum / (double)count;
+    f.stddev = std::sqrt(std::max(0.0, sumSquares / (double)count - f.mean * f.mean));
+    f.min = lo;
+    f.max = hi;
+    f.rms = std::sqrt(sumSquares / (double)count);
+    f.mav = sumAbs / (double)count;
+    f.waveformLength = length;
+
+    // Переходы считаются относительно среднего: у сырых отсчётов АЦП бывает постоянная составляющая
+    const double t = threshold;
+    for (size_t i = 1; i < count; ++i) {
+        const double a = samples[i - 1] - f.mean, b = samples[i] - f.mean;
+        if (a * b < 0.0 && std::fabs(a - b) >= t) f.zeroCrossings++;
+        if (i + 1 < count && (b - a) * (b - (samples[i + 1] - f.mean)) > t) f.slopeSignChanges++;
+    }
+    return f;
+}
+
+// ==== Разбор ====
+
+static bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Строки [begin, end); первая непустая строка, не являющаяся числом, — заголовок, если headerAllowed
+static void parseLines(const char* p, const char* end, bool headerAllowed, std::vector<float>& out,
+                       CsvParseResult& result) {
+    out.reserve(out.size() + (size_t)std::count(p, end, '\n') + 1);
+    while (p < end) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', (size_t)(end - p)));
+        if (!eol) eol = end;
+        const char* q = p;
+        while (q < eol && isBlank(*q)) ++q;
+        if (q == eol) {
+            p = eol + 1;
+            continue;
+        }
+
+        const char* number = (*q == '+') ? q + 1 : q;    // from_chars не принимает '+'
+        float value = 0.0f;
+        std::from_chars_result parsed = std::from_chars(number, eol, value);
+        bool ok = parsed.ec == std::errc();
+        if (ok) {
+            const char* tail = parsed.ptr;
+            while (tail < eol && isBlank(*tail)) ++tail;
+            ok = tail == eol || *tail == ',' || *tail == ';';    // Следующие столбцы не читаются
+        }
+
+        if (ok) {
+            out.push_back(value);
+        } else if (headerAllowed) {
+            const char* last = eol;
+            while (last > q && isBlank(last[-1])) --last;
+            result.header.assign(q, last);
+        } else {
+            result.badLines++;
+        }
+        headerAllowed = false;
+        p = eol + 1;
+    }
+}
+
+CsvParseResult parseCsvColumn(const char* data, size_t size, std::vector<float>& out, unsigned threads) {
+    CsvParseResult result;
+    if (size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0) {    // UTF-8 BOM
+        data += 3;
+        size -= 3;
+    }
+    const char* end = data + size;
+    const size_t chunks = std::max<size_t>(1, std::min<size_t>(threads, size / CSV_MIN_CHUNK_BYTES));
+    if (chunks == 1) {
+        parseLines(data, end, true, out, result);
+        return result;
+    }
+
+    // Куски начинаются с начала строки: граница сдвигается за ближайший '\n'
+    std::vector<const char*> bounds(chunks + 1, end);
+    bounds[0] = data;
+    for (size_t k = 1; k < chunks; ++k) {
+        const char* p = std::max(bounds[k - 1], data + size / chunks * k);
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', (size_t)(end - p)));
+        bounds[k] = eol ? eol + 1 : end;
+    }
+
+    std::vector<std::vector<float>> parts(chunks);
+    std::vector<CsvParseResult> results(chunks);
+    std::vector<std::exception_ptr> errors(chunks);
+    auto parseChunk = [&](size_t k) {
+        try {
+            parseLines(bounds[k], bounds[k + 1], k == 0, k == 0 ? out : parts[k], results[k]);
+        } catch (...) {
+            errors[k] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t k = 1; k < chunks; ++k) workers.emplace_back(parseChunk, k);
+    parseChunk(0);
+    for (std::thread& t : workers) t.join();
+    for (const std::exception_ptr& e : errors)
+        if (e) std::rethrow_exception(e);
+
+    size_t total = out.size();
+    for (size_t k = 1; k < chunks; ++k) total += parts[k].size();
+    out.reserve(total);
+    result = std::move(results[0]);
+    for (size_t k = 1; k < chunks; ++k) {
+        out.insert(out.end(), parts[k].begin(), parts[k].end());
+        result.badLines += results[k].badLines;
+    }
+    return result;
+}
+
+// ==== Пакет ====
+
+static bool hasCsvExtension(const fs::path& path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return ext == ".csv";
+}
+
+std::vector<std::string> listCsvFiles(const std::vector<std::string>& paths, bool recursive) {
+    std::vector<std::string> files;
+    for (const std::string& path : paths) {
+        if (!fs::is_directory(path)) {
+            files.push_back(path);
+            continue;
+        }
+        if (recursive) {
+            for (const fs::directory_entry& entry : fs::recursive_directory_iterator(path))
+                if (entry.is_regular_file() && hasCsvExtension(entry.path())) files.push_back(entry.path().string());
+        } else {
+            for (const fs::directory_entry& entry : fs::directory_iterator(path))
+                if (entry.is_regular_file() && hasCsvExtension(entry.path())) files.push_back(entry.path().string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+    return files;
+}
+
+// Все старые файлы называются example.csv: в имя .emgr входит путь, a/b/example.csv -> a_b_example.emgr
+static std::string convertedName(const std::string& path) {
+    std::string name;
+    for (const fs::path& part : fs::path(path).parent_path().relative_path()) {
+        std::string s = part.string();
+        if (s.empty() || s == "." || s == "..") continue;
+        name += s + "_";
+    }
+    return name + fs::path(path).stem().string() + ".emgr";
+}
+
+static void convertToRecording(const std::string& path, const std::vector<float>& samples,
+                               const CsvBatchOptions& options) {
+    RecordingInfo info;
+    info.device = fs::path(path).filename().string();
+    info.sampleRate = options.sampleRate;
+    RecordingWriter writer;
+    writer.open((fs::path(options.convertDirectory) / convertedName(path)).string(), info, AsyncWriterOptions(),
+                true);
+
+    // Времени прихода в CSV нет: метки блоков — по номеру сэмпла от момента конвертации
+    const int64_t startNs = hostNowNs();
+    const double periodNs = 1e9 / options.sampleRate;
+    for (size_t i = 0; i < samples.size(); i += info.blockSamples) {
+        const size_t n = std::min<size_t>(info.blockSamples, samples.size() - i);
+        writer.append(samples.data() + i, n, startNs + (int64_t)(periodNs * (double)i));
+    }
+    writer.close();
+}
+
+static void ingestFile(const std::string& path, const CsvBatchOptions& options, unsigned threads,
+                       std::vector<float>& samples, CsvFileSummary& summary) {
+    summary.path = path;
+    try {
+        samples.clear();
+        {
+            MappedFile file(path);
+            summary.bytes = file.size();
+            CsvParseResult parsed =
+                parseCsvColumn(reinterpret_cast<const char*>(file.data()), file.size(), samples, threads);
+            summary.header = parsed.header;
+            summary.badLines = parsed.badLines;
+        }
+        summary.features = computeEmgFeatures(samples.data(), samples.size(), options.threshold);
+        if (!options.convertDirectory.empty()) convertToRecording(path, samples, options);
+    } catch (const std::exception& e) {
+        summary.error = e.what();
+    }
+}
+
+std::vector<CsvFileSummary> ingestCsvFiles(const std::vector<std::string>& files, const CsvBatchOptions& options,
+                                           CsvBatchStats& stats) {
+    if (!(options.sampleRate > 0.0)) throw std::invalid_argument("ingestCsvFiles: sample rate must be positive");
+    std::vector<CsvFileSummary> summaries(files.size());
+    stats = CsvBatchStats();
+    if (files.empty()) return summaries;
+    if (!options.convertDirectory.empty()) fs::create_directories(options.convertDirectory);
+
+    // Файлов меньше, чем потоков, — свободные потоки делят файлы на куски
+    const unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    const unsigned workers = (unsigned)std::min<size_t>(threads, files.size());
+    const unsigned perFile = std::max(1u, threads / workers);
+
+    const int64_t startNs = hostNowNs();
+    std::atomic<size_t> next(0);
+    auto work = [&] {
+        std::vector<float> samples;    // Буфер потока переживает файлы: память не выделяется на каждый
+        for (size_t i = next++; i < files.size(); i = next++)
+            ingestFile(files[i], options, perFile, samples, summaries[i]);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned w = 1; w < workers; ++w) pool.emplace_back(work);
+    work();
+    for (std::thread& t : pool) t.join();
+    stats.elapsedNs = hostNowNs() - startNs;
+
+    for (const CsvFileSummary& s : summaries) {
+        stats.files++;
+        if (!s.error.empty()) stats.failed++;
+        stats.bytes += s.bytes;
+        stats.samples += s.features.count;
+        stats.badLines += s.badLines;
+    }
+    return summaries;
+}
+
+// Строковое поле CSV в кавычках
+static void writeQuoted(std::FILE* out, const std::string& s) {
+    std::fputc('"', out);
+    for (char c : s) {
+        if (c == '"') std::fputc('"', out);
+        std::fputc(c, out);
+    }
+    std::fputc('"', out);
+}
+
+void writeCsvSummary(std::FILE* out, const std::vector<CsvFileSummary>& summaries, double sampleRate) {
+    std::fputs("file,header,bytes,samples,bad_lines,duration_s,mean,std,min,max,rms,mav,waveform_length,"
+               "zero_crossings,slope_sign_changes,error\n",
+               out);
+    for (const CsvFileSummary& s : summaries) {
+        const EmgFeatures& f = s.features;
+        writeQuoted(out, s.path);
+        std::fputc(',', out);
+        writeQuoted(out, s.header);
+        std::fprintf(out, ",%llu,%llu,%llu,%.3f,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,%llu,%llu,",
+                     (unsigned long long)s.bytes, (unsigned long long)f.count, (unsigned long long)s.badLines,
+                     (double)f.count / sampleRate, f.mean, f.stddev, f.min, f.max, f.rms, f.mav, f.waveformLength,
+                     (unsigned long long)f.zeroCrossings, (unsigned long long)f.slopeSignChanges);
+        writeQuoted(out, s.error);
+        std::fputc('\n', out);
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// ==== Пакетный разбор старых CSV ====
+//
+// Файлы example.csv из single.cpp / main_src.cpp: первая строка — заголовок ("value", "COM"),
+// дальше по одному числу в строке. Файл отображается в память (MappedFile) и разбирается
+// std::from_chars без iostreams; большой файл делится на куски по границам строк и разбирается
+// в нескольких потоках. Каталоги обрабатываются пулом потоков, по файлу на поток.
+//
+// Строка, где после числа идёт что-то кроме пробелов, ',' или ';', считается испорченной и
+// пропускается: так выглядят склеенные кадры main_src.cpp ("12-3" — без перевода строки между
+// кадрами). Склейку двух положительных чисел ("125") отличить от числа нельзя.
+
+/**
+ * @brief Признаки ЭМГ во временной области
+ */
+struct EmgFeatures {
+    uint64_t count = 0;
+    double mean = 0.0;
+    double stddev = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double rms = 0.0;
+    double mav = 0.0;                   // Среднее модуля
+    double waveformLength = 0.0;        // Сумма |x[i] - x[i-1]|
+    uint64_t zeroCrossings = 0;         // Переходы через среднее с перепадом не меньше порога
+    uint64_t slopeSignChanges = 0;      // Смены знака наклона: (x[i]-x[i-1])(x[i]-x[i+1]) больше порога
+};
+
+/**
+ * @brief Признаки сигнала; threshold — порог шума для zeroCrossings и slopeSignChanges
+ */
+EmgFeatures computeEmgFeatures(const float* samples, size_t count, float threshold = 0.0f);
+
+struct CsvParseResult {
+    std::string header;                 // Первая строка, если это не число
+    uint64_t badLines = 0;              // Испорченные строки (пустые не считаются)
+};
+
+/**
+ * @brief Разбирает столбец CSV в памяти; сэмплы дописываются в out
+ * @param threads Потоков на файл; кусок — не меньше CSV_MIN_CHUNK_BYTES
+ */
+CsvParseResult parseCsvColumn(const char* data, size_t size, std::vector<float>& out, unsigned threads = 1);
+
+const size_t CSV_MIN_CHUNK_BYTES = 1 << 20;
+
+struct CsvBatchOptions {
+    unsigned threads = 0;               // 0 — по числу ядер
+    std::string convertDirectory;       // Не пусто — каждый файл ещё и в DIR/<имя>.emgr
+    double sampleRate = 500.0;          // Для длительности и заголовка .emgr
+    float threshold = 0.0f;             // Порог для computeEmgFeatures()
+};
+
+struct CsvFileSummary {
+    std::string path;
+    std::string header;
+    uint64_t bytes = 0;
+    uint64_t badLines = 0;
+    EmgFeatures features;
+    std::string error;                  // Не пусто — файл не обработан
+};
+
+struct CsvBatchStats {
+    uint64_t files = 0;
+    uint64_t failed = 0;
+    uint64_t bytes = 0;
+    uint64_t samples = 0;
+    uint64_t badLines = 0;
+    int64_t elapsedNs = 0;
+};
+
+/**
+ * @brief Файлы *.csv: пути к файлам берутся как есть, каталоги просматриваются
+ *        (с подкаталогами при recursive). Результат отсортирован.
+ */
+std::vector<std::string> listCsvFiles(const std::vector<std::string>& paths, bool recursive);
+
+/**
+ * @brief Разбор, признаки и (по options.convertDirectory) конвертация всех файлов.
+ *        Ошибка в файле не прерывает пакет — она в CsvFileSummary::error.
+ * @return Сводка в порядке files
+ */
+std::vector<CsvFileSummary> ingestCsvFiles(const std::vector<std::string>& files, const CsvBatchOptions& options,
+                                           CsvBatchStats& stats);
+
+/**
+ * @brief Сводка таблицей: строка на файл, столбец на признак (CSV с заголовком)
+ */
+void writeCsvSummary(std::FILE* out, const std::vector<CsvFileSummary>& summaries, double sampleRate);
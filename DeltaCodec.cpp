@@ -0,0 +1,348 @@
+#include "DeltaCodec.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+const int RICE_K_BITS = 4;         // k = 0..15
+const int RICE_ESCAPE = 24;        // Унарный префикс такой длины означает ESCAPE_BITS бит значения следом
+const int ESCAPE_BITS = 17;        // zigzag остатка второго порядка занимает до 17 бит
+const int BASE_LZ_BITS = 6;        // Ведущие нули XOR базы: 0..32
+
+static inline int clz64(uint64_t x) {
+#ifdef _MSC_VER
+    unsigned long idx;
+    return _BitScanReverse64(&idx, x) ? 63 - (int)idx : 64;
+#else
+    return x ? __builtin_clzll(x) : 64;
+#endif
+}
+
+static inline uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t u) {
+    return (int32_t)((u >> 1) ^ (~(u & 1) + 1));
+}
+
+static inline uint32_t floatBits(float f) {
+    uint32_t u;
+    std::memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static inline float bitsFloat(uint32_t u) {
+    float f;
+    std::memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+// ---- Битовый поток, старшие биты первыми ----
+
+class BitWriter {
+private:
+    std::vector<uint8_t>& out;
+    uint64_t acc;
+    int bits;
+
+public:
+    explicit BitWriter(std::vector<uint8_t>& out_) : out(out_), acc(0), bits(0) {}
+
+    void put(uint32_t value, int n) {    // n <= 32
+        if (n == 0) return;
+        acc = (acc << n) | (value & (uint32_t)((1ull << n) - 1));
+        bits += n;
+        while (bits >= 8) {
+            bits -= 8;
+            out.push_back((uint8_t)(acc >> bits));
+        }
+    }
+
+    void putRice(uint32_t u, int k) {
+        uint32_t q = u >> k;
+        if (q >= (uint32_t)RICE_ESCAPE) {
+            put(0, RICE_ESCAPE);
+            put(1, 1);
+            put(u, ESCAPE_BITS);
+        } else {
+            put(0, (int)q);
+            put(1, 1);
+            put(u, k);
+        }
+    }
+
+    void finish() {
+        if (bits > 0) out.push_back((uint8_t)(acc << (8 - bits)));
+        bits = 0;
+    }
+};
+
+class BitReader {
+private:
+    const uint8_t* p;
+    const uint8_t* end;
+    uint64_t window;    // Следующие биты выровнены по старшему разряду
+    int avail;
+
+public:
+    BitReader(const uint8_t* data, size_t size) : p(data), end(data + size), window(0), avail(0) {}
+
+    // После refill() в окне не меньше 57 бит (за концом данных — нули)
+    inline void refill() {
+        if (avail > 56) return;
+        if (end - p >= 8) {
+            // Быстрый путь: 8 байт одним чтением, забираем только целые байты, влезающие в окно
+            uint64_t chunk = 0;
+            for (int i = 0; i < 8; ++i) chunk = (chunk << 8) | p[i];
+            int take = (63 - avail) >> 3;
+            avail += take * 8;
+            window = (window | (chunk >> (avail - take * 8))) & (~0ull << (64 - avail));
+            p += take;
+            return;
+        }
+        while (avail <= 56) {
+            window |= (uint64_t)(p < end ? *p++ : 0) << (56 - avail);
+            avail += 8;
+        }
+    }
+
+    inline uint32_t get(int n) {    // n <= 32, после refill()
+        if (n == 0) return 0;
+        uint32_t v = (uint32_t)(window >> (64 - n));
+        window <<= n;
+        avail -= n;
+        return v;
+    }
+
+    inline uint32_t getRice(int k) {
+        refill();
+        int q = clz64(window);
+        if (q >= RICE_ESCAPE) {
+            get(RICE_ESCAPE + 1);
+            return get(ESCAPE_BITS);
+        }
+        window <<= q + 1;
+        avail -= q + 1;
+        return ((uint32_t)q << k) | get(k);
+    }
+};
+
+// ---- Кодирование ----
+
+size_t encodeDeltaBlock(const NativeFrames& frames, std::vector<uint8_t>& out) {
+    const size_t start = out.size();
+    const size_t frameCount = frames.frameCount();
+
+    DeltaBlockHeader header{};
+    header.frameCount = (uint32_t)frameCount;
+    header.diffTotal = (uint32_t)frames.diffs.size();
+
+    bool regularMeta = true;
+    uint32_t metaStep = frameCount > 1 ? frames.metadata[1] - frames.metadata[0] : 0;
+    for (size_t f = 1; f < frameCount && regularMeta; ++f)
+        regularMeta = frames.metadata[f] - frames.metadata[f-1] == metaStep;
+    bool regularCount = true;
+    for (size_t f = 1; f < frameCount && regularCount; ++f)
+        regularCount = frames.diffCount[f] == frames.diffCount[0];
+    header.metadataMode = regularMeta ? 0 : 1;
+    header.countMode = regularCount ? 0 : 1;
+
+    out.resize(start + sizeof(header));
+    auto putBytes = [&out](const void* p, size_t n) {
+        const uint8_t* b = static_cast<const uint8_t*>(p);
+        out.insert(out.end(), b, b + n);
+    };
+    if (frameCount > 0) {
+        if (regularMeta) {
+            putBytes(&frames.metadata[0], 4);
+            putBytes(&metaStep, 4);
+        } else {
+            putBytes(frames.metadata.data(), frameCount * 4);
+        }
+        if (regularCount) putBytes(&frames.diffCount[0], 2);
+        else putBytes(frames.diffCount.data(), frameCount * 2);
+    }
+
+    const size_t bitstreamStart = out.size();
+    BitWriter bw(out);
+    uint32_t pred = 0;
+    size_t d = 0;
+    for (size_t f = 0; f < frameCount; ++f) {
+        const size_t n = frames.diffCount[f];
+        const int16_t* diffs = &frames.diffs[d];
+
+        // Порядок прогноза: 0 — разницы как есть, 1 — разность соседних разниц
+        // (выгодно на медленном дрейфе, невыгодно на широкополосном шуме)
+        uint64_t sum0 = 0, sum1 = 0;
+        for (size_t i = 0; i < n; ++i) {
+            sum0 += zigzag(diffs[i]);
+            sum1 += zigzag((int32_t)diffs[i] - (i > 0 ? diffs[i-1] : 0));
+        }
+        int order = sum1 < sum0 ? 1 : 0;
+        uint64_t sum = order ? sum1 : sum0;
+        int k = 0;
+        while (k < 15 && ((uint64_t)n << (k + 1)) <= sum) k++;
+        bw.put((uint32_t)k, RICE_K_BITS);
+        bw.put((uint32_t)order, 1);
+
+        uint32_t bits = floatBits(frames.base[f]);
+        uint32_t x = bits ^ pred;
+        int lz = x ? clz64(x) - 32 : 32;
+        bw.put((uint32_t)lz, BASE_LZ_BITS);
+        bw.put(x, 32 - lz);
+
+        float val = frames.base[f];
+        for (size_t i = 0; i < n; ++i) {
+            int32_t residual = order ? (int32_t)diffs[i] - (i > 0 ? diffs[i-1] : 0) : diffs[i];
+            bw.putRice(zigzag(residual), k);
+            val += static_cast<float>(diffs[i]) / EMG_DIFF_FACTOR;
+        }
+        pred = floatBits(val);    // Прогноз следующей базы — последний сэмпл кадра
+        d += n;
+    }
+    bw.finish();
+
+    header.bitstreamBytes = (uint32_t)(out.size() - bitstreamStart);
+    std::memcpy(&out[start], &header, sizeof(header));
+    return out.size() - start;
+}
+
+// ---- Декодирование ----
+
+namespace {
+
+struct BlockLayout {
+    DeltaBlockHeader header;
+    uint32_t metaFirst, metaStep;
+    const uint8_t* metaArray;
+    uint16_t countValue;
+    const uint8_t* countArray;
+    const uint8_t* bitstream;
+};
+
+BlockLayout parseBlock(const uint8_t* data, size_t size) {
+    BlockLayout l{};
+    if (size < sizeof(DeltaBlockHeader)) throw std::runtime_error("Delta block is truncated");
+    std::memcpy(&l.header, data, sizeof(l.header));
+    const uint8_t* p = data + sizeof(DeltaBlockHeader);
+    const size_t frames = l.header.frameCount;
+    size_t need = sizeof(DeltaBlockHeader) + l.header.bitstreamBytes;
+    if (frames > 0) {
+        need += l.header.metadataMode == 0 ? 8 : frames * 4;
+        need += l.header.countMode == 0 ? 2 : frames * 2;
+    }
+    if (need > size) throw std::runtime_error("Delta block is truncated");
+
+    if (frames > 0) {
+        if (l.header.metadataMode == 0) {
+            std::memcpy(&l.metaFirst, p, 4);
+            std::memcpy(&l.metaStep, p + 4, 4);
+            p += 8;
+        } else {
+            l.metaArray = p;
+            p += frames * 4;
+        }
+        if (l.header.countMode == 0) {
+            std::memcpy(&l.countValue, p, 2);
+            p += 2;
+        } else {
+            l.countArray = p;
+            p += frames * 2;
+        }
+    }
+    l.bitstream = p;
+    return l;
+}
+
+inline uint16_t frameDiffCount(const BlockLayout& l, size_t f) {
+    if (!l.countArray) return l.countValue;
+    uint16_t c;
+    std::memcpy(&c, l.countArray + 2 * f, 2);
+    return c;
+}
+
+} // namespace
+
+size_t deltaBlockSampleCount(const uint8_t* data, size_t size) {
+    DeltaBlockHeader header;
+    if (size < sizeof(header)) return 0;
+    std::memcpy(&header, data, sizeof(header));
+    return (size_t)header.frameCount + header.diffTotal;
+}
+
+size_t decodeDeltaBlockSamples(const uint8_t* data, size_t size, float* out, size_t capacity) {
+    BlockLayout l = parseBlock(data, size);
+    // Сумма разниц кадров не превышает diffTotal, поэтому сэмплов не больше frameCount + diffTotal
+    if ((size_t)l.header.frameCount + l.header.diffTotal > capacity)
+        throw std::runtime_error("Delta block does not fit the output");
+    BitReader br(l.bitstream, l.header.bitstreamBytes);
+    uint32_t pred = 0;
+    size_t n = 0;
+    size_t diffsLeft = l.header.diffTotal;
+
+    for (size_t f = 0; f < l.header.frameCount; ++f) {
+        br.refill();
+        int k = (int)br.get(RICE_K_BITS);
+        int order = (int)br.get(1);
+        int lz = (int)br.get(BASE_LZ_BITS);
+        if (lz > 32) throw std::runtime_error("Delta block is corrupted");    // 6 бит поля — до 63
+        br.refill();
+        float val = bitsFloat(br.get(32 - lz) ^ pred);
+        out[n++] = val;
+
+        size_t count = frameDiffCount(l, f);
+        if (count > diffsLeft) throw std::runtime_error("Delta block is corrupted");
+        diffsLeft -= count;
+        int16_t diff = 0;
+        for (size_t i = 0; i < count; ++i) {
+            int32_t residual = unzigzag(br.getRice(k));
+            diff = (int16_t)(order ? diff + residual : residual);
+            val += static_cast<float>(diff) / EMG_DIFF_FACTOR;
+            out[n++] = val;
+        }
+        pred = floatBits(val);
+    }
+    return n;
+}
+
+void decodeDeltaBlock(const uint8_t* data, size_t size, NativeFrames& frames) {
+    BlockLayout l = parseBlock(data, size);
+    BitReader br(l.bitstream, l.header.bitstreamBytes);
+    uint32_t pred = 0;
+    size_t diffsLeft = l.header.diffTotal;
+
+    for (size_t f = 0; f < l.header.frameCount; ++f) {
+        uint32_t meta;
+        if (l.metaArray) std::memcpy(&meta, l.metaArray + 4 * f, 4);
+        else meta = l.metaFirst + (uint32_t)f * l.metaStep;
+
+        br.refill();
+        int k = (int)br.get(RICE_K_BITS);
+        int order = (int)br.get(1);
+        int lz = (int)br.get(BASE_LZ_BITS);
+        if (lz > 32) throw std::runtime_error("Delta block is corrupted");    // 6 бит поля — до 63
+        br.refill();
+        float base = bitsFloat(br.get(32 - lz) ^ pred);
+
+        size_t count = frameDiffCount(l, f);
+        if (count > diffsLeft) throw std::runtime_error("Delta block is corrupted");
+        diffsLeft -= count;
+        frames.metadata.push_back(meta);
+        frames.base.push_back(base);
+        frames.diffCount.push_back((uint16_t)count);
+
+        float val = base;
+        int16_t diff = 0;
+        for (size_t i = 0; i < count; ++i) {
+            int32_t residual = unzigzag(br.getRice(k));
+            diff = (int16_t)(order ? diff + residual : residual);
+            frames.diffs.push_back(diff);
+            val += static_cast<float>(diff) / EMG_DIFF_FACTOR;
+        }
+        pred = floatBits(val);
+    }
+}
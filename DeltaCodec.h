@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "FrameDecoder.h"
+
+// ==== Кодек блока EMG кадров без потерь ====
+//
+// Хранит исходное представление датчика (float база + int16 разницы) и сжимает его:
+//   [DeltaBlockHeader]
+//   [метаданные: если шаг счётчика постоянный — только первое значение и шаг, иначе uint32 на кадр]
+//   [число разниц: если одинаково во всех кадрах — одно значение, иначе uint16 на кадр]
+//   [битовый поток, на кадр: 4 бита k | 1 бит порядка | база XOR прогноз | остатки кодом Райса]
+//
+// База кодируется как XOR с последним восстановленным сэмплом предыдущего кадра:
+// 6 бит числа ведущих нулей + значимые биты. Остаток — сама разница (порядок 0) или
+// разность соседних разниц (порядок 1), порядок выбирается на кадр. Остатки — zigzag + Райс,
+// k подбирается по среднему модулю; слишком длинный унарный префикс заменяется
+// escape-кодом с 17 битами значения. Каждый блок декодируется независимо.
+
+struct DeltaBlockHeader {
+    uint32_t frameCount;
+    uint32_t diffTotal;
+    uint32_t bitstreamBytes;
+    uint8_t  metadataMode;      // 0 — арифметическая прогрессия, 1 — uint32 на кадр
+    uint8_t  countMode;         // 0 — одинаковое число разниц, 1 — uint16 на кадр
+    uint16_t reserved0;
+};
+
+static_assert(sizeof(DeltaBlockHeader) == 16, "DeltaBlockHeader layout");
+
+/**
+ * @brief Сжимает кадры в блок, дописывая байты в конец out
+ * @return Размер блока в байтах
+ */
+size_t encodeDeltaBlock(const NativeFrames& frames, std::vector<uint8_t>& out);
+
+/**
+ * @brief Восстанавливает кадры блока в исходном виде (дописывает в frames)
+ */
+void decodeDeltaBlock(const uint8_t* data, size_t size, NativeFrames& frames);
+
+/**
+ * @brief Быстрый путь: сразу в float сэмплы, побитово как FrameDecoder
+ * @param capacity Размер out; блок, где frameCount + diffTotal больше, — исключение
+ * @return Количество сэмплов
+ */
+size_t decodeDeltaBlockSamples(const uint8_t* data, size_t size, float* out, size_t capacity);
+
+/**
+ * @brief Количество сэмплов в блоке без декодирования
+ */
+size_t deltaBlockSampleCount(const uint8_t* data, size_t size);
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// ==== Профиль устройства: геометрия кадра и частота, известные при компиляции ====
+//
+// Кадр датчика: [0xA5][len][addr][len^addr][payload: len-2 байт][0x5A], всего len + 3 байт.
+// EMG кадр (addr = 0x12): payload = [4 байта метаданных][float база][int16 разницы ...],
+// каждый следующий сэмпл = предыдущий + разница / EMG_DIFF_FACTOR.
+//
+// Профиль — тип со статическими constexpr полями (см. EmgDeviceProfile). Декодер,
+// специализированный профилем (BasicFrameDecoder в FrameDecoder.h), разбирает кадры ожидаемой
+// длины развёрнутым циклом, кадры другой длины — общим путём.
+
+const uint8_t FRAME_HEAD = 0xA5;
+const uint8_t FRAME_TAIL = 0x5A;
+const uint8_t FRAME_ADDR_EMG = 0x12;
+const size_t  FRAME_MIN_BYTES = 7;
+const size_t  EMG_METADATA_BYTES = 4;
+constexpr float EMG_DIFF_FACTOR = 3.1457f;
+
+/**
+ * @brief EMG устройство с фиксированной частотой и числом сэмплов в кадре
+ * @tparam SamplesPerFrame 0 — длина кадра заранее не известна (только общий путь декодера)
+ */
+template <uint32_t RateHz, uint32_t SamplesPerFrame, uint32_t Channels = 1>
+struct EmgDeviceProfile {
+    static constexpr double   sampleRate      = RateHz;
+    static constexpr uint32_t samplesPerFrame = SamplesPerFrame;
+    static constexpr uint32_t channelCount    = Channels;          // Формат кадра пока одноканальный
+    static constexpr size_t   metadataBytes   = EMG_METADATA_BYTES;
+    static constexpr float    diffFactor      = EMG_DIFF_FACTOR;   // Масштаб разниц
+
+    // Байт len и полная длина кадра ожидаемого размера
+    static constexpr size_t payloadBytes = SamplesPerFrame > 0 ? metadataBytes + 4 + 2 * (SamplesPerFrame - 1) : 0;
+    static constexpr uint8_t frameLenByte = (uint8_t)(payloadBytes + 2);
+    static constexpr size_t frameBytes = payloadBytes + 5;
+
+    static_assert(payloadBytes + 2 <= 255, "Frame does not fit the len byte");
+};
+
+typedef EmgDeviceProfile<500, 0>  GenericEmgProfile;    // Любая длина кадра
+typedef EmgDeviceProfile<500, 16> DefaultEmgDevice;     // Датчик по умолчанию: 500 Гц, 16 сэмплов в кадре
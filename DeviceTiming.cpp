@@ -0,0 +1,217 @@
+#include "DeviceTiming.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+const size_t DETECT_FRAMES = 8;            // Кадров для выбора смысла метаданных
+const double DETECT_MATCH_SHARE = 0.75;    // Доля совпавших приращений (допускает потерю кадра в окне)
+const double MAX_GAP_SECONDS = 60.0;       // Больше — считаем перезапуском устройства, а не потерей
+
+const char* metadataModeName(MetadataMode mode) {
+    switch (mode) {
+        case MetadataMode::Detecting:     return "detecting";
+        case MetadataMode::FrameCounter:  return "frame counter";
+        case MetadataMode::SampleCounter: return "sample counter";
+        case MetadataMode::TimestampMs:   return "timestamp ms";
+        case MetadataMode::TimestampUs:   return "timestamp us";
+        case MetadataMode::None:          return "none";
+    }
+    return "?";
+}
+
+FrameSequencer::FrameSequencer(double sampleRate_) : sampleRate(sampleRate_) {
+    reset();
+}
+
+void FrameSequencer::reset() {
+    mode = MetadataMode::Detecting;
+    detectWindow.clear();
+    counterMask = 0xFFFFFFFF;
+    havePrevious = false;
+    prevMetadata = 0;
+    prevSamples = 0;
+    prevBase = 0.0f;
+    prevDiffs.clear();
+    sequence = 0;
+    deviceSample = 0;
+    deviceTimeNs = 0;
+    timeOriginUnits = 0.0;
+    frames = 0;
+    lostFrames = 0;
+    lostSamples = 0;
+    duplicates = 0;
+    discontinuities = 0;
+}
+
+double FrameSequencer::unitsPerSecond() const {
+    switch (mode) {
+        case MetadataMode::TimestampMs: return 1e3;
+        case MetadataMode::TimestampUs: return 1e6;
+        default:                        return sampleRate;
+    }
+}
+
+void FrameSequencer::detect() {
+    size_t counts[4] = {0, 0, 0, 0};    // кадры, сэмплы, мс, мкс
+    for (size_t i = 1; i < detectWindow.size(); ++i) {
+        double d = (double)(uint32_t)(detectWindow[i].metadata - detectWindow[i-1].metadata);
+        double p = (double)detectWindow[i-1].samples;
+        double ms = p * 1e3 / sampleRate;
+        double us = p * 1e6 / sampleRate;
+        if (d == 1.0) counts[0]++;
+        if (d == p) counts[1]++;
+        if (std::fabs(d - ms) <= std::max(1.0, 0.25 * ms)) counts[2]++;
+        if (std::fabs(d - us) <= 0.25 * us) counts[3]++;
+    }
+    const MetadataMode modes[4] = {MetadataMode::FrameCounter, MetadataMode::SampleCounter,
+                                   MetadataMode::TimestampMs, MetadataMode::TimestampUs};
+    size_t best = 0;
+    for (size_t m = 1; m < 4; ++m)
+        if (counts[m] > counts[best]) best = m;
+    size_t deltas = detectWindow.size() - 1;
+    mode = (double)counts[best] >= DETECT_MATCH_SHARE * (double)deltas ? modes[best] : MetadataMode::None;
+    detectWindow.clear();
+
+    // Дальше номер кадра — развёрнутые метаданные; шкала времени продолжает уже выданную
+    if (mode != MetadataMode::None) {
+        sequence = prevMetadata;
+        timeOriginUnits = (double)sequence - (double)deviceSample * unitsPerSecond() / sampleRate;
+    }
+}
+
+uint32_t FrameSequencer::maskedDelta(uint32_t metadata, uint64_t expected) {
+    uint32_t delta = (metadata - prevMetadata) & counterMask;
+    // Переполнение 8- или 16-битного счётчика выглядит как большой скачок назад
+    if (counterMask == 0xFFFFFFFF && metadata < prevMetadata) {
+        for (uint32_t mask : {0xFFu, 0xFFFFu}) {
+            uint32_t narrow = (metadata - prevMetadata) & mask;
+            if ((prevMetadata & ~mask) == 0 && narrow <= 4 * expected + 4) {
+                counterMask = mask;
+                return narrow;
+            }
+        }
+    }
+    return delta;
+}
+
+void FrameSequencer::process(const NativeFrames& batch, std::vector<FrameTiming>& timing) {
+    size_t d = 0;
+    for (size_t f = 0; f < batch.frameCount(); ++f) {
+        const uint32_t meta = batch.metadata[f];
+        const uint32_t count = batch.diffCount[f];
+        const int16_t* diffs = batch.diffs.data() + d;
+        d += count;
+        frames++;
+
+        if (!havePrevious) {
+            havePrevious = true;
+            prevMetadata = meta;
+            prevSamples = count + 1;
+            prevBase = batch.base[f];
+            prevDiffs.assign(diffs, diffs + count);
+            detectWindow.push_back({meta, count + 1});
+            timing.push_back({sequence, 0, 0, 0, false});
+            continue;
+        }
+
+        const bool sameContent = meta == prevMetadata && count + 1 == prevSamples &&
+            std::memcmp(&batch.base[f], &prevBase, sizeof(float)) == 0 &&
+            std::memcmp(diffs, prevDiffs.data(), count * sizeof(int16_t)) == 0;
+        const uint64_t maxGapSamples = (uint64_t)(MAX_GAP_SECONDS * sampleRate);
+        bool duplicate = false;
+        uint64_t lost = 0;
+        uint64_t advance = 1;    // Приращение sequence; после разрыва — ожидаемое, чтобы шкала шла дальше без скачка
+
+        switch (mode) {
+            case MetadataMode::Detecting:
+            case MetadataMode::None:
+                duplicate = sameContent;
+                break;
+            case MetadataMode::FrameCounter: {
+                uint32_t delta = maskedDelta(meta, 1);
+                advance = delta;
+                if (delta == 0) duplicate = true;
+                else if ((uint64_t)(delta - 1) * prevSamples > maxGapSamples) {
+                    discontinuities++;
+                    advance = 1;
+                } else {
+                    lostFrames += delta - 1;
+                    lost = (uint64_t)(delta - 1) * prevSamples;
+                }
+                break;
+            }
+            case MetadataMode::SampleCounter: {
+                uint32_t delta = maskedDelta(meta, prevSamples);
+                advance = delta;
+                if (delta == 0) duplicate = true;
+                else if (delta < prevSamples || delta - prevSamples > maxGapSamples) {
+                    discontinuities++;
+                    advance = prevSamples;
+                } else {
+                    lost = delta - prevSamples;
+                }
+                break;
+            }
+            case MetadataMode::TimestampMs:
+            case MetadataMode::TimestampUs: {
+                const double units = unitsPerSecond();
+                const uint64_t expected = (uint64_t)std::llround(prevSamples * units / sampleRate);
+                uint32_t delta = maskedDelta(meta, expected);
+                advance = delta;
+                uint64_t elapsed = (uint64_t)std::llround((double)delta * sampleRate / units);
+                if (delta == 0) duplicate = true;
+                else if (elapsed > prevSamples + maxGapSamples) {
+                    discontinuities++;
+                    advance = expected;
+                }
+                else if (elapsed > prevSamples + std::max<uint64_t>(1, prevSamples / 2)) lost = elapsed - prevSamples;    // Меньше — дрожание метки
+                break;
+            }
+        }
+
+        if (duplicate) {
+            duplicates++;
+            timing.push_back({sequence, deviceSample, deviceTimeNs, 0, true});
+            continue;
+        }
+
+        if (lost > 0 && mode != MetadataMode::FrameCounter) lostFrames += (lost + prevSamples / 2) / prevSamples;
+        lostSamples += lost;
+        deviceSample += prevSamples + lost;
+        sequence += (mode == MetadataMode::Detecting || mode == MetadataMode::None) ? 1 : advance;
+
+        if (mode == MetadataMode::TimestampMs || mode == MetadataMode::TimestampUs)
+            deviceTimeNs = (int64_t)(((double)sequence - timeOriginUnits) * 1e9 / unitsPerSecond());
+        else
+            deviceTimeNs = (int64_t)((double)deviceSample * 1e9 / sampleRate);
+        timing.push_back({sequence, deviceSample, deviceTimeNs, (uint32_t)lost, false});
+
+        prevMetadata = meta;
+        prevSamples = count + 1;
+        prevBase = batch.base[f];
+        prevDiffs.assign(diffs, diffs + count);
+        if (mode == MetadataMode::Detecting) {
+            detectWindow.push_back({meta, count + 1});
+            if (detectWindow.size() >= DETECT_FRAMES) detect();
+        }
+    }
+}
+
+// ==== RateWindow ====
+
+RateWindow::RateWindow(int64_t windowNs_) : windowNs(windowNs_), total(0) {}
+
+void RateWindow::add(int64_t timeNs, size_t samples) {
+    total += samples;
+    points.push_back({timeNs, total});
+    // Первая точка — последняя до начала окна: сэмплы считаются после неё
+    while (points.size() > 2 && points[1].timeNs <= timeNs - windowNs) points.pop_front();
+}
+
+double RateWindow::rate(int64_t nowNs) const {
+    if (points.empty()) return 0.0;
+    int64_t span = nowNs - points.front().timeNs;
+    if (span <= 0) return 0.0;
+    return (double)(total - points.front().total) * 1e9 / (double)span;
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "FrameDecoder.h"
+
+// ==== Время устройства по 4 байтам метаданных EMG кадра ====
+//
+// Что лежит в метаданных, зависит от прошивки, поэтому смысл поля определяется по первым
+// кадрам: счётчик кадров (+1 на кадр), счётчик сэмплов (+число сэмплов кадра) или метка
+// времени в мс / мкс (+сэмплы / частота). Поле читается как uint32 LE; 8- и 16-битные
+// счётчики распознаются по переполнению. Если закономерности нет — время берётся по номеру
+// сэмпла, а повторы ищутся по содержимому кадра.
+
+enum class MetadataMode {
+    Detecting,       // Первые кадры, закономерность ещё не выбрана
+    FrameCounter,
+    SampleCounter,
+    TimestampMs,
+    TimestampUs,
+    None,            // Метаданные не похожи ни на счётчик, ни на время
+};
+
+const char* metadataModeName(MetadataMode mode);
+
+/**
+ * @brief Время и номер кадра в шкале устройства
+ */
+struct FrameTiming {
+    uint64_t sequence;         // Номер кадра по устройству (развёрнутый счётчик / метка времени)
+    uint64_t deviceSample;     // Индекс первого сэмпла кадра с учётом потерянных
+    int64_t  deviceTimeNs;     // Время первого сэмпла по часам устройства от начала потока
+    uint32_t lostSamples;      // Потеряно сэмплов перед этим кадром
+    bool     duplicate;        // Повтор предыдущего кадра, сэмплы выброшены
+};
+
+/**
+ * @brief Разбор метаданных: номер и время кадра, потерянные и повторённые кадры
+ */
+class FrameSequencer {
+private:
+    struct Observation {
+        uint32_t metadata;
+        uint32_t samples;
+    };
+
+    double sampleRate;
+    MetadataMode mode;
+    std::vector<Observation> detectWindow;
+    uint32_t counterMask;          // 0xFF / 0xFFFF / 0xFFFFFFFF
+    bool havePrevious;
+    uint32_t prevMetadata;
+    uint32_t prevSamples;
+    float prevBase;
+    std::vector<int16_t> prevDiffs;
+    uint64_t sequence;             // Развёрнутое значение метаданных
+    uint64_t deviceSample;         // Индекс первого сэмпла последнего кадра
+    int64_t deviceTimeNs;          // Его время по часам устройства
+    double timeOriginUnits;        // Метка времени, соответствующая сэмплу 0
+
+    uint64_t frames;
+    uint64_t lostFrames;
+    uint64_t lostSamples;
+    uint64_t duplicates;
+    uint64_t discontinuities;      // Скачки назад / на минуты вперёд (перезапуск устройства)
+
+    void detect();
+    double unitsPerSecond() const;
+    uint32_t maskedDelta(uint32_t metadata, uint64_t expected);
+
+public:
+    explicit FrameSequencer(double sampleRate = 500.0);
+
+    /**
+     * @brief Разбирает кадры; для каждого кадра в timing дописывается FrameTiming
+     */
+    void process(const NativeFrames& frames, std::vector<FrameTiming>& timing);
+
+    void reset();
+
+    MetadataMode getMode() const { return mode; }
+    uint64_t getFrames() const { return frames; }
+    uint64_t getLostFrames() const { return lostFrames; }
+    uint64_t getLostSamples() const { return lostSamples; }
+    uint64_t getDuplicates() const { return duplicates; }
+    uint64_t getDiscontinuities() const { return discontinuities; }
+};
+
+/**
+ * @brief Частота по скользящему окну: сэмплы за последние windowNs по часам хоста
+ */
+class RateWindow {
+private:
+    struct Point {
+        int64_t timeNs;
+        uint64_t total;            // Накопленное число сэмплов
+    };
+
+    int64_t windowNs;
+    std::deque<Point> points;
+    uint64_t total;
+
+public:
+    explicit RateWindow(int64_t windowNs = 2000000000);
+
+    void add(int64_t timeNs, size_t samples);
+
+    // Сэмплов в секунду на момент nowNs; без данных окно "остывает" до нуля
+    double rate(int64_t nowNs) const;
+};
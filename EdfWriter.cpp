@@ -0,0 +1,295 @@
+#include "EdfWriter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <stdexcept>
+
+const size_t EDF_RESERVED_OFFSET = 192;        // Поле "reserved": EDF+C / EDF+D
+const size_t EDF_RECORD_COUNT_OFFSET = 236;    // Поле "number of data records" в заголовке
+const double EDF_PHYSICAL_LIMIT = 10000.0;
+const double BDF_PHYSICAL_LIMIT = 2000000.0;
+const char TAL_DURATION = 0x15;
+const char TAL_SEPARATOR = 0x14;
+const size_t TAL_KEEPING_MAX_BYTES = 24;      // "+" + время записи до 1e16 с ("%.3f") + 0x14 0x14 0x00
+
+// Поле заголовка: ASCII, дополненное пробелами до width и обрезанное по width
+static void putField(std::string& header, const std::string& value, size_t width) {
+    std::string field = value.substr(0, width);
+    field.resize(width, ' ');
+    header += field;
+}
+
+static std::string formatNumber(double value) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.0f", value);
+    return buf;
+}
+
+static std::string formatSeconds(double seconds) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.3f", seconds);
+    // Хвостовые нули дробной части TAL не нужны
+    std::string s = buf;
+    s.erase(s.find_last_not_of('0') + 1);
+    if (!s.empty() && s.back() == '.') s.pop_back();
+    return s;
+}
+
+EdfWriter::EdfWriter()
+    : lossless(false),
+      bytesPerSample(2),
+      samplesPerRecord(0),
+      annotationOffset(0),
+      digitalMin(0),
+      digitalMax(0),
+      gain(1.0f),
+      fill(0),
+      recordCount(0),
+      recordSlot(0),
+      droppedRecords(0),
+      droppedAnnotations(0),
+      totalSamples(0) {}
+
+EdfWriter::~EdfWriter() {
+    close();
+}
+
+void EdfWriter::open(const std::string& path_, const EdfInfo& info_, const AsyncWriterOptions& writerOptions,
+                     bool lossless_) {
+    close();
+    path = path_;
+    info = info_;
+    lossless = lossless_;
+    if (info.channels.empty()) info.channels.push_back(EdfChannel());
+
+    double perRecord = info.sampleRate * info.recordSeconds;
+    samplesPerRecord = (size_t)std::llround(perRecord);
+    if (samplesPerRecord == 0 || std::fabs(perRecord - (double)samplesPerRecord) > 1e-6)
+        throw std::invalid_argument("EdfWriter: sampleRate * recordSeconds must be a whole number");
+
+    bytesPerSample = info.format == EdfFormat::Bdf ? 3 : 2;
+    info.annotationBytes += info.annotationBytes % bytesPerSample ? bytesPerSample - info.annotationBytes % bytesPerSample : 0;
+    // Отметка времени записи и хотя бы одна TAL той же длины (пустой текст)
+    if (info.annotationBytes < 2 * TAL_KEEPING_MAX_BYTES)
+        throw std::invalid_argument("EdfWriter: annotationBytes must be at least " +
+                                    std::to_string(2 * TAL_KEEPING_MAX_BYTES));
+
+    // Физический диапазон кратен 1 / scaleFactor без остатка, если произведение целое (10000 * 3.1457 = 31457)
+    double physicalLimit = info.format == EdfFormat::Bdf ? BDF_PHYSICAL_LIMIT : EDF_PHYSICAL_LIMIT;
+    const double digitalLimit = info.format == EdfFormat::Bdf ? 8388607.0 : 32767.0;
+    while (physicalLimit * info.scaleFactor > digitalLimit) physicalLimit /= 10.0;
+    digitalMax = (int32_t)std::lround(physicalLimit * info.scaleFactor);
+    digitalMin = -digitalMax;
+    gain = info.scaleFactor;
+
+    channelOffset.clear();
+    size_t offset = 0;
+    for (size_t ch = 0; ch < info.channels.size(); ++ch) {
+        channelOffset.push_back(offset);
+        offset += samplesPerRecord * bytesPerSample;
+    }
+    annotationOffset = offset;
+    record.assign(offset + info.annotationBytes, 0);
+
+    annotations.clear();
+    fill = 0;
+    recordCount = 0;
+    recordSlot = 0;
+    droppedRecords = 0;
+    droppedAnnotations = 0;
+    totalSamples = 0;
+
+    output.open(path, writerOptions);
+    writeHeader();
+}
+
+void EdfWriter::writeHeader() {
+    const bool bdf = info.format == EdfFormat::Bdf;
+    const size_t signals = info.channels.size() + 1;    // + канал аннотаций
+    std::time_t t = std::time(nullptr);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &t);
+#else
+    localtime_r(&t, &local);
+#endif
+    static const char* MONTHS[] = {"JAN", "FEB", "MAR", "APR", "MAY", "JUN",
+                                   "JUL", "AUG", "SEP", "OCT", "NOV", "DEC"};
+    char date[32], time[32], startdate[32];
+    std::snprintf(date, sizeof(date), "%02d.%02d.%02d", local.tm_mday, local.tm_mon + 1, local.tm_year % 100);
+    std::snprintf(time, sizeof(time), "%02d.%02d.%02d", local.tm_hour, local.tm_min, local.tm_sec);
+    std::snprintf(startdate, sizeof(startdate), "%02d-%s-%04d", local.tm_mday, MONTHS[local.tm_mon], local.tm_year + 1900);
+
+    std::string h;
+    h.reserve(256 * (signals + 1));
+    if (bdf) {
+        h += '\xFF';
+        putField(h, "BIOSEMI", 7);
+    } else {
+        putField(h, "0", 8);
+    }
+    putField(h, info.patient, 80);
+    putField(h, std::string("Startdate ") + startdate + " X X " + info.equipment, 80);
+    putField(h, date, 8);
+    putField(h, time, 8);
+    putField(h, std::to_string(256 * (signals + 1)), 8);
+    putField(h, bdf ? "BDF+C" : "EDF+C", 44);
+    putField(h, "-1", 8);                                   // Число записей — правится в close()
+    putField(h, formatSeconds(info.recordSeconds), 8);
+    putField(h, std::to_string(signals), 4);
+
+    const std::string annotationLabel = bdf ? "BDF Annotations" : "EDF Annotations";
+    const std::string physMin = formatNumber(-(double)digitalMax / info.scaleFactor);
+    const std::string physMax = formatNumber((double)digitalMax / info.scaleFactor);
+    const std::string annDigMin = bdf ? "-8388608" : "-32768";
+    const std::string annDigMax = bdf ? "8388607" : "32767";
+
+    // Поля заголовка сигналов идут по полю для всех сигналов сразу
+    for (const EdfChannel& c : info.channels) putField(h, c.label, 16);
+    putField(h, annotationLabel, 16);
+    for (const EdfChannel& c : info.channels) putField(h, c.transducer, 80);
+    putField(h, "", 80);
+    for (const EdfChannel& c : info.channels) putField(h, c.physicalDimension, 8);
+    putField(h, "", 8);
+    for (size_t i = 0; i < info.channels.size(); ++i) putField(h, physMin, 8);
+    putField(h, "-1", 8);
+    for (size_t i = 0; i < info.channels.size(); ++i) putField(h, physMax, 8);
+    putField(h, "1", 8);
+    for (size_t i = 0; i < info.channels.size(); ++i) putField(h, std::to_string(digitalMin), 8);
+    putField(h, annDigMin, 8);
+    for (size_t i = 0; i < info.channels.size(); ++i) putField(h, std::to_string(digitalMax), 8);
+    putField(h, annDigMax, 8);
+    for (const EdfChannel& c : info.channels) putField(h, c.prefilter, 80);
+    putField(h, "", 80);
+    for (size_t i = 0; i < info.channels.size(); ++i) putField(h, std::to_string(samplesPerRecord), 8);
+    putField(h, std::to_string(info.annotationBytes / bytesPerSample), 8);
+    for (size_t i = 0; i < signals; ++i) putField(h, "", 32);
+
+    output.writeBlocking(h.data(), h.size());
+}
+
+void EdfWriter::append(const float* samples, size_t count) {
+    if (!output.isOpen()) return;
+    const size_t channels = info.channels.size();
+    const float lo = (float)digitalMin, hi = (float)digitalMax;
+
+    while (count > 0) {
+        size_t take = std::min(count, samplesPerRecord - fill);
+        for (size_t ch = 0; ch < channels; ++ch) {
+            uint8_t* dst = &record[channelOffset[ch] + (size_t)fill * bytesPerSample];
+            const float* src = samples + ch;
+            for (size_t i = 0; i < take; ++i, src += channels, dst += bytesPerSample) {
+                float scaled = *src * gain;
+                // NaN не проходит ни одно сравнение и даёт 0; округление от нуля без вызова lrint()
+                int32_t d = scaled >= lo ? (scaled <= hi ? (int32_t)(scaled + (scaled >= 0.0f ? 0.5f : -0.5f)) : digitalMax)
+                                         : (scaled < lo ? digitalMin : 0);
+                dst[0] = (uint8_t)d;
+                dst[1] = (uint8_t)(d >> 8);
+                if (bytesPerSample == 3) dst[2] = (uint8_t)(d >> 16);
+            }
+        }
+        samples += take * channels;
+        count -= take;
+        fill += (uint32_t)take;
+        totalSamples += take;
+        if (fill == samplesPerRecord) flushRecord(lossless);
+    }
+}
+
+void EdfWriter::appendGap(size_t count, const std::string& text) {
+    if (!output.isOpen() || count == 0) return;
+    annotate(getElapsedSeconds(), (double)count / info.sampleRate, text);
+    std::vector<float> zeros(std::min(count, samplesPerRecord) * info.channels.size(), 0.0f);
+    while (count > 0) {
+        size_t take = std::min(count, samplesPerRecord);
+        append(zeros.data(), take);
+        count -= take;
+    }
+}
+
+void EdfWriter::annotate(double onsetSeconds, double durationSeconds, const std::string& text) {
+    if (!output.isOpen()) return;
+    std::string tal = (onsetSeconds < 0 ? "" : "+") + formatSeconds(onsetSeconds);
+    if (durationSeconds > 0) tal += TAL_DURATION + formatSeconds(durationSeconds);
+    tal += TAL_SEPARATOR;
+    // Текст урезается, чтобы TAL поместилась в запись вместе с самой длинной отметкой времени записи
+    const size_t budget = info.annotationBytes - TAL_KEEPING_MAX_BYTES;
+    if (tal.size() + 2 > budget) {    // Не помещается даже без текста (длинная длительность)
+        droppedAnnotations++;
+        return;
+    }
+    tal += text.substr(0, budget - tal.size() - 2);
+    tal += TAL_SEPARATOR;
+    tal += '\0';
+    annotations.push_back(tal);
+}
+
+void EdfWriter::flushRecord(bool blocking) {
+    // Первая TAL каждой записи — её время от начала файла
+    std::string keeping = "+" + formatSeconds((double)recordSlot * info.recordSeconds);
+    keeping += TAL_SEPARATOR;
+    keeping += TAL_SEPARATOR;
+    keeping += '\0';
+
+    // TAL, которой не хватает и пустой записи, очередь не держит: отбрасывается
+    while (!annotations.empty() && keeping.size() + annotations.front().size() > info.annotationBytes) {
+        annotations.pop_front();
+        droppedAnnotations++;
+    }
+
+    uint8_t* ann = &record[annotationOffset];
+    size_t used = std::min(keeping.size(), info.annotationBytes);
+    std::memcpy(ann, keeping.data(), used);
+    size_t taken = 0;
+    for (; taken < annotations.size() && used + annotations[taken].size() <= info.annotationBytes; ++taken) {
+        std::memcpy(ann + used, annotations[taken].data(), annotations[taken].size());
+        used += annotations[taken].size();
+    }
+
+    if (blocking) output.writeBlocking(record.data(), record.size());
+    if (blocking || output.write(record.data(), record.size())) {
+        annotations.erase(annotations.begin(), annotations.begin() + taken);
+        recordCount++;
+    } else {
+        droppedRecords++;
+    }
+    std::fill(record.begin(), record.end(), 0);
+    fill = 0;
+    recordSlot++;
+}
+
+void EdfWriter::patchHeader() {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file) return;
+    std::string field;
+    if (droppedRecords > 0) {
+        // Записи идут не подряд: время каждой — в её первой TAL
+        putField(field, info.format == EdfFormat::Bdf ? "BDF+D" : "EDF+D", 44);
+        file.seekp(EDF_RESERVED_OFFSET);
+        file.write(field.data(), (std::streamsize)field.size());
+        field.clear();
+    }
+    putField(field, std::to_string(recordCount), 8);
+    file.seekp(EDF_RECORD_COUNT_OFFSET);
+    file.write(field.data(), (std::streamsize)field.size());
+}
+
+void EdfWriter::close() {
+    if (!output.isOpen()) return;
+    // Неполная запись дополняется нулями; аннотации, не поместившиеся до конца, — в лишние записи.
+    // Здесь записи не отбрасываются: close() не на пути данных
+    if (fill > 0) {
+        totalSamples += samplesPerRecord - fill;
+        flushRecord(true);
+    }
+    while (!annotations.empty()) {
+        totalSamples += samplesPerRecord;
+        flushRecord(true);
+    }
+    output.close();
+    patchHeader();
+}
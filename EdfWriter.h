@@ -0,0 +1,123 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "AsyncFileWriter.h"
+
+// ==== Потоковая запись EDF+ / BDF+ ====
+//
+//   [заголовок ASCII: 256 + 256 * (каналы + 1) байт]
+//   [запись данных: сэмплы канала 0 | канала 1 | ... | "EDF Annotations"] x N
+//
+// Сэмплы хранятся целыми: digital = round(physical * scaleFactor), то есть один отсчёт равен
+// разнице кадра датчика (1 / 3.1457). Диапазоны выбраны так, чтобы (physMax - physMin) / (digMax - digMin)
+// давало ровно 1 / scaleFactor: EDF — ±10000 <-> ±31457, BDF (24 бит) — ±2000000 <-> ±6291400.
+// Число записей в заголовке — -1 до close(), затем правится только это поле (8 байт), файл не переписывается.
+// Метки и пропуски пишутся TAL-аннотациями EDF+ в тот блок, где они произошли.
+// Запись данных, не поместившаяся в буферы писателя, отбрасывается целиком; время каждой записи стоит
+// в её первой TAL, поэтому после такого пропуска close() правит и тип файла на EDF+D / BDF+D.
+
+enum class EdfFormat {
+    Edf,    // 16 бит на сэмпл
+    Bdf,    // 24 бита на сэмпл (BioSemi)
+};
+
+struct EdfChannel {
+    std::string label = "EMG";
+    std::string transducer = "sEMG electrode";
+    std::string physicalDimension = "uV";
+    std::string prefilter;
+};
+
+struct EdfInfo {
+    EdfFormat format = EdfFormat::Edf;
+    std::vector<EdfChannel> channels;       // Пусто — один канал "EMG"
+    double sampleRate = 500.0;
+    double recordSeconds = 1.0;             // Длительность записи данных; sampleRate * recordSeconds — целое
+    float scaleFactor = 3.1457f;            // Фактор разниц устройства
+    std::string patient = "X X X X";        // Поле пациента EDF+: код, пол, дата рождения, имя
+    std::string equipment = "RecorderEMG";
+    size_t annotationBytes = 120;           // Байт под аннотации в каждой записи данных, не меньше 48
+};
+
+/**
+ * @brief Запись EDF+/BDF+ через AsyncFileWriter. Записи данных целиком собираются в памяти
+ *        и отдаются писателю, поэтому вызывающий поток не ждёт диск. Отброшенная запись
+ *        в файл не попадает, её аннотации переходят в следующую.
+ */
+class EdfWriter {
+private:
+    AsyncFileWriter output;
+    std::string path;
+    EdfInfo info;
+    bool lossless;                          // Записи пишутся writeBlocking()
+    std::vector<uint8_t> record;            // Текущая запись данных
+    std::vector<size_t> channelOffset;      // Смещение канала в записи
+    std::deque<std::string> annotations;    // TAL, ждущие своей записи
+    size_t bytesPerSample;
+    size_t samplesPerRecord;
+    size_t annotationOffset;
+    int32_t digitalMin, digitalMax;
+    float gain;                             // physical -> digital
+    uint32_t fill;                          // Заполнено сэмплов на канал в текущей записи
+    uint64_t recordCount;                   // Записано в файл
+    uint64_t recordSlot;                    // Номер текущей записи по времени, с отброшенными
+    uint64_t droppedRecords;
+    uint64_t droppedAnnotations;            // TAL, не поместившиеся в запись даже без текста
+    uint64_t totalSamples;
+
+    void writeHeader();
+    void flushRecord(bool blocking);
+    void patchHeader();
+
+public:
+    EdfWriter();
+    ~EdfWriter();
+
+    EdfWriter(const EdfWriter&) = delete;
+    EdfWriter& operator=(const EdfWriter&) = delete;
+
+    /**
+     * @param lossless Ждать свободный буфер писателя вместо отбрасывания записи (конвертация файлов)
+     * @throws std::invalid_argument sampleRate * recordSeconds не целое, annotationBytes меньше 48
+     */
+    void open(const std::string& path, const EdfInfo& info,
+              const AsyncWriterOptions& writerOptions = AsyncWriterOptions(), bool lossless = false);
+
+    /**
+     * @brief Добавляет сэмплы
+     * @param samples Кадры, чередующиеся по каналам: count * channelCount значений
+     * @param count Количество кадров (сэмплов на канал)
+     */
+    void append(const float* samples, size_t count);
+
+    /**
+     * @brief Заполняет пропуск нулями и отмечает его аннотацией с длительностью
+     */
+    void appendGap(size_t count, const std::string& text = "Gap");
+
+    /**
+     * @brief Аннотация EDF+ (метка, событие)
+     * @param onsetSeconds От начала записи
+     * @param durationSeconds 0 — без длительности
+     *        Текст урезается по annotationBytes; TAL, не помещающаяся и без текста, отбрасывается
+     *        (getDroppedAnnotations()).
+     */
+    void annotate(double onsetSeconds, double durationSeconds, const std::string& text);
+
+    /**
+     * @brief Дописывает неполную запись (нулями) и оставшиеся аннотации, правит число записей
+     */
+    void close();
+
+    bool isOpen() const { return output.isOpen(); }
+    double getElapsedSeconds() const { return (double)totalSamples / info.sampleRate; }
+    AsyncWriterStats getWriterStats() { return output.getStats(); }
+    uint64_t getTotalSamples() const { return totalSamples; }
+    uint64_t getRecordCount() const { return recordCount; }
+    uint64_t getDroppedRecords() const { return droppedRecords; }
+    uint64_t getDroppedAnnotations() const { return droppedAnnotations; }
+};
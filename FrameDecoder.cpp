@@ -0,0 +1,242 @@
+#include "FrameDecoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+void NativeFrames::clear() {
+    metadata.clear();
+    base.clear();
+    diffCount.clear();
+    diffs.clear();
+}
+
+void NativeFrames::appendFrame(uint32_t meta, float first, const int16_t* frameDiffs, size_t count) {
+    metadata.push_back(meta);
+    base.push_back(first);
+    diffCount.push_back((uint16_t)count);
+    diffs.insert(diffs.end(), frameDiffs, frameDiffs + count);
+}
+
+void NativeFrames::append(const NativeFrames& other) {
+    metadata.insert(metadata.end(), other.metadata.begin(), other.metadata.end());
+    base.insert(base.end(), other.base.begin(), other.base.end());
+    diffCount.insert(diffCount.end(), other.diffCount.begin(), other.diffCount.end());
+    diffs.insert(diffs.end(), other.diffs.begin(), other.diffs.end());
+}
+
+void NativeFrames::expand(std::vector<float>& out) const {
+    const size_t start = out.size();
+    out.resize(start + sampleCount());
+    expand(out.data() + start);
+}
+
+void NativeFrames::expand(float* out) const {
+    size_t d = 0;
+    for (size_t f = 0; f < base.size(); ++f) {
+        float val = base[f];
+        *out++ = val;
+        for (size_t k = 0; k < diffCount[f]; ++k) {
+            val += static_cast<float>(diffs[d++]) / EMG_DIFF_FACTOR;
+            *out++ = val;
+        }
+    }
+}
+
+// Куда декодер пишет сэмплы: extend(n) — место под n сэмплов, nullptr — кадр не помещается
+struct VectorSampleSink {
+    std::vector<float>& out;
+    float* extend(size_t n) {
+        const size_t start = out.size();
+        out.resize(start + n);
+        return out.data() + start;
+    }
+};
+
+struct BlockSampleSink {
+    SampleBlock& out;
+    float* extend(size_t n) { return out.extend((uint32_t)n); }
+};
+
+template <class Profile>
+BasicFrameDecoder<Profile>::BasicFrameDecoder()
+    : frame_count(0),
+      other_frames(0),
+      skipped_bytes(0),
+      header_errors(0),
+      trailer_errors(0),
+      frames_by_addr() {}
+
+template <class Profile>
+void BasicFrameDecoder<Profile>::reset() {
+    rxBuff.clear();
+}
+
+static inline int16_t readDiff(const uint8_t* p) {
+    return (int16_t)((p[1] << 8) | p[0]);
+}
+
+static inline uint32_t readMetadata(const uint8_t* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Разницы кадра фиксированной длины: цикл развёрнут на этапе компиляции
+template <size_t... K>
+static inline void expandDiffs(std::index_sequence<K...>, const uint8_t* src, float val, float diffFactor,
+                               int16_t* diffs, float* out) {
+    ((diffs[K] = readDiff(src + 2 * K), val += static_cast<float>(diffs[K]) / diffFactor, out[K] = val), ...);
+}
+
+template <class Profile>
+void BasicFrameDecoder<Profile>::decodeFixed(const uint8_t* frame, float* dst, NativeFrames* frames) {
+    // Явная инстанциация собирает и профиль без фиксированной длины: для него тела нет
+    if constexpr (Profile::samplesPerFrame > 0) {
+        constexpr size_t diffCount = Profile::samplesPerFrame - 1;
+        const uint8_t* basePos = frame + 4 + Profile::metadataBytes;
+        float first = 0.0f;
+        std::memcpy(&first, basePos, sizeof(float));
+
+        dst[0] = first;
+        int16_t diffs[diffCount > 0 ? diffCount : 1];
+        expandDiffs(std::make_index_sequence<diffCount>(), basePos + 4, first, Profile::diffFactor, diffs, dst + 1);
+        if (frames) frames->appendFrame(readMetadata(frame + 4), first, diffs, diffCount);
+    } else {
+        (void)frame;
+        (void)dst;
+        (void)frames;
+    }
+}
+
+template <class Profile>
+void BasicFrameDecoder<Profile>::decodeGeneric(const uint8_t* frame, size_t dataNum, float* out, NativeFrames* frames) {
+    const uint8_t* firstFloatPos = frame + 4 + Profile::metadataBytes;
+    const uint8_t* diffsStart = firstFloatPos + 4;
+
+    float val = 0.0f;
+    std::memcpy(&val, firstFloatPos, sizeof(float));
+    *out++ = val;
+
+    if (frames) {
+        frames->metadata.push_back(readMetadata(frame + 4));
+        frames->base.push_back(val);
+        frames->diffCount.push_back((uint16_t)dataNum);
+    }
+    for (size_t k = 0; k < dataNum; ++k) {
+        int16_t rawDiff = readDiff(diffsStart + 2*k);
+        val += static_cast<float>(rawDiff) / Profile::diffFactor;
+        *out++ = val;
+        if (frames) frames->diffs.push_back(rawDiff);
+    }
+}
+
+template <class Profile>
+size_t BasicFrameDecoder<Profile>::feed(const uint8_t* data, size_t size, std::vector<float>& out, NativeFrames* frames) {
+    VectorSampleSink sink{out};
+    return feedInto(data, size, sink, frames);
+}
+
+template <class Profile>
+size_t BasicFrameDecoder<Profile>::feed(const uint8_t* data, size_t size, SampleBlock& out, NativeFrames* frames) {
+    BlockSampleSink sink{out};
+    return feedInto(data, size, sink, frames);
+}
+
+template <class Profile>
+template <class Sink>
+size_t BasicFrameDecoder<Profile>::feedInto(const uint8_t* data, size_t size, Sink& sink, NativeFrames* frames) {
+    // Заголовок ожидаемого кадра целиком: head, len, addr, len^addr
+    constexpr bool fixed = Profile::samplesPerFrame > 0;
+    constexpr uint8_t fixedLen = Profile::frameLenByte;
+    constexpr uint8_t fixedCheck = (uint8_t)(fixedLen ^ FRAME_ADDR_EMG);
+    constexpr size_t fixedBytes = Profile::frameBytes;
+
+    rxBuff.insert(rxBuff.end(), data, data + size);
+    const uint8_t* buf = rxBuff.data();
+    const size_t bufSize = rxBuff.size();
+
+    size_t decoded = 0;
+    size_t idx = 0;
+    while (bufSize - idx >= FRAME_MIN_BYTES) {
+        const uint8_t* p = buf + idx;
+        if constexpr (fixed) {    // Для профиля без фиксированной длины быстрый путь не компилируется
+            if (p[0] == FRAME_HEAD && p[1] == fixedLen && p[2] == FRAME_ADDR_EMG && p[3] == fixedCheck) {
+                if (bufSize - idx < fixedBytes) break;    // Кадр ещё не дошёл целиком
+                if (p[fixedBytes - 1] == FRAME_TAIL) {
+                    float* dst = sink.extend(Profile::samplesPerFrame);
+                    if (!dst) break;    // Порция заполнена
+                    decodeFixed(p, dst, frames);
+                    frame_count++;
+                    decoded++;
+                    frames_by_addr[FRAME_ADDR_EMG]++;
+                    idx += fixedBytes;
+                    continue;
+                }
+                // Хвост не сошёлся — общий путь учтёт ошибку
+            }
+        }
+        if (p[0] == FRAME_HEAD) {
+            uint8_t len   = p[1];
+            uint8_t addr  = p[2];
+            uint8_t check = p[3];
+            if ((uint8_t)(len ^ addr) == check) {
+                size_t frameLen = (size_t)len + 3;
+                if (bufSize - idx < frameLen) break;    // Кадр ещё не дошёл целиком
+                if (p[frameLen - 1] == FRAME_TAIL) {
+                    if (addr == FRAME_ADDR_EMG) {
+                        int payloadBytes = (int)len - 2;
+                        if (payloadBytes >= (int)Profile::metadataBytes + 4) {
+                            size_t diffCount = (payloadBytes - Profile::metadataBytes - 4) / 2;
+                            float* dst = sink.extend(diffCount + 1);
+                            if (!dst) break;    // Порция заполнена
+                            decodeGeneric(p, diffCount, dst, frames);
+                            frame_count++;
+                            decoded++;
+                        }
+                    } else {
+                        other_frames++;
+                    }
+                    frames_by_addr[addr]++;
+                    idx += frameLen;
+                    continue;
+                }
+                trailer_errors++;
+            } else {
+                header_errors++;
+            }
+        }
+        idx++;
+        skipped_bytes++;
+    }
+    if (idx > 0) rxBuff.erase(rxBuff.begin(), rxBuff.begin() + idx);
+    return decoded;
+}
+
+template class BasicFrameDecoder<GenericEmgProfile>;
+template class BasicFrameDecoder<DefaultEmgDevice>;
+
+void encodeEmgFrame(const float* samples, size_t count, uint32_t metadata, std::vector<uint8_t>& out) {
+    if (count == 0) return;
+    size_t payloadBytes = EMG_METADATA_BYTES + 4 + 2 * (count - 1);
+    uint8_t len = (uint8_t)(payloadBytes + 2);
+
+    out.push_back(FRAME_HEAD);
+    out.push_back(len);
+    out.push_back(FRAME_ADDR_EMG);
+    out.push_back((uint8_t)(len ^ FRAME_ADDR_EMG));
+    for (size_t i = 0; i < EMG_METADATA_BYTES; ++i) out.push_back((uint8_t)(metadata >> (8 * i)));
+
+    uint8_t base[4];
+    std::memcpy(base, &samples[0], sizeof(float));
+    out.insert(out.end(), base, base + 4);
+
+    float val = samples[0];    // Значение, которое восстановит декодер
+    for (size_t k = 1; k < count; ++k) {
+        float d = std::round((samples[k] - val) * EMG_DIFF_FACTOR);
+        int16_t rawDiff = (int16_t)std::max(-32768.0f, std::min(32767.0f, d));
+        out.push_back((uint8_t)(rawDiff & 0xFF));
+        out.push_back((uint8_t)((uint16_t)rawDiff >> 8));
+        val += static_cast<float>(rawDiff) / EMG_DIFF_FACTOR;
+    }
+    out.push_back(FRAME_TAIL);
+}
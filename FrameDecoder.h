@@ -0,0 +1,93 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "DeviceProfile.h"
+#include "SampleBlock.h"
+
+/**
+ * @brief EMG кадры в исходном представлении датчика (база + int16 разницы), SoA
+ */
+struct NativeFrames {
+    std::vector<uint32_t> metadata;    // 4 байта метаданных кадра
+    std::vector<float>    base;        // Первый сэмпл кадра
+    std::vector<uint16_t> diffCount;   // Разниц в кадре (сэмплов - 1)
+    std::vector<int16_t>  diffs;       // Разницы всех кадров подряд
+
+    void clear();
+    size_t frameCount() const { return base.size(); }
+    size_t sampleCount() const { return base.size() + diffs.size(); }
+    void appendFrame(uint32_t meta, float first, const int16_t* frameDiffs, size_t count);
+    void append(const NativeFrames& other);
+
+    /**
+     * @brief Восстанавливает сэмплы так же, как FrameDecoder (побитово совпадает)
+     */
+    void expand(std::vector<float>& out) const;
+    void expand(float* out) const;    // sampleCount() значений
+};
+
+/**
+ * @brief Разбор потока байт на кадры. Хранит незавершённый хвост между вызовами feed().
+ * @tparam Profile Профиль устройства (DeviceProfile.h): кадры его длины разбираются развёрнутым
+ *         циклом без проверок на каждом сэмпле, остальные — общим путём. Результат побитово
+ *         одинаков для любого профиля.
+ */
+template <class Profile>
+class BasicFrameDecoder {
+private:
+    static_assert(Profile::channelCount == 1, "Multi-channel frames are not supported");
+
+    std::vector<uint8_t> rxBuff;    // Накопитель байт между чтениями
+    uint64_t frame_count;           // EMG кадров
+    uint64_t other_frames;          // Кадров других типов
+    uint64_t skipped_bytes;         // Байт, пропущенных при поиске начала кадра
+    uint64_t header_errors;         // Найден 0xA5, но len ^ addr не сошлось
+    uint64_t trailer_errors;        // Заголовок верный, а в конце кадра не 0x5A
+    uint64_t frames_by_addr[256];   // Кадров по адресу (типу)
+
+    void decodeFixed(const uint8_t* frame, float* out, NativeFrames* frames);
+    void decodeGeneric(const uint8_t* frame, size_t diffCount, float* out, NativeFrames* frames);
+    template <class Sink>
+    size_t feedInto(const uint8_t* data, size_t size, Sink& sink, NativeFrames* frames);
+
+public:
+    BasicFrameDecoder();
+
+    /**
+     * @brief Добавляет байты и декодирует все завершённые кадры
+     * @param out Новые сэмплы дописываются в конец
+     * @param frames Если задан, сюда же дописываются кадры в исходном виде
+     * @return Количество декодированных EMG кадров
+     */
+    size_t feed(const uint8_t* data, size_t size, std::vector<float>& out, NativeFrames* frames = nullptr);
+
+    /**
+     * @brief То же в канал 0 порции; кадры, не поместившиеся в неё, остаются до следующего feed()
+     */
+    size_t feed(const uint8_t* data, size_t size, SampleBlock& out, NativeFrames* frames = nullptr);
+
+    void reset();
+
+    uint64_t getFrameCount() const { return frame_count; }
+    uint64_t getOtherFrames() const { return other_frames; }
+    uint64_t getSkippedBytes() const { return skipped_bytes; }
+    uint64_t getHeaderErrors() const { return header_errors; }
+    uint64_t getTrailerErrors() const { return trailer_errors; }
+    uint64_t getFramesByAddress(uint8_t addr) const { return frames_by_addr[addr]; }
+    size_t getBufferedBytes() const { return rxBuff.size(); }    // Незавершённый хвост
+};
+
+// Реализация — в FrameDecoder.cpp; новый профиль добавляется строкой явной инстанциации там
+extern template class BasicFrameDecoder<GenericEmgProfile>;
+extern template class BasicFrameDecoder<DefaultEmgDevice>;
+
+typedef BasicFrameDecoder<GenericEmgProfile> FrameDecoder;    // Без быстрого пути
+
+/**
+ * @brief Собирает EMG кадр так, как его отправляет датчик (для синтетических данных и тестов).
+ *        Разницы квантуются с накоплением, поэтому декодер восстанавливает
+ *        ближайшие к samples значения без дрейфа.
+ */
+void encodeEmgFrame(const float* samples, size_t count, uint32_t metadata, std::vector<uint8_t>& out);
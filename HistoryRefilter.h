@@ -0,0 +1,204 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "HostClock.h"
+#include "LiveDecimator.h"
+
+// ==== Перефильтрация истории живого графика при смене параметра фильтра ====
+//
+// Живой фильтр обрабатывает новые сэмплы (push() из потока чтения) и хранит их сырыми в кольце
+// истории. После setCutoff() служебный поток фильтрует заново всё окно графика: берёт под mutex
+// копию сырых сэмплов, без блокировки прогоняет через фильтр с новым параметром и собирает новый
+// LiveDecimator, затем под mutex дофильтровывает пришедшее за это время и одним обменом
+// подменяет график и состояние живого фильтра. До подмены и живой фильтр, и график остаются на
+// прежнем параметре — смешения старого и нового на экране нет.
+//
+// Прогрев: фильтр выходит на установившийся режим на сырых сэмплах перед окном (warmupSamples()),
+// а если истории не хватает — на первом сэмпле, повторённом до нужной длины. Поэтому у левого края
+// окна нет переходного процесса от нулевого состояния.
+//
+// Filter — копируемый фильтр с setup(sampleRate, cutoff) и filter(double), как
+// Iir::Butterworth::HighPass<N>.
+
+struct RefilterStats {
+    double cutoff = 0.0;                // Параметр живого фильтра и графика
+    uint64_t requests = 0;
+    uint64_t swaps = 0;                 // Подмен графика
+    uint64_t cancelled = 0;             // Прервано новым запросом
+    uint64_t lastSamples = 0;           // Сэмплов окна в последней подмене
+    int64_t lastNs = 0;                 // От запроса до подмены
+    int64_t lastLockNs = 0;             // Под mutex в последней подмене
+};
+
+template <class Filter>
+class HistoryRefilter {
+private:
+    static constexpr double WARMUP_PERIODS = 4.0;           // Прогрев — периодов частоты среза
+    static constexpr size_t MIN_WARMUP_SAMPLES = 64;
+    static constexpr size_t CANCEL_CHECK_SAMPLES = 16384;   // Как часто проверять новый запрос
+
+    std::mutex& mutex;                  // Защищает target и всё ниже до "Служебный поток"
+    LiveDecimator& target;
+    const double sampleRate;
+
+    Filter live;
+    std::vector<float> history;         // Кольцо сырых сэмплов
+    uint64_t total;                     // Принято сэмплов; следующий пишется в history[total % size]
+    RefilterStats stats;
+
+    std::condition_variable cv;
+    double requestedCutoff;
+    std::atomic<uint64_t> requestedGeneration;
+    uint64_t appliedGeneration;
+    int64_t requestedAtNs;
+    bool stopping;
+
+    // Служебный поток
+    std::thread worker;
+    std::vector<float> scratch;
+
+    size_t warmupSamples(double cutoff) const {
+        double periods = cutoff > 0.0 ? WARMUP_PERIODS * sampleRate / cutoff : 0.0;
+        return std::max<size_t>(MIN_WARMUP_SAMPLES, (size_t)std::ceil(periods));
+    }
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            cv.wait(lock, [this] { return stopping || requestedGeneration.load() != appliedGeneration; });
+            if (stopping) return;
+            const uint64_t generation = requestedGeneration.load();
+            const double cutoff = requestedCutoff;
+            const int64_t startNs = requestedAtNs;
+
+            // Копия окна и прогрева — единственная работа с историей до подмены
+            const size_t available = (size_t)std::min<uint64_t>(total, history.size());
+            const size_t window = std::min(target.getWindow(), available);
+            const size_t warmup = std::min(warmupSamples(cutoff), available - window);
+            const uint64_t end = total;
+            scratch.resize(warmup + window);
+            const size_t first = (size_t)((end - scratch.size()) % history.size());
+            const size_t part = std::min(scratch.size(), history.size() - first);    // До конца кольца
+            std::copy(history.begin() + first, history.begin() + first + part, scratch.begin());
+            std::copy(history.begin(), history.begin() + (scratch.size() - part), scratch.begin() + part);
+            const size_t plotWindow = target.getWindow(), plotColumns = target.getColumns();
+            lock.unlock();
+
+            LiveDecimator fresh(plotWindow, plotColumns);
+            fresh.clear(end - window);
+
+            Filter filter;
+            filter.setup(sampleRate, cutoff);
+            if (!scratch.empty())
+                for (size_t i = warmup; i < warmupSamples(cutoff); ++i) filter.filter(scratch[0]);
+            bool cancelled = false;
+            for (size_t i = 0; i < scratch.size(); ++i) {
+                float y = (float)filter.filter(scratch[i]);
+                if (i >= warmup) fresh.push(y);
+                if (i % CANCEL_CHECK_SAMPLES == CANCEL_CHECK_SAMPLES - 1 && requestedGeneration.load() != generation) {
+                    cancelled = true;
+                    break;
+                }
+            }
+
+            lock.lock();
+            if (cancelled || requestedGeneration.load() != generation) {
+                stats.cancelled++;
+                continue;
+            }
+            const int64_t lockNs = hostNowNs();
+            // Пришедшее за время фильтрации; история длиннее окна, так что эти сэмплы ещё в ней
+            for (uint64_t s = std::max(end, total - std::min<uint64_t>(total, history.size())); s < total; ++s)
+                fresh.push((float)filter.filter(history[(size_t)(s % history.size())]));
+            std::swap(target, fresh);
+            live = filter;
+            appliedGeneration = generation;
+            stats.cutoff = cutoff;
+            stats.swaps++;
+            stats.lastSamples = window;
+            stats.lastNs = hostNowNs() - startNs;
+            stats.lastLockNs = hostNowNs() - lockNs;
+
+            lock.unlock();
+            fresh = LiveDecimator(1, 1);    // Прежний график освобождается без блокировки
+            lock.lock();
+        }
+    }
+
+public:
+    /**
+     * @param mutex Защищает target; push() вызывается под ним
+     * @param historySamples Сырых сэмплов в истории — не меньше самого длинного окна графика
+     *        плюс запас на прогрев
+     */
+    HistoryRefilter(std::mutex& mutex_, LiveDecimator& target_, double sampleRate_, size_t historySamples,
+                    double cutoff)
+        : mutex(mutex_),
+          target(target_),
+          sampleRate(sampleRate_),
+          history(std::max<size_t>(1, historySamples)),
+          total(0),
+          requestedCutoff(cutoff),
+          requestedGeneration(0),
+          appliedGeneration(0),
+          requestedAtNs(0),
+          stopping(false) {
+        live.setup(sampleRate, cutoff);
+        stats.cutoff = cutoff;
+        worker = std::thread(&HistoryRefilter::workerLoop, this);
+    }
+
+    ~HistoryRefilter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_one();
+        worker.join();
+    }
+
+    HistoryRefilter(const HistoryRefilter&) = delete;
+    HistoryRefilter& operator=(const HistoryRefilter&) = delete;
+
+    /**
+     * @brief Новый параметр фильтра; не блокирует надолго. Запросы, пришедшие во время
+     *        перефильтрации, прерывают её — применяется последний.
+     */
+    void setCutoff(double cutoff) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (cutoff == requestedCutoff) return;
+            requestedCutoff = cutoff;
+            requestedAtNs = hostNowNs();
+            requestedGeneration++;
+            stats.requests++;
+        }
+        cv.notify_one();
+    }
+
+    /**
+     * @brief Фильтрует новые сырые сэмплы в target. Вызывать под mutex.
+     */
+    void push(const float* samples, size_t count) {
+        const size_t n = history.size();
+        for (size_t i = 0; i < count; ++i) {
+            history[(size_t)(total % n)] = samples[i];
+            total++;
+            target.push((float)live.filter(samples[i]));
+        }
+    }
+
+    RefilterStats getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+};
@@ -0,0 +1,21 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+// Единые часы хоста для временных меток сэмплов
+
+/**
+ * @brief Монотонное время хоста в наносекундах (steady_clock)
+ */
+inline int64_t hostNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Календарное время (UTC) в наносекундах от эпохи Unix
+ */
+inline int64_t wallNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
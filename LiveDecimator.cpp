@@ -0,0 +1,139 @@
+#include "LiveDecimator.h"
+
+#include <algorithm>
+
+LiveDecimator::LiveDecimator(size_t windowSamples_, size_t columns_)
+    : windowSamples(std::max<size_t>(1, windowSamples_)),
+      columns(std::max<size_t>(1, columns_)),
+      binSamples(1),
+      ring(windowSamples),
+      head(0),
+      count(0),
+      total(0),
+      binHead(0),
+      binCount(0) {
+    rebuildBins();
+}
+
+void LiveDecimator::clear(uint64_t firstSample) {
+    head = 0;
+    count = 0;
+    total = firstSample;
+    binHead = 0;
+    binCount = 0;
+}
+
+void LiveDecimator::setWindow(size_t windowSamples_) {
+    windowSamples_ = std::max<size_t>(1, windowSamples_);
+    if (windowSamples_ == windowSamples) return;
+
+    // Кольцо разворачивается в новое, начиная с самого старого из оставшихся сэмплов
+    size_t keep = std::min(count, windowSamples_);
+    std::vector<float> next(windowSamples_);
+    for (size_t i = 0; i < keep; ++i) next[i] = ring[(head + count - keep + i) % windowSamples];
+    ring.swap(next);
+    windowSamples = windowSamples_;
+    head = 0;
+    count = keep;
+    rebuildBins();
+}
+
+void LiveDecimator::setColumns(size_t columns_) {
+    columns_ = std::max<size_t>(1, columns_);
+    if (columns_ == columns) return;
+    columns = columns_;
+    if ((windowSamples + columns - 1) / columns != binSamples) rebuildBins();
+}
+
+void LiveDecimator::rebuildBins() {
+    binSamples = std::max<size_t>(1, (windowSamples + columns - 1) / columns);
+    binHead = 0;
+    binCount = 0;
+    if (binSamples == 1) {
+        bins.clear();    // Raw-режим, корзины не нужны
+        return;
+    }
+    // Окно может начинаться с середины корзины — отсюда +1
+    bins.assign((windowSamples + binSamples - 1) / binSamples + 1, Bin());
+    uint64_t first = total - count;
+    for (size_t i = 0; i < count; ++i) addToBins(ring[(head + i) % windowSamples], first + i);
+}
+
+void LiveDecimator::addToBins(float value, uint64_t sample) {
+    uint64_t index = sample / binSamples;
+    if (binCount > 0) {
+        Bin& last = bins[(binHead + binCount - 1) % bins.size()];
+        if (last.index == index) {
+            if (value < last.min) {
+                last.min = value;
+                last.maxFirst = true;
+            } else if (value > last.max) {
+                last.max = value;
+                last.maxFirst = false;
+            }
+            return;
+        }
+    }
+    if (binCount == bins.size()) {
+        binHead = (binHead + 1) % bins.size();
+        binCount--;
+    }
+    bins[(binHead + binCount) % bins.size()] = {value, value, false, index};
+    binCount++;
+}
+
+void LiveDecimator::dropExpiredBins() {
+    uint64_t first = total - count;
+    while (binCount > 0 && (bins[binHead].index + 1) * binSamples <= first) {
+        binHead = (binHead + 1) % bins.size();
+        binCount--;
+    }
+}
+
+void LiveDecimator::push(float value) {
+    if (count < windowSamples) {
+        ring[(head + count) % windowSamples] = value;
+        count++;
+    } else {
+        ring[head] = value;
+        head = (head + 1) % windowSamples;
+    }
+    total++;
+    if (binSamples > 1) {
+        addToBins(value, total - 1);
+        dropExpiredBins();
+    }
+}
+
+void LiveDecimator::push(const float* values, size_t n) {
+    for (size_t i = 0; i < n; ++i) push(values[i]);
+}
+
+size_t LiveDecimator::build(std::vector<float>& xs, std::vector<float>& ys) const {
+    xs.clear();
+    ys.clear();
+    if (binSamples == 1) {
+        xs.resize(count);
+        ys.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            xs[i] = (float)i;
+            ys[i] = ring[(head + i) % windowSamples];
+        }
+        return count;
+    }
+
+    xs.reserve(2 * binCount);
+    ys.reserve(2 * binCount);
+    const uint64_t first = total - count;
+    for (size_t b = 0; b < binCount; ++b) {
+        const Bin& bin = bins[(binHead + b) % bins.size()];
+        // Крайние корзины обрезаются по окну
+        uint64_t start = std::max<uint64_t>(bin.index * binSamples, first);
+        uint64_t end = std::min<uint64_t>((bin.index + 1) * binSamples, total) - 1;
+        xs.push_back((float)(start - first));
+        xs.push_back((float)(end - first));
+        ys.push_back(bin.maxFirst ? bin.max : bin.min);
+        ys.push_back(bin.maxFirst ? bin.min : bin.max);
+    }
+    return xs.size();
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ==== Прореживание живого графика по пикселям ====
+//
+// Окно последних windowSamples сэмплов делится на корзины по binSamples = ceil(окно / ширина графика),
+// для каждой корзины хранятся min и max. Корзины выровнены по абсолютному номеру сэмпла, поэтому
+// при прокрутке старые корзины не пересчитываются: новый сэмпл дополняет последнюю, целиком
+// вышедшие из окна отбрасываются. На график уходят две вершины на корзину (min и max в порядке
+// появления) — число вершин зависит от ширины графика, а не от длины окна.
+// Пока корзина не длиннее сэмпла, рисуются сами сэмплы. Левая корзина, частично вышедшая из окна,
+// до своего удаления помнит min/max и вышедших сэмплов (не больше binSamples - 1).
+
+class LiveDecimator {
+private:
+    struct Bin {
+        float min;
+        float max;
+        bool maxFirst;           // max пришёл раньше min — порядок вершин на графике
+        uint64_t index;          // Номер корзины: абсолютный номер сэмпла / binSamples
+    };
+
+    size_t windowSamples;
+    size_t columns;
+    size_t binSamples;
+
+    // Кольцо сырых сэмплов окна — для перестройки корзин при смене окна/ширины и для raw-режима
+    std::vector<float> ring;
+    size_t head;                 // Позиция самого старого сэмпла
+    size_t count;
+    uint64_t total;              // Всего принято сэмплов
+
+    std::vector<Bin> bins;       // Кольцо корзин
+    size_t binHead;
+    size_t binCount;
+
+    void addToBins(float value, uint64_t sample);
+    void dropExpiredBins();
+    void rebuildBins();
+
+public:
+    /**
+     * @param windowSamples Длина окна в сэмплах
+     * @param columns Ширина графика в пикселях
+     */
+    explicit LiveDecimator(size_t windowSamples = 500, size_t columns = 1000);
+
+    // firstSample — номер, с которого пойдут следующие push() (выравнивание корзин по потоку)
+    void clear(uint64_t firstSample = 0);
+
+    // Последние сэмплы сохраняются; корзины перестраиваются, только если изменился их размер
+    void setWindow(size_t windowSamples);
+    void setColumns(size_t columns);
+
+    void push(float value);
+    void push(const float* values, size_t n);
+
+    /**
+     * @brief Вершины для ImPlot::PlotLine
+     * @param xs Номер сэмпла от начала окна (0 .. getWindow())
+     * @return Количество вершин
+     */
+    size_t build(std::vector<float>& xs, std::vector<float>& ys) const;
+
+    size_t size() const { return count; }
+    size_t getWindow() const { return windowSamples; }
+    size_t getColumns() const { return columns; }
+    size_t getBinSamples() const { return binSamples; }
+    uint64_t getTotalSamples() const { return total; }
+};
@@ -0,0 +1,93 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+    : ptr(nullptr),
+      length(0),
+      opened(false),
+#ifdef _WIN32
+      hFile(INVALID_HANDLE_VALUE),
+      hMapping(nullptr) {}
+#else
+      fd(-1) {}
+#endif
+
+MappedFile::MappedFile(const std::string& path) : MappedFile() {
+    open(path);
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+void MappedFile::open(const std::string& path) {
+    close();
+#ifdef _WIN32
+    hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Cannot open file " + path);
+
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(hFile, &fileSize);
+    length = static_cast<size_t>(fileSize.QuadPart);
+    opened = true;
+    if (length == 0) return;    // Пустой файл отобразить нельзя
+
+    hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (hMapping == nullptr) {
+        close();
+        throw std::runtime_error("Cannot map file " + path);
+    }
+    ptr = static_cast<const uint8_t*>(MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0));
+    if (ptr == nullptr) {
+        close();
+        throw std::runtime_error("Cannot map file " + path);
+    }
+#else
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open file " + path);
+
+    struct stat st;
+    fstat(fd, &st);
+    length = static_cast<size_t>(st.st_size);
+    opened = true;
+    if (length == 0) return;
+
+    void* p = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        close();
+        throw std::runtime_error("Cannot map file " + path);
+    }
+    madvise(p, length, MADV_SEQUENTIAL);
+    ptr = static_cast<const uint8_t*>(p);
+#endif
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (ptr) UnmapViewOfFile(ptr);
+    if (hMapping) CloseHandle(hMapping);
+    if (hFile != INVALID_HANDLE_VALUE) CloseHandle(hFile);
+    hMapping = nullptr;
+    hFile = INVALID_HANDLE_VALUE;
+#else
+    if (ptr) munmap(const_cast<uint8_t*>(ptr), length);
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+#endif
+    ptr = nullptr;
+    length = 0;
+    opened = false;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Файл, отображённый в память только для чтения (mmap / CreateFileMapping)
+ */
+class MappedFile {
+private:
+    const uint8_t* ptr;
+    size_t length;
+    bool opened;
+#ifdef _WIN32
+    void* hFile;
+    void* hMapping;
+#else
+    int fd;
+#endif
+
+public:
+    MappedFile();
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    void open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return opened; }
+    const uint8_t* data() const { return ptr; }
+    size_t size() const { return length; }
+};
@@ -0,0 +1,252 @@
+#include "Metrics.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+static size_t bucketOf(uint64_t value) {
+    if (value == 0) return 0;
+#if defined(__GNUC__) || defined(__clang__)
+    return 64 - (size_t)__builtin_clzll(value);
+#else
+    size_t k = 0;
+    while (value) {
+        value >>= 1;
+        k++;
+    }
+    return k;
+#endif
+}
+
+// Верхняя граница корзины включительно (для le в текстовом формате)
+static uint64_t bucketUpper(size_t k) {
+    if (k == 0) return 0;
+    if (k >= 64) return UINT64_MAX;
+    return ((uint64_t)1 << k) - 1;
+}
+
+// ==== Гистограмма ====
+
+double HistogramSnapshot::percentile(double q) const {
+    if (count == 0) return 0.0;
+    double rank = std::min(1.0, std::max(0.0, q)) * (double)count;
+    uint64_t seen = 0;
+    for (size_t k = 0; k < METRIC_HISTOGRAM_BUCKETS; ++k) {
+        if (buckets[k] == 0) continue;
+        if ((double)(seen + buckets[k]) >= rank) {
+            if (k == 0) return 0.0;
+            double lo = (double)((uint64_t)1 << (k - 1));
+            double hi = (double)bucketUpper(k) + 1.0;
+            double within = (rank - (double)seen) / (double)buckets[k];
+            return lo + (hi - lo) * within;
+        }
+        seen += buckets[k];
+    }
+    return (double)bucketUpper(METRIC_HISTOGRAM_BUCKETS - 1);
+}
+
+MetricHistogram::MetricHistogram() {
+    for (auto& b : buckets) b.store(0, std::memory_order_relaxed);
+}
+
+void MetricHistogram::record(uint64_t value) {
+    buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+HistogramSnapshot MetricHistogram::snapshot() const {
+    // Без блокировки: count и корзины могут разойтись на несколько записей, идущих прямо сейчас
+    HistogramSnapshot s;
+    for (size_t k = 0; k < METRIC_HISTOGRAM_BUCKETS; ++k) s.buckets[k] = buckets[k].load(std::memory_order_relaxed);
+    s.count = count.load(std::memory_order_relaxed);
+    s.sum = sum.load(std::memory_order_relaxed);
+    return s;
+}
+
+// ==== Реестр ====
+
+MetricsRegistry::Entry& MetricsRegistry::find(const std::string& name, const std::string& help, MetricKind kind) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Entry& e : entries) {
+        if (e.name != name) continue;
+        if (e.kind != kind) throw std::invalid_argument("Metric " + name + " is registered with another type");
+        return e;
+    }
+    entries.emplace_back();
+    Entry& e = entries.back();
+    e.name = name;
+    e.help = help;
+    e.kind = kind;
+    switch (kind) {
+        case MetricKind::Counter:   e.counter.reset(new MetricCounter()); break;
+        case MetricKind::Gauge:     e.gauge.reset(new MetricGauge()); break;
+        case MetricKind::Histogram: e.histogram.reset(new MetricHistogram()); break;
+    }
+    return e;
+}
+
+MetricCounter& MetricsRegistry::counter(const std::string& name, const std::string& help) {
+    return *find(name, help, MetricKind::Counter).counter;
+}
+
+MetricGauge& MetricsRegistry::gauge(const std::string& name, const std::string& help) {
+    return *find(name, help, MetricKind::Gauge).gauge;
+}
+
+MetricHistogram& MetricsRegistry::histogram(const std::string& name, const std::string& help) {
+    return *find(name, help, MetricKind::Histogram).histogram;
+}
+
+void MetricsRegistry::snapshot(std::vector<Sample>& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    out.resize(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const Entry& e = entries[i];
+        Sample& s = out[i];
+        s.name = e.name;
+        s.help = e.help;
+        s.kind = e.kind;
+        if (e.counter) s.counter = e.counter->get();
+        if (e.gauge) s.gauge = e.gauge->get();
+        if (e.histogram) s.histogram = e.histogram->snapshot();
+    }
+}
+
+// name{labels} -> name + suffix {labels, extra}
+static std::string seriesName(const std::string& name, const char* suffix, const std::string& extraLabel = "") {
+    size_t brace = name.find('{');
+    std::string base = name.substr(0, brace);
+    std::string labels = brace == std::string::npos ? "" : name.substr(brace + 1, name.size() - brace - 2);
+    if (!extraLabel.empty()) labels += (labels.empty() ? "" : ",") + extraLabel;
+    return base + suffix + (labels.empty() ? "" : "{" + labels + "}");
+}
+
+std::string MetricsRegistry::toText() const {
+    std::vector<Sample> samples;
+    snapshot(samples);
+    // HELP/TYPE — один раз на имя без меток, поэтому серии одного имени должны идти подряд
+    std::stable_sort(samples.begin(), samples.end(), [](const Sample& a, const Sample& b) {
+        return a.name.substr(0, a.name.find('{')) < b.name.substr(0, b.name.find('{'));
+    });
+
+    std::string out;
+    std::string lastBase;
+    char line[128];
+    for (const Sample& s : samples) {
+        std::string base = s.name.substr(0, s.name.find('{'));
+        if (base != lastBase) {
+            const char* type = s.kind == MetricKind::Counter ? "counter" : s.kind == MetricKind::Gauge ? "gauge" : "histogram";
+            if (!s.help.empty()) out += "# HELP " + base + " " + s.help + "\n";
+            out += "# TYPE " + base + " " + type + "\n";
+            lastBase = base;
+        }
+        switch (s.kind) {
+            case MetricKind::Counter:
+                std::snprintf(line, sizeof(line), " %llu\n", (unsigned long long)s.counter);
+                out += s.name + line;
+                break;
+            case MetricKind::Gauge:
+                std::snprintf(line, sizeof(line), " %lld\n", (long long)s.gauge);
+                out += s.name + line;
+                break;
+            case MetricKind::Histogram: {
+                const HistogramSnapshot& h = s.histogram;
+                size_t top = 0;
+                for (size_t k = 0; k < METRIC_HISTOGRAM_BUCKETS; ++k)
+                    if (h.buckets[k]) top = k;
+                uint64_t cumulative = 0;
+                for (size_t k = 0; k <= top && k < 64; ++k) {
+                    cumulative += h.buckets[k];
+                    std::snprintf(line, sizeof(line), "le=\"%llu\"", (unsigned long long)bucketUpper(k));
+                    std::string series = seriesName(s.name, "_bucket", line);
+                    std::snprintf(line, sizeof(line), " %llu\n", (unsigned long long)cumulative);
+                    out += series + line;
+                }
+                std::snprintf(line, sizeof(line), " %llu\n", (unsigned long long)h.count);
+                out += seriesName(s.name, "_bucket", "le=\"+Inf\"") + line;
+                std::snprintf(line, sizeof(line), " %llu\n", (unsigned long long)h.sum);
+                out += seriesName(s.name, "_sum") + line;
+                std::snprintf(line, sizeof(line), " %llu\n", (unsigned long long)h.count);
+                out += seriesName(s.name, "_count") + line;
+                break;
+            }
+        }
+    }
+    return out;
+}
+
+MetricsRegistry& globalMetrics() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+std::string metricLabel(const std::string& key, const std::string& value) {
+    std::string out = key + "=\"";
+    for (char c : value) {
+        if (c == '\\' || c == '"') out += '\\';
+        if (c == '\n') {
+            out += "\\n";
+            continue;
+        }
+        out += c;
+    }
+    return out + "\"";
+}
+
+// ==== Выгрузка в файл ====
+
+MetricsDumper::MetricsDumper(MetricsRegistry& registry_, const std::string& path_, double periodSeconds)
+    : registry(registry_),
+      path(path_),
+      periodMs(std::max<int64_t>(100, (int64_t)(periodSeconds * 1000.0))),
+      stopping(false) {
+    thread = std::thread(&MetricsDumper::loop, this);
+}
+
+MetricsDumper::~MetricsDumper() {
+    stop();
+}
+
+void MetricsDumper::dump() {
+    std::string text = registry.toText();
+    std::string tmp = path + ".tmp";
+    std::FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) return;    // Нет доступа — пропускаем, следующая попытка через период
+    bool ok = std::fwrite(text.data(), 1, text.size(), f) == text.size();
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok) {
+        std::remove(tmp.c_str());
+        return;
+    }
+#ifdef _WIN32
+    MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+    std::rename(tmp.c_str(), path.c_str());
+#endif
+}
+
+void MetricsDumper::loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        cv.wait_for(lock, std::chrono::milliseconds(periodMs), [this] { return stopping; });
+        lock.unlock();
+        dump();
+        lock.lock();
+    }
+}
+
+void MetricsDumper::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) return;
+        stopping = true;
+    }
+    cv.notify_one();
+    if (thread.joinable()) thread.join();
+}
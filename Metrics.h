@@ -0,0 +1,154 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ==== Метрики горячего пути ====
+//
+// Счётчики, значения и гистограммы — атомики с memory_order_relaxed: запись не берёт
+// блокировок и не ждёт читателя. Регистрация (поиск по имени) — под мьютексом, поэтому
+// метрики получают один раз и хранят указатель; адреса не меняются до конца процесса.
+// Имя может содержать метки в формате Prometheus: emg_frames_total{type="emg"}.
+//
+// Гистограмма — корзина для 0 и 64 степенные: значение v попадает в корзину k,
+// если 2^(k-1) <= v < 2^k. Перцентили по корзинам — с точностью до степени двойки,
+// внутри корзины — линейная интерполяция.
+
+enum class MetricKind {
+    Counter,
+    Gauge,
+    Histogram
+};
+
+class MetricCounter {
+private:
+    std::atomic<uint64_t> value{0};
+
+public:
+    void add(uint64_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+    // Для счётчиков, которые ведёт сам компонент (итог копируется, а не прибавляется)
+    void store(uint64_t total) { value.store(total, std::memory_order_relaxed); }
+    uint64_t get() const { return value.load(std::memory_order_relaxed); }
+};
+
+class MetricGauge {
+private:
+    std::atomic<int64_t> value{0};
+
+public:
+    void set(int64_t v) { value.store(v, std::memory_order_relaxed); }
+    int64_t get() const { return value.load(std::memory_order_relaxed); }
+};
+
+const size_t METRIC_HISTOGRAM_BUCKETS = 65;    // 0 и [2^(k-1), 2^k) для k = 1..64
+
+struct HistogramSnapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t buckets[METRIC_HISTOGRAM_BUCKETS] = {};
+
+    double mean() const { return count ? (double)sum / (double)count : 0.0; }
+    double percentile(double q) const;
+};
+
+class MetricHistogram {
+private:
+    std::atomic<uint64_t> buckets[METRIC_HISTOGRAM_BUCKETS];
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum{0};
+
+public:
+    MetricHistogram();
+
+    void record(uint64_t value);
+    HistogramSnapshot snapshot() const;
+};
+
+class MetricsRegistry {
+private:
+    struct Entry {
+        std::string name;
+        std::string help;
+        MetricKind kind;
+        std::unique_ptr<MetricCounter> counter;
+        std::unique_ptr<MetricGauge> gauge;
+        std::unique_ptr<MetricHistogram> histogram;
+    };
+
+    mutable std::mutex mutex;
+    std::deque<Entry> entries;
+
+    Entry& find(const std::string& name, const std::string& help, MetricKind kind);
+
+public:
+    MetricsRegistry() = default;
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    // Возвращает существующую метрику с этим именем или создаёт новую
+    MetricCounter& counter(const std::string& name, const std::string& help = "");
+    MetricGauge& gauge(const std::string& name, const std::string& help = "");
+    MetricHistogram& histogram(const std::string& name, const std::string& help = "");
+
+    /**
+     * @brief Снимок одной метрики для вывода (GUI, файл)
+     */
+    struct Sample {
+        std::string name;
+        std::string help;
+        MetricKind kind;
+        uint64_t counter = 0;
+        int64_t gauge = 0;
+        HistogramSnapshot histogram;
+    };
+
+    void snapshot(std::vector<Sample>& out) const;
+
+    /**
+     * @brief Текстовый формат Prometheus (для node_exporter textfile collector и т.п.)
+     */
+    std::string toText() const;
+};
+
+// Общий реестр процесса
+MetricsRegistry& globalMetrics();
+
+/**
+ * @brief Метка для имени метрики: key="value" с экранированием \ и "
+ */
+std::string metricLabel(const std::string& key, const std::string& value);
+
+/**
+ * @brief Поток, периодически записывающий реестр в файл. Файл заменяется целиком
+ *        (запись во временный и переименование), сборщик не увидит половину.
+ */
+class MetricsDumper {
+private:
+    MetricsRegistry& registry;
+    std::string path;
+    int64_t periodMs;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping;
+    std::thread thread;
+
+    void loop();
+
+public:
+    MetricsDumper(MetricsRegistry& registry, const std::string& path, double periodSeconds = 5.0);
+    ~MetricsDumper();
+
+    MetricsDumper(const MetricsDumper&) = delete;
+    MetricsDumper& operator=(const MetricsDumper&) = delete;
+
+    // Записать немедленно (вызывается и при остановке)
+    void dump();
+    void stop();
+};
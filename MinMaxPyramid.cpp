@@ -0,0 +1,201 @@
+#include "MinMaxPyramid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+const size_t LOD_BUILD_CHUNK = LOD_BASE_SAMPLES * 4096;    // Сэмплов за один readSamples() при построении
+
+static std::vector<uint64_t> levelSizes(uint64_t totalSamples) {
+    std::vector<uint64_t> sizes;
+    if (totalSamples == 0) return sizes;
+    uint64_t bins = (totalSamples + LOD_BASE_SAMPLES - 1) / LOD_BASE_SAMPLES;
+    sizes.push_back(bins);
+    while (bins > 1) {
+        bins = (bins + LOD_FANOUT - 1) / LOD_FANOUT;
+        sizes.push_back(bins);
+    }
+    return sizes;
+}
+
+MinMaxPyramid::MinMaxPyramid() : channelCount(0), totalSamples(0) {}
+
+uint64_t MinMaxPyramid::binSamples(size_t level) const {
+    uint64_t n = LOD_BASE_SAMPLES;
+    for (size_t l = 0; l < level; ++l) n *= LOD_FANOUT;
+    return n;
+}
+
+size_t MinMaxPyramid::sizeBytes() const {
+    uint64_t bins = 0;
+    for (uint64_t n : levelBins) bins += n;
+    return (size_t)(bins * channelCount * sizeof(LodBin));
+}
+
+void MinMaxPyramid::layout(const LodBin* base) {
+    levels.clear();
+    for (uint64_t bins : levelBins)
+        for (uint32_t ch = 0; ch < channelCount; ++ch) {
+            levels.push_back(base);
+            base += bins;
+        }
+}
+
+bool MinMaxPyramid::open(const RecordingReader& recording, const std::string& path, bool useCache) {
+    cache.close();
+    built.clear();
+    channelCount = recording.info().channelCount;
+    totalSamples = recording.getTotalSamples();
+    levelBins = levelSizes(totalSamples);
+
+    const std::string cachePath = path + ".lod";
+    if (useCache && recording.isComplete() && loadCache(cachePath, recording)) return true;
+
+    build(recording);
+    if (useCache && recording.isComplete()) saveCache(cachePath, recording);
+    return false;
+}
+
+bool MinMaxPyramid::loadCache(const std::string& path, const RecordingReader& recording) {
+    try {
+        cache.open(path);
+    } catch (const std::exception&) {
+        return false;
+    }
+    LodCacheHeader header;
+    if (cache.size() < sizeof(header)) return false;
+    std::memcpy(&header, cache.data(), sizeof(header));
+    bool valid = std::memcmp(header.magic, LOD_MAGIC, sizeof(header.magic)) == 0 &&
+        header.version == LOD_VERSION && header.headerBytes == sizeof(LodCacheHeader) &&
+        header.channelCount == channelCount && header.baseSamples == LOD_BASE_SAMPLES &&
+        header.fanout == LOD_FANOUT && header.levelCount == levelBins.size() &&
+        header.totalSamples == totalSamples && header.sourceBytes == recording.fileBytes() &&
+        header.sourceStartUnixNs == recording.info().startUnixNs &&
+        cache.size() == sizeof(header) + sizeBytes();
+    if (!valid) {
+        cache.close();
+        return false;
+    }
+    layout(reinterpret_cast<const LodBin*>(cache.data() + header.headerBytes));
+    return true;
+}
+
+void MinMaxPyramid::build(const RecordingReader& recording) {
+    built.assign(sizeBytes() / sizeof(LodBin), LodBin{});
+    layout(built.data());
+    if (levelBins.empty()) return;
+
+    // Уровень 0 — из сэмплов, потоково кусками по LOD_BUILD_CHUNK
+    std::vector<float> chunk(LOD_BUILD_CHUNK);
+    for (uint32_t ch = 0; ch < channelCount; ++ch) {
+        LodBin* bins = const_cast<LodBin*>(level(0, ch));
+        for (uint64_t pos = 0; pos < totalSamples; pos += LOD_BUILD_CHUNK) {
+            size_t n = recording.readSamples(ch, pos, LOD_BUILD_CHUNK, chunk.data());
+            for (size_t i = 0; i < n; i += LOD_BASE_SAMPLES) {
+                size_t end = std::min(n, i + LOD_BASE_SAMPLES);
+                float lo = chunk[i], hi = chunk[i];
+                double sum = 0.0;
+                for (size_t j = i; j < end; ++j) {
+                    lo = std::min(lo, chunk[j]);
+                    hi = std::max(hi, chunk[j]);
+                    sum += chunk[j];
+                }
+                bins[(pos + i) / LOD_BASE_SAMPLES] = {lo, hi, (float)(sum / (double)(end - i))};
+            }
+        }
+    }
+
+    // Остальные уровни — из предыдущего; среднее взвешено числом сэмплов (последняя корзина неполная)
+    for (size_t l = 1; l < levelBins.size(); ++l) {
+        const uint64_t childSamples = binSamples(l - 1);
+        for (uint32_t ch = 0; ch < channelCount; ++ch) {
+            const LodBin* child = level(l - 1, ch);
+            LodBin* bins = const_cast<LodBin*>(level(l, ch));
+            for (uint64_t b = 0; b < levelBins[l]; ++b) {
+                uint64_t c0 = b * LOD_FANOUT;
+                uint64_t c1 = std::min<uint64_t>(c0 + LOD_FANOUT, levelBins[l - 1]);
+                LodBin out = child[c0];
+                double sum = 0.0, weight = 0.0;
+                for (uint64_t c = c0; c < c1; ++c) {
+                    out.min = std::min(out.min, child[c].min);
+                    out.max = std::max(out.max, child[c].max);
+                    double w = (double)std::min(childSamples, totalSamples - c * childSamples);
+                    sum += child[c].mean * w;
+                    weight += w;
+                }
+                out.mean = (float)(sum / weight);
+                bins[b] = out;
+            }
+        }
+    }
+}
+
+void MinMaxPyramid::saveCache(const std::string& path, const RecordingReader& recording) const {
+    LodCacheHeader header{};
+    std::memcpy(header.magic, LOD_MAGIC, sizeof(header.magic));
+    header.version           = LOD_VERSION;
+    header.headerBytes       = sizeof(LodCacheHeader);
+    header.channelCount      = channelCount;
+    header.baseSamples       = LOD_BASE_SAMPLES;
+    header.fanout            = LOD_FANOUT;
+    header.levelCount        = (uint32_t)levelBins.size();
+    header.totalSamples      = totalSamples;
+    header.sourceBytes       = recording.fileBytes();
+    header.sourceStartUnixNs = recording.info().startUnixNs;
+
+    // Кэш необязателен: не удалось записать — в следующий раз пирамида построится заново
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) return;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(built.data()), (std::streamsize)(built.size() * sizeof(LodBin)));
+}
+
+void MinMaxPyramid::query(const RecordingReader& recording, uint32_t channel, double first, double last,
+                          size_t maxPoints, LodSlice& out) const {
+    out.x.clear();
+    out.min.clear();
+    out.max.clear();
+    out.mean.clear();
+    out.raw = false;
+
+    first = std::max(first, 0.0);
+    last = std::min(last, (double)totalSamples);
+    if (levelBins.empty() || channel >= channelCount || last <= first) return;
+    double perPoint = (last - first) / (double)std::max<size_t>(maxPoints, 1);
+
+    if (perPoint < LOD_BASE_SAMPLES) {
+        // Ближе уровня 0 — сами сэмплы, их не больше maxPoints * LOD_BASE_SAMPLES
+        uint64_t a = (uint64_t)std::floor(first);
+        uint64_t b = std::min<uint64_t>(totalSamples, (uint64_t)std::ceil(last) + 1);
+        out.mean.resize((size_t)(b - a));
+        size_t n = recording.readSamples(channel, a, out.mean.size(), out.mean.data());
+        out.mean.resize(n);
+        out.x.resize(n);
+        for (size_t i = 0; i < n; ++i) out.x[i] = (double)(a + i);
+        out.raw = true;
+        return;
+    }
+
+    size_t lvl = 0;
+    while (lvl + 1 < levelBins.size() && (double)binSamples(lvl + 1) <= perPoint) lvl++;
+    const uint64_t bs = binSamples(lvl);
+    // По корзине с каждой стороны, чтобы линия не обрывалась у края графика
+    uint64_t i0 = (uint64_t)(first / (double)bs);
+    uint64_t i1 = std::min<uint64_t>(levelBins[lvl], (uint64_t)std::ceil(last / (double)bs) + 1);
+    if (i0 > 0) i0--;
+
+    const LodBin* bins = level(lvl, channel);
+    size_t n = (size_t)(i1 - i0);
+    out.x.resize(n);
+    out.min.resize(n);
+    out.max.resize(n);
+    out.mean.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        const LodBin& bin = bins[i0 + i];
+        out.x[i] = (double)((i0 + i) * bs);
+        out.min[i] = bin.min;
+        out.max[i] = bin.max;
+        out.mean[i] = bin.mean;
+    }
+}
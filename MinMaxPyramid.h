@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "RecordingFormat.h"
+
+// ==== Пирамида min/max/mean для просмотра длинных записей ====
+//
+// Уровень 0 — корзины по LOD_BASE_SAMPLES сэмплов, каждый следующий уровень в LOD_FANOUT раз грубее.
+// На экран выбирается уровень, где корзина не длиннее пикселя, и читаются только видимые корзины,
+// поэтому кадр стоит O(ширина графика) при любом масштабе. Мельче корзины нулевого уровня
+// рисуются сами сэмплы из отображённого файла.
+//
+// Кэш .emgr.lod (little-endian):
+//   [LodCacheHeader]
+//   [LodBin] x bins(level) x channelCount, уровень за уровнем, внутри уровня — по каналам
+
+const char     LOD_MAGIC[8]     = {'E', 'M', 'G', 'L', 'O', 'D', '0', '1'};
+const uint32_t LOD_VERSION      = 1;
+const uint32_t LOD_BASE_SAMPLES = 32;
+const uint32_t LOD_FANOUT       = 4;
+
+struct LodBin {
+    float min;
+    float max;
+    float mean;
+};
+
+struct LodCacheHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t headerBytes;
+    uint32_t channelCount;
+    uint32_t baseSamples;
+    uint32_t fanout;
+    uint32_t levelCount;
+    uint64_t totalSamples;
+    uint64_t sourceBytes;       // Размер .emgr, по которому построен кэш
+    int64_t  sourceStartUnixNs; // startUnixNs из заголовка записи
+    uint64_t reserved0;
+};
+
+static_assert(sizeof(LodBin) == 12, "LodBin layout");
+static_assert(sizeof(LodCacheHeader) == 64, "LodCacheHeader layout");
+
+/**
+ * @brief Видимый участок канала: точки уровня пирамиды или сами сэмплы (raw)
+ */
+struct LodSlice {
+    std::vector<double> x;      // Индекс сэмпла (начало корзины)
+    std::vector<float> min;
+    std::vector<float> max;
+    std::vector<float> mean;    // Для raw — сами значения
+    bool raw = false;
+};
+
+class MinMaxPyramid {
+private:
+    MappedFile cache;
+    std::vector<LodBin> built;                  // Если кэш не загружен — пирамида в памяти
+    std::vector<const LodBin*> levels;          // levels[level * channelCount + channel]
+    std::vector<uint64_t> levelBins;
+    uint32_t channelCount;
+    uint64_t totalSamples;
+
+    bool loadCache(const std::string& path, const RecordingReader& recording);
+    void build(const RecordingReader& recording);
+    void saveCache(const std::string& path, const RecordingReader& recording) const;
+    void layout(const LodBin* base);
+
+public:
+    MinMaxPyramid();
+
+    /**
+     * @brief Загружает кэш path + ".lod" или строит пирамиду и сохраняет кэш
+     *        (только для завершённых записей — растущий файл кэш бы сразу инвалидировал)
+     * @return true, если пирамида взята из кэша
+     */
+    bool open(const RecordingReader& recording, const std::string& path, bool useCache = true);
+
+    size_t levelCount() const { return levelBins.size(); }
+    uint64_t binSamples(size_t level) const;
+    uint64_t binCount(size_t level) const { return levelBins[level]; }
+    const LodBin* level(size_t level, uint32_t channel) const { return levels[level * channelCount + channel]; }
+
+    // Объём пирамиды (в памяти или в кэше)
+    size_t sizeBytes() const;
+
+    /**
+     * @brief Точки канала на отрезке [first, last) сэмплов для графика шириной maxPoints пикселей
+     */
+    void query(const RecordingReader& recording, uint32_t channel, double first, double last,
+               size_t maxPoints, LodSlice& out) const;
+};
@@ -0,0 +1,523 @@
+#include "NetStream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "HostClock.h"
+#include "Metrics.h"
+#include "Trace.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+typedef int sendlen_t;
+static int closeSocket(socket_t s) { return closesocket(s); }
+static bool wouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+static int pollSockets(WSAPOLLFD* fds, size_t n, int timeoutMs) { return WSAPoll(fds, (ULONG)n, timeoutMs); }
+typedef WSAPOLLFD pollfd_t;
+const int SEND_FLAGS = 0;
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+typedef size_t sendlen_t;
+static int closeSocket(socket_t s) { return ::close(s); }
+static bool wouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR; }
+static int pollSockets(pollfd* fds, size_t n, int timeoutMs) { return ::poll(fds, (nfds_t)n, timeoutMs); }
+typedef pollfd pollfd_t;
+#ifdef MSG_NOSIGNAL
+const int SEND_FLAGS = MSG_NOSIGNAL;    // Разрыв соединения — ошибка send(), а не SIGPIPE
+#else
+const int SEND_FLAGS = 0;
+#endif
+#endif
+
+const intptr_t NO_SOCKET = -1;
+
+static socket_t toSocket(intptr_t s) { return (socket_t)s; }
+
+static void initSockets() {
+#ifdef _WIN32
+    static bool started = false;
+    if (!started) {
+        WSADATA data;
+        if (WSAStartup(MAKEWORD(2, 2), &data) != 0) throw std::runtime_error("WSAStartup failed");
+        started = true;
+    }
+#endif
+}
+
+static void setNonBlocking(socket_t s) {
+#ifdef _WIN32
+    u_long on = 1;
+    ioctlsocket(s, FIONBIO, &on);
+#else
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+// "host:port" или "host" + port -> IPv4-адрес
+static sockaddr_in resolve(const std::string& host, int port) {
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || !result)
+        throw std::runtime_error("Cannot resolve " + host);
+    sockaddr_in addr;
+    std::memcpy(&addr, result->ai_addr, sizeof(addr));
+    freeaddrinfo(result);
+    addr.sin_port = htons((uint16_t)port);
+    return addr;
+}
+
+static void splitHostPort(const std::string& target, std::string& host, int& port) {
+    size_t colon = target.rfind(':');
+    if (colon == std::string::npos) throw std::runtime_error("Expected host:port, got " + target);
+    host = target.substr(0, colon);
+    port = std::atoi(target.c_str() + colon + 1);
+    if (port <= 0 || port > 65535) throw std::runtime_error("Bad port in " + target);
+}
+
+// ==== Сервер ====
+
+NetStreamServer::NetStreamServer()
+    : sampleRate(0.0),
+      opened(false),
+      udpSocket(NO_SOCKET),
+      listenSocket(NO_SOCKET),
+      boundTcpPort(0),
+      buildingSinceNs(0),
+      nextSequence(0),
+      nextSample(0),
+      stopping(false) {}
+
+NetStreamServer::~NetStreamServer() {
+    close();
+}
+
+void NetStreamServer::open(const NetStreamOptions& opts, double sampleRate_) {
+    close();
+    initSockets();
+    options = opts;
+    sampleRate = sampleRate_;
+    options.batchSamples = std::max<uint32_t>(1, options.batchSamples);
+    if (!options.udpTarget.empty()) options.batchSamples = std::min(options.batchSamples, NET_MAX_UDP_SAMPLES);
+
+    try {
+        if (!options.udpTarget.empty()) {
+            std::string host;
+            int port = 0;
+            splitHostPort(options.udpTarget, host, port);
+            sockaddr_in addr = resolve(host, port);
+            socket_t s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+            if (s == (socket_t)NO_SOCKET) throw std::runtime_error("Cannot create UDP socket");
+            udpSocket = (intptr_t)s;
+            if (IN_MULTICAST(ntohl(addr.sin_addr.s_addr))) {
+                int ttl = options.udpTtl;
+                setsockopt(s, IPPROTO_IP, IP_MULTICAST_TTL, (const char*)&ttl, sizeof(ttl));
+                int loop = 1;    // Подписчики на этой же машине тоже получают
+                setsockopt(s, IPPROTO_IP, IP_MULTICAST_LOOP, (const char*)&loop, sizeof(loop));
+            }
+            udpAddress.assign((const uint8_t*)&addr, (const uint8_t*)&addr + sizeof(addr));
+        }
+
+        if (options.tcpPort >= 0) {
+            sockaddr_in addr = resolve(options.tcpBind, options.tcpPort);
+            socket_t s = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            if (s == (socket_t)NO_SOCKET) throw std::runtime_error("Cannot create TCP socket");
+            listenSocket = (intptr_t)s;
+            int on = 1;
+            setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+            if (::bind(s, (const sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(s, 8) != 0)
+                throw std::runtime_error("Cannot listen on TCP port " + std::to_string(options.tcpPort));
+            setNonBlocking(s);
+            socklen_t len = sizeof(addr);
+            getsockname(s, (sockaddr*)&addr, &len);
+            boundTcpPort = ntohs(addr.sin_port);
+        }
+    } catch (...) {
+        closeSockets();
+        throw;
+    }
+
+    building.clear();
+    ready.clear();
+    nextSequence = 0;
+    nextSample = 0;
+    stats = NetStreamStats();
+    stopping = false;
+    opened = true;
+    sender = std::thread(&NetStreamServer::senderLoop, this);
+}
+
+void NetStreamServer::close() {
+    if (!opened) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_one();
+    sender.join();
+    closeSockets();
+    opened = false;
+}
+
+void NetStreamServer::closeSockets() {
+    if (udpSocket != NO_SOCKET) closeSocket(toSocket(udpSocket));
+    if (listenSocket != NO_SOCKET) closeSocket(toSocket(listenSocket));
+    for (TcpClient& c : clients) closeSocket(toSocket(c.socket));
+    clients.clear();
+    udpSocket = NO_SOCKET;
+    listenSocket = NO_SOCKET;
+    boundTcpPort = 0;
+}
+
+void NetStreamServer::sealPacket() {
+    if (building.empty()) return;
+    NetPacketHeader* h = reinterpret_cast<NetPacketHeader*>(building.data());
+    h->sequence = nextSequence++;
+    ready.push_back(std::make_shared<std::vector<uint8_t>>(std::move(building)));
+    building = std::vector<uint8_t>();
+    stats.packets++;
+}
+
+void NetStreamServer::publish(const float* samples, size_t count, int64_t hostTimeNs, uint64_t lostSamples) {
+    if (!opened || count == 0) return;
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (count > 0) {
+            if (building.empty()) {
+                building.reserve(sizeof(NetPacketHeader) + options.batchSamples * sizeof(float));
+                building.resize(sizeof(NetPacketHeader));
+                NetPacketHeader h;
+                std::memset(&h, 0, sizeof(h));
+                h.magic = NET_PACKET_MAGIC;
+                h.version = NET_PACKET_VERSION;
+                h.headerBytes = sizeof(NetPacketHeader);
+                h.firstSample = nextSample;
+                h.hostTimeNs = hostTimeNs;
+                h.sampleRate = sampleRate;
+                std::memcpy(building.data(), &h, sizeof(h));
+                buildingSinceNs = hostNowNs();
+            }
+            NetPacketHeader* h = reinterpret_cast<NetPacketHeader*>(building.data());
+            uint32_t n = (uint32_t)std::min<size_t>(count, options.batchSamples - h->sampleCount);
+            h->lostSamples += (uint32_t)std::min<uint64_t>(lostSamples, UINT32_MAX - h->lostSamples);
+            lostSamples = 0;
+            h->sampleCount += n;
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(samples);
+            building.insert(building.end(), bytes, bytes + n * sizeof(float));
+            nextSample += n;
+            samples += n;
+            count -= n;
+            if (reinterpret_cast<NetPacketHeader*>(building.data())->sampleCount == options.batchSamples) {
+                sealPacket();
+                wake = true;
+            }
+        }
+    }
+    if (wake) cv.notify_one();
+}
+
+void NetStreamServer::senderLoop() {
+    const int64_t maxDelayNs = (int64_t)(options.maxDelayMs * 1e6);
+    std::vector<Packet> packets;
+    for (;;) {
+        bool finished;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            // Просыпаемся к сроку неполного пакета; без него — чтобы принять подписчиков и
+            // дописать очереди тем, кому не хватило места в буфере сокета
+            bool pending = false;
+            for (const TcpClient& c : clients) pending = pending || !c.queue.empty();
+            int64_t waitNs = pending ? 2000000 : 50000000;
+            if (!building.empty()) waitNs = std::min(waitNs, buildingSinceNs + maxDelayNs - hostNowNs());
+            if (waitNs > 0 && ready.empty() && !stopping)
+                cv.wait_for(lock, std::chrono::nanoseconds(waitNs), [this] { return stopping || !ready.empty(); });
+            if (!building.empty() && (stopping || hostNowNs() - buildingSinceNs >= maxDelayNs)) sealPacket();
+            packets.swap(ready);
+            finished = stopping;
+        }
+
+        const int64_t now = hostNowNs();
+        for (const Packet& p : packets) reinterpret_cast<NetPacketHeader*>(p->data())->sendNs = now;
+        if (udpSocket != NO_SOCKET && !packets.empty()) sendUdp(packets);
+        if (listenSocket != NO_SOCKET) {
+            acceptClients();
+            serveClients(packets);
+        }
+        packets.clear();
+        if (finished) break;
+    }
+}
+
+void NetStreamServer::sendUdp(const std::vector<Packet>& packets) {
+    EMG_TRACE_SCOPE("udp send");
+    const sockaddr* to = reinterpret_cast<const sockaddr*>(udpAddress.data());
+    uint64_t sent = 0, errors = 0;
+#if defined(__linux__)
+    // Все готовые пакеты — одним системным вызовом
+    const size_t MAX_BATCH = 64;
+    mmsghdr msgs[MAX_BATCH];
+    iovec iov[MAX_BATCH];
+    for (size_t start = 0; start < packets.size(); start += MAX_BATCH) {
+        size_t n = std::min(MAX_BATCH, packets.size() - start);
+        for (size_t i = 0; i < n; ++i) {
+            iov[i].iov_base = packets[start + i]->data();
+            iov[i].iov_len = packets[start + i]->size();
+            std::memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_name = const_cast<sockaddr*>(to);
+            msgs[i].msg_hdr.msg_namelen = (socklen_t)udpAddress.size();
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        size_t done = 0;
+        while (done < n) {
+            int r = sendmmsg((int)udpSocket, msgs + done, (unsigned)(n - done), 0);
+            if (r <= 0) {
+                if (r < 0 && errno == EINTR) continue;
+                errors += n - done;    // Датаграммы не повторяются: UDP допускает потери
+                break;
+            }
+            done += (size_t)r;
+            sent += (uint64_t)r;
+        }
+    }
+#else
+    for (const Packet& p : packets) {
+        if (::sendto(toSocket(udpSocket), (const char*)p->data(), (sendlen_t)p->size(), 0, to,
+                     (socklen_t)udpAddress.size()) < 0)
+            errors++;
+        else
+            sent++;
+    }
+#endif
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.udpDatagrams += sent;
+    stats.udpErrors += errors;
+}
+
+void NetStreamServer::acceptClients() {
+    for (;;) {
+        socket_t s = ::accept(toSocket(listenSocket), nullptr, nullptr);
+        if (s == (socket_t)NO_SOCKET) return;
+        if (clients.size() >= options.maxTcpClients) {
+            closeSocket(s);
+            continue;
+        }
+        setNonBlocking(s);
+        int on = 1;
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+        clients.push_back(TcpClient{(intptr_t)s, {}, 0, 0});
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.tcpClients = clients.size();
+    }
+}
+
+void NetStreamServer::serveClients(const std::vector<Packet>& packets) {
+    if (clients.empty()) return;
+    EMG_TRACE_SCOPE("tcp send");
+    uint64_t bytes = 0, dropped = 0, disconnects = 0;
+    for (size_t i = 0; i < clients.size();) {
+        TcpClient& c = clients[i];
+        for (const Packet& p : packets) {
+            c.queue.push_back(p);
+            c.queuedBytes += p->size();
+        }
+        // Медленный подписчик теряет самые старые пакеты; частично отправленная голова остаётся,
+        // иначе поток байт разорвётся посреди пакета
+        size_t keepFrom = c.headOffset > 0 ? 1 : 0;
+        while (c.queuedBytes > options.tcpQueueBytes && c.queue.size() > keepFrom + 1) {
+            c.queuedBytes -= c.queue[keepFrom]->size();
+            c.queue.erase(c.queue.begin() + (ptrdiff_t)keepFrom);
+            dropped++;
+        }
+
+        bool broken = false;
+        while (!c.queue.empty()) {
+            const std::vector<uint8_t>& head = *c.queue.front();
+            int r = (int)::send(toSocket(c.socket), (const char*)head.data() + c.headOffset,
+                                (sendlen_t)(head.size() - c.headOffset), SEND_FLAGS);
+            if (r < 0) {
+                broken = !wouldBlock();
+                break;
+            }
+            bytes += (uint64_t)r;
+            c.headOffset += (size_t)r;
+            if (c.headOffset < head.size()) break;    // Буфер сокета полон
+            c.queuedBytes -= head.size();
+            c.headOffset = 0;
+            c.queue.erase(c.queue.begin());
+        }
+        if (broken) {
+            closeSocket(toSocket(c.socket));
+            clients.erase(clients.begin() + (ptrdiff_t)i);
+            disconnects++;
+            continue;
+        }
+        ++i;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.tcpBytes += bytes;
+    stats.tcpDroppedPackets += dropped;
+    stats.tcpDisconnects += disconnects;
+    stats.tcpClients = clients.size();
+}
+
+NetStreamStats NetStreamServer::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void publishNetMetrics(MetricsRegistry& registry, const NetStreamStats& stats) {
+    registry.counter("emg_net_packets_total", "Packets built by the network streamer").store(stats.packets);
+    registry.counter("emg_net_udp_datagrams_total", "UDP datagrams sent").store(stats.udpDatagrams);
+    registry.counter("emg_net_udp_errors_total", "UDP datagrams that failed to send").store(stats.udpErrors);
+    registry.counter("emg_net_tcp_bytes_total", "Bytes sent to TCP subscribers").store(stats.tcpBytes);
+    registry.gauge("emg_net_tcp_clients", "Connected TCP subscribers").set((int64_t)stats.tcpClients);
+    registry.counter("emg_net_tcp_dropped_packets_total", "Packets dropped from slow subscriber queues").store(stats.tcpDroppedPackets);
+    registry.counter("emg_net_tcp_disconnects_total", "TCP subscribers disconnected on send errors").store(stats.tcpDisconnects);
+}
+
+// ==== Клиент ====
+
+NetStreamClient::NetStreamClient()
+    : socket(NO_SOCKET), tcp(false), bufferStart(0), haveSequence(false), expectedSequence(0), lostPackets(0) {}
+
+NetStreamClient::~NetStreamClient() {
+    close();
+}
+
+void NetStreamClient::connectTcp(const std::string& host, int port) {
+    close();
+    initSockets();
+    sockaddr_in addr = resolve(host, port);
+    socket_t s = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == (socket_t)NO_SOCKET) throw std::runtime_error("Cannot create TCP socket");
+    if (::connect(s, (const sockaddr*)&addr, sizeof(addr)) != 0) {
+        closeSocket(s);
+        throw std::runtime_error("Cannot connect to " + host + ":" + std::to_string(port));
+    }
+    int on = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+    socket = (intptr_t)s;
+    tcp = true;
+}
+
+void NetStreamClient::openUdp(int port, const std::string& group) {
+    close();
+    initSockets();
+    socket_t s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == (socket_t)NO_SOCKET) throw std::runtime_error("Cannot create UDP socket");
+    int on = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));    // Несколько подписчиков группы
+    int rcvbuf = 4 << 20;
+    setsockopt(s, SOL_SOCKET, SO_RCVBUF, (const char*)&rcvbuf, sizeof(rcvbuf));
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons((uint16_t)port);
+    if (::bind(s, (const sockaddr*)&addr, sizeof(addr)) != 0) {
+        closeSocket(s);
+        throw std::runtime_error("Cannot bind UDP port " + std::to_string(port));
+    }
+    if (!group.empty()) {
+        ip_mreq mreq;
+        mreq.imr_multiaddr = resolve(group, port).sin_addr;
+        mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (setsockopt(s, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char*)&mreq, sizeof(mreq)) != 0) {
+            closeSocket(s);
+            throw std::runtime_error("Cannot join multicast group " + group);
+        }
+    }
+    socket = (intptr_t)s;
+    tcp = false;
+}
+
+void NetStreamClient::close() {
+    if (socket != NO_SOCKET) closeSocket(toSocket(socket));
+    socket = NO_SOCKET;
+    buffer.clear();
+    bufferStart = 0;
+    haveSequence = false;
+}
+
+// Пакет из начала buffer[bufferStart..]; false — данных пока не хватает
+bool NetStreamClient::parse(NetBatch& out) {
+    size_t available = buffer.size() - bufferStart;
+    if (available < sizeof(NetPacketHeader)) return false;
+    NetPacketHeader h;
+    std::memcpy(&h, buffer.data() + bufferStart, sizeof(h));
+    if (h.magic != NET_PACKET_MAGIC || h.headerBytes < sizeof(NetPacketHeader))
+        throw std::runtime_error("Bad packet in EMG network stream");
+    size_t packetBytes = h.headerBytes + (size_t)h.sampleCount * sizeof(float);
+    if (available < packetBytes) return false;
+
+    out.header = h;
+    out.samples.resize(h.sampleCount);
+    std::memcpy(out.samples.data(), buffer.data() + bufferStart + h.headerBytes, h.sampleCount * sizeof(float));
+    out.receiveNs = hostNowNs();
+    bufferStart += packetBytes;
+
+    // UDP может переставить датаграммы: опоздавший пакет не двигает ожидаемый номер назад
+    if (haveSequence && h.sequence > expectedSequence) lostPackets += h.sequence - expectedSequence;
+    if (!haveSequence || h.sequence >= expectedSequence) expectedSequence = h.sequence + 1;
+    haveSequence = true;
+    return true;
+}
+
+bool NetStreamClient::receive(NetBatch& out, int timeoutMs) {
+    if (socket == NO_SOCKET) return false;
+    const int64_t deadline = hostNowNs() + (int64_t)timeoutMs * 1000000;
+    for (;;) {
+        if (tcp && parse(out)) return true;
+
+        int64_t left = deadline - hostNowNs();
+        pollfd_t pfd;
+        pfd.fd = toSocket(socket);
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (pollSockets(&pfd, 1, (int)std::max<int64_t>(0, left / 1000000)) <= 0) return false;
+
+        if (tcp) {
+            if (bufferStart > 0 && bufferStart * 2 > buffer.size()) {
+                buffer.erase(buffer.begin(), buffer.begin() + (ptrdiff_t)bufferStart);
+                bufferStart = 0;
+            }
+            size_t old = buffer.size();
+            buffer.resize(old + 65536);
+            int r = (int)::recv(toSocket(socket), (char*)buffer.data() + old, 65536, 0);
+            buffer.resize(old + (size_t)std::max(r, 0));
+            if (r <= 0) {
+                close();    // Сервер закрыл соединение
+                return false;
+            }
+        } else {
+            buffer.resize(NET_MAX_DATAGRAM + 64);
+            int r = (int)::recv(toSocket(socket), (char*)buffer.data(), (sendlen_t)buffer.size(), 0);
+            if (r <= 0) continue;
+            buffer.resize((size_t)r);
+            bufferStart = 0;
+            uint32_t magic = 0;
+            if (buffer.size() >= sizeof(magic)) std::memcpy(&magic, buffer.data(), sizeof(magic));
+            bool ok = magic == NET_PACKET_MAGIC && parse(out);
+            buffer.clear();
+            if (ok) return true;    // Чужая или обрезанная датаграмма пропускается
+        }
+        if (hostNowNs() >= deadline) return false;
+    }
+}
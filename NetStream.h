@@ -0,0 +1,178 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ==== Сетевая раздача живого потока (UDP, в т.ч. multicast, и TCP) ====
+//
+// Сэмплы копятся в пакеты с номером: пакет уходит, когда набрано batchSamples сэмплов или
+// самый старый сэмпл ждёт maxDelayMs — компромисс между задержкой и числом пакетов.
+// Пакет (little-endian): [NetPacketHeader][float32 x sampleCount]. По UDP — один пакет на
+// датаграмму (не больше NET_MAX_DATAGRAM байт), готовые пакеты уходят одним sendmmsg().
+// По TCP пакеты идут подряд, длина — из заголовка.
+// Подписчики TCP изолированы: у каждого своя очередь; кто не успевает, теряет самые старые
+// пакеты (виден разрыв sequence), остальные не ждут. publish() в сеть не ходит — отправка
+// в отдельном потоке.
+
+const uint32_t NET_PACKET_MAGIC   = 0x4E474D45;    // "EMGN"
+const uint16_t NET_PACKET_VERSION = 1;
+const size_t   NET_MAX_DATAGRAM   = 1400;          // Без фрагментации при MTU 1500
+
+struct NetPacketHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerBytes;
+    uint64_t sequence;          // Номер пакета
+    uint64_t firstSample;       // Индекс первого сэмпла в потоке
+    int64_t  hostTimeNs;        // Время чтения порта для первого сэмпла (часы отправителя)
+    int64_t  sendNs;            // Время отправки пакета (часы отправителя)
+    uint32_t sampleCount;
+    uint32_t lostSamples;       // Потеряно датчиком внутри пакета
+    double   sampleRate;
+};
+
+static_assert(sizeof(NetPacketHeader) == 56, "NetPacketHeader layout");
+
+const uint32_t NET_MAX_UDP_SAMPLES = (uint32_t)((NET_MAX_DATAGRAM - sizeof(NetPacketHeader)) / sizeof(float));
+
+struct NetStreamOptions {
+    std::string udpTarget;             // "239.1.2.3:5005" (multicast) или "host:port"; пусто — без UDP
+    int udpTtl = 1;                    // TTL multicast: 1 — только локальная сеть
+    int tcpPort = -1;                  // -1 — без TCP, 0 — любой свободный порт
+    std::string tcpBind = "0.0.0.0";
+    uint32_t batchSamples = 32;        // Сэмплов в пакете (для UDP не больше NET_MAX_UDP_SAMPLES)
+    double maxDelayMs = 10.0;          // Неполный пакет уходит, когда старейший сэмпл ждёт столько
+    size_t tcpQueueBytes = 1 << 20;    // Очередь одного подписчика TCP
+    size_t maxTcpClients = 16;
+};
+
+struct NetStreamStats {
+    uint64_t packets = 0;              // Собрано пакетов
+    uint64_t udpDatagrams = 0;
+    uint64_t udpErrors = 0;
+    uint64_t tcpBytes = 0;
+    uint64_t tcpClients = 0;           // Подключено сейчас
+    uint64_t tcpDroppedPackets = 0;    // Вытеснено из очередей медленных подписчиков
+    uint64_t tcpDisconnects = 0;
+};
+
+/**
+ * @brief Сервер раздачи: publish() из потока чтения, отправка — в своём потоке
+ */
+class NetStreamServer {
+private:
+    typedef std::shared_ptr<std::vector<uint8_t>> Packet;    // Общий для всех подписчиков
+
+    struct TcpClient {
+        intptr_t socket;
+        std::vector<Packet> queue;     // Голова может быть отправлена частично
+        size_t headOffset;
+        size_t queuedBytes;
+    };
+
+    NetStreamOptions options;
+    double sampleRate;
+    bool opened;
+    intptr_t udpSocket;
+    std::vector<uint8_t> udpAddress;   // sockaddr получателя
+    intptr_t listenSocket;
+    int boundTcpPort;
+    std::vector<TcpClient> clients;    // Только поток отправки
+
+    // Под mutex: текущий пакет и готовые к отправке
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<uint8_t> building;
+    int64_t buildingSinceNs;
+    std::vector<Packet> ready;
+    uint64_t nextSequence;
+    uint64_t nextSample;
+    bool stopping;
+    NetStreamStats stats;
+
+    std::thread sender;
+
+    void sealPacket();                 // Под mutex
+    void senderLoop();
+    void sendUdp(const std::vector<Packet>& packets);
+    void acceptClients();
+    void serveClients(const std::vector<Packet>& packets);
+    void closeSockets();
+
+public:
+    NetStreamServer();
+    ~NetStreamServer();
+
+    NetStreamServer(const NetStreamServer&) = delete;
+    NetStreamServer& operator=(const NetStreamServer&) = delete;
+
+    void open(const NetStreamOptions& options, double sampleRate);
+    // Отправляет неполный пакет и закрывает соединения
+    void close();
+
+    /**
+     * @param lostSamples Потеряно перед порцией (прибавляется к пакету, куда попадёт первый сэмпл)
+     */
+    void publish(const float* samples, size_t count, int64_t hostTimeNs, uint64_t lostSamples = 0);
+
+    bool isOpen() const { return opened; }
+    int getTcpPort() const { return boundTcpPort; }
+    NetStreamStats getStats();
+};
+
+class MetricsRegistry;
+
+/**
+ * @brief Копирует статистику сервера в метрики реестра (emg_net_*)
+ */
+void publishNetMetrics(MetricsRegistry& registry, const NetStreamStats& stats);
+
+/**
+ * @brief Пакет, принятый клиентом
+ */
+struct NetBatch {
+    NetPacketHeader header;
+    std::vector<float> samples;
+    int64_t receiveNs = 0;             // hostNowNs() получателя
+};
+
+/**
+ * @brief Приёмник потока (для подписчиков и проверки по loopback)
+ */
+class NetStreamClient {
+private:
+    intptr_t socket;
+    bool tcp;
+    std::vector<uint8_t> buffer;       // TCP: принятые, ещё не разобранные байты
+    size_t bufferStart;
+    bool haveSequence;
+    uint64_t expectedSequence;
+    uint64_t lostPackets;
+
+    bool parse(NetBatch& out);
+
+public:
+    NetStreamClient();
+    ~NetStreamClient();
+
+    NetStreamClient(const NetStreamClient&) = delete;
+    NetStreamClient& operator=(const NetStreamClient&) = delete;
+
+    void connectTcp(const std::string& host, int port);
+    /**
+     * @param group Адрес multicast-группы ("239.1.2.3") или пусто для unicast
+     */
+    void openUdp(int port, const std::string& group = "");
+    void close();
+
+    // false — за timeoutMs пакета нет или соединение закрыто (isOpen() == false)
+    bool receive(NetBatch& out, int timeoutMs);
+
+    bool isOpen() const { return socket != -1; }
+    uint64_t getLostPackets() const { return lostPackets; }
+};
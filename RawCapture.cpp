@@ -0,0 +1,175 @@
+#include "RawCapture.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include "HostClock.h"
+#include "Trace.h"
+
+// ==== RawCaptureWriter ====
+
+RawCaptureWriter::RawCaptureWriter()
+    : chunks(0),
+      droppedChunks(0),
+      lossless(false) {}
+
+void RawCaptureWriter::open(const std::string& path, const std::string& device, int64_t startHostNs,
+                            bool lossless_) {
+    lossless = lossless_;
+    AsyncWriterOptions opts;
+    opts.bufferBytes = 256 * 1024;
+    output.open(path, opts);
+
+    CaptureHeader header{};
+    std::memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+    header.version     = CAPTURE_VERSION;
+    header.headerBytes = sizeof(CaptureHeader);
+    header.startUnixNs = wallNowNs();
+    header.startHostNs = startHostNs;
+    std::strncpy(header.device, device.c_str(), sizeof(header.device) - 1);
+    output.writeBlocking(&header, sizeof(header));
+
+    record.reserve(sizeof(CaptureChunkHeader) + 4096);
+    chunks = 0;
+    droppedChunks = 0;
+}
+
+void RawCaptureWriter::append(CaptureDirection direction, const uint8_t* data, size_t size, int64_t hostTimeNs) {
+    if (!output.isOpen() || size == 0) return;
+    CaptureChunkHeader ch{};
+    ch.hostTimeNs = hostTimeNs;
+    ch.size = (uint32_t)size;
+    ch.direction = direction;
+
+    record.resize(sizeof(ch) + size);
+    std::memcpy(record.data(), &ch, sizeof(ch));
+    std::memcpy(record.data() + sizeof(ch), data, size);
+    if (lossless) {
+        output.writeBlocking(record.data(), record.size());
+        chunks++;
+    } else if (output.write(record.data(), record.size())) {
+        chunks++;
+    } else {
+        droppedChunks++;
+    }
+}
+
+void RawCaptureWriter::close() {
+    output.close();
+}
+
+// ==== CaptureTransport ====
+
+CaptureTransport::CaptureTransport(std::unique_ptr<Transport> inner_, const std::string& path_)
+    : inner(std::move(inner_)),
+      path(path_),
+      lastReadNs(0) {}
+
+CaptureTransport::~CaptureTransport() {
+    close();
+}
+
+void CaptureTransport::open() {
+    inner->open();
+    if (!writer.isOpen()) writer.open(path, inner->name(), hostNowNs());
+}
+
+void CaptureTransport::close() {
+    inner->close();
+    writer.close();
+}
+
+size_t CaptureTransport::read(uint8_t* buf, size_t capacity) {
+    size_t n = inner->read(buf, capacity);
+    lastReadNs = inner->readTimeNs();
+    if (n > 0) writer.append(CAPTURE_RX, buf, n, lastReadNs);    // То же время, что увидит декодер
+    return n;
+}
+
+void CaptureTransport::write(const uint8_t* data, size_t size) {
+    if (!writer.isOpen()) writer.open(path, inner->name(), hostNowNs());
+    writer.append(CAPTURE_TX, data, size, hostNowNs());
+    inner->write(data, size);
+}
+
+// ==== ReplayTransport ====
+
+ReplayTransport::ReplayTransport(const std::string& path_, double speed_)
+    : path(path_),
+      speed(speed_),
+      pos(0),
+      chunkOffset(0),
+      firstChunkNs(0),
+      replayStartNs(0),
+      lastChunkNs(0),
+      chunksReplayed(0),
+      ended(false) {}
+
+void ReplayTransport::open() {
+    mapped.open(path);
+    if (mapped.size() < sizeof(CaptureHeader))
+        throw std::runtime_error("Not a capture file: " + path);
+    const CaptureHeader* header = reinterpret_cast<const CaptureHeader*>(mapped.data());
+    if (std::memcmp(header->magic, CAPTURE_MAGIC, sizeof(header->magic)) != 0 || header->version != CAPTURE_VERSION)
+        throw std::runtime_error("Unsupported capture format: " + path);
+
+    pos = header->headerBytes;
+    chunkOffset = 0;
+    firstChunkNs = 0;
+    replayStartNs = 0;
+    chunksReplayed = 0;
+    ended = false;
+}
+
+void ReplayTransport::close() {
+    mapped.close();
+    ended = true;
+}
+
+size_t ReplayTransport::read(uint8_t* buf, size_t capacity) {
+    EMG_TRACE_SCOPE("read");
+    while (!ended) {
+        if (pos + sizeof(CaptureChunkHeader) > mapped.size()) {
+            ended = true;
+            break;
+        }
+        CaptureChunkHeader ch;
+        std::memcpy(&ch, mapped.data() + pos, sizeof(ch));
+        if (pos + sizeof(ch) + ch.size > mapped.size()) {    // Обрезанный последний чанк
+            ended = true;
+            break;
+        }
+        if (ch.direction != CAPTURE_RX) {
+            pos += sizeof(ch) + ch.size;
+            continue;
+        }
+
+        if (chunkOffset == 0) {
+            // Темп: чанк выдаётся не раньше, чем он пришёл в исходной записи (с учётом speed)
+            if (replayStartNs == 0) {
+                replayStartNs = hostNowNs();
+                firstChunkNs = ch.hostTimeNs;
+            }
+            if (speed > 0.0) {
+                int64_t due = replayStartNs + (int64_t)((ch.hostTimeNs - firstChunkNs) / speed);
+                int64_t wait = due - hostNowNs();
+                if (wait > 0) std::this_thread::sleep_for(std::chrono::nanoseconds(wait));
+            }
+            lastChunkNs = ch.hostTimeNs;
+        }
+
+        size_t n = std::min<size_t>(capacity, ch.size - chunkOffset);
+        std::memcpy(buf, mapped.data() + pos + sizeof(ch) + chunkOffset, n);
+        chunkOffset += n;
+        if (chunkOffset == ch.size) {
+            pos += sizeof(ch) + ch.size;
+            chunkOffset = 0;
+            chunksReplayed++;
+        }
+        return n;
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AsyncFileWriter.h"
+#include "MappedFile.h"
+#include "Transport.h"
+
+// ==== Захват сырого потока байт .emgcap (little-endian) ====
+//
+//   [CaptureHeader]
+//   [CaptureChunkHeader][bytes] ...   — один чанк на каждый ReadFile/read (и на каждую команду)
+//
+// Границы чанков и время их прихода сохраняются, поэтому воспроизведение
+// подаёт в декодер ровно те же порции байт, что пришли с провода.
+
+const char     CAPTURE_MAGIC[8] = {'E', 'M', 'G', 'C', 'A', 'P', '0', '1'};
+const uint32_t CAPTURE_VERSION  = 1;
+
+enum CaptureDirection : uint16_t {
+    CAPTURE_RX = 0,    // Байты от датчика
+    CAPTURE_TX = 1,    // Команды хоста
+};
+
+struct CaptureHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t headerBytes;
+    int64_t  startUnixNs;
+    int64_t  startHostNs;
+    char     device[64];
+};
+
+struct CaptureChunkHeader {
+    int64_t  hostTimeNs;    // Монотонное время хоста сразу после чтения
+    uint32_t size;
+    uint16_t direction;     // CaptureDirection
+    uint16_t reserved0;
+};
+
+static_assert(sizeof(CaptureHeader) == 96, "CaptureHeader layout");
+static_assert(sizeof(CaptureChunkHeader) == 16, "CaptureChunkHeader layout");
+
+/**
+ * @brief Запись файла захвата через AsyncFileWriter
+ */
+class RawCaptureWriter {
+private:
+    AsyncFileWriter output;
+    std::vector<uint8_t> record;    // Заголовок чанка + байты одним вызовом write()
+    uint64_t chunks;
+    uint64_t droppedChunks;
+    bool lossless;
+
+public:
+    RawCaptureWriter();
+
+    /**
+     * @param lossless Ждать писателя вместо отбрасывания чанков (для генерации файлов, не для живого порта)
+     */
+    void open(const std::string& path, const std::string& device, int64_t startHostNs, bool lossless = false);
+    void append(CaptureDirection direction, const uint8_t* data, size_t size, int64_t hostTimeNs);
+    void close();
+
+    bool isOpen() const { return output.isOpen(); }
+    uint64_t getChunkCount() const { return chunks; }
+    uint64_t getDroppedChunks() const { return droppedChunks; }
+};
+
+/**
+ * @brief Обёртка транспорта: всё прочитанное и отправленное дублируется в файл захвата
+ */
+class CaptureTransport : public Transport {
+private:
+    std::unique_ptr<Transport> inner;
+    std::string path;
+    RawCaptureWriter writer;
+    int64_t lastReadNs;
+
+public:
+    CaptureTransport(std::unique_ptr<Transport> inner, const std::string& path);
+    ~CaptureTransport() override;
+
+    void open() override;
+    void close() override;
+    size_t read(uint8_t* buf, size_t capacity) override;
+    void write(const uint8_t* data, size_t size) override;
+    void purge() override { inner->purge(); }
+    bool isEnd() const override { return inner->isEnd(); }
+    int64_t readTimeNs() const override { return lastReadNs; }
+    std::string name() const override { return inner->name(); }
+
+    uint64_t getDroppedChunks() const { return writer.getDroppedChunks(); }
+};
+
+/**
+ * @brief Воспроизведение файла захвата: те же порции байт в том же темпе
+ *        (speed = 1), в N раз быстрее (speed = N) или без пауз (speed = 0)
+ */
+class ReplayTransport : public Transport {
+private:
+    std::string path;
+    double speed;
+    MappedFile mapped;
+    size_t pos;                 // Смещение текущего чанка
+    size_t chunkOffset;         // Уже выданные байты текущего чанка
+    int64_t firstChunkNs;
+    int64_t replayStartNs;
+    int64_t lastChunkNs;
+    uint64_t chunksReplayed;
+    bool ended;
+
+public:
+    ReplayTransport(const std::string& path, double speed = 1.0);
+
+    void open() override;
+    void close() override;
+    size_t read(uint8_t* buf, size_t capacity) override;
+    void write(const uint8_t*, size_t) override {}    // Команды датчику при воспроизведении не нужны
+    bool isEnd() const override { return ended; }
+    int64_t readTimeNs() const override { return lastChunkNs; }
+    std::string name() const override { return "replay:" + path; }
+
+    uint64_t getChunksReplayed() const { return chunksReplayed; }
+
+    // Время прихода последнего выданного чанка по часам исходной записи
+    int64_t getLastChunkTimeNs() const { return lastChunkNs; }
+};
@@ -0,0 +1,371 @@
+#include "RecordingFormat.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include "DeltaCodec.h"
+#include "HostClock.h"
+
+std::string makeRecordingFileName(const std::string& prefix) {
+    std::time_t t = std::time(nullptr);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &t);
+#else
+    localtime_r(&t, &local);
+#endif
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", &local);
+    return prefix + "_" + stamp + ".emgr";
+}
+
+// ==== RecordingWriter ====
+
+RecordingWriter::RecordingWriter()
+    : header{},
+      headerMoved(false),
+      lossless(false),
+      fileOffset(0),
+      blockSequence(0),
+      droppedBlocks(0),
+      totalSamples(0),
+      fill(0),
+      lastHostNs(0) {}
+
+RecordingWriter::~RecordingWriter() {
+    close();
+}
+
+void RecordingWriter::open(const std::string& path_, const RecordingInfo& info,
+                           const AsyncWriterOptions& writerOptions, bool lossless_) {
+    close();
+    if (info.channelCount == 0 || info.blockSamples == 0)
+        throw std::invalid_argument("RecordingWriter: empty block geometry");
+    if (info.sampleFormat == SAMPLE_FORMAT_DELTA_RICE && info.channelCount != 1)
+        throw std::invalid_argument("RecordingWriter: delta format is single-channel");
+
+    output.open(path_, writerOptions);
+    path = path_;
+    headerMoved = false;
+    lossless = lossless_;
+
+    header = RecordingHeader{};
+    std::memcpy(header.magic, RECORDING_MAGIC, sizeof(header.magic));
+    header.version      = RECORDING_VERSION;
+    header.headerBytes  = sizeof(RecordingHeader);
+    header.channelCount = info.channelCount;
+    header.blockSamples = info.blockSamples;
+    header.sampleFormat = info.sampleFormat;
+    header.sensorId     = info.sensorId;
+    header.sampleRate   = info.sampleRate;
+    header.scaleFactor  = info.scaleFactor;
+    header.startUnixNs  = wallNowNs();
+    header.startHostNs  = hostNowNs();
+    std::strncpy(header.device, info.device.c_str(), sizeof(header.device) - 1);
+
+    size_t payloadBytes = (size_t)info.channelCount * info.blockSamples * sizeof(float);
+    block.assign(sizeof(RecordingBlockHeader) + payloadBytes, 0);
+    pending.clear();
+    index.clear();
+    blockSequence = 0;
+    droppedBlocks = 0;
+    totalSamples = 0;
+    fill = 0;
+    lastHostNs = header.startHostNs;
+
+    output.writeBlocking(&header, sizeof(header));
+    fileOffset = sizeof(header);
+}
+
+void RecordingWriter::append(const float* samples, size_t count, int64_t hostTimeNs) {
+    if (!output.isOpen() || header.sampleFormat != SAMPLE_FORMAT_F32) return;
+    const uint32_t channels = header.channelCount;
+    const uint32_t capacity = header.blockSamples;
+
+    while (count > 0) {
+        if (fill == 0) {
+            RecordingBlockHeader* bh = blockHeader();
+            bh->magic = RECORDING_BLOCK_MAGIC;
+            bh->payloadBytes = (uint32_t)(block.size() - sizeof(RecordingBlockHeader));
+            bh->sequence = blockSequence;
+            bh->firstSample = totalSamples;
+            bh->hostTimeFirstNs = hostTimeNs;
+        }
+
+        size_t take = std::min<size_t>(count, capacity - fill);
+        float* dst = payload();
+        if (channels == 1) {
+            std::memcpy(dst + fill, samples, take * sizeof(float));
+        } else {
+            // Чередующиеся кадры -> channel-major
+            for (size_t i = 0; i < take; ++i)
+                for (uint32_t c = 0; c < channels; ++c)
+                    dst[(size_t)c * capacity + fill + i] = samples[i * channels + c];
+        }
+
+        fill += (uint32_t)take;
+        totalSamples += take;
+        samples += take * channels;
+        count -= take;
+        lastHostNs = hostTimeNs;
+
+        if (fill == capacity) flushBlock();
+    }
+}
+
+void RecordingWriter::appendFrames(const NativeFrames& frames, int64_t hostTimeNs) {
+    if (!output.isOpen() || header.sampleFormat != SAMPLE_FORMAT_DELTA_RICE || frames.frameCount() == 0) return;
+    if (fill == 0) {
+        RecordingBlockHeader* bh = blockHeader();
+        bh->magic = RECORDING_BLOCK_MAGIC;
+        bh->sequence = blockSequence;
+        bh->firstSample = totalSamples;
+        bh->hostTimeFirstNs = hostTimeNs;
+    }
+    // Кадры не делятся между блоками: блок закрывается, когда набрано blockSamples
+    pending.append(frames);
+    fill += (uint32_t)frames.sampleCount();
+    totalSamples += frames.sampleCount();
+    lastHostNs = hostTimeNs;
+    if (fill >= header.blockSamples) flushBlock();
+}
+
+void RecordingWriter::flushBlock() {
+    if (fill == 0) return;
+    RecordingBlockHeader* bh = blockHeader();
+    bh->sampleCount = fill;
+    bh->hostTimeLastNs = lastHostNs;
+
+    if (header.sampleFormat == SAMPLE_FORMAT_DELTA_RICE) {
+        block.resize(sizeof(RecordingBlockHeader));
+        encodeDeltaBlock(pending, block);
+        block.resize((block.size() + 7) & ~(size_t)7, 0);    // Заголовки блоков и индекс остаются выровненными
+        pending.clear();
+        bh = blockHeader();
+        bh->payloadBytes = (uint32_t)(block.size() - sizeof(RecordingBlockHeader));
+    }
+
+    if (header.sampleFormat == SAMPLE_FORMAT_F32 && fill < header.blockSamples) {
+        // Хвост неполного блока обнуляется, чтобы в файл не попал мусор прошлого блока
+        float* dst = payload();
+        for (uint32_t c = 0; c < header.channelCount; ++c)
+            std::fill(dst + (size_t)c * header.blockSamples + fill,
+                      dst + (size_t)(c + 1) * header.blockSamples, 0.0f);
+    }
+
+    if (lossless) output.writeBlocking(block.data(), block.size());
+    if (lossless || output.write(block.data(), block.size())) {
+        index.push_back({fileOffset, bh->firstSample, bh->hostTimeFirstNs});
+        fileOffset += block.size();
+    } else {
+        droppedBlocks++;
+    }
+    blockSequence++;
+    fill = 0;
+}
+
+void RecordingWriter::markStart() {
+    header.startUnixNs = wallNowNs();
+    header.startHostNs = hostNowNs();
+    lastHostNs = header.startHostNs;
+    headerMoved = true;
+}
+
+void RecordingWriter::close() {
+    if (!output.isOpen()) return;
+    flushBlock();
+
+    RecordingFooter footer{};
+    footer.indexOffset  = fileOffset;
+    footer.blockCount   = index.size();
+    footer.totalSamples = totalSamples;
+    footer.endHostNs    = lastHostNs;
+    footer.magic        = RECORDING_INDEX_MAGIC;
+    footer.version      = RECORDING_VERSION;
+
+    if (!index.empty()) output.writeBlocking(index.data(), index.size() * sizeof(RecordingIndexEntry));
+    output.writeBlocking(&footer, sizeof(footer));
+    output.close();
+
+    if (headerMoved) {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        if (file) file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        headerMoved = false;
+    }
+}
+
+// ==== RecordingReader ====
+
+RecordingReader::RecordingReader()
+    : header(nullptr),
+      totalSamples(0),
+      complete(false) {}
+
+RecordingReader::RecordingReader(const std::string& path) : RecordingReader() {
+    open(path);
+}
+
+void RecordingReader::open(const std::string& path) {
+    mapped.open(path);
+    index.clear();
+    totalSamples = 0;
+    complete = false;
+
+    if (mapped.size() < sizeof(RecordingHeader))
+        throw std::runtime_error("Not a recording: " + path);
+    header = reinterpret_cast<const RecordingHeader*>(mapped.data());
+    if (std::memcmp(header->magic, RECORDING_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != RECORDING_VERSION || header->headerBytes < sizeof(RecordingHeader) ||
+        (header->sampleFormat != SAMPLE_FORMAT_F32 && header->sampleFormat != SAMPLE_FORMAT_DELTA_RICE))
+        throw std::runtime_error("Unsupported recording format: " + path);
+
+    // Футер с индексом есть только у корректно закрытой записи; не сошёлся — блоки ищутся сканированием
+    if (readIndex()) {
+        complete = true;
+        return;
+    }
+    index.clear();
+    totalSamples = 0;
+    scanBlocks();
+}
+
+// Проверенный блок: заголовок с магией и полезная нагрузка целиком в [headerBytes, end)
+bool RecordingReader::validBlock(uint64_t offset, uint64_t end) const {
+    if (offset < header->headerBytes || offset > end || end - offset < sizeof(RecordingBlockHeader)) return false;
+    const RecordingBlockHeader* bh = reinterpret_cast<const RecordingBlockHeader*>(mapped.data() + offset);
+    if (bh->magic != RECORDING_BLOCK_MAGIC || bh->payloadBytes > end - offset - sizeof(RecordingBlockHeader))
+        return false;
+    if (header->sampleFormat == SAMPLE_FORMAT_F32)
+        return bh->payloadBytes == (uint64_t)header->channelCount * header->blockSamples * sizeof(float) &&
+               bh->sampleCount <= header->blockSamples;
+    // Кадры сжатого блока не делятся, blockSamples он может превысить; но сэмпл — хотя бы бит потока
+    return bh->sampleCount > 0 && bh->sampleCount <= (uint64_t)bh->payloadBytes * 8;
+}
+
+bool RecordingReader::readIndex() {
+    const uint64_t size = mapped.size();
+    if (size < (uint64_t)header->headerBytes + sizeof(RecordingFooter)) return false;
+    const RecordingFooter* footer = reinterpret_cast<const RecordingFooter*>(mapped.data() + size - sizeof(RecordingFooter));
+    if (footer->magic != RECORDING_INDEX_MAGIC || footer->indexOffset < header->headerBytes) return false;
+    // Без переполнений: индекс ровно заполняет место между indexOffset и футером
+    const uint64_t indexEnd = size - sizeof(RecordingFooter);
+    if (footer->indexOffset > indexEnd || (indexEnd - footer->indexOffset) % sizeof(RecordingIndexEntry) != 0 ||
+        footer->blockCount != (indexEnd - footer->indexOffset) / sizeof(RecordingIndexEntry))
+        return false;
+
+    const RecordingIndexEntry* entries = reinterpret_cast<const RecordingIndexEntry*>(mapped.data() + footer->indexOffset);
+    for (uint64_t i = 0; i < footer->blockCount; ++i)
+        if (!validBlock(entries[i].offset, footer->indexOffset)) return false;
+    index.assign(entries, entries + footer->blockCount);
+    totalSamples = footer->totalSamples;
+    return true;
+}
+
+void RecordingReader::scanBlocks() {
+    uint64_t offset = header->headerBytes;
+    while (validBlock(offset, mapped.size())) {    // Недописанный блок не проходит проверку
+        const RecordingBlockHeader* bh = reinterpret_cast<const RecordingBlockHeader*>(mapped.data() + offset);
+        uint64_t blockBytes = sizeof(RecordingBlockHeader) + bh->payloadBytes;
+        index.push_back({offset, bh->firstSample, bh->hostTimeFirstNs});
+        totalSamples = bh->firstSample + bh->sampleCount;
+        offset += blockBytes;
+    }
+}
+
+const RecordingBlockHeader& RecordingReader::blockHeader(size_t i) const {
+    return *reinterpret_cast<const RecordingBlockHeader*>(mapped.data() + index[i].offset);
+}
+
+const float* RecordingReader::blockChannel(size_t i, uint32_t channel) const {
+    if (header->sampleFormat != SAMPLE_FORMAT_F32) return nullptr;
+    const uint8_t* payload = mapped.data() + index[i].offset + sizeof(RecordingBlockHeader);
+    return reinterpret_cast<const float*>(payload) + (size_t)channel * header->blockSamples;
+}
+
+size_t RecordingReader::decodeBlock(size_t i, uint32_t channel, float* out) const {
+    const RecordingBlockHeader& bh = blockHeader(i);
+    if (header->sampleFormat == SAMPLE_FORMAT_F32) {
+        std::memcpy(out, blockChannel(i, channel), bh.sampleCount * sizeof(float));
+        return bh.sampleCount;
+    }
+    const uint8_t* payload = mapped.data() + index[i].offset + sizeof(RecordingBlockHeader);
+    if (deltaBlockSampleCount(payload, bh.payloadBytes) != bh.sampleCount)
+        throw std::runtime_error("Recording block is corrupted");
+    return decodeDeltaBlockSamples(payload, bh.payloadBytes, out, bh.sampleCount);
+}
+
+void RecordingReader::decodeBlockFrames(size_t i, NativeFrames& frames) const {
+    if (header->sampleFormat != SAMPLE_FORMAT_DELTA_RICE) return;
+    const RecordingBlockHeader& bh = blockHeader(i);
+    const uint8_t* payload = mapped.data() + index[i].offset + sizeof(RecordingBlockHeader);
+    decodeDeltaBlock(payload, bh.payloadBytes, frames);
+}
+
+size_t RecordingReader::findBlock(uint64_t sample) const {
+    auto it = std::upper_bound(index.begin(), index.end(), sample,
+        [](uint64_t s, const RecordingIndexEntry& e) { return s < e.firstSample; });
+    return it == index.begin() ? 0 : (size_t)(it - index.begin()) - 1;
+}
+
+size_t RecordingReader::readSamples(uint32_t channel, uint64_t first, size_t count, float* out) const {
+    if (index.empty() || channel >= header->channelCount || first >= totalSamples) return 0;
+    count = (size_t)std::min<uint64_t>(count, totalSamples - first);
+
+    size_t copied = 0;
+    for (size_t b = findBlock(first); b < index.size() && copied < count; ++b) {
+        const RecordingBlockHeader& bh = blockHeader(b);
+        if (bh.firstSample > first + copied) {
+            // Отброшенные при записи блоки: пропуск заполняется нулями
+            size_t gap = (size_t)std::min<uint64_t>(count - copied, bh.firstSample - (first + copied));
+            std::fill(out + copied, out + copied + gap, 0.0f);
+            copied += gap;
+            if (copied == count) break;
+        }
+        uint64_t offsetInBlock = first + copied - bh.firstSample;
+        if (offsetInBlock >= bh.sampleCount) continue;
+        size_t take = std::min<size_t>(count - copied, bh.sampleCount - (size_t)offsetInBlock);
+        const float* src = blockChannel(b, channel);
+        if (!src) {
+            scratch.resize(bh.sampleCount);
+            decodeBlock(b, channel, scratch.data());
+            src = scratch.data();
+        }
+        std::memcpy(out + copied, src + offsetInBlock, take * sizeof(float));
+        copied += take;
+    }
+    return copied;
+}
+
+uint64_t repairRecording(const std::string& path) {
+    std::vector<RecordingIndexEntry> index;
+    RecordingFooter footer{};
+    {
+        RecordingReader reader(path);
+        if (reader.isComplete()) return reader.getTotalSamples();
+        footer.indexOffset = reader.info().headerBytes;
+        footer.endHostNs = reader.info().startHostNs;
+        for (size_t i = 0; i < reader.blockCount(); ++i) {
+            const RecordingBlockHeader& bh = reader.blockHeader(i);
+            index.push_back(reader.indexEntry(i));
+            footer.indexOffset = reader.indexEntry(i).offset + sizeof(RecordingBlockHeader) + bh.payloadBytes;
+            footer.endHostNs = bh.hostTimeLastNs;
+        }
+        footer.totalSamples = reader.getTotalSamples();
+    }    // Отображение снято до изменения файла
+
+    footer.blockCount = index.size();
+    footer.magic = RECORDING_INDEX_MAGIC;
+    footer.version = RECORDING_VERSION;
+    std::filesystem::resize_file(path, footer.indexOffset);
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file) throw std::runtime_error("Cannot repair " + path);
+    file.seekp((std::streamoff)footer.indexOffset);
+    if (!index.empty()) file.write(reinterpret_cast<const char*>(index.data()), (std::streamsize)(index.size() * sizeof(RecordingIndexEntry)));
+    file.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+    if (!file) throw std::runtime_error("Cannot repair " + path);
+    return footer.totalSamples;
+}
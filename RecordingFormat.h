@@ -0,0 +1,237 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "AsyncFileWriter.h"
+#include "FrameDecoder.h"
+#include "MappedFile.h"
+
+// ==== Бинарный формат записи .emgr (little-endian) ====
+//
+//   [RecordingHeader]                                   — метаданные устройства и частоты
+//   [RecordingBlockHeader][payload] x blockCount        — блоки сэмплов
+//   [RecordingIndexEntry] x blockCount                  — индекс блоков
+//   [RecordingFooter]                                   — смещение индекса и итоги
+//
+// SAMPLE_FORMAT_F32: payload — float32, channel-major (SoA), channelCount * blockSamples значений.
+// Неполный последний блок дополняется нулями, валидное число сэмплов — в sampleCount.
+// SAMPLE_FORMAT_DELTA_RICE: payload — целые кадры датчика, сжатые DeltaCodec (один канал);
+// размер блока переменный (payloadBytes, кратен 8), в блоке не меньше blockSamples сэмплов, кроме последнего.
+// Если футера нет (запись прервана), блоки находятся последовательным сканированием.
+
+const char     RECORDING_MAGIC[8]    = {'E', 'M', 'G', 'R', 'E', 'C', '0', '1'};
+const uint32_t RECORDING_VERSION     = 1;
+const uint32_t RECORDING_BLOCK_MAGIC = 0x42474D45;    // "EMGB"
+const uint32_t RECORDING_INDEX_MAGIC = 0x49474D45;    // "EMGI"
+const uint32_t RECORDING_DEFAULT_BLOCK_SAMPLES = 1024;
+
+enum RecordingSampleFormat : uint32_t {
+    SAMPLE_FORMAT_F32 = 0,           // float32 на сэмпл
+    SAMPLE_FORMAT_DELTA_RICE = 1,    // Исходные кадры датчика, сжатые без потерь (DeltaCodec.h)
+};
+
+struct RecordingHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t headerBytes;
+    uint32_t channelCount;
+    uint32_t blockSamples;      // Сэмплов на канал в одном блоке
+    uint32_t sampleFormat;      // RecordingSampleFormat
+    uint32_t sensorId;
+    double   sampleRate;        // Номинальная частота дискретизации, Гц
+    float    scaleFactor;       // Фактор разниц устройства (3.1457)
+    uint32_t reserved0;
+    int64_t  startUnixNs;       // Календарное время старта
+    int64_t  startHostNs;       // Монотонное время хоста при старте
+    char     device[64];        // Имя порта / устройства
+};
+
+struct RecordingBlockHeader {
+    uint32_t magic;
+    uint32_t payloadBytes;
+    uint64_t sequence;          // Номер блока
+    uint64_t firstSample;       // Индекс первого сэмпла блока в записи
+    uint32_t sampleCount;       // Валидных сэмплов на канал
+    uint32_t reserved0;
+    int64_t  hostTimeFirstNs;   // Время прихода первого сэмпла (steady, нс)
+    int64_t  hostTimeLastNs;    // Время прихода последнего сэмпла
+};
+
+struct RecordingIndexEntry {
+    uint64_t offset;            // Смещение RecordingBlockHeader от начала файла
+    uint64_t firstSample;
+    int64_t  hostTimeFirstNs;
+};
+
+struct RecordingFooter {
+    uint64_t indexOffset;
+    uint64_t blockCount;
+    uint64_t totalSamples;
+    int64_t  endHostNs;
+    uint32_t magic;
+    uint32_t version;
+};
+
+static_assert(sizeof(RecordingHeader) == 128, "RecordingHeader layout");
+static_assert(sizeof(RecordingBlockHeader) == 48, "RecordingBlockHeader layout");
+static_assert(sizeof(RecordingIndexEntry) == 24, "RecordingIndexEntry layout");
+static_assert(sizeof(RecordingFooter) == 40, "RecordingFooter layout");
+
+/**
+ * @brief Параметры записи, попадающие в заголовок файла
+ */
+struct RecordingInfo {
+    std::string device;
+    uint32_t sensorId = 0;
+    uint32_t channelCount = 1;
+    uint32_t blockSamples = RECORDING_DEFAULT_BLOCK_SAMPLES;
+    double sampleRate = 500.0;
+    float scaleFactor = 3.1457f;
+    uint32_t sampleFormat = SAMPLE_FORMAT_F32;
+};
+
+/**
+ * @brief Имя файла записи с датой и временем старта: prefix_YYYYMMDD_HHMMSS.emgr
+ */
+std::string makeRecordingFileName(const std::string& prefix = "emg");
+
+/**
+ * @brief Потоковая запись .emgr. Сэмплы копируются в текущий блок, целые блоки
+ *        передаются AsyncFileWriter, поэтому вызывающий поток не ждёт диск.
+ *        Блок, не поместившийся в буферы писателя, отбрасывается целиком:
+ *        в индекс он не попадает, а пропуск виден по номерам sequence.
+ */
+class RecordingWriter {
+private:
+    AsyncFileWriter output;
+    std::string path;
+    RecordingHeader header;
+    bool headerMoved;                           // Время старта изменено после open(): правится в close()
+    bool lossless;                              // Блоки пишутся writeBlocking()
+    std::vector<uint8_t> block;                 // RecordingBlockHeader + payload
+    std::vector<RecordingIndexEntry> index;
+    NativeFrames pending;                       // Кадры текущего блока (SAMPLE_FORMAT_DELTA_RICE)
+    uint64_t fileOffset;
+    uint64_t blockSequence;
+    uint64_t droppedBlocks;
+    uint64_t totalSamples;
+    uint32_t fill;                              // Заполнено сэмплов на канал в текущем блоке
+    int64_t lastHostNs;
+
+    RecordingBlockHeader* blockHeader() { return reinterpret_cast<RecordingBlockHeader*>(block.data()); }
+    float* payload() { return reinterpret_cast<float*>(block.data() + sizeof(RecordingBlockHeader)); }
+    void flushBlock();
+
+public:
+    RecordingWriter();
+    ~RecordingWriter();
+
+    RecordingWriter(const RecordingWriter&) = delete;
+    RecordingWriter& operator=(const RecordingWriter&) = delete;
+
+    /**
+     * @param lossless Ждать свободный буфер писателя вместо отбрасывания блока (конвертация файлов)
+     */
+    void open(const std::string& path, const RecordingInfo& info,
+              const AsyncWriterOptions& writerOptions = AsyncWriterOptions(), bool lossless = false);
+
+    /**
+     * @brief Добавляет сэмплы
+     * @param samples Кадры, чередующиеся по каналам: count * channelCount значений
+     * @param count Количество кадров (сэмплов на канал)
+     * @param hostTimeNs Время прихода данных (hostNowNs())
+     */
+    void append(const float* samples, size_t count, int64_t hostTimeNs);
+
+    /**
+     * @brief Добавляет кадры в исходном виде (только SAMPLE_FORMAT_DELTA_RICE)
+     */
+    void appendFrames(const NativeFrames& frames, int64_t hostTimeNs);
+
+    /**
+     * @brief Переносит время старта в заголовке на текущий момент — для файла, открытого заранее
+     *        (SegmentedRecorder). До close() на диске остаётся время open().
+     */
+    void markStart();
+
+    /**
+     * @brief Дописывает неполный блок, индекс и футер
+     */
+    void close();
+
+    bool isOpen() const { return output.isOpen(); }
+    uint64_t getTotalSamples() const { return totalSamples; }
+    uint64_t getBlockCount() const { return index.size(); }
+    uint64_t getDroppedBlocks() const { return droppedBlocks; }
+    uint64_t getFileBytes() const { return fileOffset; }    // Заголовок и принятые писателем блоки
+    const std::string& getPath() const { return path; }
+    AsyncWriterStats getWriterStats() { return output.getStats(); }
+};
+
+/**
+ * @brief Чтение .emgr через отображение файла в память, без копирования блоков
+ */
+class RecordingReader {
+private:
+    MappedFile mapped;
+    const RecordingHeader* header;
+    std::vector<RecordingIndexEntry> index;
+    uint64_t totalSamples;
+    bool complete;                              // Найден валидный футер
+    mutable std::vector<float> scratch;         // Распакованный блок для readSamples()
+
+    bool validBlock(uint64_t offset, uint64_t end) const;
+    bool readIndex();
+    void scanBlocks();
+
+public:
+    RecordingReader();
+    explicit RecordingReader(const std::string& path);
+
+    void open(const std::string& path);
+
+    const RecordingHeader& info() const { return *header; }
+    size_t blockCount() const { return index.size(); }
+    uint64_t getTotalSamples() const { return totalSamples; }
+    bool isComplete() const { return complete; }
+    bool isCompressed() const { return header->sampleFormat == SAMPLE_FORMAT_DELTA_RICE; }
+    size_t fileBytes() const { return mapped.size(); }
+
+    const RecordingBlockHeader& blockHeader(size_t i) const;
+    const RecordingIndexEntry& indexEntry(size_t i) const { return index[i]; }
+
+    /**
+     * @brief Указатель на данные канала в блоке (blockSamples значений, валидны sampleCount).
+     *        Для сжатых записей — nullptr, нужен decodeBlock().
+     */
+    const float* blockChannel(size_t i, uint32_t channel) const;
+
+    /**
+     * @brief Сэмплы канала блока в out (не меньше sampleCount значений)
+     * @return sampleCount блока
+     */
+    size_t decodeBlock(size_t i, uint32_t channel, float* out) const;
+
+    /**
+     * @brief Кадры блока в исходном виде (только сжатые записи)
+     */
+    void decodeBlockFrames(size_t i, NativeFrames& frames) const;
+
+    /**
+     * @brief Номер блока, содержащего сэмпл с индексом sample
+     */
+    size_t findBlock(uint64_t sample) const;
+
+    /**
+     * @brief Копирует count сэмплов канала начиная с first; возвращает число скопированных
+     */
+    size_t readSamples(uint32_t channel, uint64_t first, size_t count, float* out) const;
+};
+
+/**
+ * @brief Завершает прерванную запись (нет футера): хвост после последнего целого блока
+ *        отрезается, дописываются индекс и футер. Корректная запись не меняется.
+ * @return Сэмплов в записи
+ */
+uint64_t repairRecording(const std::string& path);
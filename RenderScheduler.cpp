@@ -0,0 +1,63 @@
+#include "RenderScheduler.h"
+
+#include <algorithm>
+
+RenderScheduler::RenderScheduler(double maxFps, double idleSeconds)
+    : dataPending(false),
+      inputFrames(RENDER_INPUT_FRAMES),    // Первый кадр рисуется сразу
+      minFrameNs(0),
+      idleNs((int64_t)(idleSeconds * 1e9)),
+      lastFrameNs(0),
+      frames(0) {
+    setMaxFps(maxFps);
+}
+
+void RenderScheduler::setMaxFps(double maxFps) {
+    minFrameNs = maxFps > 0.0 ? (int64_t)(1e9 / maxFps) : 0;
+}
+
+bool RenderScheduler::notifyData() {
+    return !dataPending.exchange(true, std::memory_order_relaxed);
+}
+
+void RenderScheduler::notifyInput() {
+    inputFrames = RENDER_INPUT_FRAMES;
+}
+
+double RenderScheduler::waitSeconds(int64_t nowNs) const {
+    int64_t due = lastFrameNs + (isDirty() ? minFrameNs : idleNs);
+    return due > nowNs ? (double)(due - nowNs) * 1e-9 : 0.0;
+}
+
+bool RenderScheduler::beginFrame(int64_t nowNs) {
+    bool due = isDirty() ? nowNs - lastFrameNs >= minFrameNs : nowNs - lastFrameNs >= idleNs;
+    if (!due) return false;
+    lastFrameNs = nowNs;
+    dataPending.store(false, std::memory_order_relaxed);
+    if (inputFrames > 0) inputFrames--;
+    frames++;
+    return true;
+}
+
+// ==== LatencyWindow ====
+
+LatencyWindow::LatencyWindow(size_t capacity) : values(std::max<size_t>(1, capacity)), next(0), count(0) {}
+
+void LatencyWindow::add(int64_t latencyNs) {
+    values[next] = latencyNs;
+    next = (next + 1) % values.size();
+    count = std::min(count + 1, values.size());
+}
+
+void LatencyWindow::clear() {
+    next = 0;
+    count = 0;
+}
+
+int64_t LatencyWindow::percentile(double q) const {
+    if (count == 0) return 0;
+    scratch.assign(values.begin(), values.begin() + count);
+    size_t k = (size_t)(std::min(1.0, std::max(0.0, q)) * (double)(count - 1));
+    std::nth_element(scratch.begin(), scratch.begin() + k, scratch.end());
+    return scratch[k];
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ==== Перерисовка по требованию ====
+//
+// Кадр рисуется, только когда есть причина: пришли сэмплы (notifyData() из потока чтения),
+// было событие ввода (notifyInput() из колбэков окна) или прошла секунда простоя (обновить
+// текст статистики). Частота кадров ограничена сверху maxFps. Цикл окна спит в
+// glfwWaitEventsTimeout(waitSeconds()); поток чтения будит его glfwPostEmptyEvent(),
+// когда notifyData() вернул true — не чаще одного раза на кадр.
+
+const int RENDER_INPUT_FRAMES = 3;    // Кадров после ввода: ImGui догоняет наведение и анимации
+
+class RenderScheduler {
+private:
+    std::atomic<bool> dataPending;
+    int inputFrames;
+    int64_t minFrameNs;          // 0 — без ограничения (упор в vsync)
+    int64_t idleNs;
+    int64_t lastFrameNs;
+    uint64_t frames;
+
+    bool isDirty() const { return dataPending.load(std::memory_order_relaxed) || inputFrames > 0; }
+
+public:
+    /**
+     * @param maxFps Предел частоты кадров (0 — без предела)
+     * @param idleSeconds Кадр без событий не реже, чем раз в столько секунд
+     */
+    explicit RenderScheduler(double maxFps = 60.0, double idleSeconds = 1.0);
+
+    void setMaxFps(double maxFps);
+
+    // Из потока чтения. true — цикл окна, возможно, спит и его надо разбудить
+    bool notifyData();
+
+    // Из колбэков ввода (поток окна)
+    void notifyInput();
+
+    // Сколько спать в ожидании событий до следующего возможного кадра, секунды
+    double waitSeconds(int64_t nowNs) const;
+
+    /**
+     * @brief Пора ли рисовать кадр; если да — причины сбрасываются
+     */
+    bool beginFrame(int64_t nowNs);
+
+    uint64_t getFrameCount() const { return frames; }
+};
+
+/**
+ * @brief Задержки последних измерений для p50/p99 (кольцо фиксированного размера)
+ */
+class LatencyWindow {
+private:
+    std::vector<int64_t> values;
+    size_t next;
+    size_t count;
+    mutable std::vector<int64_t> scratch;
+
+public:
+    explicit LatencyWindow(size_t capacity = 1024);
+
+    void add(int64_t latencyNs);
+    void clear();
+
+    // q в [0, 1]; 0, если измерений нет
+    int64_t percentile(double q) const;
+    size_t size() const { return count; }
+};
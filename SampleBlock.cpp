@@ -0,0 +1,100 @@
+#include "SampleBlock.h"
+
+#include <new>
+#include <stdexcept>
+
+// ==== SampleBlock ====
+
+SampleBlock::SampleBlock(SampleBlockPool* pool_, uint32_t channelCount_, uint32_t capacity_)
+    : pool(pool_),
+      data(nullptr),
+      stride((capacity_ * sizeof(float) + SAMPLE_BLOCK_ALIGN - 1) / SAMPLE_BLOCK_ALIGN * SAMPLE_BLOCK_ALIGN / sizeof(float)),
+      refs(0),
+      channelCount(channelCount_),
+      capacity(capacity_),
+      sampleCount(0),
+      sensorId(0),
+      firstSample(0) {
+    // Память затрагивается сразу: первый доступ из потока чтения не вызывает page fault
+    data = static_cast<float*>(::operator new(stride * channelCount * sizeof(float), std::align_val_t(SAMPLE_BLOCK_ALIGN)));
+    for (size_t i = 0; i < stride * channelCount; ++i) data[i] = 0.0f;
+}
+
+SampleBlock::~SampleBlock() {
+    ::operator delete(data, std::align_val_t(SAMPLE_BLOCK_ALIGN));
+}
+
+float* SampleBlock::extend(uint32_t n) {
+    if (n > capacity - sampleCount) return nullptr;
+    float* out = data + sampleCount;
+    sampleCount += n;
+    return out;
+}
+
+// ==== SampleBlockRef ====
+
+SampleBlockRef::SampleBlockRef(SampleBlock* block_) : block(block_) {
+    if (block) block->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+SampleBlockRef::SampleBlockRef(const SampleBlockRef& other) : block(other.block) {
+    if (block) block->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SampleBlockRef::reset() {
+    // acq_rel: записи других владельцев видны тому, кто вернёт порцию в пул
+    if (block && block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) block->pool->release(block);
+    block = nullptr;
+}
+
+// ==== SampleBlockPool ====
+
+SampleBlockPool::SampleBlockPool(uint32_t channelCount_, uint32_t capacity_, size_t preallocate)
+    : channelCount(channelCount_), capacity(capacity_), grown(0) {
+    if (channelCount == 0 || capacity == 0) throw std::invalid_argument("SampleBlockPool: empty block shape");
+    all.reserve(preallocate);
+    available.reserve(preallocate);
+    for (size_t i = 0; i < preallocate; ++i) {
+        all.push_back(new SampleBlock(this, channelCount, capacity));
+        available.push_back(all.back());
+    }
+}
+
+SampleBlockPool::~SampleBlockPool() {
+    for (SampleBlock* block : all) delete block;
+}
+
+SampleBlockRef SampleBlockPool::acquire() {
+    SampleBlock* block = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!available.empty()) {
+            block = available.back();
+            available.pop_back();
+        } else {
+            block = new SampleBlock(this, channelCount, capacity);
+            all.push_back(block);
+            available.reserve(all.size());    // Возврат в пул не выделяет память
+            grown++;
+        }
+    }
+    block->sampleCount = 0;
+    block->sensorId = 0;
+    block->firstSample = 0;
+    block->timing = SampleBlockTiming();
+    return SampleBlockRef(block);
+}
+
+void SampleBlockPool::release(SampleBlock* block) {
+    std::lock_guard<std::mutex> lock(mutex);
+    available.push_back(block);
+}
+
+SampleBlockPoolStats SampleBlockPool::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    SampleBlockPoolStats stats;
+    stats.blocks = all.size();
+    stats.available = available.size();
+    stats.grown = grown;
+    return stats;
+}
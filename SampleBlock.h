@@ -0,0 +1,144 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// ==== Порция сэмплов конвейера ====
+//
+// SampleBlock — сэмплы одного чтения датчика вместе с контекстом: датчик, номер первого сэмпла
+// в потоке, номер кадра, время. Данные channel-major (SoA): канал c — channel(c)[0 .. sampleCount),
+// каналы с шагом, кратным 64 байтам, начало каждого выровнено на 64 байта (строка кэша, AVX-512).
+//
+// Порции фиксированной ёмкости берутся из SampleBlockPool и возвращаются в него, когда отпущена
+// последняя ссылка SampleBlockRef (счётчик ссылок внутри порции, без отдельных выделений памяти).
+// Этапы конвейера передают SampleBlockRef копированием (несколько потребителей) или перемещением;
+// сэмплы не копируются. Пул должен жить дольше своих порций.
+
+/**
+ * @brief Порция сэмплов одного чтения в шкале устройства
+ */
+struct SampleBlockTiming {
+    uint64_t sequence = 0;        // Номер первого кадра по устройству
+    uint64_t deviceSample = 0;    // Индекс первого сэмпла с учётом потерь
+    int64_t  deviceTimeNs = 0;    // Время первого сэмпла по часам устройства
+    int64_t  hostTimeNs = 0;      // Время прихода байт на хосте
+    int64_t  sampleTimeNs = 0;    // Время первого сэмпла в шкале хоста по модели ClockSync
+    double   samplePeriodNs = 0;  // Период сэмпла в шкале хоста
+    uint32_t lostSamples = 0;     // Потеряно сэмплов внутри и перед порцией
+    uint32_t duplicateFrames = 0; // Выброшено повторённых кадров
+};
+
+const size_t   SAMPLE_BLOCK_ALIGN = 64;
+const uint32_t SAMPLE_BLOCK_DEFAULT_CAPACITY = 512;    // Больше, чем даёт одно чтение порта (512 байт)
+
+class SampleBlockPool;
+
+class SampleBlock {
+private:
+    friend class SampleBlockPool;
+    friend class SampleBlockRef;
+
+    SampleBlockPool* pool;
+    float* data;
+    size_t stride;                  // float между началами каналов
+    std::atomic<uint32_t> refs;
+
+    SampleBlock(SampleBlockPool* pool, uint32_t channelCount, uint32_t capacity);
+    ~SampleBlock();
+
+public:
+    const uint32_t channelCount;
+    const uint32_t capacity;        // Сэмплов на канал
+    uint32_t sampleCount;
+    uint32_t sensorId;
+    uint64_t firstSample;           // Индекс первого сэмпла в потоке датчика (без учёта потерь)
+    SampleBlockTiming timing;
+
+    SampleBlock(const SampleBlock&) = delete;
+    SampleBlock& operator=(const SampleBlock&) = delete;
+
+    float* channel(uint32_t c) { return data + c * stride; }
+    const float* channel(uint32_t c) const { return data + c * stride; }
+
+    /**
+     * @brief Добавляет n сэмплов во все каналы
+     * @return Место для них в канале 0 (остальные — channel(c) + прежний sampleCount),
+     *         nullptr — не помещаются
+     */
+    float* extend(uint32_t n);
+
+    bool empty() const { return sampleCount == 0; }
+};
+
+/**
+ * @brief Ссылка на порцию; последняя отпущенная возвращает порцию в пул
+ */
+class SampleBlockRef {
+private:
+    SampleBlock* block;
+
+public:
+    SampleBlockRef() : block(nullptr) {}
+    explicit SampleBlockRef(SampleBlock* block);
+    SampleBlockRef(const SampleBlockRef& other);
+    SampleBlockRef(SampleBlockRef&& other) noexcept : block(other.block) { other.block = nullptr; }
+    SampleBlockRef& operator=(SampleBlockRef other) noexcept {
+        std::swap(block, other.block);
+        return *this;
+    }
+    ~SampleBlockRef() { reset(); }
+
+    void reset();
+
+    SampleBlock* get() const { return block; }
+    SampleBlock* operator->() const { return block; }
+    SampleBlock& operator*() const { return *block; }
+    explicit operator bool() const { return block != nullptr; }
+};
+
+struct SampleBlockPoolStats {
+    uint64_t blocks = 0;            // Создано порций
+    uint64_t available = 0;         // Сейчас в пуле
+    uint64_t grown = 0;             // Созданы сверх начального запаса: пул был пуст
+};
+
+/**
+ * @brief Пул порций одной формы (каналы x ёмкость). acquire() и возврат — из любых потоков.
+ */
+class SampleBlockPool {
+private:
+    friend class SampleBlockRef;
+
+    const uint32_t channelCount;
+    const uint32_t capacity;
+    std::mutex mutex;
+    std::vector<SampleBlock*> all;
+    std::vector<SampleBlock*> available;
+    uint64_t grown;
+
+    void release(SampleBlock* block);
+
+public:
+    /**
+     * @param preallocate Порций, создаваемых сразу: в потоке чтения не будет выделений памяти,
+     *        пока одновременно удерживается не больше стольких порций
+     */
+    explicit SampleBlockPool(uint32_t channelCount = 1, uint32_t capacity = SAMPLE_BLOCK_DEFAULT_CAPACITY,
+                             size_t preallocate = 64);
+    ~SampleBlockPool();
+
+    SampleBlockPool(const SampleBlockPool&) = delete;
+    SampleBlockPool& operator=(const SampleBlockPool&) = delete;
+
+    /**
+     * @brief Пустая порция (sampleCount = 0, контекст сброшен); пул пуст — создаётся новая
+     */
+    SampleBlockRef acquire();
+
+    uint32_t getChannelCount() const { return channelCount; }
+    uint32_t getCapacity() const { return capacity; }
+    SampleBlockPoolStats getStats();
+};
@@ -0,0 +1,399 @@
+#include "SegmentedRecording.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#include "HostClock.h"
+#include "Trace.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+static std::string journalPath(const std::string& directory, const std::string& prefix) {
+    return (fs::path(directory) / (prefix + ".journal")).string();
+}
+
+// Строка журнала доходит до диска раньше, чем journal считается записанным
+static void writeJournal(std::FILE* journal, const std::string& line) {
+    std::fputs(line.c_str(), journal);
+    std::fputc('\n', journal);
+    std::fflush(journal);
+#ifdef _WIN32
+    _commit(_fileno(journal));
+#else
+    fsync(fileno(journal));
+#endif
+}
+
+// ==== Восстановление ====
+
+SegmentRecovery recoverSegments(const std::string& directory, const std::string& prefix) {
+    struct State {
+        std::string file;
+        bool closed = false;
+        bool gone = false;
+        uint64_t samples = 0;
+        uint64_t bytes = 0;
+    };
+    std::map<uint64_t, State> segments;
+    SegmentRecovery result;
+
+    const std::string path = journalPath(directory, prefix);
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        // Строка, оборванная сбоем, не разбирается и пропускается
+        std::istringstream fields(line);
+        std::string command;
+        uint64_t sequence = 0;
+        if (!(fields >> command >> sequence) || command == "session") continue;
+        if (command == "prepare") {
+            std::string file;
+            if (fields >> file) segments[sequence].file = file;
+        } else if (command == "close") {
+            State& s = segments[sequence];
+            if (fields >> s.samples >> s.bytes) s.closed = true;
+        } else if (command == "discard" || command == "prune") {
+            segments[sequence].gone = true;
+        }
+        result.nextSequence = std::max(result.nextSequence, sequence + 1);
+    }
+    in.close();
+
+    std::FILE* journal = nullptr;
+    auto record = [&](const std::string& text) {
+        if (!journal) journal = std::fopen(path.c_str(), "a");
+        if (journal) writeJournal(journal, text);
+    };
+
+    for (auto& entry : segments) {
+        const uint64_t sequence = entry.first;
+        State& s = entry.second;
+        if (s.gone || s.file.empty()) continue;
+        const std::string file = (fs::path(directory) / s.file).string();
+        std::error_code ec;
+        if (!fs::exists(file, ec)) {
+            record("discard " + std::to_string(sequence));
+            continue;
+        }
+        if (s.closed) {
+            // Строка close могла дойти до диска раньше хвоста сегмента (сбой питания): футер проверяется
+            bool valid = false;
+            try {
+                valid = RecordingReader(file).isComplete();
+            } catch (const std::exception&) {
+            }
+            if (!valid) s.closed = false;
+        }
+        if (!s.closed) {
+            uint64_t samples = 0;
+            bool readable = true;
+            try {
+                samples = repairRecording(file);
+            } catch (const std::exception&) {
+                readable = false;    // Заголовок не дописан или испорчен
+            }
+            if (!readable || samples == 0) {
+                // Заготовка без данных удаляется; повреждённый файл остаётся на диске для разбора,
+                // но из сессии исключается
+                if (readable || fs::file_size(file, ec) < sizeof(RecordingHeader)) fs::remove(file, ec);
+                record("discard " + std::to_string(sequence));
+                result.discarded++;
+                continue;
+            }
+            s.samples = samples;
+            s.bytes = (uint64_t)fs::file_size(file, ec);
+            syncFileToDisk(file);
+            record("repair " + std::to_string(sequence) + " " + std::to_string(samples));
+            record("close " + std::to_string(sequence) + " " + std::to_string(samples) + " " +
+                   std::to_string(s.bytes) + " 0");
+            result.repaired++;
+            result.repairedSamples += samples;
+        }
+        SegmentInfo info;
+        info.sequence = sequence;
+        info.file = s.file;
+        info.samples = s.samples;
+        info.bytes = s.bytes;
+        result.segments.push_back(info);
+    }
+    if (journal) std::fclose(journal);
+    return result;
+}
+
+// ==== SegmentedRecorder ====
+
+SegmentedRecorder::SegmentedRecorder()
+    : segmentLimit(0),
+      currentSequence(0),
+      segmentSamples(0),
+      totalSamples(0),
+      rotationLate(false),
+      spareSequence(0),
+      stopping(false),
+      retryAtNs(0),
+      journal(nullptr),
+      nextSequence(1) {}
+
+SegmentedRecorder::~SegmentedRecorder() {
+    close();
+}
+
+std::string SegmentedRecorder::segmentFile(uint64_t sequence) const {
+    char number[32];
+    std::snprintf(number, sizeof(number), "_%06llu.emgr", (unsigned long long)sequence);
+    return options.prefix + number;
+}
+
+std::string SegmentedRecorder::segmentPath(uint64_t sequence) const {
+    return (fs::path(options.directory) / segmentFile(sequence)).string();
+}
+
+void SegmentedRecorder::journalLine(const std::string& line) {
+    if (journal) writeJournal(journal, line);
+}
+
+std::unique_ptr<RecordingWriter> SegmentedRecorder::prepareSegment(uint64_t sequence) {
+    std::unique_ptr<RecordingWriter> writer(new RecordingWriter());
+    writer->open(segmentPath(sequence), info, options.writer);
+    journalLine("prepare " + std::to_string(sequence) + " " + segmentFile(sequence));
+    return writer;
+}
+
+void SegmentedRecorder::open(const SegmentOptions& options_, const RecordingInfo& info_) {
+    close();
+    if (options_.prefix.empty() || options_.prefix.find_first_of(" /\\") != std::string::npos)
+        throw std::invalid_argument("SegmentedRecorder: prefix must be a plain name");
+    options = options_;
+    info = info_;
+    fs::create_directories(options.directory);
+
+    SegmentRecovery recovery = recoverSegments(options.directory, options.prefix);
+    const std::string path = journalPath(options.directory, options.prefix);
+    journal = std::fopen(path.c_str(), "a");
+    if (!journal) throw std::runtime_error("Cannot open journal " + path);
+    journalLine("session " + std::to_string(wallNowNs()));
+
+    closed.assign(recovery.segments.begin(), recovery.segments.end());
+    nextSequence = recovery.nextSequence;
+    segmentLimit = options.segmentSeconds > 0.0 ? (uint64_t)std::llround(options.segmentSeconds * info.sampleRate) : 0;
+
+    currentSequence = nextSequence++;
+    current = prepareSegment(currentSequence);
+    journalLine("open " + std::to_string(currentSequence) + " 0 " + std::to_string(wallNowNs()));
+    segmentSamples = 0;
+    totalSamples = 0;
+    rotationLate = false;
+
+    spare.reset();
+    rotations.clear();
+    stopping = false;
+    retryAtNs = 0;
+    stats = SegmentStats();
+    stats.sequence = currentSequence;
+    stats.repairedSegments = recovery.repaired;
+    housekeeper = std::thread(&SegmentedRecorder::housekeeperLoop, this);
+}
+
+void SegmentedRecorder::close() {
+    if (!current) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        rotations.push_back(Rotation{std::move(current), currentSequence, 0, totalSamples, 0});
+        stopping = true;
+    }
+    cv.notify_one();
+    housekeeper.join();
+
+    if (spare) {
+        const std::string path = spare->getPath();
+        spare->close();
+        std::error_code ec;
+        fs::remove(path, ec);
+        journalLine("discard " + std::to_string(spareSequence));
+        spare.reset();
+    }
+    std::fclose(journal);
+    journal = nullptr;
+}
+
+SegmentStats SegmentedRecorder::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+bool SegmentedRecorder::rotationDue() const {
+    return (segmentLimit > 0 && segmentSamples >= segmentLimit) ||
+           (options.segmentBytes > 0 && current->getFileBytes() >= options.segmentBytes);
+}
+
+void SegmentedRecorder::rotate() {
+    std::unique_ptr<RecordingWriter> next;
+    uint64_t sequence = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!spare) {
+            // Не ждём: пишем в текущий сегмент, пока служебный поток не подготовит следующий
+            if (!rotationLate) stats.lateRotations++;
+            rotationLate = true;
+            return;
+        }
+        next = std::move(spare);
+        sequence = spareSequence;
+    }
+    next->markStart();
+    Rotation rotation{std::move(current), currentSequence, sequence, totalSamples, wallNowNs()};
+    current = std::move(next);
+    currentSequence = sequence;
+    segmentSamples = 0;
+    rotationLate = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        rotations.push_back(std::move(rotation));
+        stats.rotations++;
+        stats.sequence = sequence;
+    }
+    cv.notify_one();
+}
+
+void SegmentedRecorder::append(const float* samples, size_t count, int64_t hostTimeNs) {
+    if (!current) return;
+    const size_t channels = info.channelCount;
+    while (count > 0) {
+        // Граница по длительности — точно по сэмплу
+        size_t take = count;
+        if (segmentLimit > 0 && segmentSamples < segmentLimit)
+            take = (size_t)std::min<uint64_t>(count, segmentLimit - segmentSamples);
+        current->append(samples, take, hostTimeNs);
+        segmentSamples += take;
+        totalSamples += take;
+        samples += take * channels;
+        count -= take;
+        if (rotationDue()) rotate();
+    }
+}
+
+void SegmentedRecorder::appendFrames(const NativeFrames& frames, int64_t hostTimeNs) {
+    if (!current) return;
+    // Кадры не делятся: сегмент меняется на границе порции
+    current->appendFrames(frames, hostTimeNs);
+    segmentSamples += frames.sampleCount();
+    totalSamples += frames.sampleCount();
+    if (rotationDue()) rotate();
+}
+
+void SegmentedRecorder::housekeeperLoop() {
+    traceSetThreadName("segments");
+    applyRetention();    // Сегменты прошлых сессий
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        cv.wait_for(lock, std::chrono::seconds(1), [this] {
+            return stopping || !rotations.empty() || (!spare && hostNowNs() >= retryAtNs);
+        });
+        if (!rotations.empty()) {
+            Rotation rotation = std::move(rotations.front());
+            rotations.pop_front();
+            lock.unlock();
+            finishRotation(rotation);
+            lock.lock();
+            continue;
+        }
+        if (stopping) break;
+        if (!spare && hostNowNs() >= retryAtNs) {
+            const uint64_t sequence = nextSequence++;
+            lock.unlock();
+            std::unique_ptr<RecordingWriter> writer;
+            try {
+                EMG_TRACE_SCOPE("segment prepare");
+                writer = prepareSegment(sequence);
+            } catch (const std::exception&) {
+                // Диск переполнен или каталог недоступен: текущий сегмент растёт дальше
+            }
+            lock.lock();
+            if (writer) {
+                spare = std::move(writer);
+                spareSequence = sequence;
+            } else {
+                stats.errors++;
+                retryAtNs = hostNowNs() + 1000000000LL;
+            }
+        }
+    }
+}
+
+void SegmentedRecorder::finishRotation(Rotation& rotation) {
+    EMG_TRACE_SCOPE("segment close");
+    if (rotation.nextSequence > 0) {
+        journalLine("open " + std::to_string(rotation.nextSequence) + " " + std::to_string(rotation.firstSample) + " " +
+                    std::to_string(rotation.startUnixNs));
+    }
+    RecordingWriter& writer = *rotation.retired;
+    writer.close();
+    std::error_code ec;
+    SegmentInfo segment;
+    segment.sequence = rotation.retiredSequence;
+    segment.file = segmentFile(rotation.retiredSequence);
+    segment.samples = writer.getTotalSamples();
+
+    // close в журнал — только после того, как сегмент вместе с правленым заголовком на диске.
+    // Сбой записи оставляет дыры: сегмент завершается по целым блокам, как при восстановлении
+    bool complete = writer.getWriterStats().writeErrors == 0 && syncFileToDisk(writer.getPath());
+    if (!complete) {
+        try {
+            segment.samples = repairRecording(writer.getPath());
+            complete = syncFileToDisk(writer.getPath());
+            if (complete) journalLine("repair " + std::to_string(segment.sequence) + " " + std::to_string(segment.samples));
+        } catch (const std::exception&) {
+        }
+    }
+    if (!complete) {
+        // Без close сегмент завершит recoverSegments() при следующем open()
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.errors++;
+        stats.droppedBlocks += writer.getDroppedBlocks();
+        return;
+    }
+    segment.bytes = (uint64_t)fs::file_size(writer.getPath(), ec);
+    journalLine("close " + std::to_string(segment.sequence) + " " + std::to_string(segment.samples) + " " +
+                std::to_string(segment.bytes) + " " + std::to_string(writer.getDroppedBlocks()));
+    closed.push_back(segment);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.closedSegments++;
+        stats.droppedBlocks += writer.getDroppedBlocks();
+    }
+    rotation.retired.reset();
+    applyRetention();
+}
+
+void SegmentedRecorder::applyRetention() {
+    uint64_t total = 0;
+    for (const SegmentInfo& s : closed) total += s.bytes;
+    uint64_t prunedSegments = 0, prunedBytes = 0;
+    while (!closed.empty() && ((options.retainBytes > 0 && total > options.retainBytes) ||
+                               (options.retainSegments > 0 && closed.size() > options.retainSegments))) {
+        const SegmentInfo& oldest = closed.front();
+        std::error_code ec;
+        fs::remove(fs::path(options.directory) / oldest.file, ec);
+        journalLine("prune " + std::to_string(oldest.sequence));
+        total -= oldest.bytes;
+        prunedSegments++;
+        prunedBytes += oldest.bytes;
+        closed.pop_front();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.retainedBytes = total;
+    stats.prunedSegments += prunedSegments;
+    stats.prunedBytes += prunedBytes;
+}
@@ -0,0 +1,151 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "RecordingFormat.h"
+
+// ==== Запись сессии сегментами .emgr с журналом ====
+//
+// Сессия — файлы dir/prefix_000001.emgr, prefix_000002.emgr ..., новый сегмент начинается по
+// длительности сигнала или размеру файла. Журнал dir/prefix.journal — текстовый, только
+// дописывается, каждая строка сбрасывается на диск (fsync):
+//
+//   session <unixNs>                                   — старт сессии
+//   prepare <seq> <file>                               — файл сегмента создан заранее
+//   open <seq> <firstSample> <unixNs>                  — в сегмент пошли сэмплы
+//   close <seq> <samples> <bytes> <droppedBlocks>      — сегмент закрыт с индексом и футером
+//   repair <seq> <samples>                             — прерванный сегмент восстановлен
+//   discard <seq>                                      — сегмент без данных удалён (повреждённый — исключён)
+//   prune <seq>                                        — сегмент удалён по бюджету хранения
+//
+// Строка close пишется только после fdatasync сегмента. Сегмент без close после сбоя — или с close,
+// но без валидного футера на диске — восстанавливается при следующем open(): хвост после последнего
+// целого блока отрезается, дописываются индекс и футер (repairRecording()) — без перечитывания
+// всей сессии. Поток чтения датчика не ждёт диск: следующий сегмент открывает заранее, а
+// закрывает, пишет журнал и удаляет старые сегменты отдельный служебный поток.
+
+struct SegmentOptions {
+    std::string directory = ".";
+    std::string prefix = "emg";
+    double segmentSeconds = 3600.0;     // Сигнала в сегменте (0 — без ограничения)
+    uint64_t segmentBytes = 0;          // Размер сегмента (0 — без ограничения)
+    uint64_t retainBytes = 0;           // Бюджет на закрытые сегменты, старые удаляются (0 — без ограничения)
+    uint32_t retainSegments = 0;        // Не больше стольких закрытых сегментов (0 — без ограничения)
+    AsyncWriterOptions writer;
+};
+
+/**
+ * @brief Сегмент по журналу
+ */
+struct SegmentInfo {
+    uint64_t sequence = 0;
+    std::string file;                   // Имя в каталоге сессии
+    uint64_t samples = 0;
+    uint64_t bytes = 0;
+};
+
+struct SegmentRecovery {
+    std::vector<SegmentInfo> segments;  // Закрытые сегменты, старые первыми
+    uint64_t repaired = 0;              // Прерванных сегментов, завершённых заново
+    uint64_t repairedSamples = 0;
+    uint64_t discarded = 0;             // Пустых или нечитаемых заготовок
+    uint64_t nextSequence = 1;
+};
+
+/**
+ * @brief Восстанавливает сессию по журналу: прерванные сегменты завершаются, пустые удаляются
+ */
+SegmentRecovery recoverSegments(const std::string& directory, const std::string& prefix);
+
+struct SegmentStats {
+    uint64_t sequence = 0;              // Текущий сегмент
+    uint64_t rotations = 0;
+    uint64_t lateRotations = 0;         // Смена отложена: следующий сегмент ещё не готов
+    uint64_t closedSegments = 0;
+    uint64_t retainedBytes = 0;         // Закрытые сегменты на диске
+    uint64_t prunedSegments = 0;
+    uint64_t prunedBytes = 0;
+    uint64_t droppedBlocks = 0;         // В закрытых сегментах
+    uint64_t errors = 0;                // Сбои создания, записи и сброса на диск сегментов и журнала
+    uint64_t repairedSegments = 0;      // При open()
+};
+
+/**
+ * @brief Сессия записи сегментами. append()/appendFrames()/close() — из одного потока.
+ */
+class SegmentedRecorder {
+private:
+    SegmentOptions options;
+    RecordingInfo info;
+    uint64_t segmentLimit;              // Сэмплов в сегменте, 0 — без ограничения
+
+    // Поток чтения
+    std::unique_ptr<RecordingWriter> current;
+    uint64_t currentSequence;
+    uint64_t segmentSamples;
+    uint64_t totalSamples;
+    bool rotationLate;                  // Сегмент переполнен, а следующий ещё не готов
+
+    struct Rotation {
+        std::unique_ptr<RecordingWriter> retired;
+        uint64_t retiredSequence;
+        uint64_t nextSequence;          // 0 — закрытие сессии
+        uint64_t firstSample;
+        int64_t startUnixNs;
+    };
+
+    // Под mutex
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::unique_ptr<RecordingWriter> spare;    // Следующий сегмент, открытый заранее
+    uint64_t spareSequence;
+    std::deque<Rotation> rotations;
+    bool stopping;
+    int64_t retryAtNs;                  // Когда снова пробовать создать сегмент после сбоя
+    SegmentStats stats;
+
+    // Служебный поток
+    std::thread housekeeper;
+    std::FILE* journal;
+    uint64_t nextSequence;
+    std::deque<SegmentInfo> closed;
+
+    std::string segmentPath(uint64_t sequence) const;
+    std::string segmentFile(uint64_t sequence) const;
+    std::unique_ptr<RecordingWriter> prepareSegment(uint64_t sequence);
+    void housekeeperLoop();
+    void finishRotation(Rotation& rotation);
+    void applyRetention();
+    void journalLine(const std::string& line);    // Строка журнала с fsync
+    bool rotationDue() const;
+    void rotate();
+
+public:
+    SegmentedRecorder();
+    ~SegmentedRecorder();
+
+    SegmentedRecorder(const SegmentedRecorder&) = delete;
+    SegmentedRecorder& operator=(const SegmentedRecorder&) = delete;
+
+    /**
+     * @brief Восстанавливает прерванную прошлую сессию и открывает первый сегмент
+     */
+    void open(const SegmentOptions& options, const RecordingInfo& info);
+    void close();
+
+    // Как RecordingWriter::append() / appendFrames()
+    void append(const float* samples, size_t count, int64_t hostTimeNs);
+    void appendFrames(const NativeFrames& frames, int64_t hostTimeNs);
+
+    bool isOpen() const { return current != nullptr; }
+    uint64_t getTotalSamples() const { return totalSamples; }
+    SegmentStats getStats();
+};
@@ -1,92 +1,206 @@
 #include "SensorEMG.h"
 
-SensorEMG::SensorEMG(const std::string& port) 
-    : comPort(port),
-      hComm(INVALID_HANDLE_VALUE),
+#include <cstdio>
+
+#include "HostClock.h"
+#include "SerialTransport.h"
+#include "RawCapture.h"
+#include "Trace.h"
+
+SensorEMG::SensorEMG(const std::string& port, double sampleRate) 
+    : SensorEMG(std::unique_ptr<Transport>(new SerialTransport(port)), sampleRate) {}
+
+SensorEMG::SensorEMG(std::unique_ptr<Transport> transport_, double sampleRate)
+    : transport(std::move(transport_)),
+      sequencer(sampleRate),
+      clock(sampleRate),
+      sensorId(0),
       total_samples(0),
-      frame_count(0),
-      measuredSampleRate(0.0),
-      captureStart(std::chrono::steady_clock::now()) {}
+      measuredSampleRate(0.0) {
+    bindMetrics(&globalMetrics());
+}
+
+void SensorEMG::bindMetrics(MetricsRegistry* registry) {
+    metrics = MetricSet();
+    if (!registry) return;
+    MetricsRegistry& r = *registry;
+    metrics.registry = registry;
+    metrics.label = metricLabel("sensor", transport->name());
+    const std::string l = "{" + metrics.label + "}";
+    metrics.readCalls = &r.counter("emg_read_calls_total" + l, "Transport read() calls");
+    metrics.emptyReads = &r.counter("emg_read_empty_total" + l, "read() calls that returned no bytes");
+    metrics.readBytes = &r.counter("emg_read_bytes_total" + l, "Bytes read from the transport");
+    metrics.readSize = &r.histogram("emg_read_size_bytes" + l, "Bytes per non-empty read() call (sampled)");
+    metrics.decodeNs = &r.histogram("emg_decode_ns" + l, "Decode, sequencing and clock sync time per read (sampled), ns");
+    metrics.samples = &r.counter("emg_samples_total" + l, "Decoded samples");
+    metrics.headerErrors = &r.counter("emg_frame_header_errors_total" + l, "Frame start found but len^addr check failed");
+    metrics.trailerErrors = &r.counter("emg_frame_trailer_errors_total" + l, "Frame header valid but trailer byte is not 0x5A");
+    metrics.resyncBytes = &r.counter("emg_resync_bytes_total" + l, "Bytes skipped while searching for a frame start");
+    metrics.decoderBuffered = &r.gauge("emg_decoder_buffered_bytes" + l, "Incomplete frame bytes held by the decoder");
+    metrics.lostSamples = &r.counter("emg_lost_samples_total" + l, "Samples lost according to frame metadata");
+    metrics.duplicateFrames = &r.counter("emg_duplicate_frames_total" + l, "Repeated frames dropped");
+}
+
+void SensorEMG::enableCapture(const std::string& path) {
+    transport.reset(new CaptureTransport(std::move(transport), path));
+}
 
 void SensorEMG::connect() {
-    hComm = CreateFileA(comPort.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
-    if (hComm == INVALID_HANDLE_VALUE)
-        throw std::runtime_error("Cannot open port " + comPort);
-    std::cout << "Port opened: " << comPort << std::endl;
+    transport->open();
+}
+
+void SensorEMG::sendCommand(uint8_t* cmd, size_t size) {
+    uint8_t xorVal = 0;
+    for (size_t i = 1; i < size; ++i) xorVal ^= cmd[i];
+    cmd[size-2] = xorVal;
+    transport->write(cmd, size);
 }
 
 void SensorEMG::sendSTART() {
     uint8_t cmd[] = {0xAA, 0x04, 0x80, 0x12, 0x01, 0x00, 0x00, 0xBB};
-    uint8_t xorVal = 0;
-    for (size_t i = 1; i < sizeof(cmd); ++i) xorVal ^= cmd[i];
-    cmd[sizeof(cmd)-2] = xorVal;
-    WriteFile(hComm, cmd, sizeof(cmd), &bytesWritten, nullptr);
-    PurgeComm(hComm, PURGE_RXCLEAR | PURGE_TXCLEAR);
+    sendCommand(cmd, sizeof(cmd));
+    transport->purge();
+}
+
+void SensorEMG::sendSTOP() {
+    uint8_t cmd[] = {0xAA, 0x04, 0x80, 0x11, 0x00, 0x00, 0x00, 0xBB};
+    sendCommand(cmd, sizeof(cmd));
 }
 
 std::vector<float> SensorEMG::pollData() {
-    char buf[512];
-    DWORD bytesRead;
-    static std::vector<uint8_t> rxBuff;
-    std::vector<float> emg_vals;   
-
-    if (ReadFile(hComm, buf, sizeof(buf), &bytesRead, nullptr) && bytesRead > 0) {
-        rxBuff.insert(rxBuff.end(), buf, buf + bytesRead);
-
-        size_t idx = 0;
-        while (rxBuff.size() - idx >= 7) {
-            if (rxBuff[idx] == 0xA5) {
-                uint8_t len = rxBuff[idx+1];
-                uint8_t addr = rxBuff[idx+2];
-                uint8_t check = rxBuff[idx+3];
-                if ((uint8_t)(len ^ addr) == check) {
-                    size_t frameLen = len + 3;
-                    if (rxBuff.size() - idx >= frameLen && rxBuff[idx + frameLen - 1] == 0x5A) {
-                        if (addr == 0x12) { // EMG frame
-                            const size_t METADATA = 4;
-                            size_t firstFloatPos = idx + 4 + METADATA;
-                            size_t diffsStart = firstFloatPos + 4;
-                            int payloadBytes = len - 2;
-
-                            if (payloadBytes >= (int)METADATA + 4) {
-                                float val = 0.0f;
-                                std::memcpy(&val, &rxBuff[firstFloatPos], sizeof(float));
-                                emg_vals.push_back(val);
-
-                                size_t dataNum = (payloadBytes - METADATA - 4) / 2;
-                                const float factor = 3.1457f;
-                                for (size_t k = 0; k < dataNum; ++k) {
-                                    size_t b0 = diffsStart + 2*k;
-                                    size_t b1 = diffsStart + 2*k + 1;
-                                    int16_t rawDiff = (int16_t)((rxBuff[b1] << 8) | rxBuff[b0]);
-                                    val += static_cast<float>(rawDiff) / factor;
-                                    emg_vals.push_back(val);
-                                }
-
-                                // обновляем статистику
-                                frame_count++;
-                                total_samples += emg_vals.size();
-
-                                // считаем частоту дискретизации
-                                auto now = std::chrono::steady_clock::now();
-                                double elapsed = std::chrono::duration_cast<
-                                    std::chrono::duration<double>>(now - captureStart).count();
-                                measuredSampleRate = (elapsed > 0.0) 
-                                    ? static_cast<double>(total_samples) / elapsed 
-                                    : 0.0;
-                            }
-                        }
-                        idx += frameLen;
-                        continue;
-                    }
+    SampleBlockRef block = pollBlock();
+    if (!block) return std::vector<float>();
+    return std::vector<float>(block->channel(0), block->channel(0) + block->sampleCount);
+}
+
+SampleBlockRef SensorEMG::pollBlock() {
+    uint8_t buf[512];
+    if (!nextBlock) nextBlock = pool.acquire();
+    SampleBlock& block = *nextBlock;
+
+    lastFrames.clear();
+    frameTiming.clear();
+    size_t bytesRead = transport->read(buf, sizeof(buf));
+    int64_t now = transport->readTimeNs();
+    // Гистограммы пишутся на каждом METRIC_SAMPLING-м непустом чтении: два вызова часов и
+    // атомарные сложения дороже всей остальной публикации
+    bool timeDecode = metrics.registry && bytesRead > 0 && (metrics.nonEmptyReads + 1) % METRIC_SAMPLING == 0;
+    int64_t decodeStart = timeDecode ? hostNowNs() : 0;
+    size_t frames = 0;
+    if (bytesRead > 0) {
+        EMG_TRACE_SCOPE("decode");
+        frames = decoder.feed(buf, bytesRead, block, &lastFrames);
+    }
+    if (frames > 0) {
+        sequencer.process(lastFrames, frameTiming);
+
+        lastBlock = SampleBlockTiming();
+        lastBlock.sequence = frameTiming.front().sequence;
+        lastBlock.deviceSample = frameTiming.front().deviceSample;
+        lastBlock.deviceTimeNs = frameTiming.front().deviceTimeNs;
+        lastBlock.hostTimeNs = now;
+        for (const FrameTiming& t : frameTiming) {
+            lastBlock.lostSamples += t.lostSamples;
+            lastBlock.duplicateFrames += t.duplicate ? 1 : 0;
+        }
+
+        // Повторённые кадры выбрасываются и из сэмплов, и из кадров
+        if (lastBlock.duplicateFrames > 0) {
+            NativeFrames unique;
+            std::vector<FrameTiming> uniqueTiming;
+            size_t d = 0;
+            for (size_t f = 0; f < lastFrames.frameCount(); ++f) {
+                if (!frameTiming[f].duplicate) {
+                    unique.appendFrame(lastFrames.metadata[f], lastFrames.base[f], lastFrames.diffs.data() + d, lastFrames.diffCount[f]);
+                    uniqueTiming.push_back(frameTiming[f]);
                 }
+                d += lastFrames.diffCount[f];
             }
-            idx++;
+            lastFrames.clear();
+            lastFrames.append(unique);
+            frameTiming.swap(uniqueTiming);
+            block.sampleCount = 0;
+            lastFrames.expand(block.extend((uint32_t)lastFrames.sampleCount()));
+        }
+
+        if (!frameTiming.empty()) {
+            const FrameTiming& last = frameTiming.back();
+            clock.observe(last.deviceSample + lastFrames.diffCount.back(), now);
+        }
+        lastBlock.sampleTimeNs = clock.hostTimeOf(lastBlock.deviceSample);
+        lastBlock.samplePeriodNs = clock.samplePeriodNs();
+
+        block.sensorId = sensorId;
+        block.firstSample = total_samples;
+        block.timing = lastBlock;
+        total_samples += block.sampleCount;
+        rateWindow.add(now, block.sampleCount);
+    }
+    measuredSampleRate = rateWindow.rate(now);
+    if (metrics.registry) publishMetrics(bytesRead, timeDecode ? hostNowNs() - decodeStart : -1);
+
+    if (block.empty()) return SampleBlockRef();
+    return std::move(nextBlock);
+}
+
+void SensorEMG::publishMetrics(size_t bytesRead, int64_t decodeNs) {
+    // Поток чтения у датчика один: итоги копятся в обычных полях, а в реестр копируются
+    // на каждом замеряемом чтении и на каждом пустом (поток простаивает — значения свежие)
+    metrics.readCallsTotal++;
+    if (bytesRead == 0) {
+        metrics.emptyReadsTotal++;
+    } else {
+        metrics.nonEmptyReads++;
+        metrics.readBytesTotal += bytesRead;
+        if (decodeNs < 0) return;
+        metrics.readSize->record(bytesRead);
+        metrics.decodeNs->record((uint64_t)decodeNs);
+    }
+
+    metrics.readCalls->store(metrics.readCallsTotal);
+    metrics.emptyReads->store(metrics.emptyReadsTotal);
+    metrics.readBytes->store(metrics.readBytesTotal);
+    metrics.samples->store(total_samples);
+    metrics.headerErrors->store(decoder.getHeaderErrors());
+    metrics.trailerErrors->store(decoder.getTrailerErrors());
+    metrics.resyncBytes->store(decoder.getSkippedBytes());
+    metrics.decoderBuffered->set((int64_t)decoder.getBufferedBytes());
+    metrics.lostSamples->store(sequencer.getLostSamples());
+    metrics.duplicateFrames->store(sequencer.getDuplicates());
+
+    auto publishAddress = [this](unsigned addr) {
+        MetricCounter*& counter = metrics.framesByAddr[addr];
+        uint64_t frames = decoder.getFramesByAddress((uint8_t)addr);
+        if (!counter && frames == 0) return;
+        if (!counter) {
+            char type[8];
+            std::snprintf(type, sizeof(type), "0x%02X", addr);
+            counter = &metrics.registry->counter("emg_frames_total{" + metrics.label + "," + metricLabel("addr", type) + "}",
+                                                 "Frames decoded, by address (type)");
         }
-        if (idx > 0) rxBuff.erase(rxBuff.begin(), rxBuff.begin() + idx);
+        counter->store(frames);
+    };
+    publishAddress(FRAME_ADDR_EMG);
+    // Кадры других типов редки — все адреса просматриваются, только когда они появились
+    if (decoder.getOtherFrames() != metrics.seenOtherFrames) {
+        metrics.seenOtherFrames = decoder.getOtherFrames();
+        for (unsigned addr = 0; addr < 256; ++addr)
+            if (addr != FRAME_ADDR_EMG) publishAddress(addr);
     }
+}
+
+void SensorEMG::getSampleTimes(std::vector<int64_t>& out) {
+    out.resize(lastFrames.sampleCount());
+    size_t n = 0;
+    for (size_t f = 0; f < frameTiming.size(); ++f) {
+        size_t count = (size_t)lastFrames.diffCount[f] + 1;
+        clock.stamp(frameTiming[f].deviceSample, count, &out[n]);
+        n += count;
+    }
+}
 
-    return emg_vals;
+bool SensorEMG::isFinished() const {
+    return transport->isEnd();
 }
 
 double SensorEMG::getSampleRate() const {
@@ -94,7 +208,7 @@ double SensorEMG::getSampleRate() const {
 }
 
 uint64_t SensorEMG::getFrameCount() const {
-    return frame_count;
+    return decoder.getFrameCount();
 }
 
 uint64_t SensorEMG::getTotalSamples() const {
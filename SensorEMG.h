@@ -1,6 +1,6 @@
 #pragma once
-#include <windows.h>
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <string>
 #include <cstdint>
@@ -8,29 +8,115 @@
 #include <chrono>
 #include <stdexcept>
 
+#include "Transport.h"
+#include "FrameDecoder.h"
+#include "DeviceTiming.h"
+#include "ClockSync.h"
+#include "Metrics.h"
+#include "SampleBlock.h"
+
 class SensorEMG {
 private:
-    std::string comPort;
-    HANDLE hComm;
-    DWORD bytesWritten;
+    std::unique_ptr<Transport> transport;    // COM-порт или воспроизведение захвата
+    BasicFrameDecoder<DefaultEmgDevice> decoder;    // Быстрый путь для кадров датчика по умолчанию
+    FrameSequencer sequencer;  // Номера и время кадров по метаданным
+    ClockSync clock;           // Часы датчика -> часы хоста
+    NativeFrames lastFrames;   // Кадры последнего pollData() в исходном виде
+    std::vector<FrameTiming> frameTiming;
+    SampleBlockTiming lastBlock;
+    SampleBlockPool pool;      // Порции pollBlock()
+    SampleBlockRef nextBlock;  // Взята из пула, ещё пуста: пустые чтения не трогают пул
+    uint32_t sensorId;
 
     uint64_t total_samples;    // Всего считанных сэмплов
-    uint64_t frame_count;      // Количество фреймов
-    std::chrono::steady_clock::time_point captureStart; // Время старта
+    RateWindow rateWindow;     // Частота за последние секунды
 
     double measuredSampleRate; // Текущая оценка частоты дискретизации
 
+    static const unsigned METRIC_SAMPLING = 16;    // emg_decode_ns, emg_read_size_bytes — каждое 16-е чтение
+
+    // Метрики в реестре (Metrics.h); registry == nullptr — не публикуются
+    struct MetricSet {
+        MetricsRegistry* registry = nullptr;
+        std::string label;                      // sensor="..."
+        MetricCounter* readCalls = nullptr;
+        MetricCounter* emptyReads = nullptr;
+        MetricCounter* readBytes = nullptr;
+        MetricHistogram* readSize = nullptr;
+        MetricHistogram* decodeNs = nullptr;
+        MetricCounter* samples = nullptr;
+        MetricCounter* headerErrors = nullptr;
+        MetricCounter* trailerErrors = nullptr;
+        MetricCounter* resyncBytes = nullptr;
+        MetricGauge* decoderBuffered = nullptr;
+        MetricCounter* lostSamples = nullptr;
+        MetricCounter* duplicateFrames = nullptr;
+        MetricCounter* framesByAddr[256] = {};  // Создаются при первом кадре адреса
+        uint64_t seenOtherFrames = 0;
+        uint64_t readCallsTotal = 0;
+        uint64_t emptyReadsTotal = 0;
+        uint64_t nonEmptyReads = 0;
+        uint64_t readBytesTotal = 0;
+    } metrics;
+
+    void sendCommand(uint8_t* cmd, size_t size);
+    void publishMetrics(size_t bytesRead, int64_t decodeNs);    // decodeNs < 0 — не измерялось
+
 public:
-    explicit SensorEMG(const std::string& port);
+    /**
+     * @param sampleRate Номинальная частота датчика: по ней метаданные переводятся во время
+     */
+    explicit SensorEMG(const std::string& port, double sampleRate = DefaultEmgDevice::sampleRate);
+    explicit SensorEMG(std::unique_ptr<Transport> transport, double sampleRate = DefaultEmgDevice::sampleRate);
+
+    /**
+     * @brief Дублировать сырой поток (чтения и команды) в файл захвата .emgcap.
+     *        Вызывать до connect(), чтобы в захват попала и команда старта.
+     */
+    void enableCapture(const std::string& path);
+
+    /**
+     * @brief Публиковать метрики чтения/декодирования в registry (по умолчанию globalMetrics()),
+     *        nullptr — не публиковать. Метки: sensor="имя транспорта".
+     */
+    void bindMetrics(MetricsRegistry* registry);
 
     void connect();
     void sendSTART();
+    void sendSTOP();
 
-    // Чтение данных и возвращение новых сэмплов
+    /**
+     * @brief Чтение и декодирование прямо в порцию из пула
+     * @return Порция с новыми сэмплами и их контекстом; пустая ссылка — новых сэмплов нет
+     */
+    SampleBlockRef pollBlock();
+
+    // То же копией в вектор
     std::vector<float> pollData();
 
+    // Номер датчика в порциях (для нескольких датчиков в одном конвейере)
+    void setSensorId(uint32_t id) { sensorId = id; }
+    uint32_t getSensorId() const { return sensorId; }
+
+    // Кадры, из которых собран результат последнего pollData() (для записи без потерь)
+    const NativeFrames& getLastFrames() const { return lastFrames; }
+
+    // Номер, время устройства и потери для результата последнего pollData()
+    const SampleBlockTiming& getLastBlock() const { return lastBlock; }
+    const std::vector<FrameTiming>& getLastFrameTiming() const { return frameTiming; }
+    const FrameSequencer& getSequencer() const { return sequencer; }
+    const ClockSync& getClockSync() const { return clock; }
+
+    /**
+     * @brief Времена сэмплов последнего pollData() в шкале hostNowNs() (с учётом ухода часов датчика)
+     */
+    void getSampleTimes(std::vector<int64_t>& out);
+
+    // Источник данных закончился (только для воспроизведения)
+    bool isFinished() const;
+
     // Метрики
-    double getSampleRate() const;
+    double getSampleRate() const;    // По скользящему окну 2 с
     uint64_t getFrameCount() const;
     uint64_t getTotalSamples() const;
 };
@@ -0,0 +1,223 @@
+#include "SensorMerger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+// ==== SensorMerger ====
+
+SensorMerger::SensorMerger(size_t sensorCount, const MergerOptions& options_)
+    : options(options_),
+      periodNs(0.0),
+      inputs(sensorCount),
+      pool((uint32_t)std::max<size_t>(1, sensorCount), std::max<uint32_t>(1, options_.blockFrames), 16),
+      running(false),
+      originNs(0.0),
+      nextFrame(0),
+      firstArrivalNs(std::numeric_limits<int64_t>::min()) {
+    if (sensorCount == 0) throw std::invalid_argument("SensorMerger: no sensors");
+    if (!(options.outputRate > 0.0)) throw std::invalid_argument("SensorMerger: output rate must be positive");
+    periodNs = 1e9 / options.outputRate;
+
+    // Запас на порцию сверх окна: порция приходит целиком
+    const size_t capacity = (size_t)std::ceil(options.bufferSeconds * options.outputRate * 2.0) + SAMPLE_BLOCK_DEFAULT_CAPACITY;
+    for (Input& in : inputs) {
+        in.times.assign(capacity, 0);
+        in.values.assign(capacity, 0.0f);
+        in.head = 0;
+        in.count = 0;
+        in.offsetNs = 0;
+        in.started = false;
+    }
+}
+
+void SensorMerger::push(const SampleBlock& block, std::vector<SampleBlockRef>& ready) {
+    if (block.sensorId >= inputs.size()) throw std::out_of_range("SensorMerger: unknown sensor id");
+    Input& in = inputs[block.sensorId];
+    const double period = block.timing.samplePeriodNs > 0.0 ? block.timing.samplePeriodNs : periodNs;
+    const int64_t start = block.timing.sampleTimeNs + in.offsetNs;
+    const int64_t emittedNs = running && nextFrame > 0 ? frameTime(nextFrame - 1) : std::numeric_limits<int64_t>::min();
+    const float* values = block.channel(0);
+    const size_t capacity = in.times.size();
+
+    for (uint32_t i = 0; i < block.sampleCount; ++i) {
+        const int64_t t = start + (int64_t)(period * i);
+        if (in.count > 0 && t <= in.newest()) continue;    // Время не растёт (повтор после сбоя модели часов)
+        if (t < emittedNs) stats.lateSamples++;           // Хранится: может стать левой опорой интерполяции
+        if (in.count == capacity) {
+            in.head = (in.head + 1) % capacity;
+            in.count--;
+            stats.droppedSamples++;
+        }
+        const size_t slot = (in.head + in.count) % capacity;
+        in.times[slot] = t;
+        in.values[slot] = values[i];
+        in.count++;
+    }
+    if (block.sampleCount > 0 && !in.started) {
+        in.started = true;
+        if (firstArrivalNs == std::numeric_limits<int64_t>::min()) firstArrivalNs = in.timeAt(0);
+    }
+    stats.inputSamples += block.sampleCount;
+    stats.maxBuffered = std::max(stats.maxBuffered, in.count);
+
+    if (!running && !tryStart()) return;
+    while (emitFrame(false, ready)) {}
+    finishBlock(ready);    // Неполная порция уходит сразу: задержка не копится до blockFrames кадров
+}
+
+void SensorMerger::flush(std::vector<SampleBlockRef>& ready) {
+    if (!running) {
+        bool any = false;
+        for (const Input& in : inputs) any = any || in.count > 0;
+        if (!any) return;
+        // Сетка — с момента, когда данные есть у всех пришедших датчиков
+        originNs = -std::numeric_limits<double>::infinity();
+        for (const Input& in : inputs)
+            if (in.count > 0) originNs = std::max(originNs, (double)in.timeAt(0));
+        running = true;
+    }
+    while (emitFrame(true, ready)) {}
+    finishBlock(ready);
+}
+
+bool SensorMerger::tryStart() {
+    bool all = true;
+    int64_t first = std::numeric_limits<int64_t>::min(), newest = std::numeric_limits<int64_t>::min();
+    for (const Input& in : inputs) {
+        if (in.count == 0) {
+            all = false;
+            continue;
+        }
+        first = std::max(first, in.timeAt(0));
+        newest = std::max(newest, in.newest());
+    }
+    // Не пришедший за maxLatencyNs датчик не задерживает старт: его каналы — NaN
+    if (!all && newest - firstArrivalNs <= options.maxLatencyNs) return false;
+    originNs = (double)first;
+    nextFrame = 0;
+    running = true;
+    return true;
+}
+
+bool SensorMerger::emitFrame(bool force, std::vector<SampleBlockRef>& ready) {
+    const int64_t t = frameTime(nextFrame);
+    bool complete = true;
+    int64_t newest = std::numeric_limits<int64_t>::min();
+    for (const Input& in : inputs) {
+        if (in.count == 0 || in.newest() < t) complete = false;
+        if (in.count > 0) newest = std::max(newest, in.newest());
+    }
+    if (!complete) {
+        if (newest < t) return false;                                   // Кадр впереди всех данных
+        if (!force && newest - t <= options.maxLatencyNs) return false;  // Ещё можно подождать
+    }
+
+    if (!current) {
+        current = pool.acquire();
+        current->firstSample = nextFrame;
+        current->timing.deviceSample = nextFrame;
+        current->timing.sampleTimeNs = t;
+        current->timing.samplePeriodNs = periodNs;
+    }
+    const uint32_t row = current->sampleCount;
+    current->extend(1);
+
+    const double maxGapNs = options.maxGapPeriods * periodNs;
+    for (size_t c = 0; c < inputs.size(); ++c) {
+        Input& in = inputs[c];
+        // Остаётся последний сэмпл не позже кадра — левая опора; более старые не нужны
+        while (in.count >= 2 && in.timeAt(1) <= t) {
+            in.head = (in.head + 1) % in.times.size();
+            in.count--;
+        }
+        float value = std::numeric_limits<float>::quiet_NaN();
+        if (in.count >= 1 && in.timeAt(0) == t) {
+            value = in.valueAt(0);
+        } else if (in.count >= 2 && in.timeAt(0) < t) {
+            const int64_t t0 = in.timeAt(0), t1 = in.timeAt(1);
+            if ((double)(t1 - t0) <= maxGapNs) {
+                const double w = (double)(t - t0) / (double)(t1 - t0);
+                value = (float)(in.valueAt(0) + (in.valueAt(1) - in.valueAt(0)) * w);
+            }
+        }
+        if (std::isnan(value)) stats.missingValues++;
+        current->channel((uint32_t)c)[row] = value;
+    }
+
+    stats.frames++;
+    stats.maxFrameDelayNs = std::max(stats.maxFrameDelayNs, newest - t);
+    nextFrame++;
+    if (current->sampleCount == current->capacity) finishBlock(ready);
+    return true;
+}
+
+void SensorMerger::finishBlock(std::vector<SampleBlockRef>& ready) {
+    if (!current || current->sampleCount == 0) return;
+    ready.push_back(std::move(current));
+    current.reset();
+    stats.blocks++;
+}
+
+void SensorMerger::applyLags(const std::vector<double>& lagFrames) {
+    // Канал, запаздывающий на L кадров, получил метки на L периодов позже истинных
+    for (size_t c = 0; c < inputs.size() && c < lagFrames.size(); ++c)
+        inputs[c].offsetNs -= (int64_t)std::llround(lagFrames[c] * periodNs);
+}
+
+// ==== Взаимная корреляция ====
+
+// Огибающая: модуль отклонения от среднего, затем без своего среднего; NaN — ноль
+static std::vector<double> envelope(const float* x, size_t count) {
+    double sum = 0.0;
+    size_t valid = 0;
+    for (size_t i = 0; i < count; ++i)
+        if (!std::isnan(x[i])) {
+            sum += x[i];
+            valid++;
+        }
+    const double mean = valid ? sum / (double)valid : 0.0;
+    std::vector<double> e(count, 0.0);
+    double eSum = 0.0;
+    for (size_t i = 0; i < count; ++i)
+        if (!std::isnan(x[i])) {
+            e[i] = std::fabs(x[i] - mean);
+            eSum += e[i];
+        }
+    const double eMean = valid ? eSum / (double)valid : 0.0;
+    for (size_t i = 0; i < count; ++i)
+        if (!std::isnan(x[i])) e[i] -= eMean;
+    return e;
+}
+
+std::vector<double> estimateChannelLags(const float* const* channels, size_t channelCount, size_t count,
+                                        size_t maxLag) {
+    std::vector<double> lags(channelCount, 0.0);
+    if (channelCount < 2 || count < 3) return lags;
+    maxLag = std::min(maxLag, count - 2);
+    const std::vector<double> reference = envelope(channels[0], count);
+    std::vector<double> r(2 * maxLag + 1);
+
+    for (size_t c = 1; c < channelCount; ++c) {
+        const std::vector<double> e = envelope(channels[c], count);
+        // r[L] — среднее e0[i] * ec[i + L] по перекрытию
+        for (size_t k = 0; k < r.size(); ++k) {
+            const ptrdiff_t lag = (ptrdiff_t)k - (ptrdiff_t)maxLag;
+            const size_t from = lag < 0 ? (size_t)-lag : 0;
+            const size_t to = lag > 0 ? count - (size_t)lag : count;
+            double sum = 0.0;
+            for (size_t i = from; i < to; ++i) sum += reference[i] * e[(size_t)((ptrdiff_t)i + lag)];
+            r[k] = sum / (double)(to - from);
+        }
+        const size_t peak = (size_t)(std::max_element(r.begin(), r.end()) - r.begin());
+        double lag = (double)peak - (double)maxLag;
+        if (peak > 0 && peak + 1 < r.size()) {
+            const double a = r[peak - 1], b = r[peak], d = r[peak + 1];
+            const double denom = a - 2.0 * b + d;
+            if (denom < 0.0) lag += 0.5 * (a - d) / denom;    // Вершина параболы по трём точкам
+        }
+        lags[c] = lag;
+    }
+    return lags;
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SampleBlock.h"
+
+// ==== Слияние потоков нескольких датчиков ====
+//
+// Каждый датчик стартует в свой момент и идёт по своим часам. Время сэмплов в общей шкале хоста
+// уже даёт ClockSync датчика (SampleBlockTiming::sampleTimeNs / samplePeriodNs: счётчик сэмплов
+// устройства + время прихода, то есть рукопожатие старта и уход часов). Остаётся постоянная часть
+// задержки прихода, своя у каждого датчика, — её снимает общий синхро-сигнал (удар, хлопок):
+// estimateChannelLags() по взаимной корреляции окна слитых кадров, applyLags() — поправка сдвигов.
+//
+// SensorMerger выдаёт кадры на общей сетке времени t0 + k / outputRate: канал c — датчик c,
+// значение — линейная интерполяция его сэмплов в момент кадра. Кадр выдаётся, как только у всех
+// датчиков есть сэмплы не раньше его времени, но не позже maxLatencyNs от самого свежего датчика:
+// у отставшего датчика в таком кадре NaN. Буфер каждого датчика ограничен (bufferSeconds).
+// Потери внутри порции не видны по времени её первого сэмпла: такая порция растягивается на
+// свою длину, следующая порция снова точна.
+
+struct MergerOptions {
+    double outputRate = 500.0;
+    int64_t maxLatencyNs = 250000000;   // Дольше кадр не ждёт отставший датчик
+    double bufferSeconds = 2.0;         // Сэмплов на датчик в буфере — не больше bufferSeconds * outputRate * 2
+    uint32_t blockFrames = 64;          // Кадров в выходной порции
+    double maxGapPeriods = 3.0;         // Дыра в данных датчика длиннее — NaN, а не интерполяция
+};
+
+struct MergerStats {
+    uint64_t inputSamples = 0;
+    uint64_t frames = 0;                // Выдано кадров
+    uint64_t blocks = 0;
+    uint64_t missingValues = 0;         // Значений NaN: датчик отстал или дыра в данных
+    uint64_t lateSamples = 0;           // Пришли после того, как их кадры выданы
+    uint64_t droppedSamples = 0;        // Вытеснены из переполненного буфера
+    size_t maxBuffered = 0;             // Наибольшее число сэмплов в буфере одного датчика
+    int64_t maxFrameDelayNs = 0;        // Наибольшее отставание выданного кадра от самого свежего сэмпла
+};
+
+/**
+ * @brief Слияние порций N датчиков в кадры на общей сетке. push() и flush() — из одного потока.
+ */
+class SensorMerger {
+private:
+    // Кольцо сэмплов датчика в общей шкале времени (с учётом сдвига)
+    struct Input {
+        std::vector<int64_t> times;
+        std::vector<float> values;
+        size_t head;                    // Самый старый
+        size_t count;
+        int64_t offsetNs;               // Прибавляется ко времени сэмплов датчика
+        bool started;
+
+        int64_t timeAt(size_t i) const { return times[(head + i) % times.size()]; }
+        float valueAt(size_t i) const { return values[(head + i) % values.size()]; }
+        int64_t newest() const { return timeAt(count - 1); }
+    };
+
+    MergerOptions options;
+    double periodNs;
+    std::vector<Input> inputs;
+    SampleBlockPool pool;
+    SampleBlockRef current;             // Заполняемая выходная порция
+    bool running;                       // Сетка выбрана
+    double originNs;                    // Время кадра 0
+    uint64_t nextFrame;
+    int64_t firstArrivalNs;             // Время первого сэмпла первого пришедшего датчика
+    MergerStats stats;
+
+    bool tryStart();
+    // Кадр nextFrame: force — выдать, даже если не все датчики дошли до него
+    bool emitFrame(bool force, std::vector<SampleBlockRef>& ready);
+    void finishBlock(std::vector<SampleBlockRef>& ready);
+    int64_t frameTime(uint64_t frame) const { return (int64_t)(originNs + periodNs * (double)frame); }
+
+public:
+    SensorMerger(size_t sensorCount, const MergerOptions& options = MergerOptions());
+
+    SensorMerger(const SensorMerger&) = delete;
+    SensorMerger& operator=(const SensorMerger&) = delete;
+
+    /**
+     * @brief Порция датчика block.sensorId (канал 0); готовые порции кадров дописываются в ready
+     */
+    void push(const SampleBlock& block, std::vector<SampleBlockRef>& ready);
+
+    /**
+     * @brief Конец записи: выдаёт кадры, для которых есть данные хотя бы одного датчика
+     */
+    void flush(std::vector<SampleBlockRef>& ready);
+
+    /**
+     * @brief Сдвиг времени датчика, нс (прибавляется к времени его сэмплов). Менять до старта
+     *        или между записями: уже выданные кадры не пересчитываются.
+     */
+    void setOffsetNs(uint32_t sensor, int64_t offsetNs) { inputs.at(sensor).offsetNs = offsetNs; }
+    int64_t getOffsetNs(uint32_t sensor) const { return inputs.at(sensor).offsetNs; }
+
+    /**
+     * @brief Поправляет сдвиги на задержки из estimateChannelLags() (в кадрах выходной сетки)
+     */
+    void applyLags(const std::vector<double>& lagFrames);
+
+    size_t getSensorCount() const { return inputs.size(); }
+    double getOutputRate() const { return options.outputRate; }
+    const MergerStats& getStats() const { return stats; }
+};
+
+/**
+ * @brief Задержка каждого канала относительно канала 0 по взаимной корреляции огибающих
+ *        (модуль сигнала без среднего) — для окна вокруг общего синхро-события.
+ * @param channels channelCount указателей на count значений, NaN считаются нулём
+ * @param maxLag Наибольшая искомая задержка, в сэмплах
+ * @return Задержка в сэмплах (дробная, по параболе у пика): > 0 — канал запаздывает
+ */
+std::vector<double> estimateChannelLags(const float* const* channels, size_t channelCount, size_t count,
+                                        size_t maxLag);
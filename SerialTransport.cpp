@@ -0,0 +1,333 @@
+#include "SerialTransport.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "Trace.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <climits>
+#include <cstdlib>
+#include <linux/serial.h>
+#include <sys/ioctl.h>
+#endif
+#ifdef __APPLE__
+#include <IOKit/serial/ioss.h>
+#include <sys/ioctl.h>
+#endif
+#endif
+
+const char* serialProfileName(SerialProfile profile) {
+    switch (profile) {
+        case SerialProfile::Default:    return "default";
+        case SerialProfile::LowLatency: return "low-latency";
+        case SerialProfile::Throughput: return "throughput";
+    }
+    return "?";
+}
+
+bool parseSerialProfile(const std::string& name, SerialProfile& profile) {
+    for (SerialProfile p : {SerialProfile::Default, SerialProfile::LowLatency, SerialProfile::Throughput})
+        if (name == serialProfileName(p)) {
+            profile = p;
+            return true;
+        }
+    return false;
+}
+
+#ifndef _WIN32
+// Константа termios для стандартной скорости; B0 — такой нет. UART адаптера (FTDI, CP210x)
+// работает на заданной скорости, поэтому округлять её нельзя: поток придёт искажённым
+static speed_t standardSpeed(int baud) {
+    struct { int baud; speed_t speed; } table[] = {
+        {9600, B9600}, {19200, B19200}, {38400, B38400}, {57600, B57600},
+        {115200, B115200}, {230400, B230400},
+#ifdef B460800
+        {460800, B460800}, {921600, B921600},
+#endif
+#ifdef B500000
+        {500000, B500000}, {1000000, B1000000}, {2000000, B2000000}, {3000000, B3000000},
+#endif
+    };
+    for (auto& t : table)
+        if (t.baud == baud) return t.speed;
+    return B0;
+}
+
+#if defined(__linux__) && defined(TCGETS2)
+// struct termios2 из <asm/termbits.h> (имя нужно макросам TCGETS2/TCSETS2): сам заголовок
+// конфликтует с <termios.h>
+struct termios2 {
+    tcflag_t c_iflag, c_oflag, c_cflag, c_lflag;
+    cc_t c_line;
+    cc_t c_cc[19];
+    speed_t c_ispeed, c_ospeed;
+};
+const tcflag_t KERNEL_CBAUD = 0010017;
+const tcflag_t KERNEL_BOTHER = 0010000;
+#endif
+
+// Нестандартная скорость точно: Linux — termios2 с BOTHER, macOS — IOSSIOSPEED
+static bool setCustomSpeed(int fd, int baud) {
+#if defined(__linux__) && defined(TCGETS2)
+    termios2 tio{};
+    if (ioctl(fd, TCGETS2, &tio) != 0) return false;
+    tio.c_cflag = (tio.c_cflag & ~KERNEL_CBAUD) | KERNEL_BOTHER;
+    tio.c_ispeed = tio.c_ospeed = (speed_t)baud;
+    return ioctl(fd, TCSETS2, &tio) == 0;
+#elif defined(__APPLE__)
+    speed_t speed = (speed_t)baud;
+    return ioctl(fd, IOSSIOSPEED, &speed) == 0;
+#else
+    (void)fd;
+    (void)baud;
+    return false;
+#endif
+}
+#endif
+
+SerialTransport::SerialTransport(const std::string& port_, const SerialOptions& opts)
+    : port(port_),
+      options(opts),
+#ifdef _WIN32
+      hComm(INVALID_HANDLE_VALUE) {}
+#else
+      fd(-1),
+      savedSerialFlags(-1),
+      savedLatencyTimerMs(-1) {}
+#endif
+
+SerialTransport::~SerialTransport() {
+    close();
+}
+
+void SerialTransport::open() {
+#ifdef _WIN32
+    hComm = CreateFileA(port.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+    if (hComm == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Cannot open port " + port);
+
+    DCB dcb = {0};
+    dcb.DCBlength = sizeof(DCB);
+    if (GetCommState(hComm, &dcb)) {
+        dcb.BaudRate = options.baudRate;
+        dcb.ByteSize = 8;
+        dcb.Parity   = NOPARITY;
+        dcb.StopBits = ONESTOPBIT;
+        if (!SetCommState(hComm, &dcb)) {
+            close();
+            throw std::runtime_error("Port " + port + ": baud rate " + std::to_string(options.baudRate) +
+                                     " is not supported");
+        }
+    }
+
+    COMMTIMEOUTS timeouts = {0};
+    if (options.profile == SerialProfile::Throughput) {
+        // ReadFile копит байты, пока они идут без пауз длиннее 5 мс, но не дольше readTimeoutMs
+        timeouts.ReadIntervalTimeout        = 5;
+        timeouts.ReadTotalTimeoutMultiplier = 0;
+        timeouts.ReadTotalTimeoutConstant   = options.readTimeoutMs;
+    } else {
+        // ReadFile возвращает сразу, если байты уже есть, иначе ждёт не дольше readTimeoutMs
+        timeouts.ReadIntervalTimeout        = MAXDWORD;
+        timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
+        timeouts.ReadTotalTimeoutConstant   = options.readTimeoutMs;
+    }
+    SetCommTimeouts(hComm, &timeouts);
+#else
+    fd = ::open(port.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open port " + port);
+
+    termios tty{};
+    if (tcgetattr(fd, &tty) == 0) {
+        const speed_t speed = standardSpeed(options.baudRate);
+        cfmakeraw(&tty);
+        if (speed != B0) {
+            cfsetispeed(&tty, speed);
+            cfsetospeed(&tty, speed);
+        }
+        tty.c_cflag |= CLOCAL | CREAD;
+        if (options.profile == SerialProfile::Throughput) {
+            // Первый байт ждёт poll(), дальше read() копит VMIN байт или паузу VTIME (0.1 с)
+            tty.c_cc[VMIN]  = (cc_t)std::min(255, std::max(1, options.minReadBytes));
+            tty.c_cc[VTIME] = 1;
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+        } else {
+            tty.c_cc[VMIN]  = 0;
+            tty.c_cc[VTIME] = 0;    // Ожидание данных — через poll()
+        }
+        tcsetattr(fd, TCSANOW, &tty);
+        if (speed == B0 && !setCustomSpeed(fd, options.baudRate)) {
+            close();
+            throw std::runtime_error("Port " + port + ": baud rate " + std::to_string(options.baudRate) +
+                                     " is not supported");
+        }
+    }
+    applyProfile();
+#endif
+    std::cout << "Port opened: " << port << " (" << serialProfileName(options.profile) << ")" << std::endl;
+}
+
+#ifndef _WIN32
+// Файл latency_timer адаптера в sysfs: /dev/ttyUSB0 (или ссылка на него) -> /sys/class/tty/ttyUSB0/...
+static std::string latencyTimerFile(const std::string& port) {
+#ifdef __linux__
+    char resolved[PATH_MAX];
+    std::string device = realpath(port.c_str(), resolved) ? resolved : port;
+    return "/sys/class/tty/" + device.substr(device.find_last_of('/') + 1) + "/device/latency_timer";
+#else
+    (void)port;
+    return std::string();
+#endif
+}
+
+static int readLatencyTimer(const std::string& path) {
+    std::ifstream in(path);
+    int value = -1;
+    return in >> value ? value : -1;
+}
+
+static bool writeLatencyTimer(const std::string& path, int value) {
+    std::ofstream out(path);
+    out << value << std::flush;    // Ошибка прав видна только при записи
+    return out.good();
+}
+
+void SerialTransport::applyProfile() {
+    if (options.profile == SerialProfile::Default) return;
+    const bool lowLatency = options.profile == SerialProfile::LowLatency;
+    const int timerMs = options.latencyTimerMs >= 0 ? options.latencyTimerMs : (lowLatency ? 1 : 16);
+
+    // latency_timer читается до TIOCSSERIAL: ftdi_sio по ASYNC_LOW_LATENCY сам ставит 1 мс
+    const std::string timerPath = latencyTimerFile(port);
+    const int previousTimerMs = timerPath.empty() ? -1 : readLatencyTimer(timerPath);
+
+#ifdef __linux__
+    serial_struct serial{};
+    if (ioctl(fd, TIOCGSERIAL, &serial) == 0) {
+        const int previous = serial.flags;
+        serial.flags = lowLatency ? (serial.flags | ASYNC_LOW_LATENCY) : (serial.flags & ~ASYNC_LOW_LATENCY);
+        if (serial.flags != previous) {
+            if (ioctl(fd, TIOCSSERIAL, &serial) == 0) savedSerialFlags = previous;
+            else std::cerr << "Warning: " << port << ": cannot set ASYNC_LOW_LATENCY" << std::endl;
+        }
+    }
+#endif
+
+    if (previousTimerMs < 0) return;    // Не USB-serial адаптер с latency_timer
+    if (readLatencyTimer(timerPath) != timerMs) {
+        if (writeLatencyTimer(timerPath, timerMs)) {
+            savedLatencyTimerMs = previousTimerMs;
+            latencyTimerPath = timerPath;
+        } else {
+            std::cerr << "Warning: " << port << ": no permission to write " << timerPath << " (latency_timer "
+                      << previousTimerMs << " ms)" << std::endl;
+        }
+    } else if (previousTimerMs != timerMs) {
+        savedLatencyTimerMs = previousTimerMs;    // Поменял драйвер вслед за флагом
+        latencyTimerPath = timerPath;
+    }
+}
+
+void SerialTransport::restoreProfile() {
+#ifdef __linux__
+    serial_struct serial{};
+    if (savedSerialFlags >= 0 && ioctl(fd, TIOCGSERIAL, &serial) == 0) {
+        serial.flags = savedSerialFlags;
+        ioctl(fd, TIOCSSERIAL, &serial);
+    }
+#endif
+    if (savedLatencyTimerMs >= 0) writeLatencyTimer(latencyTimerPath, savedLatencyTimerMs);
+    savedSerialFlags = -1;
+    savedLatencyTimerMs = -1;
+}
+#endif
+
+void SerialTransport::close() {
+#ifdef _WIN32
+    if (hComm != INVALID_HANDLE_VALUE) CloseHandle(hComm);
+    hComm = INVALID_HANDLE_VALUE;
+#else
+    if (fd >= 0) {
+        restoreProfile();
+        ::close(fd);
+    }
+    fd = -1;
+#endif
+}
+
+size_t SerialTransport::read(uint8_t* buf, size_t capacity) {
+    EMG_TRACE_SCOPE("read");
+    // Адаптер отключён или порт сломан: исключение, а не "нет данных" — иначе цикл чтения крутится впустую
+#ifdef _WIN32
+    DWORD bytesRead = 0;
+    if (!ReadFile(hComm, buf, (DWORD)capacity, &bytesRead, nullptr)) {
+        const DWORD error = GetLastError();
+        if (error == ERROR_OPERATION_ABORTED) {
+            // Ошибка линии (fAbortOnError) останавливает чтение до ClearCommError
+            DWORD lineErrors = 0;
+            ClearCommError(hComm, &lineErrors, nullptr);
+            return 0;
+        }
+        throw std::runtime_error("Port " + port + ": read failed (error " + std::to_string(error) + ")");
+    }
+    return bytesRead;
+#else
+    pollfd pfd{fd, POLLIN, 0};
+    const int ready = poll(&pfd, 1, options.readTimeoutMs);
+    if (ready == 0 || (ready < 0 && errno == EINTR)) return 0;
+    if (ready < 0 || (pfd.revents & POLLNVAL))
+        throw std::runtime_error("Port " + port + ": poll failed");
+    if (!(pfd.revents & POLLIN)) throw std::runtime_error("Port " + port + ": device disconnected");    // POLLHUP/POLLERR
+    ssize_t n = ::read(fd, buf, capacity);
+    if (n > 0) return (size_t)n;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 0;
+    // poll() сообщил о данных, а read() вернул 0 — конец потока (hangup)
+    throw std::runtime_error("Port " + port + ": " + (n == 0 ? "device disconnected" : std::strerror(errno)));
+#endif
+}
+
+void SerialTransport::write(const uint8_t* data, size_t size) {
+#ifdef _WIN32
+    DWORD bytesWritten = 0;
+    WriteFile(hComm, data, (DWORD)size, &bytesWritten, nullptr);
+#else
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+        if (n <= 0) break;
+        data += n;
+        size -= (size_t)n;
+    }
+    tcdrain(fd);
+#endif
+}
+
+int SerialTransport::getLatencyTimerMs() const {
+#ifdef _WIN32
+    return -1;
+#else
+    const std::string path = latencyTimerFile(port);
+    return path.empty() ? -1 : readLatencyTimer(path);
+#endif
+}
+
+void SerialTransport::purge() {
+#ifdef _WIN32
+    PurgeComm(hComm, PURGE_RXCLEAR | PURGE_TXCLEAR);
+#else
+    tcflush(fd, TCIOFLUSH);
+#endif
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <string>
+
+#include "Transport.h"
+
+// ==== Профиль задержки порта ====
+//
+// USB-serial адаптеры (FTDI и подобные) копят принятые байты до заполнения пакета или до
+// истечения latency_timer (по умолчанию 16 мс) — это на порядок больше, чем разбор кадров.
+// LowLatency: ASYNC_LOW_LATENCY (TIOCSSERIAL), latency_timer адаптера 1 мс (sysfs, если хватает
+// прав), read() отдаёт байты сразу после первого. Throughput: latency_timer 16 мс, read()
+// ждёт до minReadBytes (VMIN/VTIME) — меньше пробуждений и системных вызовов на тот же поток.
+// Default: настройки драйвера не трогаются. На Windows профиль задаёт только COMMTIMEOUTS:
+// latency timer FTDI там настраивается в драйвере.
+
+enum class SerialProfile {
+    Default,
+    LowLatency,
+    Throughput,
+};
+
+const char* serialProfileName(SerialProfile profile);
+
+/**
+ * @brief "default", "low-latency", "throughput"
+ * @return false — имя не распознано
+ */
+bool parseSerialProfile(const std::string& name, SerialProfile& profile);
+
+struct SerialOptions {
+    int baudRate = 256000;           // Задаётся точно; неподдерживаемая скорость — исключение в open()
+    int readTimeoutMs = 10;          // Сколько ReadFile/read ждёт первый байт
+    SerialProfile profile = SerialProfile::Default;
+    int latencyTimerMs = -1;         // latency_timer адаптера; < 0 — по профилю (1 / 16 мс)
+    int minReadBytes = 128;          // Throughput: столько байт копит read() (VMIN, не больше 255)
+};
+
+/**
+ * @brief COM-порт: Win32 (CreateFile/ReadFile) или POSIX (termios/read)
+ */
+class SerialTransport : public Transport {
+private:
+    std::string port;
+    SerialOptions options;
+#ifdef _WIN32
+    void* hComm;
+#else
+    int fd;
+    int savedSerialFlags;            // Флаги serial_struct до open(); -1 — не менялись
+    int savedLatencyTimerMs;         // latency_timer до open(); -1 — не менялся
+    std::string latencyTimerPath;    // /sys/class/tty/<имя>/device/latency_timer
+
+    void applyProfile();
+    void restoreProfile();
+#endif
+
+public:
+    explicit SerialTransport(const std::string& port, const SerialOptions& opts = SerialOptions());
+    ~SerialTransport() override;
+
+    void open() override;
+    void close() override;
+    /**
+     * @throws std::runtime_error Адаптер отключён (hangup) или ошибка чтения
+     */
+    size_t read(uint8_t* buf, size_t capacity) override;
+    void write(const uint8_t* data, size_t size) override;
+    void purge() override;
+    std::string name() const override { return port; }
+
+    const SerialOptions& getOptions() const { return options; }
+
+    /**
+     * @brief Текущий latency_timer адаптера, мс; -1 — нет такого параметра (не USB-serial, Windows)
+     */
+    int getLatencyTimerMs() const;
+};
@@ -0,0 +1,419 @@
+#include "SessionHistory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "HostClock.h"
+
+const int16_t HISTORY_ESCAPE = std::numeric_limits<int16_t>::min();    // Дальше — float сэмпла
+const uint8_t HISTORY_CHANNEL_DELTA = 0;
+const uint8_t HISTORY_CHANNEL_FLOAT = 1;
+const size_t HISTORY_MAX_SPARE = 2;
+
+// Корзины по LOD_BASE_SAMPLES; NaN пропускаются, корзина из одних NaN — NaN
+static void computeBins(const float* x, size_t count, LodBin* out) {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    for (size_t i = 0; i < count; i += LOD_BASE_SAMPLES) {
+        const size_t end = std::min(count, i + LOD_BASE_SAMPLES);
+        float lo = std::numeric_limits<float>::infinity(), hi = -lo;
+        double sum = 0.0;
+        size_t valid = 0;
+        for (size_t j = i; j < end; ++j) {
+            if (std::isnan(x[j])) continue;
+            lo = std::min(lo, x[j]);
+            hi = std::max(hi, x[j]);
+            sum += x[j];
+            valid++;
+        }
+        out[i / LOD_BASE_SAMPLES] = valid ? LodBin{lo, hi, (float)(sum / (double)valid)} : LodBin{nan, nan, nan};
+    }
+}
+
+// Объединение корзин в точку графика
+struct BinAccumulator {
+    float min = std::numeric_limits<float>::infinity();
+    float max = -std::numeric_limits<float>::infinity();
+    double sum = 0.0;
+    size_t count = 0;
+
+    void add(const LodBin& bin) {
+        if (std::isnan(bin.mean)) return;
+        min = std::min(min, bin.min);
+        max = std::max(max, bin.max);
+        sum += bin.mean;
+        count++;
+    }
+
+    LodBin result() const {
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+        return count ? LodBin{min, max, (float)(sum / (double)count)} : LodBin{nan, nan, nan};
+    }
+};
+
+static bool sameBits(float a, float b) {
+    return std::memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+// ==== SessionHistory ====
+
+SessionHistory::SessionHistory(const SessionHistoryOptions& options_)
+    : options(options_),
+      binsPerBlock(options_.blockSamples / LOD_BASE_SAMPLES),
+      hotLimitBlocks((size_t)std::ceil(std::max(0.0, options_.hotSeconds) * options_.sampleRate /
+                                       std::max<uint32_t>(1, options_.blockSamples))),
+      packedBegin(0),
+      hotBegin(0),
+      totalBytes(0),
+      totalSamples(0),
+      stopping(false),
+      pushChannels(options_.channelCount) {
+    if (options.channelCount == 0) throw std::invalid_argument("SessionHistory: no channels");
+    if (options.blockSamples == 0 || options.blockSamples % LOD_BASE_SAMPLES != 0)
+        throw std::invalid_argument("SessionHistory: blockSamples must be a multiple of LOD_BASE_SAMPLES");
+    if (!(options.diffFactor > 0.0f)) throw std::invalid_argument("SessionHistory: diffFactor must be positive");
+    worker = std::thread(&SessionHistory::workerLoop, this);
+}
+
+SessionHistory::~SessionHistory() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    worker.join();
+}
+
+void SessionHistory::push(const SampleBlock& block) {
+    if (block.channelCount != options.channelCount)
+        throw std::invalid_argument("SessionHistory: channel count mismatch");
+    for (uint32_t c = 0; c < block.channelCount; ++c) pushChannels[c] = block.channel(c);
+    append(pushChannels.data(), block.sampleCount);
+}
+
+void SessionHistory::push(const float* values, size_t count) {
+    if (options.channelCount != 1) throw std::invalid_argument("SessionHistory: channel count mismatch");
+    append(&values, count);
+}
+
+void SessionHistory::append(const float* const* channels, size_t count) {
+    bool sealed = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t done = 0;
+        while (done < count) {
+            if (blocks.empty() || blocks.back().count == options.blockSamples) {
+                blocks.emplace_back();
+                Block& block = blocks.back();
+                block.firstSample = totalSamples;
+                block.count = 0;
+                block.tier = Tier::Hot;
+                if (!spare.empty()) {
+                    block.samples.swap(spare.back());
+                    spare.pop_back();
+                } else {
+                    block.samples.resize((size_t)options.blockSamples * options.channelCount);
+                }
+                totalBytes += blockBytes(block);
+            }
+            Block& block = blocks.back();
+            const size_t n = std::min(count - done, (size_t)(options.blockSamples - block.count));
+            for (uint32_t c = 0; c < options.channelCount; ++c)
+                std::memcpy(&block.samples[(size_t)c * options.blockSamples + block.count], channels[c] + done,
+                            n * sizeof(float));
+            block.count += (uint32_t)n;
+            done += n;
+            totalSamples += n;
+            if (block.count == options.blockSamples) {
+                seal(block);
+                sealed = true;
+            }
+        }
+    }
+    if (sealed) cv.notify_one();
+}
+
+void SessionHistory::seal(Block& block) {
+    totalBytes -= blockBytes(block);
+    block.bins.resize((size_t)binsPerBlock * options.channelCount);
+    block.summary.resize(options.channelCount);
+    for (uint32_t c = 0; c < options.channelCount; ++c) {
+        LodBin* bins = &block.bins[(size_t)c * binsPerBlock];
+        computeBins(&block.samples[(size_t)c * options.blockSamples], block.count, bins);
+        BinAccumulator all;
+        for (uint32_t b = 0; b < binsPerBlock; ++b) all.add(bins[b]);
+        block.summary[c] = all.result();
+    }
+    totalBytes += blockBytes(block);
+}
+
+size_t SessionHistory::blockBytes(const Block& block) const {
+    return sizeof(Block) + block.samples.capacity() * sizeof(float) + block.packed.capacity() +
+           block.packedOffsets.capacity() * sizeof(uint32_t) +
+           (block.bins.capacity() + block.summary.capacity()) * sizeof(LodBin);
+}
+
+size_t SessionHistory::sealedHotBlocks() const {
+    size_t hot = blocks.size() - hotBegin;
+    if (hot > 0 && blocks.back().count < options.blockSamples) hot--;    // Недописанный
+    return hot;
+}
+
+bool SessionHistory::needsWork() const {
+    const size_t sealedHot = sealedHotBlocks();
+    if (sealedHot > hotLimitBlocks) return true;
+    return totalBytes > options.budgetBytes && (sealedHot > 0 || hotBegin > 0);
+}
+
+void SessionHistory::workerLoop() {
+    std::vector<uint8_t> packed;
+    std::vector<uint32_t> offsets;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        cv.wait(lock, [this] { return stopping || needsWork(); });
+        if (stopping) return;
+
+        const size_t sealedHot = sealedHotBlocks();
+        if (sealedHot > hotLimitBlocks || (sealedHot > 0 && totalBytes > options.budgetBytes)) {
+            // Блоки удаляет только этот поток, push() дописывает в конец: ссылка переживает unlock
+            Block& block = blocks[hotBegin];
+            uint64_t escapes = 0, floatBlocks = 0;
+            lock.unlock();
+            const int64_t t0 = hostNowNs();
+            pack(block, packed, offsets, escapes, floatBlocks);
+            const int64_t packNs = hostNowNs() - t0;
+            lock.lock();
+
+            totalBytes -= blockBytes(block);
+            block.packed.assign(packed.begin(), packed.end());
+            block.packedOffsets.swap(offsets);
+            if (spare.size() < HISTORY_MAX_SPARE) spare.push_back(std::move(block.samples));
+            std::vector<float>().swap(block.samples);
+            block.tier = Tier::Packed;
+            totalBytes += blockBytes(block);
+            hotBegin++;
+            stats.escapes += escapes;
+            stats.floatBlocks += floatBlocks;
+            stats.packNs += packNs;
+        }
+        enforceBudget();
+    }
+}
+
+void SessionHistory::enforceBudget() {
+    while (totalBytes > options.budgetBytes) {
+        if (packedBegin < hotBegin) {
+            // Самый старый сжатый блок теряет сэмплы, сводка остаётся
+            Block& block = blocks[packedBegin];
+            totalBytes -= blockBytes(block);
+            std::vector<uint8_t>().swap(block.packed);
+            std::vector<uint32_t>().swap(block.packedOffsets);
+            block.tier = Tier::Summary;
+            totalBytes += blockBytes(block);
+            packedBegin++;
+        } else if (packedBegin > 0) {
+            totalBytes -= blockBytes(blocks.front());
+            blocks.pop_front();
+            packedBegin--;
+            hotBegin--;
+            stats.droppedBlocks++;
+        } else {
+            break;    // Остались только горячие: их сожмёт workerLoop()
+        }
+    }
+}
+
+// Канал блока: int16 разницы со escape или float целиком (если escape больше четверти)
+void SessionHistory::pack(const Block& block, std::vector<uint8_t>& packed, std::vector<uint32_t>& offsets,
+                          uint64_t& escapes, uint64_t& floatBlocks) const {
+    const float factor = options.diffFactor;
+    std::vector<int16_t> codes(block.count);
+    std::vector<float> raw;
+    packed.clear();
+    offsets.assign(options.channelCount + 1, 0);
+
+    for (uint32_t c = 0; c < options.channelCount; ++c) {
+        const float* x = &block.samples[(size_t)c * options.blockSamples];
+        raw.clear();
+        float prev = 0.0f;
+        for (uint32_t i = 0; i < block.count; ++i) {
+            // Разница попадает в сетку, если decode повторит сэмпл бит в бит
+            const double step = ((double)x[i] - (double)prev) * factor;
+            if (i > 0 && std::fabs(step) < 32767.0) {
+                const int16_t d = (int16_t)std::lrint(step);
+                const float next = prev + static_cast<float>(d) / factor;    // Как FrameDecoder
+                if (d != HISTORY_ESCAPE && sameBits(next, x[i])) {
+                    codes[i] = d;
+                    prev = next;
+                    continue;
+                }
+            }
+            codes[i] = HISTORY_ESCAPE;
+            raw.push_back(x[i]);
+            prev = x[i];
+        }
+
+        offsets[c] = (uint32_t)packed.size();
+        const size_t start = packed.size();
+        if (raw.size() * 4 > block.count) {
+            packed.resize(start + 1 + block.count * sizeof(float));
+            packed[start] = HISTORY_CHANNEL_FLOAT;
+            std::memcpy(&packed[start + 1], x, block.count * sizeof(float));
+            floatBlocks++;
+        } else {
+            packed.resize(start + 1 + block.count * sizeof(int16_t) + raw.size() * sizeof(float));
+            packed[start] = HISTORY_CHANNEL_DELTA;
+            std::memcpy(&packed[start + 1], codes.data(), block.count * sizeof(int16_t));
+            std::memcpy(&packed[start + 1 + block.count * sizeof(int16_t)], raw.data(), raw.size() * sizeof(float));
+            escapes += raw.size();
+        }
+    }
+    offsets[options.channelCount] = (uint32_t)packed.size();
+}
+
+void SessionHistory::channelSamples(const Block& block, uint32_t channel, float* out) const {
+    if (block.tier == Tier::Hot) {
+        std::memcpy(out, &block.samples[(size_t)channel * options.blockSamples], block.count * sizeof(float));
+        return;
+    }
+    const uint8_t* p = &block.packed[block.packedOffsets[channel]];
+    if (p[0] == HISTORY_CHANNEL_FLOAT) {
+        std::memcpy(out, p + 1, block.count * sizeof(float));
+        return;
+    }
+    const uint8_t* codes = p + 1;
+    const uint8_t* raw = codes + block.count * sizeof(int16_t);
+    const float factor = options.diffFactor;
+    float prev = 0.0f;
+    for (uint32_t i = 0; i < block.count; ++i) {
+        int16_t d;
+        std::memcpy(&d, codes + i * sizeof(int16_t), sizeof(d));
+        if (d == HISTORY_ESCAPE) {
+            std::memcpy(&prev, raw, sizeof(float));
+            raw += sizeof(float);
+        } else {
+            prev += static_cast<float>(d) / factor;
+        }
+        out[i] = prev;
+    }
+}
+
+void SessionHistory::query(uint32_t channel, double first, double last, size_t maxPoints, LodSlice& out) const {
+    out.x.clear();
+    out.min.clear();
+    out.max.clear();
+    out.mean.clear();
+    out.raw = false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (blocks.empty() || channel >= options.channelCount) return;
+    const uint64_t bs = options.blockSamples;
+    const uint64_t oldest = blocks.front().firstSample;
+    const uint64_t rawFrom = packedBegin < blocks.size() ? blocks[packedBegin].firstSample : totalSamples;
+    first = std::max(first, (double)oldest);
+    last = std::min(last, (double)totalSamples);
+    if (last <= first) return;
+    const double perPoint = (last - first) / (double)std::max<size_t>(maxPoints, 1);
+    std::vector<float> scratch(options.blockSamples);
+
+    if (perPoint < LOD_BASE_SAMPLES && first >= (double)rawFrom) {
+        // Ближе корзины — сами сэмплы, их не больше maxPoints * LOD_BASE_SAMPLES
+        const uint64_t a = (uint64_t)std::floor(first);
+        const uint64_t b = std::min<uint64_t>(totalSamples, (uint64_t)std::ceil(last) + 1);
+        for (uint64_t s = a; s < b;) {
+            const Block& block = blocks[(size_t)((s - oldest) / bs)];
+            channelSamples(block, channel, scratch.data());
+            const uint64_t end = std::min<uint64_t>(b, block.firstSample + block.count);
+            for (; s < end; ++s) {
+                out.x.push_back((double)s);
+                out.mean.push_back(scratch[(size_t)(s - block.firstSample)]);
+            }
+        }
+        out.raw = true;
+        return;
+    }
+
+    // Точка — группа корзин (или сводок блоков), выровненная по номеру сэмпла: при прокрутке не мерцает
+    const uint64_t unit = perPoint >= (double)bs ? bs : LOD_BASE_SAMPLES;
+    const uint64_t group = unit * std::max<uint64_t>(1, (uint64_t)(perPoint / (double)unit));
+    uint64_t g0 = (uint64_t)first / group;
+    if (g0 > 0) g0--;    // По точке с каждой стороны, чтобы линия не обрывалась у края графика
+    const uint64_t start = std::max(oldest, g0 * group);
+    const uint64_t end = std::min<uint64_t>(totalSamples, ((uint64_t)std::ceil(last / (double)group) + 1) * group);
+
+    std::vector<LodBin> openBins(binsPerBlock);
+    BinAccumulator acc;
+    uint64_t current = start / group;
+    auto flush = [&] {
+        if (acc.count == 0) return;
+        const LodBin bin = acc.result();
+        out.x.push_back((double)(current * group));
+        out.min.push_back(bin.min);
+        out.max.push_back(bin.max);
+        out.mean.push_back(bin.mean);
+        acc = BinAccumulator();
+    };
+    for (size_t i = (size_t)((start - oldest) / bs); i < blocks.size() && blocks[i].firstSample < end; ++i) {
+        const Block& block = blocks[i];
+        const LodBin* bins = block.bins.empty() ? nullptr : &block.bins[(size_t)channel * binsPerBlock];
+        if (!bins) {
+            // Недописанный блок — корзины по месту
+            computeBins(&block.samples[(size_t)channel * bs], block.count, openBins.data());
+            bins = openBins.data();
+        }
+        const uint32_t binCount = (block.count + LOD_BASE_SAMPLES - 1) / LOD_BASE_SAMPLES;
+        if (unit == bs) {
+            if (block.firstSample / group != current) {
+                flush();
+                current = block.firstSample / group;
+            }
+            if (!block.summary.empty()) {
+                acc.add(block.summary[channel]);
+            } else {
+                for (uint32_t b = 0; b < binCount; ++b) acc.add(bins[b]);
+            }
+            continue;
+        }
+        for (uint32_t b = 0; b < binCount; ++b) {
+            const uint64_t s = block.firstSample + (uint64_t)b * LOD_BASE_SAMPLES;
+            if (s < start) continue;
+            if (s >= end) break;
+            if (s / group != current) {
+                flush();
+                current = s / group;
+            }
+            acc.add(bins[b]);
+        }
+    }
+    flush();
+}
+
+uint64_t SessionHistory::getTotalSamples() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return totalSamples;
+}
+
+SessionHistoryStats SessionHistory::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    SessionHistoryStats s = stats;
+    s.totalSamples = totalSamples;
+    s.oldestSample = blocks.empty() ? 0 : blocks.front().firstSample;
+    s.rawFromSample = packedBegin < blocks.size() ? blocks[packedBegin].firstSample : totalSamples;
+    s.summaryBlocks = packedBegin;
+    s.packedBlocks = hotBegin - packedBegin;
+    s.hotBlocks = blocks.size() - hotBegin;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        const size_t bytes = blockBytes(blocks[i]);
+        if (i < packedBegin) s.summaryBytes += bytes;
+        else if (i < hotBegin) s.packedBytes += bytes;
+        else s.hotBytes += bytes;
+    }
+    return s;
+}
+
+size_t SessionHistory::sizeBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return totalBytes;
+}
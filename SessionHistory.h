@@ -0,0 +1,133 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "DeviceProfile.h"
+#include "MinMaxPyramid.h"
+#include "SampleBlock.h"
+
+// ==== История сеанса в памяти для прокрутки живого графика ====
+//
+// Сэмплы всех каналов с начала сеанса лежат блоками по blockSamples сэмплов на канал в трёх ярусах
+// по возрасту:
+//   горячий — float, как пришли: последние hotSeconds и недописанный блок;
+//   сжатый  — служебный поток перекладывает остывшие блоки в int16 разницы в масштабе датчика
+//             (prev + d / diffFactor — та же арифметика, что у FrameDecoder), без потерь. Сэмпл вне
+//             этой сетки (база кадра, NaN) — escape и float следом. Блок, где таких больше четверти
+//             (фильтрованный или интерполированный сигнал), остаётся float;
+//   сводка  — только min/max/mean корзин по LOD_BASE_SAMPLES и всего блока (есть у блоков всех ярусов).
+// Когда объём превышает budgetBytes, у самых старых сжатых блоков отбрасываются сэмплы (остаётся
+// сводка), затем и сами самые старые блоки; под нехваткой бюджета горячие блоки сжимаются раньше
+// hotSeconds. query() — как MinMaxPyramid::query(): не больше точек, чем пикселей графика.
+// push() — из потока чтения, query() — из любого потока.
+
+struct SessionHistoryOptions {
+    uint32_t channelCount = 1;
+    double sampleRate = 500.0;
+    double hotSeconds = 30.0;                 // Несжатый хвост
+    size_t budgetBytes = 64u << 20;           // Вся история вместе со сводкой
+    uint32_t blockSamples = 4096;             // Сэмплов канала в блоке, кратно LOD_BASE_SAMPLES
+    float diffFactor = EMG_DIFF_FACTOR;       // Масштаб int16 разниц
+};
+
+struct SessionHistoryStats {
+    uint64_t totalSamples = 0;                // Принято сэмплов на канал
+    uint64_t oldestSample = 0;                // Первый хранимый сэмпл
+    uint64_t rawFromSample = 0;               // С него и дальше есть сами сэмплы (до — только сводка)
+    size_t hotBlocks = 0;
+    size_t packedBlocks = 0;
+    size_t summaryBlocks = 0;
+    uint64_t droppedBlocks = 0;
+    uint64_t floatBlocks = 0;                 // Сжатых блоков, оставшихся float (каналов-блоков)
+    uint64_t escapes = 0;                     // Сэмплов вне сетки разниц
+    size_t hotBytes = 0;
+    size_t packedBytes = 0;
+    size_t summaryBytes = 0;
+    int64_t packNs = 0;                       // Время сжатия всех блоков
+};
+
+/**
+ * @brief Многоярусная история сеанса с фиксированным бюджетом памяти
+ */
+class SessionHistory {
+private:
+    enum class Tier : uint8_t { Hot, Packed, Summary };
+
+    struct Block {
+        uint64_t firstSample;
+        uint32_t count;
+        Tier tier;
+        std::vector<float> samples;           // Hot: канал c — с c * blockSamples
+        std::vector<uint8_t> packed;          // Packed: каналы подряд
+        std::vector<uint32_t> packedOffsets;  // channelCount + 1 смещений в packed
+        std::vector<LodBin> bins;             // binsPerBlock на канал; у недописанного блока пусто
+        std::vector<LodBin> summary;          // Одна на канал
+    };
+
+    const SessionHistoryOptions options;
+    const uint32_t binsPerBlock;
+    const size_t hotLimitBlocks;
+
+    mutable std::mutex mutex;                 // Защищает всё ниже до "Служебный поток"
+    std::deque<Block> blocks;                 // Подряд по времени: Summary..., Packed..., Hot...
+    size_t packedBegin;                       // Первый не-Summary блок
+    size_t hotBegin;                          // Первый Hot блок
+    size_t totalBytes;
+    uint64_t totalSamples;
+    std::vector<std::vector<float>> spare;    // Освобождённые буферы горячих блоков
+    SessionHistoryStats stats;
+
+    std::condition_variable cv;
+    bool stopping;
+
+    // Служебный поток
+    std::thread worker;
+
+    // Поток чтения: указатели каналов порции для push(), без выделения на каждый вызов
+    std::vector<const float*> pushChannels;
+
+    void append(const float* const* channels, size_t count);
+    size_t sealedHotBlocks() const;
+    bool needsWork() const;
+    void workerLoop();
+    void seal(Block& block);
+    void enforceBudget();
+    size_t blockBytes(const Block& block) const;
+    void pack(const Block& block, std::vector<uint8_t>& packed, std::vector<uint32_t>& offsets,
+              uint64_t& escapes, uint64_t& floatBlocks) const;
+    void channelSamples(const Block& block, uint32_t channel, float* out) const;
+
+public:
+    explicit SessionHistory(const SessionHistoryOptions& options = SessionHistoryOptions());
+    ~SessionHistory();
+
+    SessionHistory(const SessionHistory&) = delete;
+    SessionHistory& operator=(const SessionHistory&) = delete;
+
+    /**
+     * @brief Дописывает каналы порции (block.channelCount == channelCount)
+     */
+    void push(const SampleBlock& block);
+
+    /**
+     * @brief Один канал: values подряд (channelCount == 1)
+     */
+    void push(const float* values, size_t count);
+
+    /**
+     * @brief Точки канала на отрезке [first, last) сэмплов от начала сеанса для графика шириной
+     *        maxPoints пикселей. Сами сэмплы (out.raw) — если корзина мельче LOD_BASE_SAMPLES и у
+     *        всего отрезка они сохранились, иначе min/max/mean корзин.
+     */
+    void query(uint32_t channel, double first, double last, size_t maxPoints, LodSlice& out) const;
+
+    uint64_t getTotalSamples() const;
+    SessionHistoryStats getStats() const;
+    size_t sizeBytes() const;
+    const SessionHistoryOptions& getOptions() const { return options; }
+};
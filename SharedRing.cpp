@@ -0,0 +1,292 @@
+#include "SharedRing.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include "HostClock.h"
+#include "Trace.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ==== SharedMemory ====
+
+#ifdef _WIN32
+static std::string systemName(const std::string& name) { return "Local\\" + name; }
+#else
+static std::string systemName(const std::string& name) { return name[0] == '/' ? name : "/" + name; }
+#endif
+
+SharedMemory::SharedMemory()
+    : ptr(nullptr),
+      length(0),
+      owner(false)
+#ifdef _WIN32
+      , hMapping(nullptr)
+#endif
+{}
+
+SharedMemory::~SharedMemory() {
+    close();
+}
+
+void SharedMemory::create(const std::string& name_, size_t size) {
+    close();
+    name = systemName(name_);
+#ifdef _WIN32
+    hMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32),
+                                  (DWORD)size, name.c_str());
+    if (hMapping == nullptr) throw std::runtime_error("Cannot create shared memory " + name);
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+        // Сегмент держит другой писатель или читатель — его размер может не совпадать
+        close();
+        throw std::runtime_error("Shared memory " + name + " is in use");
+    }
+    ptr = static_cast<uint8_t*>(MapViewOfFile(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, size));
+    if (ptr == nullptr) {
+        close();
+        throw std::runtime_error("Cannot map shared memory " + name);
+    }
+#else
+    shm_unlink(name.c_str());     // Старые читатели остаются на прежнем сегменте
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) throw std::runtime_error("Cannot create shared memory " + name);
+    if (ftruncate(fd, (off_t)size) != 0) {
+        ::close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Cannot size shared memory " + name);
+    }
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Cannot map shared memory " + name);
+    }
+    ptr = static_cast<uint8_t*>(p);
+#endif
+    length = size;
+    owner = true;
+}
+
+void SharedMemory::attach(const std::string& name_) {
+    close();
+    name = systemName(name_);
+#ifdef _WIN32
+    hMapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+    if (hMapping == nullptr) throw std::runtime_error("Cannot open shared memory " + name);
+    ptr = static_cast<uint8_t*>(MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0));
+    if (ptr == nullptr) {
+        close();
+        throw std::runtime_error("Cannot map shared memory " + name);
+    }
+    MEMORY_BASIC_INFORMATION info;
+    VirtualQuery(ptr, &info, sizeof(info));
+    length = info.RegionSize;
+#else
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) throw std::runtime_error("Cannot open shared memory " + name);
+    struct stat st;
+    fstat(fd, &st);
+    void* p = st.st_size > 0 ? mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (p == MAP_FAILED) throw std::runtime_error("Cannot map shared memory " + name);
+    ptr = static_cast<uint8_t*>(p);
+    length = (size_t)st.st_size;
+#endif
+    owner = false;
+}
+
+void SharedMemory::close() {
+#ifdef _WIN32
+    if (ptr) UnmapViewOfFile(ptr);
+    if (hMapping) CloseHandle(hMapping);
+    hMapping = nullptr;
+#else
+    if (ptr) munmap(ptr, length);
+    if (ptr && owner) shm_unlink(name.c_str());
+#endif
+    ptr = nullptr;
+    length = 0;
+    owner = false;
+}
+
+// ==== Писатель ====
+
+SharedRingPublisher::SharedRingPublisher() : header(nullptr), nextSequence(0), nextSample(0) {}
+
+SharedRingPublisher::~SharedRingPublisher() {
+    close();
+}
+
+SharedBlockHeader* SharedRingPublisher::slot(uint64_t sequence) const {
+    uint8_t* base = reinterpret_cast<uint8_t*>(header) + header->headerBytes;
+    return reinterpret_cast<SharedBlockHeader*>(base + (size_t)(sequence & (header->slotCount - 1)) * header->slotBytes);
+}
+
+void SharedRingPublisher::open(const std::string& name, double sampleRate, const std::string& device,
+                               uint32_t blockSamples, uint32_t slotCount) {
+    close();
+    blockSamples = std::max<uint32_t>(1, blockSamples);
+    uint32_t slots = 1;
+    while (slots < slotCount) slots <<= 1;
+    const uint32_t slotBytes = (uint32_t)((sizeof(SharedBlockHeader) + blockSamples * sizeof(float) + 63) / 64 * 64);
+    shm.create(name, sizeof(SharedRingHeader) + (size_t)slots * slotBytes);
+
+    header = new (shm.data()) SharedRingHeader();
+    std::memcpy(header->magic, SHARED_RING_MAGIC, sizeof(header->magic));
+    header->version = SHARED_RING_VERSION;
+    header->headerBytes = sizeof(SharedRingHeader);
+    header->slotBytes = slotBytes;
+    header->slotCount = slots;
+    header->blockSamples = blockSamples;
+    header->channelCount = 1;
+    header->sampleRate = sampleRate;
+    header->startUnixNs = wallNowNs();
+#ifdef _WIN32
+    header->writerPid = (uint32_t)GetCurrentProcessId();
+#else
+    header->writerPid = (uint32_t)getpid();
+#endif
+    std::strncpy(header->device, device.c_str(), sizeof(header->device) - 1);
+    for (uint32_t i = 0; i < slots; ++i) new (slot(i)) SharedBlockHeader();
+
+    nextSequence = 0;
+    nextSample = 0;
+    // Читатель проверяет magic после state: заголовок виден целиком
+    header->state.store(SHARED_RING_LIVE, std::memory_order_release);
+}
+
+void SharedRingPublisher::close() {
+    if (!header) return;
+    header->state.store(SHARED_RING_CLOSED, std::memory_order_release);
+    header = nullptr;
+    shm.close();
+}
+
+void SharedRingPublisher::publish(const float* samples, size_t count, int64_t hostTimeNs, uint64_t lostSamples) {
+    if (!header || count == 0) return;
+    EMG_TRACE_SCOPE("shm publish");
+    const int64_t publishNs = hostNowNs();
+    while (count > 0) {
+        uint32_t n = (uint32_t)std::min<size_t>(count, header->blockSamples);
+        SharedBlockHeader* b = slot(nextSequence);
+        b->seqlock.store(2 * nextSequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);    // Нечётный seqlock виден раньше данных
+
+        b->sequence = nextSequence;
+        b->firstSample = nextSample;
+        b->hostTimeNs = hostTimeNs;
+        b->publishNs = publishNs;
+        b->sampleCount = n;
+        b->lostSamples = (uint32_t)std::min<uint64_t>(lostSamples, UINT32_MAX);
+        std::memcpy(reinterpret_cast<uint8_t*>(b) + sizeof(SharedBlockHeader), samples, n * sizeof(float));
+
+        b->seqlock.store(2 * nextSequence + 2, std::memory_order_release);
+        nextSequence++;
+        nextSample += n;
+        header->totalSamples.store(nextSample, std::memory_order_relaxed);
+        header->published.store(nextSequence, std::memory_order_release);
+
+        samples += n;
+        count -= n;
+        lostSamples = 0;
+    }
+}
+
+// ==== Читатель ====
+
+SharedRingReader::SharedRingReader() : header(nullptr), nextSequence(0), lostBlocks(0) {}
+
+const SharedBlockHeader* SharedRingReader::slot(uint64_t sequence) const {
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(header) + header->headerBytes;
+    return reinterpret_cast<const SharedBlockHeader*>(base + (size_t)(sequence & (header->slotCount - 1)) * header->slotBytes);
+}
+
+void SharedRingReader::open(const std::string& name, bool fromOldest) {
+    close();
+    shm.attach(name);
+    const SharedRingHeader* h = reinterpret_cast<const SharedRingHeader*>(shm.data());
+    if (shm.size() < sizeof(SharedRingHeader) || h->state.load(std::memory_order_acquire) == 0 ||
+        std::memcmp(h->magic, SHARED_RING_MAGIC, sizeof(h->magic)) != 0 || h->version != SHARED_RING_VERSION ||
+        shm.size() < (size_t)h->headerBytes + (size_t)h->slotCount * h->slotBytes) {
+        shm.close();
+        throw std::runtime_error("Not an EMG shared stream: " + name);
+    }
+    header = h;
+    uint64_t published = header->published.load(std::memory_order_acquire);
+    if (!fromOldest) nextSequence = published;
+    else nextSequence = published >= header->slotCount ? published - header->slotCount + 1 : 0;
+    lostBlocks = 0;
+}
+
+void SharedRingReader::close() {
+    header = nullptr;
+    shm.close();
+}
+
+SharedReadStatus SharedRingReader::next(SharedBlockView& view) {
+    if (!header) return SharedReadStatus::Closed;
+    uint64_t skipped = 0;
+    for (;;) {
+        // state читается до published: после CLOSED новых блоков не появится
+        bool closed = header->state.load(std::memory_order_acquire) == SHARED_RING_CLOSED;
+        uint64_t published = header->published.load(std::memory_order_acquire);
+        if (nextSequence >= published) {
+            lostBlocks += skipped;
+            return closed ? SharedReadStatus::Closed : SharedReadStatus::Empty;
+        }
+        if (published - nextSequence >= header->slotCount) {
+            // Отстали: старые слоты перезаписаны. Один слот запаса — его может писать писатель
+            uint64_t oldest = published - header->slotCount + 1;
+            skipped += oldest - nextSequence;
+            nextSequence = oldest;
+        }
+
+        const SharedBlockHeader* b = slot(nextSequence);
+        if (b->seqlock.load(std::memory_order_acquire) != 2 * nextSequence + 2) {
+            // Слот уже занят более новым блоком — отстали, пока проверяли
+            skipped++;
+            nextSequence++;
+            continue;
+        }
+        view.header = b;
+        view.samples = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(b) + sizeof(SharedBlockHeader));
+        view.sampleCount = std::min(b->sampleCount, header->blockSamples);
+        view.sequence = nextSequence;
+        view.firstSample = b->firstSample;
+        view.hostTimeNs = b->hostTimeNs;
+        view.publishNs = b->publishNs;
+        view.lostSamples = b->lostSamples;
+        view.skippedBlocks = skipped;
+        lostBlocks += skipped;
+        nextSequence++;
+        return SharedReadStatus::Ok;
+    }
+}
+
+bool SharedRingReader::release(const SharedBlockView& view) {
+    std::atomic_thread_fence(std::memory_order_acquire);    // Чтения данных — до повторной проверки
+    if (view.header->seqlock.load(std::memory_order_relaxed) == 2 * view.sequence + 2) return true;
+    lostBlocks++;
+    return false;
+}
+
+SharedReadStatus SharedRingReader::read(std::vector<float>& out, SharedBlockView* info) {
+    for (;;) {
+        SharedBlockView view;
+        SharedReadStatus status = next(view);
+        if (status != SharedReadStatus::Ok) return status;
+        out.assign(view.samples, view.samples + view.sampleCount);
+        if (!release(view)) continue;
+        if (info) *info = view;
+        return SharedReadStatus::Ok;
+    }
+}
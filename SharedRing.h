@@ -0,0 +1,188 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ==== Живой поток в разделяемой памяти (shm_open / CreateFileMapping) ====
+//
+//   [SharedRingHeader]                                  — 128 байт
+//   ([SharedBlockHeader][float32 x blockSamples]) x slotCount — слоты кольца, slotBytes каждый
+//
+// Один писатель, сколько угодно читателей. Блок с номером seq лежит в слоте seq % slotCount.
+// Писатель не ждёт читателей: отставший больше чем на slotCount блоков теряет старые блоки
+// (и узнаёт об этом по номерам). Слот защищён seqlock: перед записью seqlock = 2*seq+1,
+// после — 2*seq+2; читатель сверяет seqlock до и после чтения данных.
+//
+// Раскладка фиксирована (little-endian, выравнивание полей естественное), читается и без
+// этой библиотеки — например, Python: mmap("/dev/shm/<name>") + struct. Время — hostNowNs()
+// (CLOCK_MONOTONIC / QPC), общее для процессов одной машины.
+
+const char     SHARED_RING_MAGIC[8] = {'E', 'M', 'G', 'S', 'H', 'M', '0', '1'};
+const uint32_t SHARED_RING_VERSION  = 1;
+const uint32_t SHARED_RING_DEFAULT_BLOCK_SAMPLES = 64;
+const uint32_t SHARED_RING_DEFAULT_SLOTS = 4096;         // ~8 минут при 500 Гц и полных блоках
+
+enum SharedRingState : uint32_t {
+    SHARED_RING_LIVE = 1,
+    SHARED_RING_CLOSED = 2,    // Писатель завершился; новых блоков не будет
+};
+
+struct SharedRingHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t headerBytes;
+    uint32_t slotBytes;         // Заголовок блока + сэмплы, кратно 64
+    uint32_t slotCount;         // Степень двойки
+    uint32_t blockSamples;      // Сэмплов в полном блоке
+    uint32_t channelCount;
+    double   sampleRate;
+    int64_t  startUnixNs;       // Отличает перезапуск писателя с тем же именем
+    std::atomic<uint64_t> published;       // Опубликовано блоков (номер следующего)
+    std::atomic<uint64_t> totalSamples;
+    std::atomic<uint32_t> state;           // SharedRingState
+    uint32_t writerPid;
+    char     device[56];
+};
+
+struct SharedBlockHeader {
+    std::atomic<uint64_t> seqlock;         // 2*seq+1 — идёт запись, 2*seq+2 — блок seq готов
+    uint64_t sequence;
+    uint64_t firstSample;       // Индекс первого сэмпла в потоке
+    int64_t  hostTimeNs;        // Время чтения порта для первого сэмпла
+    int64_t  publishNs;         // Время публикации (для задержки публикация -> чтение)
+    uint32_t sampleCount;
+    uint32_t lostSamples;       // Потеряно датчиком перед этим блоком
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared ring needs address-free 64-bit atomics");
+static_assert(sizeof(std::atomic<uint64_t>) == 8 && sizeof(std::atomic<uint32_t>) == 4, "atomic layout");
+static_assert(sizeof(SharedRingHeader) == 128, "SharedRingHeader layout");
+static_assert(sizeof(SharedBlockHeader) == 48, "SharedBlockHeader layout");
+
+/**
+ * @brief Отображение именованного сегмента разделяемой памяти
+ */
+class SharedMemory {
+private:
+    uint8_t* ptr;
+    size_t length;
+    std::string name;
+    bool owner;
+#ifdef _WIN32
+    void* hMapping;
+#endif
+
+public:
+    SharedMemory();
+    ~SharedMemory();
+
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    // Создать (старый сегмент с тем же именем заменяется) — для писателя
+    void create(const std::string& name, size_t size);
+    // Подключиться к существующему — для читателя
+    void attach(const std::string& name);
+    void close();
+
+    bool isOpen() const { return ptr != nullptr; }
+    uint8_t* data() const { return ptr; }
+    size_t size() const { return length; }
+};
+
+/**
+ * @brief Писатель живого потока. publish() не блокируется и не выделяет память.
+ */
+class SharedRingPublisher {
+private:
+    SharedMemory shm;
+    SharedRingHeader* header;
+    uint64_t nextSequence;
+    uint64_t nextSample;
+
+    SharedBlockHeader* slot(uint64_t sequence) const;
+
+public:
+    SharedRingPublisher();
+    ~SharedRingPublisher();
+
+    /**
+     * @param name Имя сегмента без префикса ("emg" -> /dev/shm/emg, Local\emg)
+     * @param slotCount Округляется вверх до степени двойки
+     */
+    void open(const std::string& name, double sampleRate, const std::string& device = "",
+              uint32_t blockSamples = SHARED_RING_DEFAULT_BLOCK_SAMPLES, uint32_t slotCount = SHARED_RING_DEFAULT_SLOTS);
+    // Помечает поток завершённым и удаляет имя; подключённые читатели дочитывают остаток
+    void close();
+
+    /**
+     * @brief Опубликовать порцию; длиннее blockSamples — несколькими блоками
+     * @param lostSamples Потеряно перед порцией (пишется в первый блок)
+     */
+    void publish(const float* samples, size_t count, int64_t hostTimeNs, uint64_t lostSamples = 0);
+
+    bool isOpen() const { return header != nullptr; }
+    uint64_t getPublishedBlocks() const { return nextSequence; }
+};
+
+enum class SharedReadStatus {
+    Ok,
+    Empty,     // Новых блоков пока нет
+    Closed     // Писатель завершился и всё прочитано
+};
+
+/**
+ * @brief Блок без копирования — указатели в разделяемую память. Действителен, пока
+ *        SharedRingReader::release() не вернёт true; false — писатель успел перезаписать слот.
+ */
+struct SharedBlockView {
+    const SharedBlockHeader* header = nullptr;
+    const float* samples = nullptr;
+    uint32_t sampleCount = 0;
+    uint64_t sequence = 0;
+    uint64_t firstSample = 0;
+    int64_t hostTimeNs = 0;
+    int64_t publishNs = 0;
+    uint32_t lostSamples = 0;
+    uint64_t skippedBlocks = 0;    // Потеряно читателем перед этим блоком (отстал)
+};
+
+/**
+ * @brief Читатель живого потока (другой процесс). Не влияет на писателя и других читателей.
+ */
+class SharedRingReader {
+private:
+    SharedMemory shm;
+    const SharedRingHeader* header;
+    uint64_t nextSequence;
+    uint64_t lostBlocks;
+
+    const SharedBlockHeader* slot(uint64_t sequence) const;
+
+public:
+    SharedRingReader();
+
+    /**
+     * @param fromOldest true — начать с самого старого блока в кольце, false — только новые
+     */
+    void open(const std::string& name, bool fromOldest = false);
+    void close();
+
+    // Следующий блок без копирования. После использования данных — release()
+    SharedReadStatus next(SharedBlockView& view);
+    // true — слот не перезаписан, пока читались данные view
+    bool release(const SharedBlockView& view);
+
+    /**
+     * @brief Следующий блок с копированием и проверкой; перезаписанные блоки пропускаются
+     */
+    SharedReadStatus read(std::vector<float>& out, SharedBlockView* info = nullptr);
+
+    bool isOpen() const { return header != nullptr; }
+    double getSampleRate() const { return header ? header->sampleRate : 0.0; }
+    uint32_t getBlockSamples() const { return header ? header->blockSamples : 0; }
+    uint64_t getLostBlocks() const { return lostBlocks; }
+    int64_t getStreamId() const { return header ? header->startUnixNs : 0; }
+};
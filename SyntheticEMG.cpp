@@ -0,0 +1,88 @@
+#include "SyntheticEMG.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "FrameDecoder.h"
+#include "RawCapture.h"
+
+SyntheticEMG::SyntheticEMG(double sampleRate_, uint32_t seed)
+    : sampleRate(sampleRate_),
+      rng(seed),
+      noise(0.0f, 1.0f),
+      n(0),
+      bandState{0.0f, 0.0f},
+      envelope(20.0f),
+      target(20.0f),
+      nextSwitch(0) {}
+
+float SyntheticEMG::next() {
+    const float PI = 3.14159265f;
+    if (n >= nextSwitch) {
+        // Чередование покоя и сокращений по 0.5..3 с
+        bool contraction = target < 100.0f;
+        target = contraction ? 200.0f + 200.0f * std::generate_canonical<float, 24>(rng) : 20.0f;
+        nextSwitch = n + (uint64_t)(sampleRate * (0.5 + 2.5 * std::generate_canonical<double, 32>(rng)));
+    }
+    envelope += (target - envelope) * 0.02f;
+
+    // Двухполюсный резонатор около 80 Гц — типичная полоса поверхностной ЭМГ
+    float w = 2.0f * PI * 80.0f / (float)sampleRate;
+    float r = 0.7f;
+    float y = noise(rng) + 2.0f * r * std::cos(w) * bandState[0] - r * r * bandState[1];
+    bandState[1] = bandState[0];
+    bandState[0] = y;
+
+    float t = (float)(n / sampleRate);
+    float baseline = 1200.0f + 40.0f * std::sin(2.0f * PI * 0.2f * t);
+    float hum = 8.0f * std::sin(2.0f * PI * 50.0f * t);
+    n++;
+    return baseline + hum + 0.5f * envelope * y;
+}
+
+void SyntheticEMG::generate(float* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) out[i] = next();
+}
+
+void writeSyntheticCapture(const std::string& path, double seconds, double sampleRate,
+                           size_t samplesPerFrame, size_t readChunk, int readPeriodMs,
+                           double clockDriftPpm, int readJitterUs) {
+    SyntheticEMG gen(sampleRate);
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> jitter(0, std::max(0, readJitterUs));
+    const double deviceRate = sampleRate * (1.0 + clockDriftPpm * 1e-6);    // Частота в шкале хоста
+    RawCaptureWriter writer;
+    writer.open(path, "synthetic", 0, true);
+
+    const uint64_t totalSamples = (uint64_t)(seconds * sampleRate);
+    const int64_t periodNs = (int64_t)readPeriodMs * 1000000;
+    std::vector<float> frame(samplesPerFrame);
+    std::vector<uint8_t> wire;                    // Байты, отправленные датчиком, но ещё не прочитанные
+    uint32_t frameCounter = 0;
+    uint64_t produced = 0;
+    int64_t pollTimeNs = 0;
+
+    while (produced < totalSamples || !wire.empty()) {
+        pollTimeNs += periodNs;
+        int64_t readTimeNs = pollTimeNs + (int64_t)jitter(rng) * 1000;
+        // Всё, что датчик успел отправить к моменту чтения
+        uint64_t due = std::min<uint64_t>(totalSamples, (uint64_t)(readTimeNs * 1e-9 * deviceRate));
+        while (produced + samplesPerFrame <= due) {
+            gen.generate(frame.data(), samplesPerFrame);
+            encodeEmgFrame(frame.data(), samplesPerFrame, frameCounter++, wire);
+            produced += samplesPerFrame;
+        }
+        if (produced + samplesPerFrame > totalSamples) produced = totalSamples;
+
+        // Драйвер отдаёт не больше readChunk байт за один ReadFile
+        size_t offset = 0;
+        while (offset < wire.size()) {
+            size_t n = std::min(readChunk, wire.size() - offset);
+            writer.append(CAPTURE_RX, wire.data() + offset, n, readTimeNs);
+            offset += n;
+        }
+        wire.clear();
+    }
+    writer.close();
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+
+#include "DeviceProfile.h"
+
+/**
+ * @brief Генератор сигнала, похожего на ЭМГ: дрейф базовой линии, сетевая наводка 50 Гц
+ *        и шум с огибающей сокращений (покой ~20, сокращение ~300 единиц)
+ */
+class SyntheticEMG {
+private:
+    double sampleRate;
+    std::mt19937 rng;
+    std::normal_distribution<float> noise;
+    uint64_t n;              // Номер следующего сэмпла
+    float bandState[2];      // Полосовой фильтр для "мышечного" шума
+    float envelope;          // Текущая амплитуда
+    float target;            // Целевая амплитуда (покой / сокращение)
+    uint64_t nextSwitch;     // Когда сменится состояние мышцы
+
+public:
+    explicit SyntheticEMG(double sampleRate = DefaultEmgDevice::sampleRate, uint32_t seed = 1);
+
+    float next();
+    void generate(float* out, size_t count);
+};
+
+/**
+ * @brief Пишет файл захвата .emgcap с синтетическими EMG кадрами, нарезанными
+ *        на порции как при чтении COM-порта (до readChunk байт каждые readPeriodMs)
+ * @param clockDriftPpm Насколько часы датчика спешат относительно хоста
+ * @param readJitterUs Случайная добавка 0..readJitterUs к моменту каждого чтения
+ */
+void writeSyntheticCapture(const std::string& path, double seconds, double sampleRate = DefaultEmgDevice::sampleRate,
+                           size_t samplesPerFrame = DefaultEmgDevice::samplesPerFrame, size_t readChunk = 512, int readPeriodMs = 10,
+                           double clockDriftPpm = 0.0, int readJitterUs = 0);
@@ -0,0 +1,122 @@
+#include "Trace.h"
+
+#ifdef EMG_TRACE
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> traceEnabledFlag{false};
+
+struct TraceEvent {
+    const char* name;
+    int64_t startNs;
+    int64_t durationNs;
+};
+
+// Буфер одного потока: пишет только владелец, читает выгрузка
+struct TraceBuffer {
+    std::vector<TraceEvent> events;      // Кольцо фиксированного размера
+    std::atomic<uint64_t> written{0};    // Всего записано; позиция — written % size
+    unsigned tid = 0;
+    std::string threadName;              // Под traceMutex
+};
+
+static std::mutex traceMutex;
+static std::vector<std::unique_ptr<TraceBuffer>> traceBuffers;    // Живут до конца процесса: поток может завершиться раньше выгрузки
+static size_t traceEventsPerThread = TRACE_DEFAULT_EVENTS;
+static int64_t traceStartNs = 0;
+static thread_local TraceBuffer* localBuffer = nullptr;
+
+static TraceBuffer* threadBuffer() {
+    if (!localBuffer) {
+        std::lock_guard<std::mutex> lock(traceMutex);
+        traceBuffers.emplace_back(new TraceBuffer());
+        localBuffer = traceBuffers.back().get();
+        localBuffer->events.resize(traceEventsPerThread);
+        localBuffer->tid = (unsigned)traceBuffers.size();
+    }
+    return localBuffer;
+}
+
+static void appendEscaped(std::string& out, const char* s) {
+    for (; *s; ++s) {
+        char c = *s;
+        if (c == '"' || c == '\\') out += '\\';
+        if ((unsigned char)c < 0x20) continue;
+        out += c;
+    }
+}
+
+void traceEnable(size_t eventsPerThread) {
+    {
+        std::lock_guard<std::mutex> lock(traceMutex);
+        traceEventsPerThread = eventsPerThread > 0 ? eventsPerThread : 1;
+        traceStartNs = hostNowNs();
+    }
+    traceEnabledFlag.store(true, std::memory_order_relaxed);
+}
+
+void traceSetThreadName(const char* name) {
+    TraceBuffer* b = threadBuffer();
+    std::lock_guard<std::mutex> lock(traceMutex);
+    b->threadName = name;
+}
+
+void traceRecord(const char* name, int64_t startNs, int64_t endNs) {
+    TraceBuffer* b = threadBuffer();
+    uint64_t n = b->written.load(std::memory_order_relaxed);
+    b->events[n % b->events.size()] = TraceEvent{name, startNs, endNs - startNs};
+    b->written.store(n + 1, std::memory_order_release);
+}
+
+bool traceWriteJson(const std::string& path) {
+    if (!traceIsEnabled()) return false;
+    std::lock_guard<std::mutex> lock(traceMutex);
+
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    char line[160];
+    bool first = true;
+    auto separator = [&] {
+        if (!first) out += ",\n";
+        first = false;
+    };
+    for (const auto& b : traceBuffers) {
+        if (!b->threadName.empty()) {
+            separator();
+            std::snprintf(line, sizeof(line), "{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":\"", b->tid);
+            out += line;
+            appendEscaped(out, b->threadName.c_str());
+            out += "\"}}";
+        }
+
+        const uint64_t capacity = b->events.size();
+        uint64_t end = b->written.load(std::memory_order_acquire);
+        uint64_t begin = end > capacity ? end - capacity : 0;
+        std::vector<TraceEvent> copy;
+        copy.reserve((size_t)(end - begin));
+        for (uint64_t i = begin; i < end; ++i) copy.push_back(b->events[i % capacity]);
+        // Поток мог продолжать писать и затереть начало скопированного
+        uint64_t after = b->written.load(std::memory_order_acquire);
+        size_t skip = after > capacity && after - capacity > begin ? (size_t)(after - capacity - begin) : 0;
+
+        for (size_t i = skip; i < copy.size(); ++i) {
+            const TraceEvent& e = copy[i];
+            separator();
+            out += "{\"ph\":\"X\",\"pid\":1,\"name\":\"";
+            appendEscaped(out, e.name);
+            std::snprintf(line, sizeof(line), "\",\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", b->tid,
+                          (double)(e.startNs - traceStartNs) / 1e3, (double)e.durationNs / 1e3);
+            out += line;
+        }
+    }
+    out += "\n]}\n";
+
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = std::fwrite(out.data(), 1, out.size(), f) == out.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+#endif
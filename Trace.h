@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// ==== Трассировка этапов конвейера ====
+//
+// EMG_TRACE_SCOPE("имя") отмечает интервал от объявления до конца блока: чтение порта,
+// декодирование, фильтр, кадр ImGui, запись на диск. События пишутся в буфер своего потока
+// (кольцо, без блокировок; при переполнении остаются последние) и выгружаются в JSON
+// формата Chrome trace event — открывается в chrome://tracing и ui.perfetto.dev.
+//
+// Собирается только с определённым EMG_TRACE (CMake: -DEMG_TRACE=ON). Без него макрос
+// пустой, функции — пустые inline, в код не попадает ничего. Со сборкой, но без
+// traceEnable() каждая отметка — одно relaxed-чтение флага.
+//
+// Имена — строковые литералы: хранится только указатель.
+
+const size_t TRACE_DEFAULT_EVENTS = 1 << 18;    // Событий на поток (~6 МБ на поток)
+
+#ifdef EMG_TRACE
+
+#include <atomic>
+#include <cstdint>
+
+#include "HostClock.h"
+
+const bool TRACE_AVAILABLE = true;
+
+extern std::atomic<bool> traceEnabledFlag;
+
+/**
+ * @brief Начать запись событий. Вызывать до запуска потоков: размер буфера потока
+ *        фиксируется при его первом событии.
+ */
+void traceEnable(size_t eventsPerThread = TRACE_DEFAULT_EVENTS);
+
+inline bool traceIsEnabled() { return traceEnabledFlag.load(std::memory_order_relaxed); }
+
+// Имя текущего потока на шкале времени
+void traceSetThreadName(const char* name);
+
+void traceRecord(const char* name, int64_t startNs, int64_t endNs);
+
+/**
+ * @brief Записать все события в JSON. Вызывать после остановки пишущих потоков:
+ *        события, перезаписанные во время выгрузки, отбрасываются, но не ждутся.
+ * @return false — трассировка не включена или файл не записан
+ */
+bool traceWriteJson(const std::string& path);
+
+class TraceScope {
+private:
+    const char* name;
+    int64_t startNs;
+
+public:
+    explicit TraceScope(const char* name_) : name(name_), startNs(traceIsEnabled() ? hostNowNs() : 0) {}
+    ~TraceScope() {
+        if (startNs) traceRecord(name, startNs, hostNowNs());
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+#define EMG_TRACE_CONCAT_(a, b) a##b
+#define EMG_TRACE_CONCAT(a, b) EMG_TRACE_CONCAT_(a, b)
+#define EMG_TRACE_SCOPE(name) TraceScope EMG_TRACE_CONCAT(traceScope_, __LINE__)(name)
+
+#else
+
+const bool TRACE_AVAILABLE = false;
+
+inline void traceEnable(size_t = TRACE_DEFAULT_EVENTS) {}
+inline bool traceIsEnabled() { return false; }
+inline void traceSetThreadName(const char*) {}
+inline bool traceWriteJson(const std::string&) { return false; }
+
+#define EMG_TRACE_SCOPE(name) ((void)0)
+
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "HostClock.h"
+
+/**
+ * @brief Источник байтов датчика: COM-порт, файл захвата и т.д.
+ */
+class Transport {
+public:
+    virtual ~Transport() = default;
+
+    virtual void open() = 0;
+    virtual void close() = 0;
+
+    /**
+     * @brief Читает доступные байты (не более capacity)
+     * @return Количество прочитанных байт, 0 — данных нет (таймаут)
+     * @throws std::runtime_error Источник отвалился (порт отключён) — повторять бессмысленно
+     */
+    virtual size_t read(uint8_t* buf, size_t capacity) = 0;
+
+    virtual void write(const uint8_t* data, size_t size) = 0;
+
+    // Время прихода байт последнего read() по часам хоста (воспроизведение — время из захвата)
+    virtual int64_t readTimeNs() const { return hostNowNs(); }
+
+    // Сброс входного/выходного буфера драйвера
+    virtual void purge() {}
+
+    // Источник исчерпан (конец файла воспроизведения)
+    virtual bool isEnd() const { return false; }
+
+    virtual std::string name() const = 0;
+};
@@ -0,0 +1,392 @@
+#include "TriggeredCapture.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "HostClock.h"
+#include "Trace.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+static int closeSocket(socket_t s) { return closesocket(s); }
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+static int closeSocket(socket_t s) { return ::close(s); }
+#endif
+
+const char* triggerSourceName(TriggerSource source) {
+    switch (source) {
+        case TriggerSource::Manual: return "manual";
+        case TriggerSource::Command: return "command";
+        case TriggerSource::Threshold: return "threshold";
+    }
+    return "unknown";
+}
+
+// ==== TriggeredRecorder ====
+
+TriggeredRecorder::TriggeredRecorder()
+    : sampleRate(0.0),
+      ringHead(0),
+      ringFill(0),
+      streamSample(0),
+      preSamples(0),
+      postSamples(0),
+      armed(false),
+      eventIndex(0),
+      eventStart(0),
+      eventTrigger(0),
+      eventEnd(0),
+      eventTriggerNs(0),
+      eventSource(TriggerSource::Manual),
+      hasPending(false),
+      spareIndex(0),
+      stopping(false),
+      retryAtNs(0),
+      eventLog(nullptr),
+      nextIndex(1) {}
+
+TriggeredRecorder::~TriggeredRecorder() {
+    close();
+}
+
+void TriggeredRecorder::open(const TriggerOptions& options_, const RecordingInfo& info_) {
+    close();
+    if (info_.sampleRate <= 0.0 || info_.channelCount != 1)
+        throw std::invalid_argument("TriggeredRecorder: single channel with a positive sample rate");
+    if (options_.preSeconds < 0.0 || options_.postSeconds < 0.0)
+        throw std::invalid_argument("TriggeredRecorder: negative window");
+
+    const std::string logPath = options_.prefix + "_events.csv";
+    eventLog = std::fopen(logPath.c_str(), "a");
+    if (!eventLog) throw std::runtime_error("Cannot open " + logPath);
+    std::fseek(eventLog, 0, SEEK_END);
+    if (std::ftell(eventLog) == 0)
+        std::fprintf(eventLog, "event,file,source,trigger_sample,first_sample,samples,pre_samples,trigger_s\n");
+
+    options = options_;
+    info = info_;
+    info.sampleFormat = SAMPLE_FORMAT_F32;    // В кольце — готовые сэмплы, исходных кадров нет
+    sampleRate = info.sampleRate;
+    preSamples = (size_t)std::llround(options.preSeconds * sampleRate);
+    postSamples = (size_t)std::llround(options.postSeconds * sampleRate);
+
+    // Всё кольцо выделяется и затрагивается сразу: в потоке чтения ни аллокаций, ни page fault
+    ring.assign(std::max<size_t>(preSamples, 1), 0.0f);
+    ringTime.assign(ring.size(), 0);
+    ringHead = 0;
+    ringFill = 0;
+    streamSample = 0;
+    armed = false;    // Взводится, когда сигнал впервые ниже порога
+    eventIndex = 0;
+    nextIndex = 1;
+    stats = TriggerStats();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sharedStats = TriggerStats();
+        spare.reset();
+        finished.clear();
+        stopping = false;
+        retryAtNs = 0;
+    }
+    housekeeper = std::thread(&TriggeredRecorder::housekeeperLoop, this);
+}
+
+void TriggeredRecorder::close() {
+    if (!isOpen()) return;
+    if (stats.active) finishEvent();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_one();
+    housekeeper.join();
+
+    if (spare) {
+        // Заготовка следующего события без данных удаляется
+        const std::string path = spare->getPath();
+        spare->close();
+        std::remove(path.c_str());
+        spare.reset();
+    }
+    ring.clear();
+    ring.shrink_to_fit();
+    ringTime.clear();
+    ringTime.shrink_to_fit();
+    if (eventLog) std::fclose(eventLog);
+    eventLog = nullptr;
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.clear();
+    hasPending = false;
+}
+
+void TriggeredRecorder::trigger(TriggerSource source) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back(PendingTrigger{source, hostNowNs()});
+    hasPending.store(true, std::memory_order_release);
+}
+
+TriggerStats TriggeredRecorder::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return sharedStats;
+}
+
+void TriggeredRecorder::shareStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    // droppedBlocks и errors считает служебный поток
+    const uint64_t dropped = sharedStats.droppedBlocks;
+    const uint64_t errors = sharedStats.errors;
+    sharedStats = stats;
+    sharedStats.droppedBlocks = dropped;
+    sharedStats.errors = errors;
+}
+
+std::unique_ptr<RecordingWriter> TriggeredRecorder::prepareEvent(uint64_t index) {
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), "_%04llu.emgr", (unsigned long long)index);
+    AsyncWriterOptions writerOptions;
+    writerOptions.bufferBytes = 256 << 10;    // Событие — секунды сигнала
+    std::unique_ptr<RecordingWriter> next(new RecordingWriter());
+    next->open(options.prefix + suffix, info, writerOptions);
+    return next;
+}
+
+void TriggeredRecorder::fire(TriggerSource source, int64_t hostTimeNs) {
+    if (stats.active) {
+        eventEnd = std::max(eventEnd, streamSample + postSamples);
+        stats.retriggers++;
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (spare) {
+            writer = std::move(spare);
+            eventIndex = spareIndex;
+        }
+    }
+    if (!writer) {
+        // Не ждём: файл ещё создаётся или диск недоступен — событие пропускается
+        stats.missedEvents++;
+        shareStats();
+        return;
+    }
+    cv.notify_one();    // Служебный поток готовит файл следующего события
+    writer->markStart();
+
+    const size_t pre = std::min(preSamples, ringFill);
+    eventTrigger = streamSample;
+    eventStart = streamSample - pre;
+    eventEnd = streamSample + postSamples;
+    eventTriggerNs = hostTimeNs;
+    eventSource = source;
+
+    // Окно до триггера из кольца, порциями с одинаковым временем прихода
+    const size_t n = ring.size();
+    size_t pos = (ringHead + n - pre) % n;
+    for (size_t i = 0; i < pre;) {
+        size_t run = 1;
+        while (i + run < pre && pos + run < n && ringTime[pos + run] == ringTime[pos]) run++;
+        writer->append(&ring[pos], run, ringTime[pos]);
+        i += run;
+        pos = (pos + run) % n;
+    }
+    stats.samplesWritten += pre;
+    stats.events++;
+    stats.active = true;
+    if (postSamples == 0) finishEvent();
+    shareStats();
+}
+
+void TriggeredRecorder::finishEvent() {
+    stats.active = false;
+    {
+        // Файл закрывает и строку журнала пишет служебный поток
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.push_back(FinishedEvent{std::move(writer), eventIndex, eventSource, eventTrigger, eventStart});
+    }
+    cv.notify_one();
+    shareStats();
+}
+
+void TriggeredRecorder::housekeeperLoop() {
+    traceSetThreadName("events");
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        cv.wait_for(lock, std::chrono::seconds(1), [this] {
+            return stopping || !finished.empty() || (!spare && hostNowNs() >= retryAtNs);
+        });
+        if (!finished.empty()) {
+            FinishedEvent event = std::move(finished.front());
+            finished.pop_front();
+            lock.unlock();
+            const uint64_t dropped = closeEvent(event);
+            lock.lock();
+            sharedStats.droppedBlocks += dropped;
+            continue;
+        }
+        if (stopping) break;
+        if (!spare && hostNowNs() >= retryAtNs) {
+            lock.unlock();
+            std::unique_ptr<RecordingWriter> next;
+            try {
+                EMG_TRACE_SCOPE("event prepare");
+                next = prepareEvent(nextIndex);
+            } catch (const std::exception&) {
+                // Диск переполнен или каталог недоступен: триггеры пропускаются до следующей попытки
+            }
+            lock.lock();
+            if (next) {
+                spare = std::move(next);
+                spareIndex = nextIndex++;
+            } else {
+                sharedStats.errors++;
+                retryAtNs = hostNowNs() + 1000000000LL;
+            }
+        }
+    }
+}
+
+uint64_t TriggeredRecorder::closeEvent(FinishedEvent& event) {
+    EMG_TRACE_SCOPE("event close");
+    RecordingWriter& finishedWriter = *event.writer;
+    finishedWriter.close();
+    std::fprintf(eventLog, "%llu,%s,%s,%llu,%llu,%llu,%llu,%.6f\n", (unsigned long long)event.index,
+                 finishedWriter.getPath().c_str(), triggerSourceName(event.source),
+                 (unsigned long long)event.triggerSample, (unsigned long long)event.firstSample,
+                 (unsigned long long)finishedWriter.getTotalSamples(),
+                 (unsigned long long)(event.triggerSample - event.firstSample),
+                 (double)event.triggerSample / sampleRate);
+    std::fflush(eventLog);
+    const uint64_t dropped = finishedWriter.getDroppedBlocks();
+    event.writer.reset();
+    return dropped;
+}
+
+void TriggeredRecorder::consume(const float* samples, size_t count, int64_t hostTimeNs) {
+    if (count == 0) return;
+    if (stats.active) {
+        size_t n = (size_t)std::min<uint64_t>(count, eventEnd - streamSample);
+        writer->append(samples, n, hostTimeNs);
+        stats.samplesWritten += n;
+        if (streamSample + n >= eventEnd) finishEvent();
+    }
+
+    // В кольцо — не больше его размера с конца порции
+    const size_t n = ring.size();
+    size_t skip = count > n ? count - n : 0;
+    size_t left = count - skip;
+    samples += skip;
+    ringHead = (ringHead + skip) % n;
+    while (left > 0) {
+        size_t part = std::min(left, n - ringHead);
+        std::memcpy(&ring[ringHead], samples, part * sizeof(float));
+        std::fill(ringTime.begin() + ringHead, ringTime.begin() + ringHead + part, hostTimeNs);
+        ringHead = (ringHead + part) % n;
+        samples += part;
+        left -= part;
+    }
+    ringFill = std::min(n, ringFill + count);
+    streamSample += count;
+}
+
+// Индекс первого пересечения порога в порции или count
+size_t TriggeredRecorder::findCrossing(const float* samples, size_t count) {
+    if (options.threshold <= 0.0f) return count;
+    const float high = options.threshold;
+    const float low = options.threshold * options.rearmFraction;
+    for (size_t i = 0; i < count; ++i) {
+        float a = std::fabs(samples[i]);
+        if (armed) {
+            if (a >= high) {
+                armed = false;
+                return i;
+            }
+        } else if (a < low) {
+            armed = true;
+        }
+    }
+    return count;
+}
+
+void TriggeredRecorder::push(const float* samples, size_t count, int64_t hostTimeNs) {
+    if (!isOpen() || count == 0) return;
+
+    // Внешние триггеры — перед первым сэмплом порции
+    if (hasPending.load(std::memory_order_acquire)) {
+        std::vector<PendingTrigger> requests;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            requests.swap(pending);
+            hasPending = false;
+        }
+        for (const PendingTrigger& t : requests) fire(t.source, t.hostTimeNs);
+    }
+
+    size_t i = 0;
+    while (i < count) {
+        size_t next = i + findCrossing(samples + i, count - i);
+        consume(samples + i, next - i, hostTimeNs);
+        if (next == count) break;
+        fire(TriggerSource::Threshold, hostTimeNs);
+        i = next;
+    }
+    if (stats.active) shareStats();
+}
+
+// ==== TriggerSocket ====
+
+TriggerSocket::TriggerSocket() : socket(-1) {}
+
+TriggerSocket::~TriggerSocket() {
+    close();
+}
+
+void TriggerSocket::open(int port) {
+    close();
+#ifdef _WIN32
+    WSADATA data;
+    if (WSAStartup(MAKEWORD(2, 2), &data) != 0) throw std::runtime_error("WSAStartup failed");
+#endif
+    socket_t s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == (socket_t)-1) throw std::runtime_error("Cannot create UDP socket");
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);    // Команды только с этой машины
+    addr.sin_port = htons((uint16_t)port);
+    if (::bind(s, (const sockaddr*)&addr, sizeof(addr)) != 0) {
+        closeSocket(s);
+        throw std::runtime_error("Cannot bind trigger port " + std::to_string(port));
+    }
+#ifdef _WIN32
+    u_long on = 1;
+    ioctlsocket(s, FIONBIO, &on);
+#else
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    socket = (intptr_t)s;
+}
+
+void TriggerSocket::close() {
+    if (socket != -1) closeSocket((socket_t)socket);
+    socket = -1;
+}
+
+size_t TriggerSocket::poll() {
+    if (socket == -1) return 0;
+    size_t commands = 0;
+    char buf[256];
+    while (::recv((socket_t)socket, buf, sizeof(buf), 0) >= 0) commands++;
+    return commands;
+}
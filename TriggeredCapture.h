@@ -0,0 +1,162 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "RecordingFormat.h"
+
+// ==== Запись по событиям ====
+//
+// Последние preSeconds сигнала лежат в кольце, выделенном при open(). По триггеру в файл
+// prefix_NNNN.emgr уходят preSeconds до триггера и postSeconds после; триггер во время события
+// продлевает его. Каждое событие — строка в prefix_events.csv. Индексы сэмплов — в потоке,
+// переданном push(): порог привязан к сэмплу точно, внешний триггер (клавиша, команда) —
+// к первому сэмплу, пришедшему после него. Поток чтения не ждёт диск: файл следующего события
+// открывает заранее, а закрывает завершённые события и пишет строки журнала служебный поток.
+
+enum class TriggerSource {
+    Manual,       // Клавиша в GUI
+    Command,      // Строка в stdin или датаграмма на локальный порт
+    Threshold,    // Модуль сигнала достиг порога
+};
+
+const char* triggerSourceName(TriggerSource source);
+
+struct TriggerOptions {
+    std::string prefix = "event";     // Файлы prefix_0001.emgr ..., prefix_events.csv
+    double preSeconds = 2.0;
+    double postSeconds = 3.0;
+    float threshold = 0.0f;           // 0 — без порогового триггера
+    float rearmFraction = 0.5f;       // Порог снова взводится, когда |x| < threshold * rearmFraction
+};
+
+struct TriggerStats {
+    uint64_t events = 0;              // Начато событий
+    uint64_t retriggers = 0;          // Триггеров, продливших текущее событие
+    uint64_t samplesWritten = 0;
+    uint64_t droppedBlocks = 0;       // Блоков, не принятых писателем (RecordingWriter), в закрытых событиях
+    uint64_t missedEvents = 0;        // Триггеров, когда файл события ещё не был готов
+    uint64_t errors = 0;              // Сбои создания файлов событий
+    bool active = false;              // Сейчас пишется событие
+};
+
+/**
+ * @brief Запись окон вокруг событий. push() и close() — из одного потока (чтения датчика),
+ *        trigger() — из любого.
+ */
+class TriggeredRecorder {
+private:
+    TriggerOptions options;
+    RecordingInfo info;
+    double sampleRate;
+
+    // Кольцо последних сэмплов и времени их прихода
+    std::vector<float> ring;
+    std::vector<int64_t> ringTime;
+    size_t ringHead;                  // Куда пишется следующий сэмпл
+    size_t ringFill;
+    uint64_t streamSample;            // Индекс следующего сэмпла потока
+
+    size_t preSamples;
+    size_t postSamples;
+    bool armed;                       // Пороговый триггер взведён
+
+    std::unique_ptr<RecordingWriter> writer;    // Текущее событие
+    uint64_t eventIndex;
+    uint64_t eventStart;              // Индекс первого сэмпла события в потоке
+    uint64_t eventTrigger;
+    uint64_t eventEnd;                // Событие пишется до этого сэмпла (не включая)
+    int64_t eventTriggerNs;
+    TriggerSource eventSource;
+    TriggerStats stats;
+
+    struct PendingTrigger {
+        TriggerSource source;
+        int64_t hostTimeNs;
+    };
+
+    struct FinishedEvent {
+        std::unique_ptr<RecordingWriter> writer;
+        uint64_t index;
+        TriggerSource source;
+        uint64_t triggerSample;
+        uint64_t firstSample;
+    };
+
+    // Под mutex: внешние триггеры до ближайшего push(), копия stats для других потоков
+    // и обмен файлами со служебным потоком
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<PendingTrigger> pending;
+    std::atomic<bool> hasPending;
+    TriggerStats sharedStats;
+    std::unique_ptr<RecordingWriter> spare;    // Файл следующего события, открытый заранее
+    uint64_t spareIndex;
+    std::deque<FinishedEvent> finished;
+    bool stopping;
+    int64_t retryAtNs;                // Когда снова пробовать создать файл после сбоя
+
+    // Служебный поток
+    std::thread housekeeper;
+    std::FILE* eventLog;
+    uint64_t nextIndex;
+
+    std::unique_ptr<RecordingWriter> prepareEvent(uint64_t index);
+    void housekeeperLoop();
+    uint64_t closeEvent(FinishedEvent& event);    // Закрывает файл и пишет строку журнала
+
+    void fire(TriggerSource source, int64_t hostTimeNs);    // В позиции streamSample
+    void finishEvent();
+    void consume(const float* samples, size_t count, int64_t hostTimeNs);
+    size_t findCrossing(const float* samples, size_t count);
+    void shareStats();
+
+public:
+    TriggeredRecorder();
+    ~TriggeredRecorder();
+
+    TriggeredRecorder(const TriggeredRecorder&) = delete;
+    TriggeredRecorder& operator=(const TriggeredRecorder&) = delete;
+
+    void open(const TriggerOptions& options, const RecordingInfo& info);
+    // Дописывает текущее событие (сколько успело прийти после триггера)
+    void close();
+
+    void push(const float* samples, size_t count, int64_t hostTimeNs);
+    void trigger(TriggerSource source);
+
+    bool isOpen() const { return !ring.empty(); }
+    TriggerStats getStats();
+};
+
+/**
+ * @brief Команды триггера по UDP на 127.0.0.1:port: любая датаграмма — триггер
+ *        (например, echo t | nc -u -w0 127.0.0.1 PORT)
+ */
+class TriggerSocket {
+private:
+    intptr_t socket;
+
+public:
+    TriggerSocket();
+    ~TriggerSocket();
+
+    TriggerSocket(const TriggerSocket&) = delete;
+    TriggerSocket& operator=(const TriggerSocket&) = delete;
+
+    void open(int port);
+    void close();
+
+    // Не блокирует: количество принятых команд
+    size_t poll();
+
+    bool isOpen() const { return socket != -1; }
+};
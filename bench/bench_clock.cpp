@@ -0,0 +1,76 @@
+// Бенчмарк ClockSync: синтетический захват с уходом часов датчика и дрожанием чтений,
+// ошибка времени сэмплов по модели против "индекс / частота" и "время прихода".
+// Использование: BenchClock [дрейф ppm] [дрожание мкс] [секунды]
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "HostClock.h"
+#include "RawCapture.h"
+#include "SensorEMG.h"
+#include "SyntheticEMG.h"
+
+const double SAMPLE_RATE = 500.0;
+
+struct ErrorStats {
+    std::vector<double> values;
+
+    void add(double errorNs) { values.push_back(std::fabs(errorNs)); }
+
+    void print(const char* name) {
+        std::sort(values.begin(), values.end());
+        auto at = [this](double q) { return values[(size_t)(q * (double)(values.size() - 1))] / 1e6; };
+        std::printf("  %-24s p50 %8.3f ms | p99 %8.3f ms | max %8.3f ms\n", name, at(0.5), at(0.99), at(1.0));
+    }
+};
+
+int main(int argc, char** argv) {
+    double driftPpm = argc > 1 ? std::atof(argv[1]) : 75.0;
+    int jitterUs = argc > 2 ? std::atoi(argv[2]) : 4000;
+    double seconds = argc > 3 ? std::atof(argv[3]) : 3600.0;
+    const std::string path = "bench_clock.emgcap";
+    writeSyntheticCapture(path, seconds, SAMPLE_RATE, 16, 512, 10, driftPpm, jitterUs);
+
+    SensorEMG sensor{std::make_unique<ReplayTransport>(path, 0.0), SAMPLE_RATE};
+    sensor.connect();
+
+    // Сэмпл k готов к отправке в момент (k + 1) / (частота * (1 + дрейф)) по часам хоста захвата
+    const double truePeriodNs = 1e9 / (SAMPLE_RATE * (1.0 + driftPpm * 1e-6));
+    const double nominalPeriodNs = 1e9 / SAMPLE_RATE;
+    const uint64_t warmupSamples = (uint64_t)(60.0 * SAMPLE_RATE);    // Первая минута — окно модели ещё заполняется
+
+    ErrorStats model, byIndex, byArrival;
+    std::vector<int64_t> times;
+    uint64_t sample = 0;
+    int64_t t0 = hostNowNs();
+    while (!sensor.isFinished()) {
+        std::vector<float> samples = sensor.pollData();
+        if (samples.empty()) continue;
+        sensor.getSampleTimes(times);
+        const int64_t arrival = sensor.getLastBlock().hostTimeNs;
+        for (size_t i = 0; i < samples.size(); ++i, ++sample) {
+            if (sample < warmupSamples) continue;
+            double truth = (double)(sample + 1) * truePeriodNs;
+            model.add((double)times[i] - truth);
+            byIndex.add((double)(sample + 1) * nominalPeriodNs - truth);
+            // Последний сэмпл порции — момент прихода, остальные — назад с номинальным периодом
+            byArrival.add((double)arrival - (double)(samples.size() - 1 - i) * nominalPeriodNs - truth);
+        }
+    }
+    double wall = (double)(hostNowNs() - t0) / 1e9;
+
+    const ClockSyncStats& stats = sensor.getClockSync().getStats();
+    std::printf("%.0f s @ %.0f Hz, true drift %+.1f ppm, read jitter 0..%d us; replay + sync %.2f s\n",
+                seconds, SAMPLE_RATE, driftPpm, jitterUs, wall);
+    std::printf("estimated drift %+.2f ppm, rate %.5f Hz, jitter rms %.3f ms, latency spread %.3f ms, %zu points\n",
+                stats.driftPpm, stats.rateHz, stats.jitterRmsNs / 1e6, stats.latencySpreadNs / 1e6, stats.points);
+    std::printf("per-sample timestamp error after the first minute:\n");
+    model.print("ClockSync");
+    byIndex.print("index / nominal rate");
+    byArrival.print("arrival time");
+    return 0;
+}
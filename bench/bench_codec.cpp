@@ -0,0 +1,102 @@
+// Бенчмарк DeltaCodec на синтетическом сигнале: степень сжатия и скорость кодирования/декодирования.
+// Использование: BenchCodec [часы] [сэмплов в кадре]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "DeltaCodec.h"
+#include "FrameDecoder.h"
+#include "SyntheticEMG.h"
+
+const double SAMPLE_RATE = 500.0;
+const size_t BLOCK_SAMPLES = 1024;
+
+static double secondsSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+    double hours = argc > 1 ? std::atof(argv[1]) : 10.0;
+    size_t samplesPerFrame = argc > 2 ? (size_t)std::atoi(argv[2]) : 16;
+    size_t total = (size_t)(hours * 3600.0 * SAMPLE_RATE);
+    total -= total % samplesPerFrame;
+
+    // Сигнал -> кадры на проводе -> FrameDecoder: эталонные float и исходные кадры
+    SyntheticEMG generator(SAMPLE_RATE);
+    std::vector<float> signal(total);
+    generator.generate(signal.data(), total);
+
+    std::vector<uint8_t> wire;
+    for (size_t i = 0; i < total; i += samplesPerFrame)
+        encodeEmgFrame(&signal[i], samplesPerFrame, (uint32_t)(i / samplesPerFrame), wire);
+
+    FrameDecoder decoder;
+    NativeFrames frames;
+    std::vector<float> reference;
+    reference.reserve(total);
+    decoder.feed(wire.data(), wire.size(), reference, &frames);
+
+    // Блоки из целых кадров, как их режет RecordingWriter
+    std::vector<NativeFrames> blocks;
+    {
+        NativeFrames one, pending;
+        size_t d = 0;
+        for (size_t f = 0; f < frames.frameCount(); ++f) {
+            one.clear();
+            one.appendFrame(frames.metadata[f], frames.base[f], &frames.diffs[d], frames.diffCount[f]);
+            d += frames.diffCount[f];
+            pending.append(one);
+            if (pending.sampleCount() >= BLOCK_SAMPLES) {
+                blocks.push_back(pending);
+                pending.clear();
+            }
+        }
+        if (pending.frameCount() > 0) blocks.push_back(pending);
+    }
+
+    std::vector<uint8_t> encoded;
+    std::vector<size_t> offsets;
+    encoded.reserve(total * 2);
+    auto t0 = std::chrono::steady_clock::now();
+    for (const NativeFrames& block : blocks) {
+        offsets.push_back(encoded.size());
+        encodeDeltaBlock(block, encoded);
+    }
+    double encodeSec = secondsSince(t0);
+    offsets.push_back(encoded.size());
+
+    std::vector<float> decoded(total);
+    t0 = std::chrono::steady_clock::now();
+    size_t n = 0;
+    for (size_t b = 0; b + 1 < offsets.size(); ++b)
+        n += decodeDeltaBlockSamples(&encoded[offsets[b]], offsets[b+1] - offsets[b], &decoded[n], total - n);
+    double decodeSec = secondsSince(t0);
+
+    NativeFrames restored;
+    t0 = std::chrono::steady_clock::now();
+    for (size_t b = 0; b + 1 < offsets.size(); ++b)
+        decodeDeltaBlock(&encoded[offsets[b]], offsets[b+1] - offsets[b], restored);
+    double decodeFramesSec = secondsSince(t0);
+
+    bool samplesExact = n == reference.size() &&
+        std::memcmp(decoded.data(), reference.data(), n * sizeof(float)) == 0;
+    bool framesExact = restored.metadata == frames.metadata && restored.diffCount == frames.diffCount &&
+        restored.diffs == frames.diffs &&
+        std::memcmp(restored.base.data(), frames.base.data(), frames.base.size() * sizeof(float)) == 0;
+
+    const double MB = 1024.0 * 1024.0;
+    double floatBytes = (double)total * sizeof(float);
+    double rawMB = floatBytes / MB;
+    std::printf("signal: %.1f h @ %.0f Hz, %zu samples, %zu samples/frame, %zu blocks\n",
+                hours, SAMPLE_RATE, total, samplesPerFrame, blocks.size());
+    std::printf("float32 %.2f MB | wire %.2f MB | delta %.2f MB (%.2f bits/sample)\n",
+                rawMB, wire.size() / MB, encoded.size() / MB, encoded.size() * 8.0 / total);
+    std::printf("ratio: %.2fx vs float32, %.2fx vs wire\n",
+                floatBytes / encoded.size(), (double)wire.size() / encoded.size());
+    std::printf("encode %.0f MB/s, decode -> float %.0f MB/s, decode -> frames %.0f MB/s (float32 equivalent)\n",
+                rawMB / encodeSec, rawMB / decodeSec, rawMB / decodeFramesSec);
+    std::printf("bit-exact: samples %s, frames %s\n", samplesExact ? "yes" : "NO", framesExact ? "yes" : "NO");
+    return samplesExact && framesExact ? 0 : 1;
+}
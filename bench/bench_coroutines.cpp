@@ -0,0 +1,125 @@
+// Бенчмарк задержки пробуждения потребителей порций: поток на потребителя с опросом и sleep 1 мс
+// (как emg_thread) против корутин на EmgExecutor (AsyncAcquisition.h). Издатель выпускает порцию
+// каждые PERIOD_MS; задержка — от публикации до того, как потребитель держит порцию в руках.
+// Считаются p50/p99/max задержки и процессорное время процесса.
+// Использование: BenchCoroutines [порций] [потоков исполнителя]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+#include "AsyncAcquisition.h"
+#include "HostClock.h"
+
+const int PERIOD_MS = 5;
+const size_t CONSUMER_COUNTS[] = {1, 100, 500};
+
+struct RunResult {
+    std::vector<int64_t> latencyNs;
+    double cpuSeconds;
+    double wallSeconds;
+};
+
+// Издатель в своём потоке: каждые PERIOD_MS порция с моментом публикации в timing.hostTimeNs
+template <class Publish>
+static void produce(SampleBlockPool& pool, size_t blocks, Publish publish) {
+    auto next = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < blocks; ++i) {
+        next += std::chrono::milliseconds(PERIOD_MS);
+        std::this_thread::sleep_until(next);
+        SampleBlockRef block = pool.acquire();
+        block->extend(16);
+        block->firstSample = i * 16;
+        block->timing.hostTimeNs = hostNowNs();
+        publish(std::move(block));
+    }
+}
+
+static RunResult runThreads(size_t consumers, size_t blocks) {
+    std::vector<int64_t> stamps(blocks);
+    std::atomic<size_t> published(0);
+    std::vector<std::vector<int64_t>> latency(consumers);
+
+    const std::clock_t c0 = std::clock();
+    const int64_t t0 = hostNowNs();
+    std::vector<std::thread> threads;
+    for (size_t c = 0; c < consumers; ++c) {
+        threads.emplace_back([&, c] {
+            latency[c].reserve(blocks);
+            size_t seen = 0;
+            while (seen < blocks) {
+                size_t n = published.load(std::memory_order_acquire);
+                if (seen == n) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    continue;
+                }
+                const int64_t now = hostNowNs();
+                for (; seen < n; ++seen) latency[c].push_back(now - stamps[seen]);
+            }
+        });
+    }
+    SampleBlockPool pool(1, 64, 64);
+    produce(pool, blocks, [&](SampleBlockRef block) {
+        const size_t i = published.load(std::memory_order_relaxed);
+        stamps[i] = block->timing.hostTimeNs;
+        published.store(i + 1, std::memory_order_release);
+    });
+    for (std::thread& t : threads) t.join();
+
+    RunResult r;
+    r.cpuSeconds = (double)(std::clock() - c0) / CLOCKS_PER_SEC;
+    r.wallSeconds = (hostNowNs() - t0) / 1e9;
+    for (const std::vector<int64_t>& v : latency) r.latencyNs.insert(r.latencyNs.end(), v.begin(), v.end());
+    return r;
+}
+
+static EmgTask consume(BlockSubscription sub, std::vector<int64_t>& latency) {
+    while (SampleBlockRef block = co_await sub.nextBlock()) latency.push_back(hostNowNs() - block->timing.hostTimeNs);
+}
+
+static RunResult runCoroutines(size_t consumers, size_t blocks, unsigned executorThreads) {
+    std::vector<std::vector<int64_t>> latency(consumers);
+    for (std::vector<int64_t>& v : latency) v.reserve(blocks);
+
+    const std::clock_t c0 = std::clock();
+    const int64_t t0 = hostNowNs();
+    SampleBlockPool pool(1, 64, 128);    // Переживает поток порций: в его кольце остаются ссылки
+    {
+        EmgExecutor executor(executorThreads);
+        BlockStream stream(executor, 64);
+        for (size_t c = 0; c < consumers; ++c) executor.spawn(consume(stream.subscribe(), latency[c]));
+        produce(pool, blocks, [&](SampleBlockRef block) { stream.publish(std::move(block)); });
+        stream.close();
+        executor.waitIdle();
+    }
+
+    RunResult r;
+    r.cpuSeconds = (double)(std::clock() - c0) / CLOCKS_PER_SEC;
+    r.wallSeconds = (hostNowNs() - t0) / 1e9;
+    for (const std::vector<int64_t>& v : latency) r.latencyNs.insert(r.latencyNs.end(), v.begin(), v.end());
+    return r;
+}
+
+static void report(const char* name, RunResult r, size_t expected) {
+    std::sort(r.latencyNs.begin(), r.latencyNs.end());
+    auto q = [&](double p) { return r.latencyNs[std::min(r.latencyNs.size() - 1, (size_t)(p * r.latencyNs.size()))] / 1e3; };
+    std::printf("  %-24s p50 %8.1f us  p99 %8.1f us  max %8.1f us  cpu %5.1f%%  (%zu/%zu delivered)\n", name, q(0.5),
+                q(0.99), r.latencyNs.back() / 1e3, 100.0 * r.cpuSeconds / r.wallSeconds, r.latencyNs.size(), expected);
+}
+
+int main(int argc, char** argv) {
+    const size_t blocks = argc > 1 ? (size_t)std::atoi(argv[1]) : 400;
+    const unsigned executorThreads = argc > 2 ? (unsigned)std::atoi(argv[2]) : 1;
+    std::printf("%zu blocks every %d ms, executor threads %u, %u cores\n", blocks, PERIOD_MS, executorThreads,
+                std::thread::hardware_concurrency());
+    for (size_t consumers : CONSUMER_COUNTS) {
+        std::printf(" %zu consumers\n", consumers);
+        report("thread + sleep(1 ms)", runThreads(consumers, blocks), consumers * blocks);
+        report("coroutines", runCoroutines(consumers, blocks, executorThreads), consumers * blocks);
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+// Бенчмарк разбора старых CSV (example.csv: заголовок "COM", по отсчёту в строке):
+// std::ifstream >> float, как в прежних скриптах, против MappedFile + std::from_chars (CsvIngest.h)
+// в одном и нескольких потоках. Каталог из множества коротких файлов и один длинный файл.
+// Использование: BenchCsvIngest [файлов] [секунд в файле] [секунд в длинном файле]
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CsvIngest.h"
+#include "HostClock.h"
+#include "MappedFile.h"
+#include "SyntheticEMG.h"
+
+namespace fs = std::filesystem;
+
+const double SAMPLE_RATE = 500.0;
+
+// Отсчёты целые, как у main_src.cpp
+static void writeCsv(const std::string& path, double seconds, uint32_t seed) {
+    SyntheticEMG gen(SAMPLE_RATE, seed);
+    std::FILE* f = std::fopen(path.c_str(), "w");
+    std::fputs("COM\n", f);
+    for (size_t i = 0; i < (size_t)(seconds * SAMPLE_RATE); ++i) std::fprintf(f, "%ld\n", std::lround(gen.next()));
+    std::fclose(f);
+}
+
+static double iostreamSum(const std::string& path, uint64_t& samples) {
+    std::ifstream in(path);
+    std::string header;
+    std::getline(in, header);
+    double sum = 0.0;
+    float x;
+    while (in >> x) {
+        sum += x;
+        samples++;
+    }
+    return sum;
+}
+
+static void report(const char* name, int64_t ns, uint64_t bytes, size_t files, uint64_t samples) {
+    const double s = ns / 1e9;
+    std::printf("  %-28s %8.1f ms  %8.1f files/s  %6.3f GB/s  %7.1f Msamples/s  (%llu samples)\n", name, ns / 1e6,
+                files / s, bytes / 1e9 / s, samples / 1e6 / s, (unsigned long long)samples);
+}
+
+int main(int argc, char** argv) {
+    const size_t fileCount = argc > 1 ? (size_t)std::atoi(argv[1]) : 400;
+    const double fileSeconds = argc > 2 ? std::atof(argv[2]) : 120.0;
+    const double longSeconds = argc > 3 ? std::atof(argv[3]) : 4 * 3600.0;
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> threadCounts = {1};
+    if (cores > 1) threadCounts.push_back(cores);
+
+    const fs::path dir = "bench_csv_ingest";
+    fs::create_directories(dir / "long");
+    std::vector<std::string> files;
+    for (size_t i = 0; i < fileCount; ++i) {
+        fs::create_directories(dir / std::to_string(i));
+        files.push_back((dir / std::to_string(i) / "example.csv").string());
+        writeCsv(files.back(), fileSeconds, (uint32_t)i + 1);
+    }
+    const std::string longFile = (dir / "long" / "example.csv").string();
+    writeCsv(longFile, longSeconds, 7);
+
+    uint64_t bytes = 0;
+    for (const std::string& f : files) bytes += fs::file_size(f);
+    std::printf("%zu files x %.0f s, %.1f MB; %u cores\n", fileCount, fileSeconds, bytes / 1e6, cores);
+
+    uint64_t samples = 0;
+    int64_t t0 = hostNowNs();
+    for (const std::string& f : files) iostreamSum(f, samples);
+    report("ifstream >> float", hostNowNs() - t0, bytes, files.size(), samples);
+
+    for (unsigned threads : threadCounts) {
+        CsvBatchOptions options;
+        options.threads = threads;
+        CsvBatchStats stats;
+        ingestCsvFiles(files, options, stats);
+        std::string name = "from_chars + features, " + std::to_string(threads) + "t";
+        report(name.c_str(), stats.elapsedNs, stats.bytes, stats.files, stats.samples);
+    }
+
+    const uint64_t longBytes = fs::file_size(longFile);
+    std::printf("1 file x %.0f s, %.1f MB\n", longSeconds, longBytes / 1e6);
+    samples = 0;
+    t0 = hostNowNs();
+    iostreamSum(longFile, samples);
+    report("ifstream >> float", hostNowNs() - t0, longBytes, 1, samples);
+
+    std::vector<float> values;
+    for (unsigned threads : threadCounts) {
+        values.clear();
+        t0 = hostNowNs();
+        MappedFile file(longFile);
+        parseCsvColumn(reinterpret_cast<const char*>(file.data()), file.size(), values, threads);
+        std::string name = "mmap + from_chars, " + std::to_string(threads) + "t";
+        report(name.c_str(), hostNowNs() - t0, longBytes, 1, values.size());
+    }
+
+    fs::remove_all(dir);
+    return 0;
+}
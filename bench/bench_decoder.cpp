@@ -0,0 +1,126 @@
+// Бенчмарк декодера кадров: общий путь (FrameDecoder) против специализированного профилем
+// устройства (BasicFrameDecoder<DefaultEmgDevice>). Поток режется на порции по 512 байт, как
+// чтения COM-порта. Проверяется, что сэмплы, исходные кадры и счётчики совпадают побитово.
+// Использование: BenchDecoder [минут сигнала] [повторов]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "FrameDecoder.h"
+#include "SyntheticEMG.h"
+
+const size_t READ_CHUNK = 512;
+
+static double secondsSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+/**
+ * @param otherEvery Каждый otherEvery-й кадр — другой длины и с мусором перед ним (0 — нет)
+ */
+static std::vector<uint8_t> makeWire(double minutes, size_t otherEvery, size_t& samples) {
+    SyntheticEMG generator(DefaultEmgDevice::sampleRate);
+    std::mt19937 rng(7);
+    std::vector<uint8_t> wire;
+    std::vector<float> frame(64);
+    const size_t total = (size_t)(minutes * 60.0 * DefaultEmgDevice::sampleRate);
+    samples = 0;
+    for (uint32_t f = 0; samples < total; ++f) {
+        size_t count = DefaultEmgDevice::samplesPerFrame;
+        if (otherEvery > 0 && f % otherEvery == otherEvery - 1) {
+            count = 4 + rng() % 40;
+            for (size_t i = rng() % 8; i > 0; --i) wire.push_back((uint8_t)rng());
+        }
+        generator.generate(frame.data(), count);
+        encodeEmgFrame(frame.data(), count, f, wire);
+        samples += count;
+    }
+    return wire;
+}
+
+struct RunResult {
+    double seconds = 1e30;    // Лучший из повторов
+    std::vector<float> samples;
+    NativeFrames frames;
+    uint64_t counters[5] = {};
+};
+
+template <class Decoder>
+static RunResult run(const std::vector<uint8_t>& wire, size_t samples, bool withFrames, int repeats) {
+    RunResult r;
+    for (int rep = 0; rep <= repeats; ++rep) {    // Нулевой проход — прогрев, не замеряется
+        Decoder decoder;
+        std::vector<float> out;
+        NativeFrames frames;
+        std::vector<float> chunkOut;
+        // Замеряется декодер, а не рост накопителей
+        out.reserve(samples);
+        frames.metadata.reserve(samples);
+        frames.base.reserve(samples);
+        frames.diffCount.reserve(samples);
+        frames.diffs.reserve(samples);
+        chunkOut.reserve(READ_CHUNK);
+        auto t0 = std::chrono::steady_clock::now();
+        // Как SensorEMG::pollData(): каждое чтение — свой вектор сэмплов
+        for (size_t pos = 0; pos < wire.size(); pos += READ_CHUNK) {
+            chunkOut.clear();
+            decoder.feed(wire.data() + pos, std::min(READ_CHUNK, wire.size() - pos), chunkOut,
+                         withFrames ? &frames : nullptr);
+            out.insert(out.end(), chunkOut.begin(), chunkOut.end());
+        }
+        if (rep > 0) r.seconds = std::min(r.seconds, secondsSince(t0));
+        if (rep == 0) {
+            r.samples.swap(out);
+            r.frames = frames;
+            r.counters[0] = decoder.getFrameCount();
+            r.counters[1] = decoder.getOtherFrames();
+            r.counters[2] = decoder.getSkippedBytes();
+            r.counters[3] = decoder.getHeaderErrors();
+            r.counters[4] = decoder.getTrailerErrors();
+        }
+    }
+    return r;
+}
+
+static bool sameFrames(const NativeFrames& a, const NativeFrames& b) {
+    return a.metadata == b.metadata && a.diffCount == b.diffCount && a.diffs == b.diffs &&
+           a.base.size() == b.base.size() &&
+           std::memcmp(a.base.data(), b.base.data(), a.base.size() * sizeof(float)) == 0;
+}
+
+static void compare(const char* title, const std::vector<uint8_t>& wire, size_t samples, bool withFrames, int repeats) {
+    RunResult generic = run<FrameDecoder>(wire, samples, withFrames, repeats);
+    RunResult fixed = run<BasicFrameDecoder<DefaultEmgDevice>>(wire, samples, withFrames, repeats);
+
+    bool same = generic.samples.size() == fixed.samples.size() &&
+                std::memcmp(generic.samples.data(), fixed.samples.data(), generic.samples.size() * sizeof(float)) == 0 &&
+                sameFrames(generic.frames, fixed.frames) &&
+                std::equal(generic.counters, generic.counters + 5, fixed.counters);
+    const double mb = (double)wire.size() / 1e6;
+    std::printf("  %-28s generic %6.2f ns/sample (%6.0f MB/s) | profile %6.2f ns/sample (%6.0f MB/s) | x%.2f | %s\n",
+                title, generic.seconds * 1e9 / (double)samples, mb / generic.seconds,
+                fixed.seconds * 1e9 / (double)samples, mb / fixed.seconds, generic.seconds / fixed.seconds,
+                same ? "identical" : "MISMATCH");
+}
+
+int main(int argc, char** argv) {
+    double minutes = argc > 1 ? std::atof(argv[1]) : 10.0;
+    int repeats = argc > 2 ? std::atoi(argv[2]) : 31;
+
+    size_t samples = 0;
+    std::vector<uint8_t> clean = makeWire(minutes, 0, samples);
+    std::printf("%.0f min @ %.0f Hz, %u samples/frame, %.1f MB, best of %d\n", minutes, DefaultEmgDevice::sampleRate,
+                DefaultEmgDevice::samplesPerFrame, (double)clean.size() / 1e6, repeats);
+    compare("expected frames", clean, samples, false, repeats);
+    compare("expected frames + native", clean, samples, true, repeats);
+
+    size_t mixedSamples = 0;
+    std::vector<uint8_t> mixed = makeWire(minutes, 10, mixedSamples);
+    compare("10% other length + noise", mixed, mixedSamples, false, repeats);
+    compare("  + native", mixed, mixedSamples, true, repeats);
+    return 0;
+}
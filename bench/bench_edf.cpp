@@ -0,0 +1,112 @@
+// Бенчмарк EdfWriter: много каналов на высокой частоте, EDF+ и BDF+, с проверкой чтением обратно.
+// Использование: BenchEdf [каналы] [частота] [секунды]
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "EdfWriter.h"
+#include "HostClock.h"
+#include "SyntheticEMG.h"
+
+// Поле заголовка EDF как число
+static double headerNumber(const std::string& header, size_t offset, size_t width) {
+    return std::atof(header.substr(offset, width).c_str());
+}
+
+static bool verify(const std::string& path, const EdfInfo& info, const std::vector<float>& channel0, size_t total,
+                   uint64_t expectedRecords) {
+    std::ifstream file(path, std::ios::binary);
+    std::string header(256, '\0');
+    file.read(&header[0], 256);
+    size_t signals = (size_t)headerNumber(header, 252, 4);
+    size_t headerBytes = (size_t)headerNumber(header, 184, 8);
+    uint64_t records = (uint64_t)headerNumber(header, 236, 8);
+    header.resize(headerBytes);
+    file.read(&header[256], (std::streamsize)(headerBytes - 256));
+
+    auto signalField = [&](size_t fieldOffset, size_t width, size_t s) {
+        return headerNumber(header, 256 + fieldOffset * signals + width * s, width);
+    };
+    double physMin = signalField(104, 8, 0), physMax = signalField(112, 8, 0);
+    double digMin = signalField(120, 8, 0), digMax = signalField(128, 8, 0);
+    size_t perRecord = (size_t)signalField(216, 8, 0);
+    double gain = (physMax - physMin) / (digMax - digMin);
+    size_t bps = info.format == EdfFormat::Bdf ? 3 : 2;
+
+    size_t recordBytes = 0;
+    for (size_t s = 0; s < signals; ++s) recordBytes += (size_t)signalField(216, 8, s) * bps;
+    std::vector<uint8_t> record(recordBytes);
+    double maxError = 0.0;
+    size_t checked = 0;
+    for (uint64_t r = 0; r < records && checked < total; ++r) {
+        file.read(reinterpret_cast<char*>(record.data()), (std::streamsize)recordBytes);
+        for (size_t i = 0; i < perRecord && checked < total; ++i, ++checked) {
+            const uint8_t* p = &record[i * bps];
+            int32_t d = bps == 3 ? (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24) >> 8
+                                 : (int16_t)(p[0] | p[1] << 8);
+            double phys = (d - digMin) * gain + physMin;
+            maxError = std::max(maxError, std::fabs(phys - channel0[checked]));
+        }
+    }
+    bool ok = signals == info.channels.size() + 1 && records == expectedRecords && checked == total &&
+              maxError <= 0.5 / info.scaleFactor + 1e-4;
+    std::printf("  read back: %zu signals, %llu records, gain 1/%.6f, max |error| %.4f (half LSB %.4f) -> %s\n",
+                signals, (unsigned long long)records, 1.0 / gain, maxError, 0.5 / info.scaleFactor, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    size_t channels = argc > 1 ? (size_t)std::atoi(argv[1]) : 32;
+    double rate = argc > 2 ? std::atof(argv[2]) : 2000.0;
+    double seconds = argc > 3 ? std::atof(argv[3]) : 600.0;
+    const size_t total = (size_t)(rate * seconds);
+    const size_t chunk = (size_t)(rate / 100.0);    // Порция как от датчика каждые 10 мс
+
+    SyntheticEMG generator(rate);
+    std::vector<float> channel0(total);
+    generator.generate(channel0.data(), total);
+    // Остальные каналы — сдвинутые копии, генерация не входит в замер
+    std::vector<float> interleaved(total * channels);
+    for (size_t i = 0; i < total; ++i)
+        for (size_t ch = 0; ch < channels; ++ch) interleaved[i * channels + ch] = channel0[(i + ch * 997) % total];
+
+    bool ok = true;
+    for (EdfFormat format : {EdfFormat::Edf, EdfFormat::Bdf}) {
+        const bool bdf = format == EdfFormat::Bdf;
+        const std::string path = bdf ? "bench_edf.bdf" : "bench_edf.edf";
+        EdfInfo info;
+        info.format = format;
+        info.sampleRate = rate;
+        for (size_t ch = 0; ch < channels; ++ch) {
+            EdfChannel c;
+            c.label = "EMG" + std::to_string(ch + 1);
+            info.channels.push_back(c);
+        }
+
+        EdfWriter writer;
+        writer.open(path, info, AsyncWriterOptions(), true);    // Быстрее реального времени: без отбрасывания
+        int64_t t0 = hostNowNs();
+        for (size_t i = 0; i < total; i += chunk) {
+            size_t n = std::min(chunk, total - i);
+            writer.append(&interleaved[i * channels], n);
+            if (i % (size_t)(rate * 10) == 0) writer.annotate(writer.getElapsedSeconds(), 0, "Marker");
+        }
+        writer.appendGap((size_t)rate / 2);
+        int64_t t1 = hostNowNs();
+        uint64_t records = writer.getRecordCount();
+        writer.close();
+        int64_t t2 = hostNowNs();
+        records = writer.getRecordCount();
+
+        double appendSec = (double)(t1 - t0) / 1e9;
+        double samples = (double)total * channels;
+        std::printf("%s: %zu ch x %.0f Hz x %.0f s: append %.2f ns/sample, %.0fx realtime, close %.1f ms\n",
+                    bdf ? "BDF+" : "EDF+", channels, rate, seconds, appendSec * 1e9 / samples,
+                    seconds / appendSec, (double)(t2 - t1) / 1e6);
+        ok = verify(path, info, channel0, total, records) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+// Бенчмарк живого графика: время подготовки кадра и число вершин для окон 10/60/600 с.
+// Кадр 60 Гц: приход 1/60 с сэмплов в два канала (сырой и фильтрованный) + вершины для PlotLine.
+// Сравнение: прежняя схема (vector с erase(begin) на сэмпл, все сэмплы окна на график)
+// и LiveDecimator (корзины min/max по пикселям).
+// Использование: BenchLivePlot [частота, Гц] [ширина графика, пикс.]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "LiveDecimator.h"
+#include "SyntheticEMG.h"
+
+const double FRAME_RATE = 60.0;
+const double RUN_SECONDS = 20.0;    // Симулируемого времени на замер после заполнения окна
+
+struct FrameResult {
+    double p50Us;
+    double p99Us;
+    size_t vertices;
+};
+
+struct NaivePlot {
+    size_t window;
+    std::vector<float> buffer, xs;
+
+    void push(const float* v, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            buffer.push_back(v[i]);
+            if (buffer.size() > window) buffer.erase(buffer.begin());
+        }
+    }
+    size_t build() {
+        xs.resize(buffer.size());
+        for (size_t i = 0; i < xs.size(); ++i) xs[i] = (float)i;
+        return xs.size();
+    }
+};
+
+struct DecimatedPlot {
+    LiveDecimator lod;
+    std::vector<float> xs, ys;
+
+    void push(const float* v, size_t n) { lod.push(v, n); }
+    size_t build() { return lod.build(xs, ys); }
+};
+
+template <typename Plot>
+FrameResult runFrames(Plot& raw, Plot& filtered, SyntheticEMG& gen, double rate, size_t windowSamples) {
+    const size_t perFrame = (size_t)(rate / FRAME_RATE);
+    std::vector<float> chunk(perFrame);
+
+    // Заполнение окна не замеряется
+    for (size_t filled = 0; filled < windowSamples; filled += perFrame) {
+        gen.generate(chunk.data(), perFrame);
+        raw.push(chunk.data(), perFrame);
+        filtered.push(chunk.data(), perFrame);
+    }
+
+    const size_t frames = (size_t)(RUN_SECONDS * FRAME_RATE);
+    std::vector<double> times;
+    size_t vertices = 0;
+    for (size_t f = 0; f < frames; ++f) {
+        gen.generate(chunk.data(), perFrame);
+        auto t0 = std::chrono::steady_clock::now();
+        raw.push(chunk.data(), perFrame);
+        filtered.push(chunk.data(), perFrame);
+        vertices = raw.build() + filtered.build();
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+        times.push_back(us);
+    }
+    std::sort(times.begin(), times.end());
+    return {times[times.size() / 2], times[times.size() * 99 / 100], vertices};
+}
+
+// Огибающая по вершинам должна совпасть с min/max сырых сэмплов окна
+bool envelopeMatches(const DecimatedPlot& plot, const NaivePlot& reference) {
+    if (reference.buffer.empty()) return true;
+    auto range = std::minmax_element(reference.buffer.begin(), reference.buffer.end());
+    auto drawn = std::minmax_element(plot.ys.begin(), plot.ys.end());
+    return *drawn.first == *range.first && *drawn.second == *range.second;
+}
+
+int main(int argc, char** argv) {
+    double rate = argc > 1 ? std::atof(argv[1]) : 500.0;
+    size_t width = argc > 2 ? (size_t)std::atoi(argv[2]) : 2000;
+    std::printf("%.0f Hz, %zu px plot, 2 channels, %.0f fps\n", rate, width, FRAME_RATE);
+    std::printf("%8s | %38s | %34s |\n", "window", "vector + all samples", "LiveDecimator");
+
+    for (double seconds : {10.0, 60.0, 600.0}) {
+        const size_t windowSamples = (size_t)(seconds * rate);
+
+        SyntheticEMG genNaive(rate), genLod(rate);
+        NaivePlot naiveRaw{windowSamples, {}, {}}, naiveFiltered{windowSamples, {}, {}};
+        FrameResult naive = runFrames(naiveRaw, naiveFiltered, genNaive, rate, windowSamples);
+
+        DecimatedPlot lodRaw{LiveDecimator(windowSamples, width), {}, {}};
+        DecimatedPlot lodFiltered{LiveDecimator(windowSamples, width), {}, {}};
+        FrameResult lod = runFrames(lodRaw, lodFiltered, genLod, rate, windowSamples);
+
+        std::printf("%6.0f s | p50 %8.1f us p99 %8.1f %7zu v | p50 %6.1f us p99 %6.1f %5zu v | envelope %s\n",
+                    seconds, naive.p50Us, naive.p99Us, naive.vertices, lod.p50Us, lod.p99Us, lod.vertices,
+                    envelopeMatches(lodRaw, naiveRaw) ? "ok" : "MISMATCH");
+    }
+    return 0;
+}
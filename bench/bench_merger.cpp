@@ -0,0 +1,186 @@
+// Бенчмарк слияния датчиков (SensorMerger): 2–16 датчиков со своим моментом старта, уходом часов
+// (±50 ppm) и своей задержкой прихода (1–8 мс + джиттер). Время сэмплов — как у SensorEMG, через
+// ClockSync каждого датчика. На 60-й секунде у всех общий синхро-импульс (удар).
+// Ошибка выравнивания — размах по датчикам ошибки времени сэмпла относительно истинного в момент
+// импульса: по ClockSync и после поправки по взаимной корреляции окна вокруг него (медиана ошибки
+// ClockSync по второй половине записи — для сравнения: модель часов продолжает уточняться). Пропускная способность —
+// только вызовы push(), без генерации сигнала.
+// Использование: BenchMerger [секунд записи]
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "ClockSync.h"
+#include "HostClock.h"
+#include "SensorMerger.h"
+#include "SyntheticEMG.h"
+
+const double SAMPLE_RATE = 500.0;
+const uint32_t BLOCK_SAMPLES = 16;
+const double SYNC_SECONDS = 60.0;
+const size_t SENSOR_COUNTS[] = {2, 4, 8, 16};
+
+struct Arrival {
+    int64_t arrivalNs;
+    uint32_t sensor;
+    uint64_t firstIndex;
+};
+
+struct Sensor {
+    double startNs;          // Истинное время сэмпла 0
+    double periodNs;         // Истинный период (уход часов)
+    double latencyNs;        // Постоянная часть задержки прихода
+    std::vector<float> signal;
+    std::vector<int64_t> stampNs;    // Время первого сэмпла порции по ClockSync
+    std::vector<double> stampPeriodNs;
+    std::vector<double> errorNs;     // stamp - истина для порций второй половины
+    double syncErrorNs = 0.0;        // stamp - истина для порции с импульсом
+};
+
+static double trueTime(const Sensor& s, uint64_t i) {
+    return s.startNs + s.periodNs * (double)i;
+}
+
+static float syncPulse(double dtNs) {
+    if (dtNs < 0) return 0.0f;
+    const double dt = dtNs / 1e9;
+    return (float)(3000.0 * std::exp(-dt / 0.02) * std::sin(2.0 * 3.14159265358979 * 40.0 * dt));
+}
+
+static double median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    return v.empty() ? 0.0 : v[v.size() / 2];
+}
+
+// Слияние всех порций в порядке прихода; каналы — целиком в channels
+static double merge(std::vector<Sensor>& sensors, const std::vector<Arrival>& arrivals, SensorMerger& merger,
+                    std::vector<std::vector<float>>& channels, int64_t& originNs) {
+    SampleBlockPool pool(1, BLOCK_SAMPLES, 8);
+    std::vector<SampleBlockRef> ready;
+    for (std::vector<float>& c : channels) c.clear();
+    originNs = 0;
+    auto collect = [&] {
+        for (const SampleBlockRef& b : ready) {
+            if (channels[0].empty()) originNs = b->timing.sampleTimeNs;
+            for (uint32_t c = 0; c < b->channelCount; ++c)
+                channels[c].insert(channels[c].end(), b->channel(c), b->channel(c) + b->sampleCount);
+        }
+        ready.clear();
+    };
+
+    int64_t pushNs = 0;
+    for (const Arrival& a : arrivals) {
+        Sensor& s = sensors[a.sensor];
+        const size_t block = (size_t)(a.firstIndex / BLOCK_SAMPLES);
+        SampleBlockRef b = pool.acquire();
+        std::copy(s.signal.begin() + a.firstIndex, s.signal.begin() + a.firstIndex + BLOCK_SAMPLES, b->extend(BLOCK_SAMPLES));
+        b->sensorId = a.sensor;
+        b->timing.sampleTimeNs = s.stampNs[block];
+        b->timing.samplePeriodNs = s.stampPeriodNs[block];
+        const int64_t t0 = hostNowNs();
+        merger.push(*b, ready);
+        pushNs += hostNowNs() - t0;
+        collect();
+    }
+    merger.flush(ready);
+    collect();
+    return pushNs / 1e9;
+}
+
+int main(int argc, char** argv) {
+    const double seconds = argc > 1 ? std::atof(argv[1]) : 120.0;
+    const uint64_t samples = (uint64_t)(seconds * SAMPLE_RATE) / BLOCK_SAMPLES * BLOCK_SAMPLES;
+    std::printf("%.0f s @ %.0f Hz, blocks of %u samples, sync pulse at %.0f s\n", seconds, SAMPLE_RATE, BLOCK_SAMPLES,
+                SYNC_SECONDS);
+
+    for (size_t sensorCount : SENSOR_COUNTS) {
+        std::mt19937 rng(1000 + (uint32_t)sensorCount);
+        std::uniform_real_distribution<double> startDist(0.0, 5e8), ppmDist(-50.0, 50.0), latencyDist(1e6, 8e6);
+        std::exponential_distribution<double> jitterDist(1.0 / 5e5);
+
+        // Истинные моменты сэмплов, сигнал и время прихода порций
+        std::vector<Sensor> sensors(sensorCount);
+        std::vector<Arrival> arrivals;
+        const double syncNs = 5e8 + SYNC_SECONDS * 1e9;
+        for (uint32_t s = 0; s < sensorCount; ++s) {
+            Sensor& sensor = sensors[s];
+            sensor.startNs = startDist(rng);
+            sensor.periodNs = 1e9 / SAMPLE_RATE / (1.0 + ppmDist(rng) * 1e-6);
+            sensor.latencyNs = latencyDist(rng);
+            sensor.signal.resize(samples);
+            SyntheticEMG gen(SAMPLE_RATE, s + 1);
+            gen.generate(sensor.signal.data(), samples);
+            for (uint64_t i = 0; i < samples; ++i) sensor.signal[i] += syncPulse(trueTime(sensor, i) - syncNs);
+
+            ClockSync clock(SAMPLE_RATE);
+            for (uint64_t i = 0; i < samples; i += BLOCK_SAMPLES) {
+                const int64_t arrival =
+                    (int64_t)(trueTime(sensor, i + BLOCK_SAMPLES - 1) + sensor.latencyNs + jitterDist(rng));
+                clock.observe(i + BLOCK_SAMPLES, arrival);
+                sensor.stampNs.push_back(clock.hostTimeOf(i));
+                sensor.stampPeriodNs.push_back(clock.samplePeriodNs());
+                const double error = (double)sensor.stampNs.back() - trueTime(sensor, i);
+                if (i > samples / 2) sensor.errorNs.push_back(error);
+                if (trueTime(sensor, i) <= syncNs && syncNs < trueTime(sensor, i + BLOCK_SAMPLES)) sensor.syncErrorNs = error;
+                arrivals.push_back({arrival, s, i});
+            }
+        }
+        // k-way слияние по времени прихода — порядок, в котором порции пришли бы на хост
+        std::sort(arrivals.begin(), arrivals.end(),
+                  [](const Arrival& a, const Arrival& b) { return a.arrivalNs < b.arrivalNs; });
+
+        std::vector<double> clockError(sensorCount), steadyError(sensorCount);
+        for (size_t s = 0; s < sensorCount; ++s) {
+            clockError[s] = sensors[s].syncErrorNs;
+            steadyError[s] = median(sensors[s].errorNs);
+        }
+        auto spread = [](const std::vector<double>& e) {
+            return *std::max_element(e.begin(), e.end()) - *std::min_element(e.begin(), e.end());
+        };
+
+        MergerOptions options;
+        options.outputRate = SAMPLE_RATE;
+        SensorMerger merger(sensorCount, options);
+        std::vector<std::vector<float>> channels(sensorCount);
+        int64_t originNs = 0;
+        const double pushSeconds = merge(sensors, arrivals, merger, channels, originNs);
+        const MergerStats stats = merger.getStats();
+
+        // Окно ±1 с вокруг импульса по сетке слитых кадров
+        const double periodNs = 1e9 / SAMPLE_RATE;
+        const size_t syncFrame = (size_t)std::max(0.0, (syncNs - (double)originNs) / periodNs);
+        const size_t from = syncFrame > (size_t)SAMPLE_RATE ? syncFrame - (size_t)SAMPLE_RATE : 0;
+        const size_t count = std::min<size_t>(2 * (size_t)SAMPLE_RATE, channels[0].size() - from);
+        std::vector<const float*> window(sensorCount);
+        for (size_t s = 0; s < sensorCount; ++s) window[s] = channels[s].data() + from;
+        std::vector<double> lags = estimateChannelLags(window.data(), sensorCount, count, 50);
+        merger.applyLags(lags);
+
+        std::vector<double> corrected(sensorCount);
+        for (size_t s = 0; s < sensorCount; ++s) corrected[s] = clockError[s] + (double)merger.getOffsetNs((uint32_t)s);
+
+        // Повторное слияние с поправками: остаточная задержка по той же корреляции
+        SensorMerger aligned(sensorCount, options);
+        for (uint32_t s = 0; s < sensorCount; ++s) aligned.setOffsetNs(s, merger.getOffsetNs(s));
+        merge(sensors, arrivals, aligned, channels, originNs);
+        for (size_t s = 0; s < sensorCount; ++s) window[s] = channels[s].data() + from;
+        std::vector<double> residual = estimateChannelLags(window.data(), sensorCount, count, 50);
+        double residualMax = 0.0;
+        for (double r : residual) residualMax = std::max(residualMax, std::fabs(r) * periodNs);
+
+        const double inputSamples = (double)stats.inputSamples;
+        std::printf("%2zu sensors: alignment spread ClockSync %7.1f us (steady %7.1f us) -> xcorr %6.1f us "
+                    "(residual lag %5.1f us)\n"
+                    "            %6.1f Msamples/s in, %6.2f Mframes/s out; max buffered %zu, max frame delay %.1f ms, "
+                    "NaN %llu, late %llu\n",
+                    sensorCount, spread(clockError) / 1e3, spread(steadyError) / 1e3, spread(corrected) / 1e3,
+                    residualMax / 1e3,
+                    inputSamples / 1e6 / pushSeconds, stats.frames / 1e6 / pushSeconds, stats.maxBuffered,
+                    stats.maxFrameDelayNs / 1e6, (unsigned long long)stats.missingValues,
+                    (unsigned long long)stats.lateSamples);
+    }
+    return 0;
+}
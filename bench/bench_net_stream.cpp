@@ -0,0 +1,149 @@
+// Бенчмарк сетевой раздачи (NetStream.h) по loopback.
+//   1. Задержка: поток 500 Гц порциями по 4 сэмпла, размер пакета 1/16/64 сэмпла —
+//      возраст старейшего сэмпла пакета при получении (батч + сеть) и отправка -> приём.
+//   2. Пропускная способность: писатель без пауз, подписчики TCP и UDP.
+//   3. Изоляция: подписчик TCP, который не читает, не тормозит быстрого.
+// Использование: BenchNetStream [секунд на замер задержки]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "HostClock.h"
+#include "NetStream.h"
+
+const int UDP_PORT = 47123;
+
+struct ClientResult {
+    uint64_t packets = 0;
+    uint64_t samples = 0;
+    uint64_t lostPackets = 0;
+    std::vector<int64_t> ageNs;        // Приём - время чтения первого сэмпла
+    std::vector<int64_t> networkNs;    // Приём - отправка
+};
+
+void clientLoop(NetStreamClient* client, std::atomic<bool>* stop, ClientResult* r) {
+    NetBatch batch;
+    while (!stop->load()) {
+        if (!client->receive(batch, 20)) {
+            if (!client->isOpen()) break;
+            continue;
+        }
+        r->packets++;
+        r->samples += batch.samples.size();
+        r->ageNs.push_back(batch.receiveNs - batch.header.hostTimeNs);
+        r->networkNs.push_back(batch.receiveNs - batch.header.sendNs);
+    }
+    r->lostPackets = client->getLostPackets();
+}
+
+double percentileUs(std::vector<int64_t> v, double q) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    return (double)v[(size_t)(q * (double)(v.size() - 1))] / 1e3;
+}
+
+void latencyRun(uint32_t batchSamples, double seconds) {
+    NetStreamOptions options;
+    options.udpTarget = "127.0.0.1:" + std::to_string(UDP_PORT);
+    options.tcpPort = 0;
+    options.batchSamples = batchSamples;
+    options.maxDelayMs = 200.0;    // Пакет уходит по наполнению
+    NetStreamServer server;
+    server.open(options, 500.0);
+
+    NetStreamClient tcp, udp;
+    tcp.connectTcp("127.0.0.1", server.getTcpPort());
+    udp.openUdp(UDP_PORT);
+    std::atomic<bool> stop(false);
+    ClientResult tcpResult, udpResult;
+    std::thread tcpThread(clientLoop, &tcp, &stop, &tcpResult);
+    std::thread udpThread(clientLoop, &udp, &stop, &udpResult);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));    // Сервер принимает подписчика
+
+    // 500 Гц порциями по 4 сэмпла — как кадры датчика
+    std::vector<float> chunk(4, 1.0f);
+    const int64_t periodNs = 8000000;
+    const int64_t start = hostNowNs();
+    for (int64_t due = start; due < start + (int64_t)(seconds * 1e9); due += periodNs) {
+        while (hostNowNs() < due) std::this_thread::sleep_for(std::chrono::microseconds(200));
+        server.publish(chunk.data(), chunk.size(), hostNowNs());
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    server.close();
+    stop = true;
+    tcpThread.join();
+    udpThread.join();
+
+    std::printf("  batch %3u | TCP age p50 %8.2f ms p99 %8.2f ms, send->recv p50 %6.1f us p99 %7.1f us"
+                " | UDP age p50 %8.2f ms, send->recv p50 %6.1f us p99 %7.1f us\n",
+                batchSamples, percentileUs(tcpResult.ageNs, 0.5) / 1e3, percentileUs(tcpResult.ageNs, 0.99) / 1e3,
+                percentileUs(tcpResult.networkNs, 0.5), percentileUs(tcpResult.networkNs, 0.99),
+                percentileUs(udpResult.ageNs, 0.5) / 1e3, percentileUs(udpResult.networkNs, 0.5),
+                percentileUs(udpResult.networkNs, 0.99));
+}
+
+void throughputRun(uint64_t totalSamples, bool withSlowSubscriber) {
+    NetStreamOptions options;
+    options.udpTarget = withSlowSubscriber ? "" : "127.0.0.1:" + std::to_string(UDP_PORT);
+    options.tcpPort = 0;
+    options.batchSamples = withSlowSubscriber ? 256 : NET_MAX_UDP_SAMPLES;
+    options.tcpQueueBytes = 4 << 20;
+    NetStreamServer server;
+    server.open(options, 500.0);
+
+    NetStreamClient tcp, udp, slow;
+    tcp.connectTcp("127.0.0.1", server.getTcpPort());
+    if (withSlowSubscriber) slow.connectTcp("127.0.0.1", server.getTcpPort());    // Подключён, но не читает
+    else udp.openUdp(UDP_PORT);
+    std::atomic<bool> stop(false);
+    ClientResult tcpResult, udpResult;
+    std::thread tcpThread(clientLoop, &tcp, &stop, &tcpResult);
+    std::thread udpThread;
+    if (!withSlowSubscriber) udpThread = std::thread(clientLoop, &udp, &stop, &udpResult);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::vector<float> chunk(64, 1.0f);
+    const int64_t t0 = hostNowNs();
+    for (uint64_t sent = 0; sent < totalSamples; sent += chunk.size()) {
+        server.publish(chunk.data(), chunk.size(), hostNowNs());
+        // Писатель быстрее сети: уступаем процессор, иначе на одном ядре он один
+        if ((sent / chunk.size()) % 64 == 0) std::this_thread::yield();
+    }
+    server.close();
+    const double seconds = (double)(hostNowNs() - t0) * 1e-9;
+    stop = true;
+    tcpThread.join();
+    if (udpThread.joinable()) udpThread.join();
+    NetStreamStats stats = server.getStats();
+
+    if (!withSlowSubscriber) {
+        std::printf("  %llu samples in %.2f s: %.1f Msamples/s published | TCP got %.1f%%, lost %llu packets"
+                    " | UDP got %.1f%% (%llu datagrams sent, %llu send errors)\n",
+                    (unsigned long long)totalSamples, seconds, (double)totalSamples / seconds / 1e6,
+                    100.0 * (double)tcpResult.samples / (double)totalSamples, (unsigned long long)tcpResult.lostPackets,
+                    100.0 * (double)udpResult.samples / (double)totalSamples,
+                    (unsigned long long)stats.udpDatagrams, (unsigned long long)stats.udpErrors);
+    } else {
+        std::printf("  fast subscriber got %.1f%%, lost %llu packets | slow subscriber: %llu packets dropped from its queue\n",
+                    100.0 * (double)tcpResult.samples / (double)totalSamples, (unsigned long long)tcpResult.lostPackets,
+                    (unsigned long long)stats.tcpDroppedPackets);
+    }
+}
+
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 3.0;
+
+    std::printf("latency, 500 Hz in chunks of 4 samples, %.0f s per batch size\n", seconds);
+    for (uint32_t batch : {4u, 16u, 64u}) latencyRun(batch, seconds);
+
+    std::printf("throughput, writer without pauses\n");
+    throughputRun(20000000, false);
+
+    std::printf("slow subscriber isolation (TCP, one subscriber never reads)\n");
+    throughputRun(20000000, true);
+    return 0;
+}
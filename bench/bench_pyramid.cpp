@@ -0,0 +1,112 @@
+// Бенчмарк пирамиды min/max: построение, загрузка из кэша, время до первого кадра и стоимость кадра при зуме.
+// Использование: BenchPyramid [часы] [каналы]
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "HostClock.h"
+#include "MinMaxPyramid.h"
+#include "RecordingFormat.h"
+#include "SyntheticEMG.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+const double SAMPLE_RATE = 500.0;
+const size_t PLOT_WIDTH = 1920;    // Точек на кадр — ширина графика в пикселях
+
+static double msSince(int64_t t0) {
+    return (double)(hostNowNs() - t0) / 1e6;
+}
+
+// Resident set процесса, МБ (только Linux)
+static double residentMB() {
+#ifdef __linux__
+    long pages = 0, resident = 0;
+    if (FILE* f = std::fopen("/proc/self/statm", "r")) {
+        if (std::fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+        std::fclose(f);
+    }
+    return (double)resident * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+#else
+    return 0.0;
+#endif
+}
+
+int main(int argc, char** argv) {
+    double hours = argc > 1 ? std::atof(argv[1]) : 10.0;
+    uint32_t channels = argc > 2 ? (uint32_t)std::atoi(argv[2]) : 4;
+    const std::string path = "bench_pyramid.emgr";
+    const uint64_t total = (uint64_t)(hours * 3600.0 * SAMPLE_RATE);
+
+    {
+        std::vector<SyntheticEMG> generators;
+        for (uint32_t ch = 0; ch < channels; ++ch) generators.emplace_back(SAMPLE_RATE, ch + 1);
+        RecordingInfo info;
+        info.device = "synthetic";
+        info.channelCount = channels;
+        info.sampleRate = SAMPLE_RATE;
+        RecordingWriter writer;
+        AsyncWriterOptions options;
+        options.bufferCount = 8;
+        writer.open(path, info, options);
+        std::vector<float> frame(channels * 1024);
+        int64_t t0 = hostNowNs();
+        for (uint64_t done = 0; done < total; ) {
+            size_t n = (size_t)std::min<uint64_t>(1024, total - done);
+            for (size_t i = 0; i < n; ++i)
+                for (uint32_t ch = 0; ch < channels; ++ch) frame[i * channels + ch] = generators[ch].next();
+            writer.append(frame.data(), n, hostNowNs());
+            done += n;
+        }
+        writer.close();
+        std::printf("recording: %.1f h x %u ch @ %.0f Hz, %llu samples/ch, dropped blocks %llu, written in %.0f ms\n",
+                    hours, channels, SAMPLE_RATE, (unsigned long long)total,
+                    (unsigned long long)writer.getDroppedBlocks(), msSince(t0));
+    }
+    std::remove((path + ".lod").c_str());
+
+    LodSlice slice;
+    {
+        int64_t t0 = hostNowNs();
+        RecordingReader reader(path);
+        MinMaxPyramid pyramid;
+        pyramid.open(reader, path);
+        double buildMs = msSince(t0);
+        std::printf("cold open (build + save cache): %.0f ms, pyramid %.1f MB in %zu levels, RSS %.0f MB\n",
+                    buildMs, pyramid.sizeBytes() / (1024.0 * 1024.0), pyramid.levelCount(), residentMB());
+    }
+
+    double rssBefore = residentMB();
+    int64_t t0 = hostNowNs();
+    RecordingReader reader(path);
+    MinMaxPyramid pyramid;
+    bool cached = pyramid.open(reader, path);
+    for (uint32_t ch = 0; ch < channels; ++ch)
+        pyramid.query(reader, ch, 0.0, (double)total, PLOT_WIDTH, slice);
+    std::printf("time to first render (open + cache + %u full-range queries): %.2f ms, from cache: %s\n",
+                channels, msSince(t0), cached ? "yes" : "no");
+    std::printf("RSS growth after first render: %.1f MB (file %.0f MB mapped)\n",
+                residentMB() - rssBefore, reader.fileBytes() / (1024.0 * 1024.0));
+
+    // Стоимость кадра на разных масштабах: от всей записи до пары сотен сэмплов
+    const double spans[] = {(double)total, 3600.0 * SAMPLE_RATE, 60.0 * SAMPLE_RATE, 10.0 * SAMPLE_RATE, 400.0};
+    for (double span : spans) {
+        if (span > (double)total) continue;
+        const int frames = 200;
+        size_t points = 0;
+        int64_t q0 = hostNowNs();
+        for (int f = 0; f < frames; ++f) {
+            double first = (double)(total - (uint64_t)span) * f / frames;
+            for (uint32_t ch = 0; ch < channels; ++ch) {
+                pyramid.query(reader, ch, first, first + span, PLOT_WIDTH, slice);
+                points += slice.x.size();
+            }
+        }
+        std::printf("span %10.0f samples: %.3f ms/frame, %zu points/channel%s\n", span,
+                    msSince(q0) / frames, points / (frames * channels), slice.raw ? " (raw samples)" : "");
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+// Бенчмарк: запись CSV (как в single.cpp) против бинарного формата .emgr
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "HostClock.h"
+#include "RecordingFormat.h"
+
+const int SAMPLE_RATE = 500;
+const size_t SAMPLES_PER_FRAME = 16;           // Сэмплов в EMG фрейме
+const double RECORDING_SECONDS = 3600.0;       // Объём данных: час записи
+
+struct BenchResult {
+    double wallSec;
+    double cpuSec;
+    double bytes;
+};
+
+static std::vector<float> makeSignal(size_t n) {
+    std::mt19937 rng(42);
+    std::normal_distribution<float> noise(0.0f, 40.0f);
+    std::vector<float> v(n);
+    for (size_t i = 0; i < n; ++i) {
+        float burst = (i / SAMPLE_RATE) % 4 == 0 ? 5.0f : 1.0f;    // Каждые 4 с — сокращение
+        v[i] = 1200.0f + 30.0f * std::sin(0.01f * i) + burst * noise(rng);
+    }
+    return v;
+}
+
+template <class F>
+static BenchResult measure(F&& body, const std::string& path) {
+    auto t0 = std::chrono::steady_clock::now();
+    std::clock_t c0 = std::clock();
+    body();
+    std::clock_t c1 = std::clock();
+    auto t1 = std::chrono::steady_clock::now();
+
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    return {std::chrono::duration<double>(t1 - t0).count(),
+            double(c1 - c0) / CLOCKS_PER_SEC,
+            double(in.tellg())};
+}
+
+static void report(const char* name, const BenchResult& r, size_t samples) {
+    std::printf("%-8s wall %8.3f s | cpu %8.3f s | %7.1f ns/sample | %8.2f MB | %7.2f x realtime load %.4f%%\n",
+                name, r.wallSec, r.cpuSec, 1e9 * r.cpuSec / samples, r.bytes / 1e6,
+                RECORDING_SECONDS / r.wallSec, 100.0 * r.cpuSec / RECORDING_SECONDS);
+}
+
+int main() {
+    const size_t total = (size_t)(SAMPLE_RATE * RECORDING_SECONDS);
+    std::vector<float> signal = makeSignal(total);
+
+    // --- CSV: поток + форматирование float на каждый сэмпл ---
+    BenchResult csv = measure([&] {
+        std::ofstream file("bench_recording.csv");
+        file << "value\n";
+        for (size_t i = 0; i < total; i += SAMPLES_PER_FRAME)
+            for (size_t k = i; k < i + SAMPLES_PER_FRAME && k < total; ++k) file << signal[k] << "\n";
+    }, "bench_recording.csv");
+
+    // --- .emgr: копирование кадра в блок, запись целыми блоками в фоновом потоке ---
+    AsyncWriterStats writerStats;
+    BenchResult bin = measure([&] {
+        RecordingWriter writer;
+        RecordingInfo info;
+        info.device = "bench";
+        info.sampleRate = SAMPLE_RATE;
+        writer.open("bench_recording.emgr", info);
+        for (size_t i = 0; i < total; i += SAMPLES_PER_FRAME)
+            writer.append(&signal[i], std::min(SAMPLES_PER_FRAME, total - i), hostNowNs());
+        writerStats = writer.getWriterStats();
+        writer.close();
+    }, "bench_recording.emgr");
+
+    std::printf("%zu samples (%.0f s @ %d Hz), %zu samples/frame\n", total, RECORDING_SECONDS, SAMPLE_RATE, SAMPLES_PER_FRAME);
+    report("csv", csv, total);
+    report("emgr", bin, total);
+    std::printf("writer: %llu buffers, max lag %.2f ms, max write %.2f ms, dropped %llu writes\n",
+                (unsigned long long)writerStats.buffersWritten, writerStats.maxLagNs / 1e6,
+                writerStats.maxWriteNs / 1e6, (unsigned long long)writerStats.droppedWrites);
+
+    // --- Чтение .emgr через mmap ---
+    auto t0 = std::chrono::steady_clock::now();
+    RecordingReader reader("bench_recording.emgr");
+    double sum = 0.0;
+    for (size_t b = 0; b < reader.blockCount(); ++b) {
+        const float* ch = reader.blockChannel(b, 0);
+        for (uint32_t i = 0; i < reader.blockHeader(b).sampleCount; ++i) sum += ch[i];
+    }
+    double readSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::printf("mmap read: %llu samples in %.3f ms (checksum %.1f)\n",
+                (unsigned long long)reader.getTotalSamples(), 1e3 * readSec, sum);
+
+    std::remove("bench_recording.csv");
+    std::remove("bench_recording.emgr");
+    return 0;
+}
@@ -0,0 +1,120 @@
+// Бенчмарк перефильтрации окна живого графика (HistoryRefilter) при смене частоты среза:
+// время от запроса до подмены графика, время под mutex и худшее ожидание потока чтения.
+// Точность: окно после подмены против фильтрации всего сигнала с новой частотой с самого начала.
+// Фильтр — бикад верхних частот (RBJ), чтобы не зависеть от Iir.
+// Использование: BenchRefilter [окно, с]
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "HistoryRefilter.h"
+#include "HostClock.h"
+#include "SyntheticEMG.h"
+
+const double SAMPLE_RATE = 500.0;
+const size_t FRAME_SAMPLES = 16;
+const double READER_SPEED = 16.0;    // Поток чтения быстрее реального времени
+
+struct HighPassBiquad {
+    double b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+    double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+
+    void setup(double rate, double cutoff) {
+        const double w = 2.0 * 3.14159265358979 * cutoff / rate;
+        const double alpha = std::sin(w) / (2.0 * std::sqrt(0.5));
+        const double a0 = 1.0 + alpha;
+        b0 = (1.0 + std::cos(w)) / 2.0 / a0;
+        b1 = -(1.0 + std::cos(w)) / a0;
+        b2 = b0;
+        a1 = -2.0 * std::cos(w) / a0;
+        a2 = (1.0 - alpha) / a0;
+    }
+    double filter(double x) {
+        double y = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+        return y;
+    }
+};
+
+int main(int argc, char** argv) {
+    const double windowSeconds = argc > 1 ? std::atof(argv[1]) : 600.0;
+    const size_t window = (size_t)(windowSeconds * SAMPLE_RATE);
+    const size_t prefill = window + (size_t)(60 * SAMPLE_RATE);
+
+    // Весь сигнал заранее: с ним же сравнивается результат
+    std::vector<float> signal(prefill + (size_t)(3600 * SAMPLE_RATE));
+    SyntheticEMG gen(SAMPLE_RATE);
+    gen.generate(signal.data(), signal.size());
+
+    std::mutex mutex;
+    LiveDecimator plot(window, window);    // Без прореживания: build() отдаёт сами сэмплы
+    HistoryRefilter<HighPassBiquad> refilter(mutex, plot, SAMPLE_RATE, prefill, 30.0);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        refilter.push(signal.data(), prefill);
+    }
+
+    std::atomic<size_t> fed(prefill);
+    std::atomic<bool> paused(false), stop(false);
+    std::atomic<int64_t> maxWaitNs(0);
+    std::thread reader([&] {
+        const int64_t periodNs = (int64_t)(1e9 * FRAME_SAMPLES / SAMPLE_RATE / READER_SPEED);
+        while (!stop) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(periodNs));
+            if (paused || fed + FRAME_SAMPLES > signal.size()) continue;
+            int64_t t0 = hostNowNs();
+            std::lock_guard<std::mutex> lock(mutex);
+            maxWaitNs = std::max<int64_t>(maxWaitNs, hostNowNs() - t0);
+            refilter.push(&signal[fed], FRAME_SAMPLES);
+            fed += FRAME_SAMPLES;
+        }
+    });
+
+    std::printf("window %.0f s (%zu samples), reader %.0fx realtime\n", windowSeconds, window, READER_SPEED);
+    const double cutoffs[] = {10.0, 80.0, 0.5, 150.0, 20.0};
+    std::vector<float> xs, ys;
+    for (double cutoff : cutoffs) {
+        uint64_t swaps = refilter.getStats().swaps;
+        maxWaitNs = 0;
+        refilter.setCutoff(cutoff);
+        while (refilter.getStats().swaps == swaps) std::this_thread::sleep_for(std::chrono::microseconds(200));
+        RefilterStats stats = refilter.getStats();
+        int64_t waitNs = maxWaitNs;
+
+        // Сравнение без новых сэмплов
+        paused = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        size_t n, end;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            n = plot.build(xs, ys);
+            end = fed;
+        }
+        HighPassBiquad reference;
+        reference.setup(SAMPLE_RATE, cutoff);
+        double maxError = 0.0, maxValue = 0.0;
+        for (size_t i = 0; i < end; ++i) {
+            float y = (float)reference.filter(signal[i]);
+            if (i + n >= end) {
+                maxError = std::max(maxError, (double)std::fabs(y - ys[i + n - end]));
+                maxValue = std::max(maxValue, (double)std::fabs(y));
+            }
+        }
+        paused = false;
+
+        std::printf("cutoff %6.1f Hz: swap after %7.2f ms, under lock %6.1f us, reader wait max %6.1f us, "
+                    "max error %.2e of %.1f\n",
+                    cutoff, stats.lastNs / 1e6, stats.lastLockNs / 1e3, waitNs / 1e3, maxError, maxValue);
+    }
+    stop = true;
+    reader.join();
+    return 0;
+}
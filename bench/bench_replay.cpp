@@ -0,0 +1,93 @@
+// Бенчмарк цепочки декодер -> фильтр -> запись на воспроизведении захвата, без датчика.
+// Использование: BenchReplay [capture.emgcap] [speed]   (speed 0 — максимальная скорость)
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Iir.h"
+
+#include "HostClock.h"
+#include "RawCapture.h"
+#include "RecordingFormat.h"
+#include "SensorEMG.h"
+#include "SyntheticEMG.h"
+
+const int SAMPLE_RATE = 500;
+const float HIGHPASS_CUTOFF = 30;
+
+int main(int argc, char** argv) {
+    std::string capturePath = argc > 1 ? argv[1] : "bench_replay.emgcap";
+    double speed = argc > 2 ? std::atof(argv[2]) : 0.0;
+    bool synthetic = argc <= 1;
+
+    if (synthetic) {
+        auto t0 = std::chrono::steady_clock::now();
+        writeSyntheticCapture(capturePath, 3600.0, SAMPLE_RATE);
+        std::printf("synthetic capture: 3600 s @ %d Hz in %.2f s\n", SAMPLE_RATE,
+                    std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+    }
+
+    auto* replay = new ReplayTransport(capturePath, speed);
+    SensorEMG sensor{std::unique_ptr<Transport>(replay)};
+    sensor.connect();
+
+    Iir::Butterworth::HighPass<4> hp;
+    hp.setup(SAMPLE_RATE, HIGHPASS_CUTOFF);
+
+    RecordingInfo info;
+    info.device = capturePath;
+    info.sampleRate = SAMPLE_RATE;
+    RecordingWriter recorder;
+    recorder.open("bench_replay.emgr", info);
+
+    std::vector<float> filtered;
+    int64_t decodeNs = 0, filterNs = 0, sinkNs = 0;
+    double checksum = 0.0;
+    auto start = std::chrono::steady_clock::now();
+
+    while (!sensor.isFinished()) {
+        int64_t t0 = hostNowNs();
+        std::vector<float> samples = sensor.pollData();
+        int64_t t1 = hostNowNs();
+        if (samples.empty()) {
+            decodeNs += t1 - t0;
+            continue;
+        }
+
+        filtered.resize(samples.size());
+        for (size_t i = 0; i < samples.size(); ++i) {
+            filtered[i] = static_cast<float>(hp.filter(static_cast<double>(samples[i])));
+            checksum += samples[i];
+        }
+        int64_t t2 = hostNowNs();
+        recorder.append(filtered.data(), filtered.size(), replay->getLastChunkTimeNs());
+        int64_t t3 = hostNowNs();
+
+        decodeNs += t1 - t0;
+        filterNs += t2 - t1;
+        sinkNs += t3 - t2;
+    }
+    recorder.close();
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t samples = sensor.getTotalSamples();
+    double seconds = (double)samples / SAMPLE_RATE;
+    std::printf("replayed %llu chunks, %llu frames, %llu samples (%.0f s of signal) in %.3f s, %.0fx realtime\n",
+                (unsigned long long)replay->getChunksReplayed(), (unsigned long long)sensor.getFrameCount(),
+                (unsigned long long)samples, seconds, wall, seconds / wall);
+    std::printf("decode %6.1f ns/sample | filter %6.1f ns/sample | sink %6.1f ns/sample | %.1f Msamples/s\n",
+                (double)decodeNs / samples, (double)filterNs / samples, (double)sinkNs / samples, samples / wall / 1e6);
+    std::printf("checksum %.3f, dropped blocks %llu\n", checksum, (unsigned long long)recorder.getDroppedBlocks());
+    const FrameSequencer& sequencer = sensor.getSequencer();
+    std::printf("metadata: %s, lost frames %llu (%llu samples), duplicates %llu, discontinuities %llu\n",
+                metadataModeName(sequencer.getMode()), (unsigned long long)sequencer.getLostFrames(),
+                (unsigned long long)sequencer.getLostSamples(), (unsigned long long)sequencer.getDuplicates(),
+                (unsigned long long)sequencer.getDiscontinuities());
+
+    std::remove("bench_replay.emgr");
+    if (synthetic) std::remove(capturePath.c_str());
+    return 0;
+}
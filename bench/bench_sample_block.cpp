@@ -0,0 +1,175 @@
+// Бенчмарк передачи сэмплов по конвейеру: вектор на каждое чтение (pollData) против порций из пула
+// (pollBlock). Воспроизведение синтетического захвата через SensorEMG; порцию читают три приёмника
+// (кольцо графика, сумма, копия в буфер записи) — в потоке чтения или в потоке обработки за очередью.
+// Считаются время на сэмпл и выделения памяти на чтение.
+// Использование: BenchSampleBlock [секунды сигнала] [повторов]
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "HostClock.h"
+#include "LiveDecimator.h"
+#include "RawCapture.h"
+#include "SensorEMG.h"
+#include "SyntheticEMG.h"
+
+const double SAMPLE_RATE = 500.0;
+
+static std::atomic<uint64_t> allocations(0);
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+// Очередь между потоками чтения и обработки
+template <class T>
+struct Handoff {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<T> items;
+    bool done = false;
+
+    void push(T item) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            items.push_back(std::move(item));
+        }
+        cv.notify_one();
+    }
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return done || !items.empty(); });
+        if (items.empty()) return false;
+        item = std::move(items.front());
+        items.pop_front();
+        return true;
+    }
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+        }
+        cv.notify_one();
+    }
+};
+
+struct Sinks {
+    LiveDecimator plot{(size_t)(10 * SAMPLE_RATE), 2000};
+    std::vector<float> recorder = std::vector<float>(1 << 16);
+    size_t recorderFill = 0;
+    double checksum = 0.0;
+
+    void consume(const float* values, size_t n) {
+        plot.push(values, n);
+        for (size_t i = 0; i < n; ++i) checksum += values[i];
+        if (recorderFill + n > recorder.size()) recorderFill = 0;
+        std::memcpy(&recorder[recorderFill], values, n * sizeof(float));
+        recorderFill += n;
+    }
+};
+
+struct RunResult {
+    int64_t ns;
+    uint64_t allocations;
+    uint64_t reads;
+    double checksum;
+};
+
+// threaded: приёмники в отдельном потоке (как запись и сеть), иначе — в потоке чтения
+template <class Item, class Poll, class View>
+static RunResult run(const std::string& path, bool threaded, Poll poll, View view) {
+    SensorEMG sensor{std::make_unique<ReplayTransport>(path, 0.0), SAMPLE_RATE};
+    sensor.bindMetrics(nullptr);
+    sensor.connect();
+    Sinks sinks;
+    Handoff<Item> queue;
+    std::thread worker;
+    if (threaded) {
+        worker = std::thread([&] {
+            Item item;
+            while (queue.pop(item)) {
+                const float* values = nullptr;
+                size_t n = view(item, values);
+                sinks.consume(values, n);
+                item = Item();    // Порция возвращается в пул сразу после приёмников
+            }
+        });
+    }
+
+    RunResult r{0, 0, 0, 0.0};
+    const uint64_t a0 = allocations.load();
+    const int64_t t0 = hostNowNs();
+    while (!sensor.isFinished()) {
+        Item item = poll(sensor);
+        const float* values = nullptr;
+        size_t n = view(item, values);
+        if (n == 0) continue;
+        r.reads++;
+        if (threaded) queue.push(std::move(item));
+        else sinks.consume(values, n);
+    }
+    if (threaded) {
+        queue.finish();
+        worker.join();
+    }
+    r.ns = hostNowNs() - t0;
+    r.allocations = allocations.load() - a0;
+    r.checksum = sinks.checksum;
+    return r;
+}
+
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 3600.0;
+    int repeats = argc > 2 ? std::atoi(argv[2]) : 5;
+    const std::string path = "bench_sample_block.emgcap";
+    writeSyntheticCapture(path, seconds, SAMPLE_RATE);
+
+    auto pollVector = [](SensorEMG& s) { return s.pollData(); };
+    auto viewVector = [](const std::vector<float>& v, const float*& values) {
+        values = v.data();
+        return v.size();
+    };
+    auto pollBlock = [](SensorEMG& s) { return s.pollBlock(); };
+    auto viewBlock = [](const SampleBlockRef& b, const float*& values) -> size_t {
+        if (!b) return 0;
+        values = b->channel(0);
+        return b->sampleCount;
+    };
+
+    const double samples = seconds * SAMPLE_RATE;
+    std::printf("replay %.0f s @ %.0f Hz, 3 sinks (plot ring, sum, record buffer), best of %d\n", seconds,
+                SAMPLE_RATE, repeats);
+    auto report = [&](const char* name, const RunResult& r) {
+        std::printf("  %-26s %8.2f ms  %6.2f ns/sample  %5.2f allocations/read  (checksum %.1f)\n", name, r.ns / 1e6,
+                    r.ns / samples, (double)r.allocations / (double)std::max<uint64_t>(1, r.reads), r.checksum);
+    };
+    for (bool threaded : {false, true}) {
+        RunResult bestVector{INT64_MAX, 0, 0, 0.0}, bestBlock{INT64_MAX, 0, 0, 0.0};
+        for (int r = 0; r < repeats; ++r) {
+            RunResult v = run<std::vector<float>>(path, threaded, pollVector, viewVector);
+            RunResult b = run<SampleBlockRef>(path, threaded, pollBlock, viewBlock);
+            if (v.ns < bestVector.ns) bestVector = v;
+            if (b.ns < bestBlock.ns) bestBlock = b;
+        }
+        std::printf(" %s\n", threaded ? "sinks on a worker thread (queue)" : "sinks on the reader thread");
+        report("vector (pollData)", bestVector);
+        report("block (pollBlock)", bestBlock);
+        std::printf("  speedup x%.2f\n", (double)bestVector.ns / (double)bestBlock.ns);
+    }
+    std::remove(path.c_str());
+    return 0;
+}
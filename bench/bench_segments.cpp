@@ -0,0 +1,82 @@
+// Бенчмарк: задержка append() в потоке чтения — один файл .emgr против записи сегментами
+// с частой сменой сегментов и удалением старых (SegmentedRecorder)
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "HostClock.h"
+#include "RecordingFormat.h"
+#include "SegmentedRecording.h"
+
+const int SAMPLE_RATE = 500;
+const size_t SAMPLES_PER_FRAME = 16;
+const double RECORDING_SECONDS = 2 * 3600.0;
+const double SEGMENT_SECONDS = 60.0;    // 120 смен сегмента
+
+static std::vector<float> makeSignal(size_t n) {
+    std::mt19937 rng(42);
+    std::normal_distribution<float> noise(0.0f, 40.0f);
+    std::vector<float> v(n);
+    for (size_t i = 0; i < n; ++i) v[i] = 1200.0f + 30.0f * std::sin(0.01f * i) + noise(rng);
+    return v;
+}
+
+// Время каждого вызова append(); между кадрами поток уступает процессор, как поток чтения порта
+template <class F>
+static std::vector<int64_t> run(const std::vector<float>& signal, F&& append) {
+    std::vector<int64_t> ns;
+    ns.reserve(signal.size() / SAMPLES_PER_FRAME + 1);
+    for (size_t i = 0; i < signal.size(); i += SAMPLES_PER_FRAME) {
+        int64_t t0 = hostNowNs();
+        append(&signal[i], std::min(SAMPLES_PER_FRAME, signal.size() - i), t0);
+        ns.push_back(hostNowNs() - t0);
+        std::this_thread::yield();
+    }
+    return ns;
+}
+
+static void report(const char* name, std::vector<int64_t> ns) {
+    std::sort(ns.begin(), ns.end());
+    auto q = [&](double p) { return ns[std::min(ns.size() - 1, (size_t)(p * ns.size()))] / 1e3; };
+    std::printf("%-9s p50 %7.2f us | p99 %7.2f us | p99.9 %8.2f us | max %9.2f us\n", name, q(0.5), q(0.99), q(0.999),
+                ns.back() / 1e3);
+}
+
+int main() {
+    const size_t total = (size_t)(SAMPLE_RATE * RECORDING_SECONDS);
+    std::vector<float> signal = makeSignal(total);
+    RecordingInfo info;
+    info.device = "bench";
+    info.sampleRate = SAMPLE_RATE;
+
+    RecordingWriter single;
+    single.open("bench_segments.emgr", info);
+    std::vector<int64_t> singleNs = run(signal, [&](const float* s, size_t n, int64_t t) { single.append(s, n, t); });
+    single.close();
+    std::remove("bench_segments.emgr");
+
+    SegmentOptions options;
+    options.directory = "bench_segments";
+    options.segmentSeconds = SEGMENT_SECONDS;
+    options.retainSegments = 10;
+    SegmentedRecorder segments;
+    segments.open(options, info);
+    std::vector<int64_t> segmentNs = run(signal, [&](const float* s, size_t n, int64_t t) { segments.append(s, n, t); });
+    segments.close();
+    SegmentStats stats = segments.getStats();
+    std::filesystem::remove_all(options.directory);
+
+    std::printf("%zu samples (%.0f s @ %d Hz), %zu samples/frame, %.0f s segments\n", total, RECORDING_SECONDS,
+                SAMPLE_RATE, SAMPLES_PER_FRAME, SEGMENT_SECONDS);
+    report("single", singleNs);
+    report("segments", segmentNs);
+    std::printf("segments: %llu rotations (%llu late), %llu pruned, %llu dropped blocks, %llu errors\n",
+                (unsigned long long)stats.rotations, (unsigned long long)stats.lateRotations,
+                (unsigned long long)stats.prunedSegments, (unsigned long long)stats.droppedBlocks,
+                (unsigned long long)stats.errors);
+    return 0;
+}
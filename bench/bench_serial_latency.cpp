@@ -0,0 +1,135 @@
+// Бенчмарк задержки "провод -> декодер" для профилей порта (SerialTransport.h): от записи кадра в
+// порт до того, как FrameDecoder выдал его сэмплы. Без аргумента порта — псевдотерминал (pty):
+// задержки USB адаптера в нём нет, видна только разница VMIN/VTIME и чтения. С портом — адаптер
+// с перемычкой TX-RX (петля): кадры пишутся в тот же порт, и в задержку входит latency_timer.
+// Считаются p50/p99/max задержки, вызовов read() в секунду и процессорное время процесса.
+// Использование: BenchSerialLatency [секунд на профиль] [порт с петлёй TX-RX]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "FrameDecoder.h"
+#include "HostClock.h"
+#include "SerialTransport.h"
+#include "SyntheticEMG.h"
+
+const uint32_t FRAME_SAMPLES = DefaultEmgDevice::samplesPerFrame;
+const double FRAME_PERIOD_NS = 1e9 * FRAME_SAMPLES / DefaultEmgDevice::sampleRate;
+const size_t READ_CHUNK = 512;    // Как в SensorEMG::pollBlock()
+
+struct RunResult {
+    std::vector<int64_t> latencyNs;
+    uint64_t readCalls = 0;
+    double cpuSeconds = 0.0;
+    double wallSeconds = 0.0;
+    int latencyTimerMs = -1;
+};
+
+static RunResult run(SerialProfile profile, double seconds, const std::string& loopPort) {
+    // Ведущая сторона pty пишет кадры, ведомая открывается как порт
+    int master = -1;
+    std::string port = loopPort;
+    if (port.empty()) {
+        master = posix_openpt(O_RDWR | O_NOCTTY);
+        if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) throw std::runtime_error("posix_openpt failed");
+        port = ptsname(master);
+    }
+    SerialOptions options;
+    options.profile = profile;
+    SerialTransport transport(port, options);
+    transport.open();
+    transport.purge();
+
+    const size_t frames = (size_t)(seconds * 1e9 / FRAME_PERIOD_NS);
+    std::vector<std::vector<uint8_t>> wire(frames);
+    {
+        SyntheticEMG generator(DefaultEmgDevice::sampleRate);
+        std::vector<float> samples(FRAME_SAMPLES);
+        for (size_t i = 0; i < frames; ++i) {
+            generator.generate(samples.data(), FRAME_SAMPLES);
+            encodeEmgFrame(samples.data(), FRAME_SAMPLES, (uint32_t)i, wire[i]);
+        }
+    }
+    std::vector<std::atomic<int64_t>> written(frames);
+    std::atomic<bool> done(false);
+
+    RunResult r;
+    r.latencyTimerMs = transport.getLatencyTimerMs();
+    const std::clock_t c0 = std::clock();
+    const int64_t t0 = hostNowNs();
+    std::thread writer([&] {
+        auto next = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < frames; ++i) {
+            next += std::chrono::nanoseconds((int64_t)FRAME_PERIOD_NS);
+            std::this_thread::sleep_until(next);
+            written[i].store(hostNowNs(), std::memory_order_release);
+            if (master >= 0) {
+                if (::write(master, wire[i].data(), wire[i].size()) < 0) break;
+            } else {
+                transport.write(wire[i].data(), wire[i].size());
+            }
+        }
+        done = true;
+    });
+
+    FrameDecoder decoder;
+    std::vector<float> out;
+    uint8_t buf[READ_CHUNK];
+    size_t decoded = 0;
+    int64_t idleSince = 0;
+    r.latencyNs.reserve(frames);
+    while (decoded < frames) {
+        const size_t n = transport.read(buf, sizeof(buf));
+        r.readCalls++;
+        if (n == 0) {
+            // Хвост потерян (переполнение буфера pty) — не ждать вечно
+            if (!done) continue;
+            if (idleSince == 0) idleSince = hostNowNs();
+            if (hostNowNs() - idleSince > 500000000) break;
+            continue;
+        }
+        const size_t count = decoder.feed(buf, n, out);
+        out.clear();
+        const int64_t now = hostNowNs();
+        for (size_t k = 0; k < count && decoded < frames; ++k, ++decoded)
+            r.latencyNs.push_back(now - written[decoded].load(std::memory_order_acquire));
+    }
+    writer.join();
+    r.cpuSeconds = (double)(std::clock() - c0) / CLOCKS_PER_SEC;
+    r.wallSeconds = (hostNowNs() - t0) / 1e9;
+    transport.close();
+    if (master >= 0) ::close(master);
+    return r;
+}
+
+int main(int argc, char** argv) {
+    const double seconds = argc > 1 ? std::atof(argv[1]) : 10.0;
+    const std::string loopPort = argc > 2 ? argv[2] : "";
+    std::printf("%s, frame of %u samples every %.1f ms, %.0f s per profile\n",
+                loopPort.empty() ? "pty" : ("loopback " + loopPort).c_str(), FRAME_SAMPLES, FRAME_PERIOD_NS / 1e6,
+                seconds);
+
+    for (SerialProfile profile : {SerialProfile::Default, SerialProfile::LowLatency, SerialProfile::Throughput}) {
+        RunResult r = run(profile, seconds, loopPort);
+        if (r.latencyNs.empty()) {
+            std::printf("  %-12s no frames decoded\n", serialProfileName(profile));
+            continue;
+        }
+        std::sort(r.latencyNs.begin(), r.latencyNs.end());
+        auto q = [&](double p) { return r.latencyNs[std::min(r.latencyNs.size() - 1, (size_t)(p * r.latencyNs.size()))] / 1e3; };
+        std::printf("  %-12s p50 %8.1f us  p99 %8.1f us  max %8.1f us  %6.1f reads/s  cpu %4.1f%%  latency_timer %s\n",
+                    serialProfileName(profile), q(0.5), q(0.99), r.latencyNs.back() / 1e3, r.readCalls / r.wallSeconds,
+                    100.0 * r.cpuSeconds / r.wallSeconds,
+                    r.latencyTimerMs < 0 ? "n/a" : (std::to_string(r.latencyTimerMs) + " ms").c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+// Бенчмарк истории сеанса (SessionHistory): час записи 1 и 16 датчиков по 500 Гц с бюджетом памяти.
+// Сигнал проходит encodeEmgFrame -> FrameDecoder, поэтому сэмплы — в арифметике датчика, как в живом
+// потоке. Считаются: скорость push() (с фоновым сжатием), итоговый объём против бюджета и против
+// float, байт на сэмпл сжатого яруса, ярусы, время query() на весь час и на окно 10 с, и точность —
+// сэмплы из сжатого яруса против исходных бит в бит.
+// Использование: BenchSessionHistory [минут] [бюджет, МБ]
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "FrameDecoder.h"
+#include "HostClock.h"
+#include "SessionHistory.h"
+#include "SyntheticEMG.h"
+
+const double SAMPLE_RATE = 500.0;
+const uint32_t FRAME_SAMPLES = 16;
+const uint32_t CHANNEL_COUNTS[] = {1, 16};
+const size_t PLOT_WIDTH = 2000;
+
+static double queryMs(const SessionHistory& history, uint32_t channels, double first, double last, LodSlice& slice) {
+    const int repeats = 20;
+    const int64_t t0 = hostNowNs();
+    for (int r = 0; r < repeats; ++r)
+        for (uint32_t c = 0; c < channels; ++c) history.query(c, first, last, PLOT_WIDTH, slice);
+    return (hostNowNs() - t0) / 1e6 / repeats;
+}
+
+int main(int argc, char** argv) {
+    const double minutes = argc > 1 ? std::atof(argv[1]) : 60.0;
+    const double budgetMB = argc > 2 ? std::atof(argv[2]) : 64.0;
+    const size_t samples = (size_t)(minutes * 60.0 * SAMPLE_RATE) / FRAME_SAMPLES * FRAME_SAMPLES;
+
+    // Один канал в арифметике датчика; датчик c — тот же сигнал со сдвигом
+    std::vector<float> source;
+    {
+        SyntheticEMG generator(SAMPLE_RATE);
+        std::vector<float> signal(samples);
+        generator.generate(signal.data(), samples);
+        std::vector<uint8_t> wire;
+        for (size_t i = 0; i < samples; i += FRAME_SAMPLES)
+            encodeEmgFrame(&signal[i], FRAME_SAMPLES, (uint32_t)(i / FRAME_SAMPLES), wire);
+        FrameDecoder decoder;
+        source.reserve(samples);
+        decoder.feed(wire.data(), wire.size(), source);
+    }
+    std::printf("%.0f min @ %.0f Hz, budget %.0f MB, frames of %u samples\n", minutes, SAMPLE_RATE, budgetMB,
+                FRAME_SAMPLES);
+
+    for (uint32_t channels : CHANNEL_COUNTS) {
+        SessionHistoryOptions options;
+        options.channelCount = channels;
+        options.sampleRate = SAMPLE_RATE;
+        options.budgetBytes = (size_t)(budgetMB * (1 << 20));
+        SessionHistory history(options);
+        auto sourceAt = [&](uint32_t c, size_t i) { return source[(i + (size_t)c * 7919) % source.size()]; };
+
+        SampleBlockPool pool(channels, FRAME_SAMPLES, 4);
+        const int64_t t0 = hostNowNs();
+        for (size_t i = 0; i < source.size(); i += FRAME_SAMPLES) {
+            SampleBlockRef block = pool.acquire();
+            block->extend(FRAME_SAMPLES);
+            for (uint32_t c = 0; c < channels; ++c)
+                for (uint32_t k = 0; k < FRAME_SAMPLES; ++k) block->channel(c)[k] = sourceAt(c, i + k);
+            history.push(*block);
+        }
+        const double pushSeconds = (hostNowNs() - t0) / 1e9;
+
+        // Ждём, пока фон догонит: горячим остаётся только хвост hotSeconds
+        const size_t hotLimit = (size_t)std::ceil(options.hotSeconds * SAMPLE_RATE / options.blockSamples) + 1;
+        SessionHistoryStats stats = history.getStats();
+        for (int wait = 0; wait < 10000 && (stats.hotBlocks > hotLimit || history.sizeBytes() > options.budgetBytes); ++wait) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            stats = history.getStats();
+        }
+        const double totalSeconds = (hostNowNs() - t0) / 1e9;
+
+        // Сэмплы сжатого яруса против исходных
+        LodSlice slice;
+        size_t compared = 0, mismatches = 0;
+        const uint64_t hotFrom = stats.totalSamples - std::min<uint64_t>(stats.totalSamples, stats.hotBlocks * options.blockSamples);
+        for (uint64_t a = stats.rawFromSample; a + 1000 <= hotFrom; a += 100003) {
+            for (uint32_t c = 0; c < channels; ++c) {
+                history.query(c, (double)a, (double)(a + 1000), 1000, slice);
+                for (size_t k = 0; k < slice.x.size(); ++k) {
+                    const float expected = sourceAt(c, (size_t)slice.x[k]);
+                    mismatches += std::memcmp(&expected, &slice.mean[k], sizeof(float)) != 0;
+                    compared++;
+                }
+            }
+        }
+
+        const double total = (double)stats.totalSamples;
+        const double floatMB = total * channels * sizeof(float) / (1 << 20);
+        const size_t packedSamples = stats.packedBlocks * (size_t)options.blockSamples * channels;
+        const double everPacked = (double)(stats.packedBlocks + stats.summaryBlocks + stats.droppedBlocks) *
+                                  options.blockSamples * channels;
+        std::printf("%2u ch: push %6.1f Msamples/s (with compaction %6.1f), %.1f MB vs %.1f MB float, "
+                    "packed %.2f B/sample\n",
+                    channels, total * channels / 1e6 / pushSeconds, total * channels / 1e6 / totalSeconds,
+                    history.sizeBytes() / (double)(1 << 20), floatMB,
+                    packedSamples ? (double)stats.packedBytes / packedSamples : 0.0);
+        std::printf("       blocks hot %zu / packed %zu / summary %zu / dropped %llu; samples kept from %.1f min, "
+                    "summary from %.1f min; escapes %.2f%%, float blocks %llu, pack %.1f ns/sample\n",
+                    stats.hotBlocks, stats.packedBlocks, stats.summaryBlocks, (unsigned long long)stats.droppedBlocks,
+                    stats.rawFromSample / SAMPLE_RATE / 60.0, stats.oldestSample / SAMPLE_RATE / 60.0,
+                    100.0 * stats.escapes / std::max(1.0, everPacked), (unsigned long long)stats.floatBlocks,
+                    stats.packNs / std::max(1.0, everPacked));
+        std::printf("       query all channels: whole session %.2f ms, 10 s at the start of kept samples %.2f ms; "
+                    "lossless %zu/%zu\n",
+                    queryMs(history, channels, 0.0, total, slice),
+                    queryMs(history, channels, (double)stats.rawFromSample, stats.rawFromSample + 10.0 * SAMPLE_RATE, slice),
+                    compared - mismatches, compared);
+    }
+    return 0;
+}
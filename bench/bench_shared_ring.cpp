@@ -0,0 +1,122 @@
+// Бенчмарк живого потока в разделяемой памяти (SharedRing.h).
+// Писатель и читатель — разные потоки с отдельными отображениями сегмента по имени, как у
+// двух процессов. Пропускная способность: писатель без пауз; задержка публикация -> чтение:
+// писатель с заданным темпом, читатель опрашивает в цикле (yield) или засыпает на 1 мс.
+// Использование: BenchSharedRing [блоков] [сэмплов в блоке]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "HostClock.h"
+#include "SharedRing.h"
+
+const char* const RING_NAME = "emg_bench_ring";
+
+struct ReaderResult {
+    uint64_t blocks = 0;
+    uint64_t samples = 0;
+    uint64_t lostBlocks = 0;
+    uint64_t badSamples = 0;
+    std::vector<int64_t> latencyNs;
+    double checksum = 0.0;
+};
+
+// Сэмпл i потока — (float)(i % 1000): читатель проверяет, что данные не порваны
+void readerLoop(bool sleepWhenEmpty, ReaderResult& r, std::atomic<bool>& attached) {
+    SharedRingReader reader;
+    reader.open(RING_NAME, true);
+    attached = true;
+    SharedBlockView view;
+    for (;;) {
+        SharedReadStatus status = reader.next(view);
+        if (status == SharedReadStatus::Closed) break;
+        if (status == SharedReadStatus::Empty) {
+            if (sleepWhenEmpty) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            else std::this_thread::yield();    // На одном ядре чистый спин отнимает время у писателя
+            continue;
+        }
+        const int64_t now = hostNowNs();
+        uint64_t bad = 0;
+        double sum = 0.0;
+        for (uint32_t i = 0; i < view.sampleCount; ++i) {
+            sum += view.samples[i];
+            if (view.samples[i] != (float)((view.firstSample + i) % 1000)) bad++;
+        }
+        if (!reader.release(view)) continue;    // Перезаписан во время чтения — не считается
+        r.blocks++;
+        r.samples += view.sampleCount;
+        r.badSamples += bad;
+        r.checksum += sum;
+        r.latencyNs.push_back(now - view.publishNs);
+    }
+    r.lostBlocks = reader.getLostBlocks();
+}
+
+void printLatency(const char* title, std::vector<int64_t>& v) {
+    if (v.empty()) return;
+    std::sort(v.begin(), v.end());
+    auto at = [&](double q) { return (double)v[(size_t)(q * (double)(v.size() - 1))] / 1e3; };
+    std::printf("  %-22s p50 %7.2f us  p99 %7.2f us  p99.9 %8.2f us  max %8.2f us\n", title, at(0.5), at(0.99),
+                at(0.999), (double)v.back() / 1e3);
+}
+
+/**
+ * @param periodNs Пауза между блоками писателя (0 — без пауз)
+ */
+ReaderResult run(uint64_t blocks, uint32_t blockSamples, int64_t periodNs, bool sleepingReader, double& publishSeconds) {
+    SharedRingPublisher publisher;
+    publisher.open(RING_NAME, 500.0, "bench", blockSamples, 4096);
+
+    ReaderResult result;
+    result.latencyNs.reserve((size_t)blocks);
+    std::atomic<bool> attached(false);
+    std::thread reader(readerLoop, sleepingReader, std::ref(result), std::ref(attached));
+    while (!attached) std::this_thread::yield();
+
+    std::vector<float> block(blockSamples);
+    uint64_t sample = 0;
+    const int64_t t0 = hostNowNs();
+    int64_t due = t0;
+    for (uint64_t b = 0; b < blocks; ++b) {
+        for (float& v : block) v = (float)(sample++ % 1000);
+        if (periodNs > 0) {
+            due += periodNs;
+            while (hostNowNs() < due) std::this_thread::yield();    // Темп без погрешности sleep
+        }
+        publisher.publish(block.data(), block.size(), hostNowNs());
+    }
+    publishSeconds = (double)(hostNowNs() - t0) * 1e-9;
+    publisher.close();
+    reader.join();
+    return result;
+}
+
+int main(int argc, char** argv) {
+    uint64_t blocks = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    uint32_t blockSamples = argc > 2 ? (uint32_t)std::atoi(argv[2]) : 64;
+
+    double seconds = 0.0;
+    ReaderResult flat = run(blocks, blockSamples, 0, false, seconds);
+    std::printf("throughput, %llu blocks x %u samples, writer without pauses\n", (unsigned long long)blocks, blockSamples);
+    std::printf("  writer %.1f Msamples/s (%.0f ns/block), reader got %.1f%%, lost %llu blocks, torn %llu samples\n",
+                (double)blocks * blockSamples / seconds / 1e6, seconds * 1e9 / (double)blocks,
+                100.0 * (double)flat.blocks / (double)blocks, (unsigned long long)flat.lostBlocks,
+                (unsigned long long)flat.badSamples);
+
+    // Темп живого потока с запасом: блок каждые 100 мкс
+    const uint64_t pacedBlocks = 20000;
+    std::printf("latency publish -> read, %llu blocks every 100 us\n", (unsigned long long)pacedBlocks);
+    ReaderResult spin = run(pacedBlocks, blockSamples, 100000, false, seconds);
+    printLatency("polling reader", spin.latencyNs);
+    ReaderResult sleeper = run(pacedBlocks, blockSamples, 100000, true, seconds);
+    printLatency("reader sleeping 1 ms", sleeper.latencyNs);
+    std::printf("  lost %llu / %llu blocks, torn %llu / %llu samples\n",
+                (unsigned long long)spin.lostBlocks, (unsigned long long)sleeper.lostBlocks,
+                (unsigned long long)spin.badSamples, (unsigned long long)sleeper.badSamples);
+    return 0;
+}
@@ -0,0 +1,91 @@
+// Пакетная обработка старых CSV-записей (example.csv из single.cpp / main_src.cpp, CsvIngest.h):
+// сводная таблица признаков по файлам и, по желанию, конвертация в .emgr.
+// Аргументы:
+//   ПУТЬ ...                файлы или каталоги (в каталогах — *.csv)
+//   --recursive             просматривать подкаталоги
+//   --threads N             потоков (по умолчанию — по числу ядер)
+//   --summary FILE.csv      сводка в файл (по умолчанию stdout)
+//   --convert DIR           записать каждый файл в DIR/<путь_имя>.emgr
+//   --rate HZ               частота дискретизации записей (по умолчанию 500)
+//   --threshold X           порог шума для пересечений нуля и смен наклона (по умолчанию 0)
+//   --quiet                 без итоговой строки
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "CsvIngest.h"
+
+struct Options {
+    std::vector<std::string> paths;
+    std::string summaryPath;
+    CsvBatchOptions batch;
+    bool recursive = false;
+    bool quiet = false;
+};
+
+void printUsage(const char* argv0) {
+    std::fprintf(stderr,
+                 "Usage: %s [--recursive] [--threads N] [--summary FILE.csv] [--convert DIR] [--rate HZ]\n"
+                 "       [--threshold X] [--quiet] PATH...\n", argv0);
+}
+
+bool parseOptions(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--recursive") opt.recursive = true;
+        else if (arg == "--threads" && hasValue) opt.batch.threads = (unsigned)std::atoi(argv[++i]);
+        else if (arg == "--summary" && hasValue) opt.summaryPath = argv[++i];
+        else if (arg == "--convert" && hasValue) opt.batch.convertDirectory = argv[++i];
+        else if (arg == "--rate" && hasValue) opt.batch.sampleRate = std::atof(argv[++i]);
+        else if (arg == "--threshold" && hasValue) opt.batch.threshold = (float)std::atof(argv[++i]);
+        else if (arg == "--quiet") opt.quiet = true;
+        else if (arg.size() > 1 && arg[0] == '-') return false;
+        else opt.paths.push_back(arg);
+    }
+    return !opt.paths.empty() && opt.batch.sampleRate > 0.0;
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    try {
+        std::vector<std::string> files = listCsvFiles(opt.paths, opt.recursive);
+        CsvBatchStats stats;
+        std::vector<CsvFileSummary> summaries = ingestCsvFiles(files, opt.batch, stats);
+
+        std::FILE* out = stdout;
+        if (!opt.summaryPath.empty()) {
+            out = std::fopen(opt.summaryPath.c_str(), "w");
+            if (!out) {
+                std::fprintf(stderr, "Cannot open %s\n", opt.summaryPath.c_str());
+                return 2;
+            }
+        }
+        writeCsvSummary(out, summaries, opt.batch.sampleRate);
+        if (out != stdout) std::fclose(out);
+
+        for (const CsvFileSummary& s : summaries)
+            if (!s.error.empty()) std::fprintf(stderr, "%s: %s\n", s.path.c_str(), s.error.c_str());
+        if (!opt.quiet) {
+            const double seconds = std::max(1e-9, stats.elapsedNs / 1e9);
+            std::fprintf(stderr,
+                         "%llu files (%llu failed), %.3f GB, %llu samples, %llu bad lines in %.3f s: "
+                         "%.1f files/s, %.3f GB/s, %.1f Msamples/s\n",
+                         (unsigned long long)stats.files, (unsigned long long)stats.failed, stats.bytes / 1e9,
+                         (unsigned long long)stats.samples, (unsigned long long)stats.badLines, seconds,
+                         stats.files / seconds, stats.bytes / 1e9 / seconds, stats.samples / 1e6 / seconds);
+        }
+        return stats.failed == 0 ? 0 : 3;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        return 2;
+    }
+}
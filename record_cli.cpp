@@ -0,0 +1,356 @@
+// Консольный регистратор ЭМГ без GUI: датчик (или воспроизведение захвата) -> .emgr / EDF+.
+// Аргументы:
+//   --port NAME             COM-порт (COM3, /dev/ttyUSB0)
+//   --serial-profile NAME   default | low-latency (ASYNC_LOW_LATENCY, latency_timer 1 мс) |
+//                           throughput (latency_timer 16 мс, чтение порциями) — SerialTransport.h
+//   --replay file.emgcap    вместо порта воспроизвести захват
+//   --speed N               скорость воспроизведения (1 — реальное время, 0 — максимальная)
+//   --output file.emgr      файл записи (по умолчанию emg_YYYYMMDD_HHMMSS.emgr, "-" — не писать)
+//   --compress              .emgr без потерь в исходных кадрах (delta/Rice)
+//   --edf file.edf          дополнительно писать EDF+ (--bdf file.bdf — 24-битный BDF+)
+//   --capture file.emgcap   дублировать сырой поток порта в файл захвата
+//   --duration SEC          остановиться после SEC секунд сигнала (0 — до Ctrl+C)
+//   --rate HZ               частота дискретизации (по умолчанию 500)
+//   --no-start              не посылать команду старта (датчик уже передаёт)
+//   --no-stop               не посылать команду остановки при выходе
+//   --quiet                 без строки состояния
+//   --metrics file.prom     выгружать метрики (текстовый формат Prometheus)
+//   --metrics-interval SEC  период выгрузки метрик (по умолчанию 5 с)
+//   --shm NAME              публиковать живой поток в разделяемой памяти (SharedRing.h)
+//   --udp HOST:PORT         раздавать поток по UDP (адрес multicast-группы — всем подписчикам)
+//   --tcp PORT              раздавать поток подписчикам TCP
+//   --net-batch N           сэмплов в сетевом пакете (по умолчанию 32)
+//   --net-delay MS          неполный пакет уходит через MS мс (по умолчанию 10)
+//   --trace file.json       трасса этапов (Chrome trace event; только в сборке с EMG_TRACE)
+//   --trigger PREFIX        запись только вокруг событий: PREFIX_0001.emgr ..., PREFIX_events.csv
+//                           (без --output непрерывная запись не ведётся); строка в stdin — триггер
+//   --pre SEC / --post SEC  окно до и после триггера (по умолчанию 2 и 3 с)
+//   --threshold X           триггер, когда модуль сигнала достигает X
+//   --trigger-port PORT     триггер — любая датаграмма на 127.0.0.1:PORT
+//   --segments DIR          запись сегментами DIR/emg_000001.emgr ... с журналом (SegmentedRecording.h);
+//                           без --output непрерывный файл не пишется
+//   --segment-seconds SEC   длительность сегмента (по умолчанию 3600 с)
+//   --segment-mb N          размер сегмента, МБ
+//   --retain-mb N           бюджет на закрытые сегменты: старые удаляются
+//   --retain-segments N     хранить не больше N закрытых сегментов
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EdfWriter.h"
+#include "HostClock.h"
+#include "Metrics.h"
+#include "NetStream.h"
+#include "RawCapture.h"
+#include "RecordingFormat.h"
+#include "SegmentedRecording.h"
+#include "SensorEMG.h"
+#include "SerialTransport.h"
+#include "SharedRing.h"
+#include "Trace.h"
+#include "TriggeredCapture.h"
+
+const int64_t STATUS_PERIOD_NS = 1000000000;    // Строка состояния раз в секунду
+
+std::atomic<bool> running(true);
+std::atomic<uint32_t> stdinTriggers(0);
+
+void onSignal(int) {
+    running = false;
+}
+
+struct Options {
+    std::string port, replayPath, outputPath, edfPath, capturePath, metricsPath, tracePath, shmName;
+    EdfFormat edfFormat = EdfFormat::Edf;
+    double replaySpeed = 1.0;
+    double durationSeconds = 0.0;
+    double sampleRate = DefaultEmgDevice::sampleRate;
+    double metricsInterval = 5.0;
+    SerialOptions serial;
+    NetStreamOptions net;
+    TriggerOptions trigger;
+    bool triggered = false;
+    int triggerPort = -1;
+    SegmentOptions segments;
+    bool segmented = false;
+    bool compress = false;
+    bool sendStart = true;
+    bool sendStop = true;
+    bool quiet = false;
+};
+
+void printUsage(const char* argv0) {
+    std::fprintf(stderr,
+                 "Usage: %s (--port NAME [--serial-profile NAME] | --replay FILE [--speed N]) [--output FILE.emgr|-]\n"
+                 "       [--compress] [--edf FILE | --bdf FILE] [--capture FILE] [--duration SEC] [--rate HZ]\n"
+                 "       [--no-start] [--no-stop] [--quiet] [--metrics FILE.prom [--metrics-interval SEC]]\n"
+                 "       [--shm NAME] [--udp HOST:PORT] [--tcp PORT] [--net-batch N] [--net-delay MS]\n"
+                 "       [--trace FILE.json] [--trigger PREFIX [--pre SEC] [--post SEC] [--threshold X]\n"
+                 "       [--trigger-port PORT]] [--segments DIR [--segment-seconds SEC] [--segment-mb N]\n"
+                 "       [--retain-mb N] [--retain-segments N]]\n", argv0);
+}
+
+bool parseOptions(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--port" && hasValue) opt.port = argv[++i];
+        else if (arg == "--serial-profile" && hasValue) {
+            if (!parseSerialProfile(argv[++i], opt.serial.profile)) return false;
+        }
+        else if (arg == "--replay" && hasValue) opt.replayPath = argv[++i];
+        else if (arg == "--speed" && hasValue) opt.replaySpeed = std::atof(argv[++i]);
+        else if (arg == "--output" && hasValue) opt.outputPath = argv[++i];
+        else if (arg == "--compress") opt.compress = true;
+        else if (arg == "--edf" && hasValue) opt.edfPath = argv[++i];
+        else if (arg == "--bdf" && hasValue) {
+            opt.edfPath = argv[++i];
+            opt.edfFormat = EdfFormat::Bdf;
+        }
+        else if (arg == "--capture" && hasValue) opt.capturePath = argv[++i];
+        else if (arg == "--duration" && hasValue) opt.durationSeconds = std::atof(argv[++i]);
+        else if (arg == "--rate" && hasValue) opt.sampleRate = std::atof(argv[++i]);
+        else if (arg == "--no-start") opt.sendStart = false;
+        else if (arg == "--no-stop") opt.sendStop = false;
+        else if (arg == "--quiet") opt.quiet = true;
+        else if (arg == "--metrics" && hasValue) opt.metricsPath = argv[++i];
+        else if (arg == "--metrics-interval" && hasValue) opt.metricsInterval = std::atof(argv[++i]);
+        else if (arg == "--trace" && hasValue) opt.tracePath = argv[++i];
+        else if (arg == "--shm" && hasValue) opt.shmName = argv[++i];
+        else if (arg == "--udp" && hasValue) opt.net.udpTarget = argv[++i];
+        else if (arg == "--tcp" && hasValue) opt.net.tcpPort = std::atoi(argv[++i]);
+        else if (arg == "--net-batch" && hasValue) opt.net.batchSamples = (uint32_t)std::atoi(argv[++i]);
+        else if (arg == "--net-delay" && hasValue) opt.net.maxDelayMs = std::atof(argv[++i]);
+        else if (arg == "--trigger" && hasValue) {
+            opt.trigger.prefix = argv[++i];
+            opt.triggered = true;
+        }
+        else if (arg == "--pre" && hasValue) opt.trigger.preSeconds = std::atof(argv[++i]);
+        else if (arg == "--post" && hasValue) opt.trigger.postSeconds = std::atof(argv[++i]);
+        else if (arg == "--threshold" && hasValue) opt.trigger.threshold = (float)std::atof(argv[++i]);
+        else if (arg == "--trigger-port" && hasValue) opt.triggerPort = std::atoi(argv[++i]);
+        else if (arg == "--segments" && hasValue) {
+            opt.segments.directory = argv[++i];
+            opt.segmented = true;
+        }
+        else if (arg == "--segment-seconds" && hasValue) opt.segments.segmentSeconds = std::atof(argv[++i]);
+        else if (arg == "--segment-mb" && hasValue) opt.segments.segmentBytes = (uint64_t)(std::atof(argv[++i]) * (1 << 20));
+        else if (arg == "--retain-mb" && hasValue) opt.segments.retainBytes = (uint64_t)(std::atof(argv[++i]) * (1 << 20));
+        else if (arg == "--retain-segments" && hasValue) opt.segments.retainSegments = (uint32_t)std::atoi(argv[++i]);
+        else return false;
+    }
+    return opt.port.empty() != opt.replayPath.empty() && opt.sampleRate > 0.0;
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    if (!opt.tracePath.empty()) {
+        if (TRACE_AVAILABLE) traceEnable();
+        else std::fprintf(stderr, "Warning: built without EMG_TRACE, --trace ignored\n");
+        traceSetThreadName("main");
+    }
+
+    try {
+        std::unique_ptr<SensorEMG> sensor;
+        if (!opt.replayPath.empty()) {
+            sensor = std::make_unique<SensorEMG>(std::make_unique<ReplayTransport>(opt.replayPath, opt.replaySpeed),
+                                                 opt.sampleRate);
+        } else {
+            sensor = std::make_unique<SensorEMG>(std::make_unique<SerialTransport>(opt.port, opt.serial), opt.sampleRate);
+            if (!opt.capturePath.empty()) sensor->enableCapture(opt.capturePath);
+        }
+
+        RecordingWriter recorder;
+        if ((opt.triggered || opt.segmented) && opt.outputPath.empty()) opt.outputPath = "-";
+        if (opt.outputPath != "-") {
+            if (opt.outputPath.empty()) opt.outputPath = makeRecordingFileName();
+            RecordingInfo info;
+            info.device = opt.replayPath.empty() ? opt.port : opt.replayPath;
+            info.sampleRate = opt.sampleRate;
+            info.sampleFormat = opt.compress ? SAMPLE_FORMAT_DELTA_RICE : SAMPLE_FORMAT_F32;
+            recorder.open(opt.outputPath, info);
+        }
+
+        SegmentedRecorder segments;
+        if (opt.segmented) {
+            RecordingInfo info;
+            info.device = opt.replayPath.empty() ? opt.port : opt.replayPath;
+            info.sampleRate = opt.sampleRate;
+            info.sampleFormat = opt.compress ? SAMPLE_FORMAT_DELTA_RICE : SAMPLE_FORMAT_F32;
+            segments.open(opt.segments, info);
+            SegmentStats segmentStats = segments.getStats();
+            if (segmentStats.repairedSegments > 0 && !opt.quiet)
+                std::fprintf(stderr, "Repaired %llu interrupted segment(s) in %s\n",
+                             (unsigned long long)segmentStats.repairedSegments, opt.segments.directory.c_str());
+        }
+
+        EdfWriter edf;
+        if (!opt.edfPath.empty()) {
+            EdfInfo edfInfo;
+            edfInfo.format = opt.edfFormat;
+            edfInfo.sampleRate = opt.sampleRate;
+            edf.open(opt.edfPath, edfInfo);
+        }
+
+        SharedRingPublisher shm;
+        if (!opt.shmName.empty()) shm.open(opt.shmName, opt.sampleRate, opt.replayPath.empty() ? opt.port : opt.replayPath);
+
+        NetStreamServer net;
+        if (!opt.net.udpTarget.empty() || opt.net.tcpPort >= 0) {
+            net.open(opt.net, opt.sampleRate);
+            if (net.getTcpPort() > 0 && !opt.quiet) std::fprintf(stderr, "Streaming on TCP port %d\n", net.getTcpPort());
+        }
+
+        TriggeredRecorder events;
+        TriggerSocket triggerSocket;
+        if (opt.triggered) {
+            RecordingInfo info;
+            info.device = opt.replayPath.empty() ? opt.port : opt.replayPath;
+            info.sampleRate = opt.sampleRate;
+            events.open(opt.trigger, info);
+            if (opt.triggerPort >= 0) triggerSocket.open(opt.triggerPort);
+            // Поток не завершается, пока stdin открыт: он только считает строки
+            std::thread([] {
+                int c;
+                while ((c = std::getchar()) != EOF)
+                    if (c == '\n') stdinTriggers++;
+            }).detach();
+        }
+
+        MetricsRegistry& metrics = globalMetrics();
+        MetricHistogram& emgrSinkNs = metrics.histogram("emg_sink_ns{sink=\"emgr\"}", "Sink append time per block, ns");
+        MetricHistogram& edfSinkNs = metrics.histogram("emg_sink_ns{sink=\"edf\"}", "Sink append time per block, ns");
+        std::unique_ptr<MetricsDumper> dumper;
+        if (!opt.metricsPath.empty()) dumper.reset(new MetricsDumper(metrics, opt.metricsPath, opt.metricsInterval));
+
+        std::signal(SIGINT, onSignal);
+        std::signal(SIGTERM, onSignal);
+
+        sensor->connect();
+        if (opt.sendStart) sensor->sendSTART();
+
+        // Длительность считается по сэмплам, а не по часам: так же точно и при воспроизведении
+        const uint64_t maxSamples = opt.durationSeconds > 0.0 ? (uint64_t)(opt.durationSeconds * opt.sampleRate) : 0;
+        const int64_t startNs = hostNowNs();
+        int64_t nextStatusNs = startNs + STATUS_PERIOD_NS;
+        uint64_t written = 0;
+        bool statusShown = false;
+
+        while (running && !sensor->isFinished()) {
+            // Порция из пула: все приёмники читают её сэмплы на месте
+            SampleBlockRef samples = sensor->pollBlock();
+
+            if (samples) {
+                const SampleBlockTiming& block = samples->timing;
+                const float* values = samples->channel(0);
+                // Последняя порция обрезается по длительности; сжатая запись хранит кадры целиком
+                size_t keep = samples->sampleCount;
+                uint64_t before = samples->firstSample;
+                if (maxSamples > 0 && before + keep > maxSamples) keep = (size_t)(maxSamples - before);
+
+                if (recorder.isOpen()) {
+                    EMG_TRACE_SCOPE("sink emgr");
+                    int64_t t0 = hostNowNs();
+                    if (opt.compress) recorder.appendFrames(sensor->getLastFrames(), block.hostTimeNs);
+                    else recorder.append(values, keep, block.hostTimeNs);
+                    emgrSinkNs.record((uint64_t)(hostNowNs() - t0));
+                }
+                if (segments.isOpen()) {
+                    EMG_TRACE_SCOPE("sink segments");
+                    if (opt.compress) segments.appendFrames(sensor->getLastFrames(), block.hostTimeNs);
+                    else segments.append(values, keep, block.hostTimeNs);
+                }
+                if (edf.isOpen()) {
+                    EMG_TRACE_SCOPE("sink edf");
+                    int64_t t0 = hostNowNs();
+                    if (block.lostSamples > 0) edf.appendGap(block.lostSamples, "Lost frames");
+                    edf.append(values, keep);
+                    edfSinkNs.record((uint64_t)(hostNowNs() - t0));
+                }
+                if (events.isOpen()) {
+                    EMG_TRACE_SCOPE("sink events");
+                    for (uint32_t n = stdinTriggers.exchange(0); n > 0; --n) events.trigger(TriggerSource::Command);
+                    for (size_t n = triggerSocket.poll(); n > 0; --n) events.trigger(TriggerSource::Command);
+                    events.push(values, keep, block.hostTimeNs);
+                }
+                if (shm.isOpen()) shm.publish(values, keep, block.hostTimeNs, block.lostSamples);
+                if (net.isOpen()) net.publish(values, keep, block.hostTimeNs, block.lostSamples);
+                written += keep;
+                if (maxSamples > 0 && before + keep >= maxSamples) running = false;
+            }
+
+            int64_t now = hostNowNs();
+            if (now < nextStatusNs) continue;
+            nextStatusNs = now + STATUS_PERIOD_NS;
+            if (recorder.isOpen()) publishWriterMetrics(metrics, "emgr", recorder.getWriterStats());
+            if (edf.isOpen()) publishWriterMetrics(metrics, "edf", edf.getWriterStats());
+            if (net.isOpen()) publishNetMetrics(metrics, net.getStats());
+            if (!opt.quiet) {
+                statusShown = true;
+                std::fprintf(stderr, "\r%7.0f s | %llu samples | %6.1f Hz | lost %llu | drift %+.1f ppm   ",
+                             (double)(now - startNs) * 1e-9, (unsigned long long)sensor->getTotalSamples(),
+                             sensor->getSampleRate(), (unsigned long long)sensor->getSequencer().getLostSamples(),
+                             sensor->getClockSync().getStats().driftPpm);
+            }
+        }
+
+        if (opt.sendStop && opt.replayPath.empty()) sensor->sendSTOP();
+        bool wasRecording = recorder.isOpen(), wasEdf = edf.isOpen();
+        recorder.close();
+        events.close();
+        TriggerStats eventStats = events.getStats();
+        segments.close();
+        SegmentStats segmentStats = segments.getStats();
+        edf.close();
+        shm.close();
+        bool wasNet = net.isOpen();
+        net.close();
+        if (wasNet) publishNetMetrics(metrics, net.getStats());
+        if (wasRecording) publishWriterMetrics(metrics, "emgr", recorder.getWriterStats());
+        if (wasEdf) {
+            publishWriterMetrics(metrics, "edf", edf.getWriterStats());
+            if (edf.getDroppedRecords() > 0)
+                std::fprintf(stderr, "Warning: %llu EDF records dropped (disk too slow), file marked discontinuous\n",
+                             (unsigned long long)edf.getDroppedRecords());
+            if (edf.getDroppedAnnotations() > 0)
+                std::fprintf(stderr, "Warning: %llu EDF annotations dropped (annotation field too small)\n",
+                             (unsigned long long)edf.getDroppedAnnotations());
+        }
+        if (dumper) dumper->stop();    // Последняя выгрузка — с итогами
+        // Потоки записи уже остановлены close()
+        if (traceIsEnabled() && !traceWriteJson(opt.tracePath))
+            std::fprintf(stderr, "Warning: cannot write trace %s\n", opt.tracePath.c_str());
+
+        if (statusShown) std::fprintf(stderr, "\n");
+        if (opt.triggered)
+            std::fprintf(stderr, "%llu events (%llu retriggers, %llu missed), %llu samples -> %s_*.emgr\n",
+                         (unsigned long long)eventStats.events, (unsigned long long)eventStats.retriggers,
+                         (unsigned long long)eventStats.missedEvents, (unsigned long long)eventStats.samplesWritten,
+                         opt.trigger.prefix.c_str());
+        if (opt.segmented)
+            std::fprintf(stderr, "%llu rotations (%llu late), %llu segments pruned, %.1f MB kept -> %s\n",
+                         (unsigned long long)segmentStats.rotations, (unsigned long long)segmentStats.lateRotations,
+                         (unsigned long long)segmentStats.prunedSegments, (double)segmentStats.retainedBytes / (1 << 20),
+                         opt.segments.directory.c_str());
+        std::fprintf(stderr, "%llu samples (%.1f s), lost %llu, duplicates %llu, dropped blocks %llu%s%s\n",
+                     (unsigned long long)written, (double)written / opt.sampleRate,
+                     (unsigned long long)sensor->getSequencer().getLostSamples(),
+                     (unsigned long long)sensor->getSequencer().getDuplicates(),
+                     (unsigned long long)recorder.getDroppedBlocks(),
+                     opt.outputPath != "-" ? " -> " : "", opt.outputPath != "-" ? opt.outputPath.c_str() : "");
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
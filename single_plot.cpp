@@ -4,10 +4,13 @@
 #include <string>
 #include <cstdint>
 #include <cstring>
+#include <cfloat>
 #include <thread>
 #include <mutex>
 #include <atomic>
 #include <chrono>
+#include <cstdlib>
+#include <memory>
 
 #include "imgui.h"
 #include "implot.h"
@@ -18,19 +21,49 @@
 #include "Iir.h"    // Фильтры
 
 #include "SensorEMG.h"
+#include "SerialTransport.h"
+#include "RawCapture.h"
+#include "RecordingFormat.h"
+#include "MinMaxPyramid.h"
+#include "EdfWriter.h"
+#include "LiveDecimator.h"
+#include "HistoryRefilter.h"
+#include "SessionHistory.h"
+#include "RenderScheduler.h"
+#include "HostClock.h"
+#include "Metrics.h"
+#include "Trace.h"
+#include "SharedRing.h"
+#include "NetStream.h"
+#include "TriggeredCapture.h"
 
 // ==== параметры ==== 
-const int SAMPLE_RATE = 500;       // Гц
-const int MAX_PLOT_POINTS = 500;   // количество точек на графике
+const int SAMPLE_RATE = (int)DefaultEmgDevice::sampleRate;    // Гц
+const float MIN_PLOT_SECONDS = 1.0f;
+const float MAX_PLOT_SECONDS = 600.0f;
 
-std::vector<float> emg_buffer;             // Глобальный буффер для сырых данных
-std::vector<float> emg_filtered_buffer;    // Глобальный буффер для фильтрованных данных
+float PLOT_SECONDS = 10.0f;                // Длина окна живого графика, изменяется слайдером
+LiveDecimator emg_plot(10 * SAMPLE_RATE);           // Сырые данные, прореженные по ширине графика
+LiveDecimator emg_filtered_plot(10 * SAMPLE_RATE);  // Фильтрованные данные
 std::mutex buffer_mutex;                   // Буффер для синхронизации?
+std::vector<int64_t> pending_read_ns;      // Время чтения порций, ещё не попавших на экран (под buffer_mutex)
+const size_t MAX_PENDING_READS = 4096;     // График не рисуется (свёрнут) — новые не копим
+RenderScheduler renderScheduler;           // Кадр только при новых данных/вводе
 std::atomic<bool> running(true);
+std::atomic<bool> markerRequested(false);  // Кнопка "Marker" -> аннотация в EDF
 
-double measuredSampleRate;                 // Эмпирическая частота дискретизации
+std::atomic<double> measuredSampleRate(0.0);   // Частота по скользящему окну
+std::atomic<uint64_t> lostSamples(0);          // Потеряно сэмплов по метаданным кадров
+std::atomic<uint64_t> duplicateFrames(0);      // Выброшено повторённых кадров
+std::atomic<double> clockDriftPpm(0.0);        // Уход часов датчика относительно хоста
+std::atomic<double> arrivalJitterMs(0.0);      // СКО времени прихода вокруг модели часов
+std::atomic<bool> portFailed(false);           // Чтение остановлено ошибкой порта (адаптер отключён)
 
 float HIGHPASS_CUTOFF = 30;                // Частота обрезки для High-Pass фильтра, изменяется слайдером
+const float REFILTER_HEADROOM_SECONDS = 60.0f;    // История сверх самого длинного окна — на прогрев фильтра
+
+// Живой фильтр графика; при смене частоты обрезки окно перефильтровывается в фоне
+typedef HistoryRefilter<Iir::Butterworth::HighPass<4>> HighPassRefilter;
 
 // ==== функции для COM-портов ====
 std::vector<std::string> ScanPorts(int minPort = 1, int maxPort = 256) {
@@ -62,34 +95,76 @@ std::vector<float> filterEMG(const std::vector<float> inputEMG) {
 }
 
 // --- Поток для чтения данных --- 
-void emg_thread(SensorEMG* sensor) {
-    Iir::Butterworth::HighPass<4> hp;
-    float lastCutOff = HIGHPASS_CUTOFF;    // Последняя частота обрезки (для обновления фильтра при изменении слайдера)
-    hp.setup(SAMPLE_RATE, lastCutOff);     // Установка параметров фильтра
+void emg_thread(SensorEMG* sensor, EdfWriter* edf, SharedRingPublisher* shm, NetStreamServer* net,
+                TriggeredRecorder* events, TriggerSocket* triggerSocket, HighPassRefilter* highPass,
+                SessionHistory* history) {
+    MetricsRegistry& metrics = globalMetrics();
+    MetricHistogram& filterNs = metrics.histogram("emg_filter_ns", "High-pass filter and plot push time per block, ns");
+    MetricHistogram& edfSinkNs = metrics.histogram("emg_sink_ns{sink=\"edf\"}", "Sink append time per block, ns");
+    int64_t nextWriterMetricsNs = 0;
+    traceSetThreadName("reader");
 
     while (running) {
-        if (lastCutOff != HIGHPASS_CUTOFF) {
-            hp.setup(SAMPLE_RATE, lastCutOff);    // Переустановка параметров фильтра
-            lastCutOff = HIGHPASS_CUTOFF;
+        SampleBlockRef block;
+        try {
+            block = sensor->pollBlock();    // Приёмники читают сэмплы порции на месте
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            portFailed = true;
+            renderScheduler.notifyData();
+            glfwPostEmptyEvent();    // Показать ошибку в окне
+            break;
+        }
+        const float* newData = block ? block->channel(0) : nullptr;
+        const size_t newCount = block ? block->sampleCount : 0;
+        // Для порта совпадает с временем чтения до микросекунд декодирования; readTimeNs()
+        // воспроизведения — время из захвата, для задержки до экрана не годится
+        const int64_t readNs = hostNowNs();
+
+        const FrameSequencer& sequencer = sensor->getSequencer();
+        measuredSampleRate = sensor->getSampleRate();
+        lostSamples = sequencer.getLostSamples();
+        duplicateFrames = sequencer.getDuplicates();
+        clockDriftPpm = sensor->getClockSync().getStats().driftPpm;
+        arrivalJitterMs = sensor->getClockSync().getStats().jitterRmsNs / 1e6;
+
+        if (edf->isOpen()) {
+            if (markerRequested.exchange(false)) edf->annotate(edf->getElapsedSeconds(), 0, "Marker");
+            if (block) {
+                EMG_TRACE_SCOPE("sink edf");
+                int64_t t0 = hostNowNs();
+                if (block->timing.lostSamples > 0) edf->appendGap(block->timing.lostSamples, "Lost frames");
+                edf->append(newData, newCount);
+                edfSinkNs.record((uint64_t)(hostNowNs() - t0));
+            }
+        }
+        if (readNs >= nextWriterMetricsNs) {
+            nextWriterMetricsNs = readNs + 1000000000LL;
+            if (edf->isOpen()) publishWriterMetrics(metrics, "edf", edf->getWriterStats());
+            if (net->isOpen()) publishNetMetrics(metrics, net->getStats());
         }
 
-        std::vector<float> newData = sensor->pollData();
-
-        if (!newData.empty()) {
-            std::lock_guard<std::mutex> lock(buffer_mutex);
-
-            for (float v : newData) {
-                // сохраняем сырой
-                emg_buffer.push_back(v);
-                if (emg_buffer.size() > MAX_PLOT_POINTS)
-                    emg_buffer.erase(emg_buffer.begin());
+        if (shm->isOpen() && block) shm->publish(newData, newCount, block->timing.hostTimeNs, block->timing.lostSamples);
+        if (net->isOpen() && block) net->publish(newData, newCount, block->timing.hostTimeNs, block->timing.lostSamples);
+        if (events->isOpen()) {
+            for (size_t n = triggerSocket->poll(); n > 0; --n) events->trigger(TriggerSource::Command);
+            if (block) events->push(newData, newCount, block->timing.hostTimeNs);
+        }
 
-                // фильтруем и сохраняем отфильтрованный
-                double yf = hp.filter(static_cast<double>(v));
-                emg_filtered_buffer.push_back(static_cast<float>(yf));
-                if (emg_filtered_buffer.size() > MAX_PLOT_POINTS)
-                    emg_filtered_buffer.erase(emg_filtered_buffer.begin());
+        if (block) {
+            history->push(newData, newCount);    // Своя блокировка; сжатие — в её потоке
+            {
+                std::lock_guard<std::mutex> lock(buffer_mutex);
+                EMG_TRACE_SCOPE("filter");
+                const int64_t filterStart = hostNowNs();
+
+                // сохраняем сырой, фильтруем и сохраняем отфильтрованный
+                emg_plot.push(newData, newCount);
+                highPass->push(newData, newCount);
+                filterNs.record((uint64_t)(hostNowNs() - filterStart));
+                if (pending_read_ns.size() < MAX_PENDING_READS) pending_read_ns.push_back(readNs);
             }
+            if (renderScheduler.notifyData()) glfwPostEmptyEvent();    // Разбудить цикл окна
         } else {
             // чтобы не заполнять CPU если нет данных
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
@@ -97,20 +172,246 @@ void emg_thread(SensorEMG* sensor) {
     }
 }
 
+void notifyWindowInput(GLFWwindow* window) {
+    static_cast<RenderScheduler*>(glfwGetWindowUserPointer(window))->notifyInput();
+}
+
+// Ввод будит цикл окна. Ставить до ImGui_ImplGlfw_InitForOpenGL: ImGui вызывает прежние колбэки
+void installRedrawCallbacks(GLFWwindow* window, RenderScheduler* scheduler) {
+    glfwSetWindowUserPointer(window, scheduler);
+    glfwSetCursorPosCallback(window, [](GLFWwindow* w, double, double) { notifyWindowInput(w); });
+    glfwSetMouseButtonCallback(window, [](GLFWwindow* w, int, int, int) { notifyWindowInput(w); });
+    glfwSetScrollCallback(window, [](GLFWwindow* w, double, double) { notifyWindowInput(w); });
+    glfwSetKeyCallback(window, [](GLFWwindow* w, int, int, int, int) { notifyWindowInput(w); });
+    glfwSetCharCallback(window, [](GLFWwindow* w, unsigned int) { notifyWindowInput(w); });
+    glfwSetWindowSizeCallback(window, [](GLFWwindow* w, int, int) { notifyWindowInput(w); });
+    glfwSetWindowRefreshCallback(window, [](GLFWwindow* w) { notifyWindowInput(w); });
+}
+
+// Ожидание событий до следующего кадра; false — кадр рисовать рано
+bool waitForFrame(RenderScheduler& scheduler) {
+    double wait = scheduler.waitSeconds(hostNowNs());
+    if (wait > 0.0) glfwWaitEventsTimeout(wait);
+    else glfwPollEvents();
+    return scheduler.beginFrame(hostNowNs());
+}
+
+// ==== Просмотр записи .emgr ====
+// Файл отображается в память, график строится по пирамиде min/max (MinMaxPyramid.h):
+// на кадр читаются только видимые корзины, поэтому зум от часов до сэмплов не зависит от длины записи.
+int runViewer(const std::string& path, double maxFps) {
+    auto openStart = std::chrono::steady_clock::now();
+    RecordingReader recording(path);
+    MinMaxPyramid pyramid;
+    bool fromCache = pyramid.open(recording, path);
+    double openMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - openStart).count();
+
+    const RecordingHeader& info = recording.info();
+    const double rate = info.sampleRate;
+    const double duration = (double)recording.getTotalSamples() / rate;
+    std::cout << "Recording: " << path << ", " << info.channelCount << " ch, " << duration << " s, pyramid "
+              << pyramid.sizeBytes() / (1024.0 * 1024.0) << " MB (" << (fromCache ? "cache" : "built")
+              << ", " << openMs << " ms)" << std::endl;
+
+    if (!glfwInit()) return 1;
+    GLFWwindow* window = glfwCreateWindow(1600, 900, "EMG Recording Viewer", nullptr, nullptr);
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(1);
+
+    RenderScheduler scheduler(maxFps);    // Запись не меняется — кадр только по вводу
+    installRedrawCallbacks(window, &scheduler);
+
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImPlot::CreateContext();
+    ImGui::StyleColorsDark();
+    ImGui_ImplGlfw_InitForOpenGL(window, true);
+    ImGui_ImplOpenGL3_Init("#version 130");
+
+    double viewMin = 0.0, viewMax = duration;    // Общая ось X всех каналов, секунды
+    LodSlice slice;
+    std::vector<double> xs;
+    double firstRenderMs = 0.0;
+
+    while (!glfwWindowShouldClose(window)) {
+        if (!waitForFrame(scheduler)) continue;
+
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
+
+        ImGuiIO& io = ImGui::GetIO();
+        ImGui::SetNextWindowPos(ImVec2(0, 0));
+        ImGui::SetNextWindowSize(io.DisplaySize);
+        ImGui::Begin("Recording", nullptr, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoCollapse);
+        ImGui::Text("%s | %u ch @ %.0f Hz | %.1f s | pyramid %.1f MB (%s) | first render %.1f ms",
+                    info.device, info.channelCount, rate, duration, pyramid.sizeBytes() / (1024.0 * 1024.0),
+                    fromCache ? "cache" : "built", firstRenderMs);
+
+        float plotHeight = ImGui::GetContentRegionAvail().y / (float)info.channelCount - 4.0f;
+        for (uint32_t ch = 0; ch < info.channelCount; ++ch) {
+            std::string title = "Channel " + std::to_string(ch);
+            if (ImPlot::BeginPlot(title.c_str(), ImVec2(-1, plotHeight))) {
+                ImPlot::SetupAxes("s", nullptr);
+                ImPlot::SetupAxisLinks(ImAxis_X1, &viewMin, &viewMax);
+                ImPlotRect limits = ImPlot::GetPlotLimits();
+                size_t width = (size_t)std::max(1.0f, ImPlot::GetPlotSize().x);
+                pyramid.query(recording, ch, limits.X.Min * rate, limits.X.Max * rate, width, slice);
+
+                xs.resize(slice.x.size());
+                for (size_t i = 0; i < xs.size(); ++i) xs[i] = slice.x[i] / rate;
+                int n = (int)xs.size();
+                if (slice.raw) {
+                    ImPlot::PlotLine("EMG", xs.data(), slice.mean.data(), n);
+                } else {
+                    ImPlot::PlotShaded("min/max", xs.data(), slice.min.data(), slice.max.data(), n);
+                    ImPlot::PlotLine("mean", xs.data(), slice.mean.data(), n);
+                }
+                ImPlot::EndPlot();
+            }
+        }
+        ImGui::End();
+
+        ImGui::Render();
+        int display_w, display_h;
+        glfwGetFramebufferSize(window, &display_w, &display_h);
+        glViewport(0, 0, display_w, display_h);
+        glClear(GL_COLOR_BUFFER_BIT);
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        glfwSwapBuffers(window);
+
+        if (firstRenderMs == 0.0) {
+            firstRenderMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - openStart).count();
+            std::cout << "Time to first render: " << firstRenderMs << " ms" << std::endl;
+        }
+    }
+
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImPlot::DestroyContext();
+    ImGui::DestroyContext();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
+
 // ==== main ====
-int main() {
+// Аргументы:
+//   --capture file.emgcap   дублировать сырой поток порта в файл захвата
+//   --serial-profile NAME   default | low-latency | throughput (SerialTransport.h)
+//   --replay file.emgcap    вместо порта воспроизвести захват
+//   --speed N               скорость воспроизведения (1 — реальное время, 0 — максимальная)
+//   --view file.emgr        просмотр записи вместо работы с датчиком
+//   --edf file.edf          писать сырой сигнал в EDF+ (--bdf file.bdf — 24-битный BDF+)
+//   --max-fps N             предел частоты кадров (0 — без предела, упор в vsync)
+//   --history-mb N          бюджет памяти истории сеанса для прокрутки (по умолчанию 64 МБ)
+//   --history-hot SEC       несжатый хвост истории (по умолчанию 30 с)
+//   --metrics file.prom     выгружать метрики (текстовый формат Prometheus)
+//   --metrics-interval SEC  период выгрузки метрик (по умолчанию 5 с)
+//   --shm NAME              публиковать живой поток в разделяемой памяти (SharedRing.h)
+//   --udp HOST:PORT         раздавать поток по UDP (адрес multicast-группы — всем подписчикам)
+//   --tcp PORT              раздавать поток подписчикам TCP
+//   --net-batch N           сэмплов в сетевом пакете (по умолчанию 32)
+//   --net-delay MS          неполный пакет уходит через MS мс (по умолчанию 10)
+//   --trace file.json       трасса этапов (Chrome trace event; только в сборке с EMG_TRACE)
+//   --trigger PREFIX        запись окон вокруг событий (клавиша T или кнопка "Trigger"):
+//                           PREFIX_0001.emgr ..., PREFIX_events.csv
+//   --pre SEC / --post SEC  окно до и после триггера (по умолчанию 2 и 3 с)
+//   --threshold X           триггер, когда модуль сигнала достигает X
+//   --trigger-port PORT     триггер — любая датаграмма на 127.0.0.1:PORT
+int main(int argc, char** argv) {
     try {
-        auto ports = ScanPorts();
-        if (ports.empty()) {
-            std::cerr << "No COM ports found!" << std::endl;
-            return -1;
+        std::string capturePath, replayPath, viewPath, edfPath, metricsPath, tracePath, shmName;
+        EdfInfo edfInfo;
+        double replaySpeed = 1.0;
+        double maxFps = 60.0;
+        double metricsInterval = 5.0;
+        SerialOptions serialOptions;
+        SessionHistoryOptions historyOptions;
+        NetStreamOptions netOptions;
+        TriggerOptions triggerOptions;
+        bool triggered = false;
+        int triggerPort = -1;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--capture" && i + 1 < argc) capturePath = argv[++i];
+            else if (arg == "--serial-profile" && i + 1 < argc) {
+                if (!parseSerialProfile(argv[++i], serialOptions.profile))
+                    std::cerr << "Warning: unknown serial profile " << argv[i] << ", using default" << std::endl;
+            }
+            else if (arg == "--replay" && i + 1 < argc) replayPath = argv[++i];
+            else if (arg == "--speed" && i + 1 < argc) replaySpeed = std::atof(argv[++i]);
+            else if (arg == "--view" && i + 1 < argc) viewPath = argv[++i];
+            else if (arg == "--max-fps" && i + 1 < argc) maxFps = std::atof(argv[++i]);
+            else if (arg == "--history-mb" && i + 1 < argc) historyOptions.budgetBytes = (size_t)(std::atof(argv[++i]) * (1 << 20));
+            else if (arg == "--history-hot" && i + 1 < argc) historyOptions.hotSeconds = std::atof(argv[++i]);
+            else if (arg == "--edf" && i + 1 < argc) edfPath = argv[++i];
+            else if (arg == "--metrics" && i + 1 < argc) metricsPath = argv[++i];
+            else if (arg == "--metrics-interval" && i + 1 < argc) metricsInterval = std::atof(argv[++i]);
+            else if (arg == "--trace" && i + 1 < argc) tracePath = argv[++i];
+            else if (arg == "--shm" && i + 1 < argc) shmName = argv[++i];
+            else if (arg == "--udp" && i + 1 < argc) netOptions.udpTarget = argv[++i];
+            else if (arg == "--tcp" && i + 1 < argc) netOptions.tcpPort = std::atoi(argv[++i]);
+            else if (arg == "--net-batch" && i + 1 < argc) netOptions.batchSamples = (uint32_t)std::atoi(argv[++i]);
+            else if (arg == "--net-delay" && i + 1 < argc) netOptions.maxDelayMs = std::atof(argv[++i]);
+            else if (arg == "--trigger" && i + 1 < argc) {
+                triggerOptions.prefix = argv[++i];
+                triggered = true;
+            }
+            else if (arg == "--pre" && i + 1 < argc) triggerOptions.preSeconds = std::atof(argv[++i]);
+            else if (arg == "--post" && i + 1 < argc) triggerOptions.postSeconds = std::atof(argv[++i]);
+            else if (arg == "--threshold" && i + 1 < argc) triggerOptions.threshold = (float)std::atof(argv[++i]);
+            else if (arg == "--trigger-port" && i + 1 < argc) triggerPort = std::atoi(argv[++i]);
+            else if (arg == "--bdf" && i + 1 < argc) {
+                edfPath = argv[++i];
+                edfInfo.format = EdfFormat::Bdf;
+            }
+        }
+        if (!viewPath.empty()) return runViewer(viewPath, maxFps);
+        if (!tracePath.empty()) {
+            if (TRACE_AVAILABLE) traceEnable();
+            else std::cerr << "Warning: built without EMG_TRACE, --trace ignored" << std::endl;
+            traceSetThreadName("ui");
+        }
+
+        std::unique_ptr<SensorEMG> sensor;
+        if (!replayPath.empty()) {
+            sensor = std::make_unique<SensorEMG>(std::make_unique<ReplayTransport>(replayPath, replaySpeed), SAMPLE_RATE);
+        } else {
+            auto ports = ScanPorts();
+            if (ports.empty()) {
+                std::cerr << "No COM ports found!" << std::endl;
+                return -1;
+            }
+            sensor = std::make_unique<SensorEMG>(std::make_unique<SerialTransport>(ports[0], serialOptions), SAMPLE_RATE);
+            if (!capturePath.empty()) sensor->enableCapture(capturePath);
         }
+        sensor->connect();
+        sensor->sendSTART();
 
-        SensorEMG sensor(ports[0]);
-        sensor.connect();
-        sensor.sendSTART();
+        EdfWriter edf;
+        if (!edfPath.empty()) {
+            edfInfo.sampleRate = SAMPLE_RATE;
+            edf.open(edfPath, edfInfo);
+        }
+        SharedRingPublisher shm;
+        if (!shmName.empty()) shm.open(shmName, SAMPLE_RATE, replayPath.empty() ? "serial" : replayPath);
+        NetStreamServer net;
+        if (!netOptions.udpTarget.empty() || netOptions.tcpPort >= 0) net.open(netOptions, SAMPLE_RATE);
+        TriggeredRecorder events;
+        TriggerSocket triggerSocket;
+        if (triggered) {
+            RecordingInfo eventInfo;
+            eventInfo.device = replayPath.empty() ? "serial" : replayPath;
+            eventInfo.sampleRate = SAMPLE_RATE;
+            events.open(triggerOptions, eventInfo);
+            if (triggerPort >= 0) triggerSocket.open(triggerPort);
+        }
 
-        std::thread reader(emg_thread, &sensor);
+        std::unique_ptr<MetricsDumper> dumper;
+        if (!metricsPath.empty()) dumper.reset(new MetricsDumper(globalMetrics(), metricsPath, metricsInterval));
+        MetricHistogram& glassLatencyNs = globalMetrics().histogram("emg_glass_latency_ns", "Port read to frame on screen, ns");
+        std::vector<MetricsRegistry::Sample> metricSamples;    // Для окна статистики
 
         // ==== init GLFW + OpenGL + ImGui ====
         if (!glfwInit()) return 1;
@@ -125,6 +426,9 @@ int main() {
         glfwMakeContextCurrent(window);
         glfwSwapInterval(1);
 
+        renderScheduler.setMaxFps(maxFps);
+        installRedrawCallbacks(window, &renderScheduler);
+
         IMGUI_CHECKVERSION();
         ImGui::CreateContext();
         ImPlot::CreateContext();
@@ -133,9 +437,27 @@ int main() {
         ImGui_ImplGlfw_InitForOpenGL(window, true);
         ImGui_ImplOpenGL3_Init("#version 130");
 
+        HighPassRefilter highPass(buffer_mutex, emg_filtered_plot, SAMPLE_RATE,
+                                  (size_t)((MAX_PLOT_SECONDS + REFILTER_HEADROOM_SECONDS) * SAMPLE_RATE), HIGHPASS_CUTOFF);
+
+        historyOptions.sampleRate = SAMPLE_RATE;
+        SessionHistory history(historyOptions);    // Весь сеанс для прокрутки назад (SessionHistory.h)
+
+        // Поток чтения — после glfwInit: он будит цикл окна через glfwPostEmptyEvent()
+        std::thread reader(emg_thread, sensor.get(), &edf, &shm, &net, &events, &triggerSocket, &highPass, &history);
+
+        std::vector<float> plot_x, plot_y;    // Вершины графика, переиспользуются между кадрами
+        std::vector<int64_t> frame_read_ns;   // Время чтения порций, впервые нарисованных в этом кадре
+        LatencyWindow glassLatency;           // Чтение порта -> кадр на экране
+        double historyMin = 0.0, historyMax = 60.0;    // Видимый участок истории, секунды от начала сеанса
+        bool historyFollow = true;            // Правый край — за последним сэмплом
+        LodSlice historySlice;
+        std::vector<double> historyX;
+
         // ==== Main loop ====
         while (!glfwWindowShouldClose(window)) {
-            glfwPollEvents();
+            if (!waitForFrame(renderScheduler)) continue;
+            EMG_TRACE_SCOPE("frame");    // Кадр ImGui целиком, вместе с glfwSwapBuffers
 
             ImGui_ImplOpenGL3_NewFrame();
             ImGui_ImplGlfw_NewFrame();
@@ -147,52 +469,141 @@ int main() {
             ImGui::SetNextWindowSize(io.DisplaySize);        // размер окна   ImVec2(2000, 1000), ImGuiCond_Always
             ImGuiWindowFlags main_flags = ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoCollapse;
 
+            // Окно и ширина графика задают размер корзин прореживания (LiveDecimator.h)
+            {
+                std::lock_guard<std::mutex> lock(buffer_mutex);
+                emg_plot.setWindow((size_t)(PLOT_SECONDS * SAMPLE_RATE));
+                emg_filtered_plot.setWindow((size_t)(PLOT_SECONDS * SAMPLE_RATE));
+            }
+
             // График 1 (raw)
             ImGui::Begin("EMG Signal");
             ImVec2 plot_size(2000, 500); 
             if (ImPlot::BeginPlot("Realtime EMG", plot_size)) {
-                ImPlot::SetupAxisLimits(ImAxis_X1, 0, MAX_PLOT_POINTS); 
+                ImPlot::SetupAxes("s", nullptr);
+                ImPlot::SetupAxisLimits(ImAxis_X1, 0, PLOT_SECONDS, ImPlotCond_Always); 
                 std::lock_guard<std::mutex> lock(buffer_mutex);
-                if (!emg_buffer.empty()) {
-                    // x-координаты
-                    std::vector<float> x(emg_buffer.size());
-                    for (size_t i = 0; i < x.size(); i++)
-                        x[i] = static_cast<float>(i);
-
+                emg_plot.setColumns((size_t)std::max(1.0f, ImPlot::GetPlotSize().x));
+                int n = (int)emg_plot.build(plot_x, plot_y);
+                frame_read_ns.insert(frame_read_ns.end(), pending_read_ns.begin(), pending_read_ns.end());
+                pending_read_ns.clear();
+                if (n > 0) {
+                    for (float& x : plot_x) x /= SAMPLE_RATE;    // Сэмплы -> секунды
                     // Здесь сейчас рисуется сырой сигнал
-                    ImPlot::PlotLine("Raw EMG", x.data(), emg_buffer.data(), emg_buffer.size());
-                    // std::cout << emg_filtered_buffer.size() << std::endl;
-                    // std::cout << sensor.getSampleRate() << std::endl;
+                    ImPlot::PlotLine("Raw EMG", plot_x.data(), plot_y.data(), n);
                 }
                 ImPlot::EndPlot();
             }
 
             // График 2 (filtered)
             if (ImPlot::BeginPlot("Filtered EMG", plot_size)) {
-                ImPlot::SetupAxisLimits(ImAxis_X1, 0, MAX_PLOT_POINTS);    // Ограничение диапазонов осей
+                ImPlot::SetupAxes("s", nullptr);
+                ImPlot::SetupAxisLimits(ImAxis_X1, 0, PLOT_SECONDS, ImPlotCond_Always);    // Ограничение диапазонов осей
                 ImPlot::SetupAxisLimits(ImAxis_Y1, -400, 400); 
                 std::lock_guard<std::mutex> lock(buffer_mutex);
-                if (!emg_filtered_buffer.empty()) {
-                    std::vector<float> x(emg_filtered_buffer.size());
-                    for (size_t i = 0; i < x.size(); i++) x[i] = static_cast<float>(i);
-
-                    ImPlot::PlotLine("Filtered", x.data(), emg_filtered_buffer.data(), (int)emg_filtered_buffer.size());
+                emg_filtered_plot.setColumns((size_t)std::max(1.0f, ImPlot::GetPlotSize().x));
+                int n = (int)emg_filtered_plot.build(plot_x, plot_y);
+                if (n > 0) {
+                    for (float& x : plot_x) x /= SAMPLE_RATE;
+                    ImPlot::PlotLine("Filtered", plot_x.data(), plot_y.data(), n);
                 }
                 ImPlot::EndPlot();
             } 
 
             ImGui::SliderFloat("float", &HIGHPASS_CUTOFF, 0.1f, SAMPLE_RATE/2);    // Слайдер для регуляции нижней частоты обрезки
+            highPass.setCutoff(HIGHPASS_CUTOFF);    // Окно перефильтруется в фоне, график подменится целиком
+            ImGui::SliderFloat("window, s", &PLOT_SECONDS, MIN_PLOT_SECONDS, MAX_PLOT_SECONDS, "%.0f",
+                               ImGuiSliderFlags_Logarithmic);    // Длина окна живого графика
+            if (edf.isOpen() && ImGui::Button("Marker")) markerRequested = true;         // Метка в EDF на текущем сэмпле
+            // История сеанса: прокрутка и зум назад до начала сеанса (в пределах бюджета памяти)
+            if (ImGui::CollapsingHeader("Session history")) {
+                ImGui::Checkbox("follow", &historyFollow);
+                const double historyEnd = (double)history.getTotalSamples() / SAMPLE_RATE;
+                if (historyFollow) {
+                    const double span = historyMax - historyMin;
+                    historyMax = historyEnd;
+                    historyMin = historyEnd - span;
+                }
+                if (ImPlot::BeginPlot("History", plot_size)) {
+                    ImPlot::SetupAxes("s", nullptr);
+                    ImPlot::SetupAxisLinks(ImAxis_X1, &historyMin, &historyMax);
+                    ImPlotRect limits = ImPlot::GetPlotLimits();
+                    size_t width = (size_t)std::max(1.0f, ImPlot::GetPlotSize().x);
+                    history.query(0, limits.X.Min * SAMPLE_RATE, limits.X.Max * SAMPLE_RATE, width, historySlice);
+                    if (ImPlot::IsPlotHovered() && (ImGui::IsMouseDragging(ImGuiMouseButton_Left) || io.MouseWheel != 0.0f))
+                        historyFollow = false;    // Пользователь ушёл назад — не тянуть к концу
+
+                    historyX.resize(historySlice.x.size());
+                    for (size_t i = 0; i < historyX.size(); ++i) historyX[i] = historySlice.x[i] / SAMPLE_RATE;
+                    int n = (int)historyX.size();
+                    if (historySlice.raw) {
+                        ImPlot::PlotLine("EMG", historyX.data(), historySlice.mean.data(), n);
+                    } else {
+                        ImPlot::PlotShaded("min/max", historyX.data(), historySlice.min.data(), historySlice.max.data(), n);
+                        ImPlot::PlotLine("mean", historyX.data(), historySlice.mean.data(), n);
+                    }
+                    ImPlot::EndPlot();
+                }
+            }
+            if (events.isOpen()) {
+                if (edf.isOpen()) ImGui::SameLine();
+                bool key = !io.WantCaptureKeyboard && ImGui::IsKeyPressed(ImGuiKey_T, false);
+                if (ImGui::Button("Trigger") || key) events.trigger(TriggerSource::Manual);    // Окно вокруг текущего сэмпла
+            }
 
             ImGui::End();
 
             // --- Текстовое окно для вывода частоты дискретизации и общего количества собранных сэмплов --- 
             ImGui::SetNextWindowPos(ImVec2(1020, 10), ImGuiCond_Always);
-            ImGui::SetNextWindowSize(ImVec2(240, 80), ImGuiCond_Always);
-            ImGuiWindowFlags small_flags = ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoCollapse;
+            ImGui::SetNextWindowSizeConstraints(ImVec2(240, 0), ImVec2(FLT_MAX, FLT_MAX));
+            ImGuiWindowFlags small_flags = ImGuiWindowFlags_NoMove | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoCollapse;
             ImGui::Begin("Stats", nullptr, small_flags);
 
-            ImGui::Text("Sample rate: %.1f Hz", measuredSampleRate);
-            ImGui::Text("Samples: %zu", emg_buffer.size());
+            if (portFailed) ImGui::Text("Port error: reading stopped");
+            ImGui::Text("Sample rate: %.1f Hz", measuredSampleRate.load());
+            ImGui::Text("Lost: %llu, duplicates: %llu", (unsigned long long)lostSamples.load(),
+                        (unsigned long long)duplicateFrames.load());
+            ImGui::Text("Drift: %+.1f ppm, jitter %.2f ms", clockDriftPpm.load(), arrivalJitterMs.load());
+            ImGui::Text("Latency p50 %.1f ms, p99 %.1f ms", glassLatency.percentile(0.5) / 1e6,
+                        glassLatency.percentile(0.99) / 1e6);
+            {
+                RefilterStats filterStats = highPass.getStats();
+                ImGui::Text("High-pass %.1f Hz, refiltered %llu samples in %.1f ms", filterStats.cutoff,
+                            (unsigned long long)filterStats.lastSamples, filterStats.lastNs / 1e6);
+            }
+            if (events.isOpen()) {
+                TriggerStats eventStats = events.getStats();
+                ImGui::Text("Events: %llu%s, retriggers %llu", (unsigned long long)eventStats.events,
+                            eventStats.active ? " (recording)" : "", (unsigned long long)eventStats.retriggers);
+            }
+            {
+                std::lock_guard<std::mutex> lock(buffer_mutex);
+                ImGui::Text("Samples: %llu (bin %zu)", (unsigned long long)emg_plot.getTotalSamples(),
+                            emg_plot.getBinSamples());
+            }
+            {
+                SessionHistoryStats historyStats = history.getStats();
+                ImGui::Text("History %.1f / %.0f MB: samples from %.0f s, summary from %.0f s",
+                            history.sizeBytes() / (1024.0 * 1024.0), historyOptions.budgetBytes / (1024.0 * 1024.0),
+                            historyStats.rawFromSample / (double)SAMPLE_RATE, historyStats.oldestSample / (double)SAMPLE_RATE);
+            }
+            if (ImGui::CollapsingHeader("Metrics")) {
+                globalMetrics().snapshot(metricSamples);
+                for (const MetricsRegistry::Sample& m : metricSamples) {
+                    switch (m.kind) {
+                        case MetricKind::Counter:
+                            ImGui::Text("%s %llu", m.name.c_str(), (unsigned long long)m.counter);
+                            break;
+                        case MetricKind::Gauge:
+                            ImGui::Text("%s %lld", m.name.c_str(), (long long)m.gauge);
+                            break;
+                        case MetricKind::Histogram:
+                            ImGui::Text("%s n=%llu p50 %.0f p99 %.0f", m.name.c_str(), (unsigned long long)m.histogram.count,
+                                        m.histogram.percentile(0.5), m.histogram.percentile(0.99));
+                            break;
+                    }
+                }
+            }
 
             ImGui::End(); // конец маленького окна
 
@@ -202,12 +613,31 @@ int main() {
             glViewport(0, 0, display_w, display_h);
             glClear(GL_COLOR_BUFFER_BIT);
             ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-            glfwSwapBuffers(window);
+            {
+                EMG_TRACE_SCOPE("swap");    // С vsync — ожидание смены кадра
+                glfwSwapBuffers(window);
+            }
+
+            // С vsync swap возвращается после смены кадра — ближайшая к "стеклу" точка
+            const int64_t shownNs = hostNowNs();
+            for (int64_t readNs : frame_read_ns) {
+                glassLatency.add(shownNs - readNs);
+                glassLatencyNs.record((uint64_t)(shownNs - readNs));
+            }
+            frame_read_ns.clear();
         }
 
         // cleanup
         running = false;
         reader.join();
+        bool wasEdf = edf.isOpen();
+        edf.close();
+        if (wasEdf) publishWriterMetrics(globalMetrics(), "edf", edf.getWriterStats());
+        shm.close();
+        net.close();
+        events.close();
+        if (dumper) dumper->stop();    // Последняя выгрузка — с итогами
+        if (traceIsEnabled() && !traceWriteJson(tracePath)) std::cerr << "Warning: cannot write trace " << tracePath << std::endl;
         ImGui_ImplOpenGL3_Shutdown();
         ImGui_ImplGlfw_Shutdown();
         ImPlot::DestroyContext();